@@ -5,6 +5,10 @@
 #include <fstream>
 #include <algorithm>
 #include <sstream>
+#include <new>
+#include <ctime>
+#include <cmath>
+#include <random>
 #ifdef HAS_GOTOOLS
 	#include <GoTools/geometry/SplineSurface.h>
 	#include <GoTools/trivariate/SplineVolume.h>
@@ -14,11 +18,26 @@
 #include "LRSpline/LRSplineVolume.h"
 #include "LRSpline/Profiler.h"
 #include "LRSpline/Element.h"
+#include "LRSpline/Basisfunction.h"
+#include "LRSpline/BasisWorkspace.h"
 #include "LRSpline/MeshRectangle.h"
 
 using namespace LR;
 using namespace std;
 
+// count all heap allocations done by this program (used by the -alloc mode)
+static long allocCount = 0;
+void* operator new(size_t size) {
+	allocCount++;
+	void *p = malloc(size);
+	if(p == NULL)
+		throw std::bad_alloc();
+	return p;
+}
+void operator delete(void *p) noexcept {
+	free(p);
+}
+
 int main(int argc, char **argv) {
 #ifdef TIME_LRSPLINE
 	Profiler prof(argv[0]);
@@ -35,6 +54,13 @@ int main(int argc, char **argv) {
 	int dim             = 3;
 	bool rat            = false;
 	bool vol            = false;
+	bool allocTest      = false;
+	bool kernelTest     = false;
+	bool bezierTest     = false;
+	int  nFields        = 0;
+	bool batchTest      = false;
+	int  gridSize       = 0;
+	int  simd           = -1;
 	char *lrInitMesh    = NULL;
 	stringstream parameters;
 	parameters << " parameters: \n" \
@@ -48,6 +74,13 @@ int main(int argc, char **argv) {
 	              "   -n     <n>  number of basis functions in all parametric directions\n" \
 	              "   -it    <n>  number of evaluation points per element\n" \
 	              "   -in:   <s>  make the LRSplineSurface <s> the initial mesh\n"\
+	              "   -alloc      count heap allocations per Basisfunction evaluation\n"\
+	              "   -kernel     time Basisfunction evaluation for all derivative levels up to 3\n"\
+	              "   -bezier     compare point() against evaluation from the cached Bezier elements\n"\
+	              "   -field <n>  time evaluation of n fields at once against n single-field evaluations\n"\
+	              "   -batch      compare per-point evaluation against batch evaluation of all points (surfaces only)\n"\
+	              "   -grid  <n>  compare per-point evaluation against tensor grid evaluation on n points per direction\n"\
+	              "   -simd  <n>  restrict vectorized evaluation to instruction set n (0=none, 1=SSE2, 2=AVX2, 3=AVX-512)\n"\
 	              "   -help       display (this) help screen\n";
 	parameters << " default values\n";
 	parameters << "   -p   = { " << p1 << ", " << p2 << ", " << p3 << " }\n";
@@ -81,6 +114,20 @@ int main(int argc, char **argv) {
 			lrInitMesh = argv[i]+4;
 		} else if(strcmp(argv[i], "-vol") == 0) {
 			vol = true;
+		} else if(strcmp(argv[i], "-alloc") == 0) {
+			allocTest = true;
+		} else if(strcmp(argv[i], "-kernel") == 0) {
+			kernelTest = true;
+		} else if(strcmp(argv[i], "-bezier") == 0) {
+			bezierTest = true;
+		} else if(strcmp(argv[i], "-field") == 0) {
+			nFields = atoi(argv[++i]);
+		} else if(strcmp(argv[i], "-batch") == 0) {
+			batchTest = true;
+		} else if(strcmp(argv[i], "-grid") == 0) {
+			gridSize = atoi(argv[++i]);
+		} else if(strcmp(argv[i], "-simd") == 0) {
+			simd = atoi(argv[++i]);
 		} else if(strcmp(argv[i], "-help") == 0) {
 			cout << "usage: " << argv[0] << "[parameters] " << endl << parameters.str();
 			exit(0);
@@ -91,7 +138,13 @@ int main(int argc, char **argv) {
 	}
 
 	// do some error testing on input
-	if(n1 < p1) {
+	if(batchTest && vol) {
+		cerr << "ERROR: batch evaluation only available for surfaces\n";
+		exit(2);
+	} else if(simd >= 0 && !Basisfunction::setInstructionSet((simdInstructionSet) simd)) {
+		cerr << "ERROR: instruction set " << simd << " not supported on this machine\n";
+		exit(2);
+	} else if(n1 < p1) {
 		cerr << "ERROR: n1 must be greater or equal to p1\n";
 		exit(2);
 	} else if(n2 < p2) {
@@ -159,13 +212,324 @@ int main(int argc, char **argv) {
 	}
 	lr->generateIDs();
 
+	int maxDerivs = max(p1,p2);
+	if(vol) maxDerivs = max(maxDerivs, p3);
+	maxDerivs -= 2;
+
+	// ---------------- Count heap allocations per function evaluation  --------------
+	if(allocTest) {
+		vector<double> values;
+		long nCalls = 0;
+		long nAlloc = 0;
+		double sum  = 0;
+		for(int pass=0; pass<2; pass++) { // first pass warms up any reusable buffers
+			nCalls     = 0;
+			allocCount = 0;
+			for(Element *el : lr->getAllElements()) {
+				double u = (el->getParmin(0) + el->getParmax(0))/2.0;
+				double v = (el->getParmin(1) + el->getParmax(1))/2.0;
+				double w = (vol) ? (el->getParmin(2) + el->getParmax(2))/2.0 : 0.0;
+				for(Basisfunction *b : el->support()) {
+					for(int i=0; i<it; i++, nCalls++) {
+						if(vol)
+							b->evaluate(values, u,v,w, maxDerivs);
+						else
+							b->evaluate(values, u,v,   maxDerivs);
+						sum += values[0];
+					}
+				}
+			}
+			nAlloc = allocCount;
+		}
+		cout << "evaluate(vector&, ..., " << maxDerivs << " derivs): " << (double) nAlloc / nCalls << " allocations per call" << endl;
+
+		nCalls     = 0;
+		allocCount = 0;
+		for(Element *el : lr->getAllElements()) {
+			double u = (el->getParmin(0) + el->getParmax(0))/2.0;
+			double v = (el->getParmin(1) + el->getParmax(1))/2.0;
+			double w = (vol) ? (el->getParmin(2) + el->getParmax(2))/2.0 : 0.0;
+			for(Basisfunction *b : el->support()) {
+				for(int i=0; i<it; i++, nCalls++) {
+					if(vol)
+						sum += b->evaluate(u,v,w);
+					else
+						sum += b->evaluate(u,v);
+				}
+			}
+		}
+		nAlloc = allocCount;
+		cout << "evaluate(u,v[,w])                 : " << (double) nAlloc / nCalls << " allocations per call" << endl;
+
+		BasisWorkspace workspace;
+		double parPt[3];
+		bool   fromRight[] = {true, true, true};
+		values.resize(Basisfunction::nDerivatives(lr->nVariate(), maxDerivs));
+		for(int pass=0; pass<2; pass++) {
+			nCalls     = 0;
+			allocCount = 0;
+			for(Element *el : lr->getAllElements()) {
+				parPt[0] = (el->getParmin(0) + el->getParmax(0))/2.0;
+				parPt[1] = (el->getParmin(1) + el->getParmax(1))/2.0;
+				parPt[2] = (vol) ? (el->getParmin(2) + el->getParmax(2))/2.0 : 0.0;
+				for(Basisfunction *b : el->support()) {
+					for(int i=0; i<it; i++, nCalls++) {
+						b->evaluate(values.data(), parPt, maxDerivs, fromRight, workspace);
+						sum += values[0];
+					}
+				}
+			}
+			nAlloc = allocCount;
+		}
+		cout << "evaluate(double*, ..., workspace) : " << (double) nAlloc / nCalls << " allocations per call" << endl;
+		cout << "(checksum " << sum << ")" << endl;
+		exit(0);
+	}
+
+
+	// ---------------- Time the evaluation of single basis functions  --------------
+	if(kernelTest) {
+		BasisWorkspace workspace;
+		vector<double> values(Basisfunction::nDerivatives(lr->nVariate(), 3));
+		double parPt[3];
+		bool   fromRight[] = {true, true, true};
+		double sum = 0;
+		for(int derivs=0; derivs<=3; derivs++) {
+			long nCalls = 0;
+			clock_t start = clock();
+			for(Element *el : lr->getAllElements()) {
+				for(Basisfunction *b : el->support()) {
+					for(int i=0; i<it; i++, nCalls++) {
+						for(int d=0; d<lr->nVariate(); d++)
+							parPt[d] = el->getParmin(d) + (i+0.5)/it * (el->getParmax(d)-el->getParmin(d));
+						b->evaluate(values.data(), parPt, derivs, fromRight, workspace);
+						sum += values[0];
+					}
+				}
+			}
+			double time = (double) (clock()-start) / CLOCKS_PER_SEC;
+			cout << "evaluate " << derivs << " derivs: " << 1e9*time/nCalls << " ns per call (" << nCalls << " calls)" << endl;
+		}
+		cout << "(checksum " << sum << ")" << endl;
+		exit(0);
+	}
+
+	// ---------------- Time evaluation of many fields at once  --------------
+	if(nFields > 0) {
+		int nBasis = lr->nBasisFunctions();
+		int nRes   = (vol) ? (maxDerivs+1)*(maxDerivs+2)*(maxDerivs+3)/6 : (maxDerivs+1)*(maxDerivs+2)/2;
+		vector<double> coefs(nBasis*nFields); // column major, so that each field is also a valid single-field array
+		for(uint i=0; i<coefs.size(); i++)
+			coefs[i] = (i*839 % 853) / 853.0;
+		vector<double> all(nRes*nFields), one(nRes);
+		double maxDiff = 0;
+		double timeAll = 0;
+		double timeOne = 0;
+		for(Element *el : lr->getAllElements()) {
+			for(int i=0; i<it; i++) {
+				double u = el->getParmin(0) + (i+0.5)/it * (el->getParmax(0)-el->getParmin(0));
+				double v = el->getParmin(1) + (i+0.5)/it * (el->getParmax(1)-el->getParmin(1));
+				double w = (vol) ? el->getParmin(2) + (i+0.5)/it * (el->getParmax(2)-el->getParmin(2)) : 0;
+				clock_t start = clock();
+				if(vol)
+					lrv->pointField(all.data(), coefs.data(), nFields, u, v, w, maxDerivs, el->getId(), COLUMN_MAJOR);
+				else
+					lrs->pointField(all.data(), coefs.data(), nFields, u, v,    maxDerivs, el->getId(), COLUMN_MAJOR);
+				clock_t mid = clock();
+				for(int f=0; f<nFields; f++) {
+					if(vol)
+						lrv->pointField(one.data(), &coefs[f*nBasis], 1, u, v, w, maxDerivs, el->getId());
+					else
+						lrs->pointField(one.data(), &coefs[f*nBasis], 1, u, v,    maxDerivs, el->getId());
+					for(int d=0; d<nRes; d++)
+						maxDiff = max(maxDiff, fabs(one[d] - all[d*nFields+f]));
+				}
+				timeAll += (double) (mid    -start) / CLOCKS_PER_SEC;
+				timeOne += (double) (clock()-mid  ) / CLOCKS_PER_SEC;
+			}
+		}
+		cout << "Evaluated " << nFields << " fields with " << maxDerivs << " derivatives on " << it*lr->nElements() << " points" << endl;
+		cout << "All fields at once  : " << timeAll << " s" << endl;
+		cout << "One field at a time : " << timeOne << " s" << endl;
+		cout << "max difference      : " << maxDiff << endl;
+		exit(0);
+	}
+
+	// ---------------- Compare point() and Bezier evaluation, before and after refinement  --------------
+	if(bezierTest) {
+		for(int pass=0; pass<2; pass++) {
+			if(pass == 1) { // refine every third element; should invalidate all affected Bezier elements
+				vector<int> elements;
+				for(int i=0; i<lr->nElements(); i+=3)
+					elements.push_back(i);
+				lr->refineElement(elements);
+				lr->generateIDs();
+				cout << "Refined to " << lr->nElements() << " elements" << endl;
+			}
+			vector<double> u, v, w;
+			for(Element *el : lr->getAllElements()) {
+				for(int i=0; i<it; i++) {
+					u.push_back(el->getParmin(0) + (i+0.5)/it          * (el->getParmax(0)-el->getParmin(0)));
+					v.push_back(el->getParmin(1) + ((i*7)%it + 0.5)/it * (el->getParmax(1)-el->getParmin(1)));
+					if(vol)
+						w.push_back(el->getParmin(2) + ((i*3)%it + 0.5)/it * (el->getParmax(2)-el->getParmin(2)));
+				}
+			}
+			int nPts = u.size();
+			vector<vector<double> > resPoint, resBezier;
+			double maxDiff = 0;
+			double timePoint  = 0;
+			double timeBezier[2];
+			for(int run=0; run<2; run++) { // first run fills the cache
+				clock_t start = clock();
+				for(int i=0; i<nPts; i++) {
+					if(vol)
+						lrv->pointBezier(resBezier, u[i], v[i], w[i], maxDerivs);
+					else
+						lrs->pointBezier(resBezier, u[i], v[i], maxDerivs);
+				}
+				timeBezier[run] = (double) (clock()-start) / CLOCKS_PER_SEC;
+			}
+			clock_t start = clock();
+			for(int i=0; i<nPts; i++) {
+				if(vol)
+					lrv->point(resPoint, u[i], v[i], w[i], maxDerivs);
+				else
+					lrs->point(resPoint, u[i], v[i], maxDerivs);
+			}
+			timePoint = (double) (clock()-start) / CLOCKS_PER_SEC;
+			for(int i=0; i<nPts; i++) {
+				if(vol) {
+					lrv->point(      resPoint,  u[i], v[i], w[i], maxDerivs);
+					lrv->pointBezier(resBezier, u[i], v[i], w[i], maxDerivs);
+				} else {
+					lrs->point(      resPoint,  u[i], v[i], maxDerivs);
+					lrs->pointBezier(resBezier, u[i], v[i], maxDerivs);
+				}
+				for(uint d=0; d<resPoint.size(); d++)
+					for(int j=0; j<dim; j++)
+						maxDiff = max(maxDiff, fabs(resPoint[d][j]-resBezier[d][j]) / max(1.0, fabs(resPoint[d][j])));
+			}
+			cout << "Evaluated " << nPts << " points with " << maxDerivs << " derivatives" << endl;
+			cout << "point()                      : " << timePoint     << " s" << endl;
+			cout << "pointBezier() (filling cache): " << timeBezier[0] << " s" << endl;
+			cout << "pointBezier() (cached)       : " << timeBezier[1] << " s" << endl;
+			cout << "max relative difference      : " << maxDiff       << endl;
+		}
+		exit(0);
+	}
+
+	// ---------------- Compare per-point and batch evaluation on scattered points  --------------
+	if(batchTest) {
+		// 'it' points in each element, visited in random order
+		vector<double> u, v;
+		for(Element *el : lr->getAllElements()) {
+			for(int i=0; i<it; i++) {
+				u.push_back(el->umin() + (i+0.5)/it                * (el->umax()-el->umin()));
+				v.push_back(el->vmin() + ((i*7)%it + 0.5)/it       * (el->vmax()-el->vmin()));
+			}
+		}
+		int nPts = u.size();
+		vector<int> perm(nPts);
+		for(int i=0; i<nPts; i++)
+			perm[i] = i;
+		shuffle(perm.begin(), perm.end(), mt19937(nPts));
+		vector<double> uu(nPts), vv(nPts);
+		for(int i=0; i<nPts; i++) {
+			uu[i] = u[perm[i]];
+			vv[i] = v[perm[i]];
+		}
+
+		int nRes = (maxDerivs+1)*(maxDerivs+2)/2;
+		vector<double> perPoint(nPts*nRes*dim);
+		vector<double> batch(nPts*nRes*dim);
+		vector<vector<double> > res;
+
+		clock_t start = clock();
+		{
+		PROFILE("per-point");
+		for(int i=0; i<nPts; i++) {
+			lrs->point(res, uu[i], vv[i], maxDerivs);
+			for(int d=0; d<nRes; d++)
+				for(int j=0; j<dim; j++)
+					perPoint[(i*nRes+d)*dim+j] = res[d][j];
+		}
+		}
+		double timePerPoint = (double) (clock()-start) / CLOCKS_PER_SEC;
+
+		start = clock();
+		{
+		PROFILE("batch");
+		lrs->points(batch.data(), uu.data(), vv.data(), nPts, maxDerivs);
+		}
+		double timeBatch = (double) (clock()-start) / CLOCKS_PER_SEC;
+
+		double maxDiff = 0;
+		for(int i=0; i<nPts*nRes*dim; i++)
+			maxDiff = max(maxDiff, fabs(perPoint[i]-batch[i]));
+		cout << "Evaluated " << nPts << " points with " << maxDerivs << " derivatives" << endl;
+		cout << "per-point evaluation: " << timePerPoint << " s" << endl;
+		cout << "batch evaluation    : " << timeBatch    << " s" << endl;
+		cout << "max difference      : " << maxDiff      << endl;
+		exit(0);
+	}
+
+	// ---------------- Compare per-point and tensor grid evaluation  --------------
+	if(gridSize > 0) {
+		int nVar = lr->nVariate();
+		vector<double> grid[3];
+		for(int d=0; d<nVar; d++)
+			for(int i=0; i<gridSize; i++)
+				grid[d].push_back(lr->startparam(d) + (lr->endparam(d)-lr->startparam(d)) * i / (gridSize-1.0));
+		int nPts = (vol) ? gridSize*gridSize*gridSize : gridSize*gridSize;
+		int nRes = (vol) ? (maxDerivs+1)*(maxDerivs+2)*(maxDerivs+3)/6 : (maxDerivs+1)*(maxDerivs+2)/2;
+		vector<double> perPoint(nPts*nRes*dim);
+		vector<double> gridResult;
+		vector<vector<double> > res;
+
+		clock_t start = clock();
+		{
+		PROFILE("per-point");
+		int n = 0;
+		for(int k=0; k<((vol)?gridSize:1); k++) {
+			for(int j=0; j<gridSize; j++) {
+				for(int i=0; i<gridSize; i++, n++) {
+					if(vol)
+						lrv->point(res, grid[0][i], grid[1][j], grid[2][k], maxDerivs);
+					else
+						lrs->point(res, grid[0][i], grid[1][j], maxDerivs);
+					for(int d=0; d<nRes; d++)
+						for(int c=0; c<dim; c++)
+							perPoint[(n*nRes+d)*dim+c] = res[d][c];
+				}
+			}
+		}
+		}
+		double timePerPoint = (double) (clock()-start) / CLOCKS_PER_SEC;
+
+		start = clock();
+		{
+		PROFILE("grid");
+		if(vol)
+			lrv->gridEvaluate(grid[0], grid[1], grid[2], maxDerivs, gridResult);
+		else
+			lrs->gridEvaluate(grid[0], grid[1], maxDerivs, gridResult);
+		}
+		double timeGrid = (double) (clock()-start) / CLOCKS_PER_SEC;
+
+		double maxDiff = 0;
+		for(int i=0; i<nPts*nRes*dim; i++)
+			maxDiff = max(maxDiff, fabs(perPoint[i]-gridResult[i]));
+		cout << "Evaluated " << nPts << " grid points with " << maxDerivs << " derivatives" << endl;
+		cout << "per-point evaluation: " << timePerPoint << " s" << endl;
+		cout << "grid evaluation     : " << timeGrid     << " s" << endl;
+		cout << "max difference      : " << maxDiff      << endl;
+		exit(0);
+	}
 
 	// ---------------- Do evaluation on known elements  --------------
 	vector<vector<double> > result;
 	vector<double> pt;
-	int maxDerivs = max(p1,p2);
-	if(vol) maxDerivs = max(maxDerivs, p3);
-	maxDerivs -= 2;
 	char string[256];
 	bool firstPrint = true;
 	for(Element *el : lr->getAllElements()) {
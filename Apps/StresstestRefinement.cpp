@@ -4,6 +4,8 @@
 #include <string.h>
 #include <fstream>
 #include <cmath>
+#include <ctime>
+#include <new>
 #include "LRSpline/LRSplineSurface.h"
 #include "LRSpline/LRSplineVolume.h"
 #include "LRSpline/Profiler.h"
@@ -14,6 +16,28 @@
 using namespace LR;
 using namespace std;
 
+// count all heap allocations, to see how many the object pools of the splines save
+static long nAllocations   = 0;
+static long nDeallocations = 0;
+
+void* operator new(size_t size) {
+	nAllocations++;
+	void *p = malloc(size);
+	if(p == NULL)
+		throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void *p) noexcept {
+	if(p != NULL)
+		nDeallocations++;
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+	operator delete(p);
+}
+
 int main(int argc, char **argv) {
 #ifdef TIME_LRSPLINE
 	Profiler prof(argv[0]);
@@ -27,8 +51,12 @@ int main(int argc, char **argv) {
 	 * splits the bottom left corner by introducing 3 new corner functions for
 	 * each successively inserted cross. The knotlines are distributed uniformely
 	 * throughout the lower left element
+	 *
+	 * LONGLINE refinement
+	 * inserts one long line of constant v, followed by many short lines with the
+	 * same constant v, each between two new lines spanning all of v (surfaces only)
 	 */
-	enum refinement_scheme {UNIFORM, CORNER, DIAGONAL} refinement_scheme;
+	enum refinement_scheme {UNIFORM, CORNER, DIAGONAL, LONGLINE} refinement_scheme;
 
 	// set default parameter values
 	int goalBasisFunctions = 15000;
@@ -58,6 +86,7 @@ int main(int argc, char **argv) {
 	                  "   -unif      UNIFORM refinemen scheme\n"\
 	                  "   -corner    CORNER refinemen scheme\n"\
 	                  "   -diag      DIAGONAL refinemen scheme\n"\
+	                  "   -longline  LONGLINE refinemen scheme\n"\
 	                  "   -vol       create a LRSplineVolume instead of Surface\n"\
 	                  "   -dumpfile  writes an eps- and txt-file of the LR-mesh\n"\
 	                  "   -help      display (this) help screen\n"\
@@ -92,6 +121,8 @@ int main(int argc, char **argv) {
 			refinement_scheme = CORNER;
 		else if(strcmp(argv[i], "-diag") == 0)
 			refinement_scheme = DIAGONAL;
+		else if(strcmp(argv[i], "-longline") == 0)
+			refinement_scheme = LONGLINE;
 		else if(strcmp(argv[i], "-vol") == 0)
 			vol = true;
 		else if(strcmp(argv[i], "-dumpfile") == 0)
@@ -115,6 +146,9 @@ int main(int argc, char **argv) {
 	} else if(n3 < p3) {
 		cerr << "ERROR: n3 must be greater or equal to p3\n";
 		exit(2);
+	} else if(vol && refinement_scheme == LONGLINE) {
+		cerr << "ERROR: the LONGLINE scheme is for surfaces only\n";
+		exit(2);
 	}
 
 	// make a uniform integer knot vector
@@ -139,6 +173,7 @@ int main(int argc, char **argv) {
 	// make two identical surfaces
 	LRSplineVolume  *lv=nullptr;
 	LRSplineSurface *lr=nullptr;
+	long allocConstruct = nAllocations;
 	if(vol)
 		lv = new LRSplineVolume(n1, n2, n3, p1, p2, p3, knot_u.begin(), knot_v.begin(), knot_w.begin(), cp.begin(), dim, rat);
 	else
@@ -157,7 +192,14 @@ int main(int argc, char **argv) {
 	double v = h/2.0;
 	double w = h/2.0;
 	double unif_step_h = 1.0 / ((goalBasisFunctions - nBasis) / 3.0 + 1.0);
+	long allocRefine   = nAllocations;
+	allocConstruct     = allocRefine - allocConstruct;
 	int iter = 0;
+	// time per inserted line each time the number of lines doubles, to see how refinement scales with the mesh size
+	vector<int>    scaleLines, scaleBasis;
+	vector<double> scaleTime;
+	clock_t scaleStart = clock();
+	int     nInserted  = 0;
 	if(vol) {
 		nBasis     = lv->nBasisFunctions();
 		nElements  = lv->nElements();
@@ -236,6 +278,18 @@ int main(int argc, char **argv) {
 				v = h/2.0;
 				w = h/2.0;
 			}
+		} else if(refinement_scheme == LONGLINE) {
+			// the lines spanning v add about n2 functions each, so the short lines fill the right half in one pass
+			double step = (end1 - floor(end1/2.0)) / (goalBasisFunctions/n2 + 1.0);
+			if(iter == 0) {
+				u = floor(end1/2.0);
+				lr->insert_const_v_edge(v, 0, u);
+			}
+			lr->insert_const_u_edge(u+step, 0, end2);
+			if(iter % 2 == 1) // leave a gap to the previous short line, so that they are not merged
+				lr->insert_const_v_edge(v, u, u+step);
+			u += step;
+			iter++;
 		}
 
 		if(vol) {
@@ -247,6 +301,14 @@ int main(int argc, char **argv) {
 			nElements  = lr->nElements();
 			nMeshlines = lr->nMeshlines();
 		}
+		nInserted += (refinement_scheme == UNIFORM) ? 1 : (refinement_scheme == LONGLINE) ? 1 + (iter%2 == 0) : (vol) ? 3 : 2;
+		if(scaleLines.empty() || nMeshlines >= 2*scaleLines.back() || nBasis >= goalBasisFunctions) {
+			scaleLines.push_back(nMeshlines);
+			scaleBasis.push_back(nBasis);
+			scaleTime.push_back((double) (clock()-scaleStart) / CLOCKS_PER_SEC / nInserted);
+			scaleStart = clock();
+			nInserted  = 0;
+		}
 
 		if (system("clear")) ;
 		cout << "LR type                  : " << ((vol)?"Volume":"Surface") << endl;
@@ -254,6 +316,7 @@ int main(int argc, char **argv) {
 		if(refinement_scheme == UNIFORM) cout << "UNIFORM\n";
 		else if(refinement_scheme == CORNER) cout << "CORNER\n";
 		else if(refinement_scheme == DIAGONAL) cout << "DIAGONAL\n";
+		else if(refinement_scheme == LONGLINE) cout << "LONGLINE\n";
 		cout << "GOAL basis functions     : " << goalBasisFunctions << endl;
 		cout << "=================================================" << endl;
 		cout << endl;
@@ -262,6 +325,8 @@ int main(int argc, char **argv) {
 		cout << "Number of meshlines      : " << nMeshlines         << endl;
 	}
 
+	allocRefine = nAllocations - allocRefine;
+
 	// harvest some statistics and display these results
 	double avgBasisToElement = 0;
 	double avgBasisToLine    = 0;
@@ -310,6 +375,17 @@ int main(int argc, char **argv) {
 	cout <<                                      " (" << hashCodePercentage*100 << " %)"  << endl;
 
 
+	cout << endl;
+	cout << "Refinement scaling: " << endl;
+	cout << "-------------------------------------------------------------" << endl;
+	cout << "Meshlines  Basis functions  ms per inserted line" << endl;
+	for(uint i=0; i<scaleLines.size(); i++) {
+		char line[128];
+		sprintf(line, "%9d  %15d  %20.4f", scaleLines[i], scaleBasis[i], scaleTime[i]*1000);
+		cout << line << endl;
+	}
+	cout << endl;
+
 	if(dumpFile) {
 		cout << endl;
 		cout << "Written";
@@ -329,5 +405,20 @@ int main(int argc, char **argv) {
 
 		cout << " stresstest.lr\n";
 	}
+
+	long    freeTeardown = nDeallocations;
+	clock_t start        = clock();
+	delete lr;
+	delete lv;
+	double  timeTeardown = (double) (clock()-start) / CLOCKS_PER_SEC;
+	freeTeardown         = nDeallocations - freeTeardown;
+
+	cout << endl;
+	cout << "Heap allocations: " << endl;
+	cout << "-------------------------------------------------------------" << endl;
+	cout << "Allocations constructing the spline  : " << allocConstruct << endl;
+	cout << "Allocations during refinement        : " << allocRefine    << endl;
+	// the pools give back whole slabs, so what is left is the few large containers and the vectors of the meshrectangles
+	cout << "Frees when deleting the spline       : " << freeTeardown   << " (" << timeTeardown << " s)" << endl;
 }
 
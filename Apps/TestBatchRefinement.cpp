@@ -0,0 +1,391 @@
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <map>
+#include <chrono>
+#include <thread>
+#include <iomanip>
+#include "LRSpline/LRSplineSurface.h"
+#include "LRSpline/LRSplineVolume.h"
+#include "LRSpline/Element.h"
+#include "LRSpline/Basisfunction.h"
+#include "LRSpline/Meshline.h"
+#include "LRSpline/MeshRectangle.h"
+
+using namespace LR;
+using namespace std;
+
+typedef vector<double> Knots;
+
+/************************************************************************************************************************//**
+ * \brief Returns the wall clock time in seconds since some fixed point
+ ***************************************************************************************************************************/
+double wallTime() {
+	return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/************************************************************************************************************************//**
+ * \brief Returns the meshlines (or meshrectangles) in the order they are stored, each given by its exact end points,
+ *        direction and multiplicity
+ ***************************************************************************************************************************/
+vector<Knots> getMesh(LRSpline *lr) {
+	vector<Knots> result;
+	if(lr->nVariate() == 2) {
+		for(Meshline *m : static_cast<LRSplineSurface*>(lr)->getAllMeshlines())
+			result.push_back({m->const_par_, m->start_, m->stop_, (double) m->span_u_line_, (double) m->multiplicity_});
+	} else {
+		for(MeshRectangle *m : static_cast<LRSplineVolume*>(lr)->getAllMeshRectangles()) {
+			Knots rect(m->start_);
+			rect.insert(rect.end(), m->stop_.begin(), m->stop_.end());
+			rect.push_back(m->multiplicity_);
+			result.push_back(rect);
+		}
+	}
+	return result;
+}
+
+/************************************************************************************************************************//**
+ * \brief Returns the corners of an element, which identifies it
+ ***************************************************************************************************************************/
+Knots getBox(const Element *el) {
+	Knots box;
+	for(int d=0; d<el->getDim(); d++) {
+		box.push_back(el->getParmin(d));
+		box.push_back(el->getParmax(d));
+	}
+	return box;
+}
+
+/************************************************************************************************************************//**
+ * \brief Returns all knots of a basis function, which identifies it
+ ***************************************************************************************************************************/
+Knots getKnots(const Basisfunction *b) {
+	Knots knots;
+	for(int d=0; d<b->nVariate(); d++)
+		knots.insert(knots.end(), (*b)[d].begin(), (*b)[d].end());
+	return knots;
+}
+
+/************************************************************************************************************************//**
+ * \brief Compares the result of sequential and batched refinement
+ * \returns The number of differences found
+ ***************************************************************************************************************************/
+int compare(LRSpline *seq, LRSpline *batch) {
+	int nWrong = 0;
+
+	// the mesh and the elements should be exactly the same, and stored in the same order
+	vector<Knots> seqMesh   = getMesh(seq);
+	vector<Knots> batchMesh = getMesh(batch);
+	if(seqMesh != batchMesh) {
+		cout << "Meshlines differ: " << seqMesh.size() << " vs " << batchMesh.size() << endl;
+		nWrong++;
+	}
+	int nElementsWrong = 0;
+	if(seq->nElements() != batch->nElements())
+		nElementsWrong = max(seq->nElements(), batch->nElements());
+	else
+		for(int i=0; i<seq->nElements(); i++)
+			if(getBox(seq->getElement(i)) != getBox(batch->getElement(i)))
+				nElementsWrong++;
+	if(nElementsWrong > 0) {
+		cout << "Elements differ: " << nElementsWrong << " of " << seq->nElements() << " vs " << batch->nElements() << endl;
+		nWrong += nElementsWrong;
+	}
+
+	// the functions are the same up to their order, and roundoff in the control points
+	map<Knots, const Basisfunction*> seqBasis;
+	for(int i=0; i<seq->nBasisFunctions(); i++)
+		seqBasis[getKnots(seq->getBasisfunction(i))] = seq->getBasisfunction(i);
+	if(seq->nBasisFunctions() != batch->nBasisFunctions()) {
+		cout << "Number of basis functions differ: " << seq->nBasisFunctions() << " vs " << batch->nBasisFunctions() << endl;
+		nWrong++;
+	}
+	// functions found in only one of them count as one difference each
+	int nMatched = 0;
+	for(int i=0; i<batch->nBasisFunctions(); i++) {
+		const Basisfunction *b = batch->getBasisfunction(i);
+		map<Knots, const Basisfunction*>::iterator it = seqBasis.find(getKnots(b));
+		if(it == seqBasis.end()) {
+			nWrong++;
+			continue;
+		}
+		nMatched++;
+		const Basisfunction *s = it->second;
+		bool same = fabs(s->w() - b->w()) < 1e-12;
+		for(int k=0; k<b->dim(); k++)
+			same &= fabs(s->cp(k) - b->cp(k)) < 1e-10;
+		// support, given by the element boxes
+		vector<Knots> seqSupport, batchSupport;
+		for(Element *el : s->support())
+			seqSupport.push_back(getBox(el));
+		for(Element *el : b->support())
+			batchSupport.push_back(getBox(el));
+		sort(seqSupport.begin(),   seqSupport.end());
+		sort(batchSupport.begin(), batchSupport.end());
+		same &= (seqSupport == batchSupport);
+		if(!same)
+			nWrong++;
+	}
+	nWrong += seqBasis.size() - nMatched;
+	for(int i=0; i<batch->nElements(); i++) {
+		Element *el = batch->getElement(i);
+		int nSupport = 0;
+		for(Basisfunction *b : el->support())
+			if(find(b->support().begin(), b->support().end(), el) != b->support().end())
+				nSupport++;
+		if(nSupport != el->nBasisFunctions())
+			nWrong++;
+	}
+	return nWrong;
+}
+
+/************************************************************************************************************************//**
+ * \brief Returns a copy of a surface or volume
+ ***************************************************************************************************************************/
+LRSpline* copy(LRSpline *lr) {
+	if(lr->nVariate() == 3)
+		return static_cast<LRSplineVolume*>(lr)->copy();
+	return static_cast<LRSplineSurface*>(lr)->copy();
+}
+
+/************************************************************************************************************************//**
+ * \brief Returns true if a point is within a distance r of the center of one of the n^d boxes evenly dividing [0,L]^d
+ ***************************************************************************************************************************/
+bool inRegion(const vector<double> &pt, int n, double L, double r) {
+	double dist2 = 0;
+	for(double x : pt) {
+		double h = L / n;
+		double c = (floor(x/h) + 0.5) * h;
+		dist2 += (x-c)*(x-c);
+	}
+	return dist2 < r*r;
+}
+
+/************************************************************************************************************************//**
+ * \brief Returns the number of differences between two splines refined the same way, which should be exactly equal
+ ***************************************************************************************************************************/
+int compareExact(LRSpline *a, LRSpline *b) {
+	if(a->nBasisFunctions() != b->nBasisFunctions() || a->nElements() != b->nElements())
+		return 1;
+	int nWrong = 0;
+	for(int i=0; i<a->nBasisFunctions(); i++) {
+		const Basisfunction *f = a->getBasisfunction(i);
+		const Basisfunction *g = b->getBasisfunction(i);
+		bool same = getKnots(f) == getKnots(g) && f->w() == g->w() && f->nSupportedElements() == g->nSupportedElements();
+		for(int k=0; k<f->dim(); k++)
+			same &= f->cp(k) == g->cp(k);
+		if(!same)
+			nWrong++;
+	}
+	return nWrong;
+}
+
+int main(int argc, char **argv) {
+
+	// set default parameter values
+	int p         = 3;
+	int n         = 6;
+	int iter      = 6;
+	int mult      = 1;
+	int strat     = 0;
+	double beta   = 0.15;
+	int threads   = 1;
+	int regions   = 0;
+	bool vol      = false;
+	bool scaling  = false;
+	string parameters(" parameters: \n" \
+	                  "   -p     <n> polynomial ORDER (degree+1) in all parametric directions\n" \
+	                  "   -n     <n> number of basis functions in all parametric directions\n" \
+	                  "   -iter  <n> number of refinement iterations\n" \
+	                  "   -mult  <n> multiplicity of the new meshlines\n" \
+	                  "   -strat <n> refinement strategy: 0 fullspan, 1 minspan, 2 structured mesh (refining basis functions)\n" \
+	                  "   -beta  <t> fraction of the elements (or functions) refined in every iteration\n" \
+	                  "   -threads <n> number of threads used by the batched refinement\n" \
+	                  "   -regions <n> refine around the centers of n^d separate regions instead of a random fraction\n" \
+	                  "   -scaling   time the batched refinement on 1, 2, 4, 8 (and all available) threads\n" \
+	                  "   -vol       test a trivariate volume instead of a surface\n" \
+	                  "   -help      display (this) help information\n");
+
+	// read input
+	for(int i=1; i<argc; i++) {
+		if(strcmp(argv[i], "-p") == 0)
+			p = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-n") == 0)
+			n = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-iter") == 0)
+			iter = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-mult") == 0)
+			mult = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-strat") == 0)
+			strat = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-beta") == 0)
+			beta = atof(argv[++i]);
+		else if(strcmp(argv[i], "-threads") == 0)
+			threads = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-regions") == 0)
+			regions = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-scaling") == 0)
+			scaling = true;
+		else if(strcmp(argv[i], "-vol") == 0)
+			vol = true;
+		else if(strcmp(argv[i], "-help") == 0) {
+			cout << "usage: " << argv[0] << endl << parameters;
+			exit(0);
+		} else {
+			cerr << "usage: " << argv[0] << endl << parameters;
+			exit(1);
+		}
+	}
+
+	if(scaling && vol) {
+		cerr << "Volumes are refined on one thread, -scaling only applies to surfaces" << endl;
+		exit(1);
+	}
+	vector<int> scaleThreads; // the thread counts timed by -scaling
+	if(scaling) {
+		for(int t=1; t<=8; t*=2)
+			scaleThreads.push_back(t);
+		if(thread::hardware_concurrency() > 8)
+			scaleThreads.push_back(thread::hardware_concurrency());
+	}
+	vector<double> scaleTime(scaleThreads.size(), 0.0);
+	// volumes refuse batch refinement (see LRSpline::setBatchRefinement()), so the "batched" volume is refined the same way
+	if(vol)
+		cout << "Volumes insert their meshrectangles one by one, the batched volume is refined sequentially" << endl;
+
+	// make a uniform integer knot vector and some control points
+	vector<double> knot(n+p);
+	for(int i=0; i<p+n; i++)
+		knot[i] = (i<p) ? 0 : (i>n) ? n-p+1 : i-p+1;
+	vector<double> cp((vol) ? 3*n*n*n : 2*n*n);
+	for(size_t i=0; i<cp.size(); i++)
+		cp[i] = (i*839 % 853) / 853.0;
+
+	LRSpline *seq;
+	if(vol)
+		seq = new LRSplineVolume(n, n, n, p, p, p, knot.begin(), knot.begin(), knot.begin(), cp.begin(), 3);
+	else
+		seq = new LRSplineSurface(n, n, p, p, knot.begin(), knot.begin(), cp.begin(), 2);
+	enum refinementStrategy refStrat = (strat == 0) ? LR_FULLSPAN : (strat == 1) ? LR_MINSPAN : LR_STRUCTURED_MESH;
+	seq->setRefStrat(refStrat);
+	seq->setRefMultiplicity(mult);
+
+	// refine the same elements (or functions) of two equal splines in every iteration, picking them by a fixed pseudo-random
+	// sequence or around fixed points. The batched one is thrown away afterwards, since the functions come in a different order, and strategies
+	// choosing between functions (e.g. minspan) would then pick differently in the next iteration
+	double timeSeq   = 0;
+	double timeBatch = 0;
+	int nWrong = 0;
+	for(int it=0; it<iter; it++) {
+		LRSpline *batch  = copy(seq);
+		LRSpline *single = (threads > 1) ? copy(seq) : NULL;
+		batch->setRefStrat(refStrat);
+		batch->setRefMultiplicity(mult);
+		if(!vol) {
+			batch->setBatchRefinement(true);
+			batch->setRefinementThreads(threads);
+		}
+		if(single != NULL) {
+			single->setRefStrat(refStrat);
+			single->setRefMultiplicity(mult);
+			single->setBatchRefinement(!vol);
+		}
+		vector<LRSpline*> scaled;
+		for(int t : scaleThreads) {
+			scaled.push_back(copy(seq));
+			scaled.back()->setRefStrat(refStrat);
+			scaled.back()->setRefMultiplicity(mult);
+			scaled.back()->setBatchRefinement(true);
+			scaled.back()->setRefinementThreads(t);
+		}
+
+		seq->generateIDs();
+		vector<int> marked;
+		int nMarkable = (refStrat == LR_STRUCTURED_MESH) ? seq->nBasisFunctions() : seq->nElements();
+		for(int i=0; i<nMarkable; i++) {
+			if(regions > 0) {
+				// the center of the element, or of the function support
+				vector<double> mid;
+				for(int d=0; d<seq->nVariate(); d++) {
+					if(refStrat == LR_STRUCTURED_MESH)
+						mid.push_back(((*seq->getBasisfunction(i))[d][0] + (*seq->getBasisfunction(i))[d][p]) / 2);
+					else
+						mid.push_back(seq->getElement(i)->midpoint()[d]);
+				}
+				double L = n-p+1;
+				if(inRegion(mid, regions, L, L/regions/4/pow(1.5, it)))
+					marked.push_back(i);
+			} else if(((i+it)*7919 % 1000) < 1000*beta) {
+				marked.push_back(i);
+			}
+		}
+
+		double start = wallTime();
+		if(refStrat == LR_STRUCTURED_MESH)
+			seq->refineBasisFunction(marked);
+		else
+			seq->refineElement(marked);
+		timeSeq += wallTime() - start;
+		start = wallTime();
+		if(refStrat == LR_STRUCTURED_MESH)
+			batch->refineBasisFunction(marked);
+		else
+			batch->refineElement(marked);
+		timeBatch += wallTime() - start;
+
+		seq->generateIDs();
+		batch->generateIDs();
+		nWrong += compare(seq, batch);
+
+		// the result of batched refinement does not depend on the number of threads
+		if(single != NULL) {
+			if(refStrat == LR_STRUCTURED_MESH)
+				single->refineBasisFunction(marked);
+			else
+				single->refineElement(marked);
+			single->generateIDs();
+			int nDiff = compareExact(single, batch);
+			if(nDiff > 0)
+				cout << nDiff << " differences between batched refinement on 1 and " << threads << " threads" << endl;
+			nWrong += nDiff;
+			delete single;
+		}
+
+		// the same refinement on an increasing number of threads
+		for(size_t k=0; k<scaled.size(); k++) {
+			start = wallTime();
+			if(refStrat == LR_STRUCTURED_MESH)
+				scaled[k]->refineBasisFunction(marked);
+			else
+				scaled[k]->refineElement(marked);
+			scaleTime[k] += wallTime() - start;
+			scaled[k]->generateIDs();
+			int nDiff = compareExact(scaled[k], batch);
+			if(nDiff > 0)
+				cout << nDiff << " differences between batched refinement on " << threads << " and " << scaleThreads[k] << " threads" << endl;
+			nWrong += nDiff;
+			delete scaled[k];
+		}
+		delete batch;
+	}
+	cout << "Refined to " << seq->nElements() << " elements and " << seq->nBasisFunctions() << " basis functions" << endl;
+	cout << "Refinement time: sequential " << timeSeq << " s, batched " << timeBatch << " s" << endl;
+	if(scaling) {
+		cout << "Batched refinement scaling (" << thread::hardware_concurrency() << " hardware threads available):" << endl;
+		cout << "  threads   time (s)   speedup" << endl;
+		for(size_t k=0; k<scaleThreads.size(); k++)
+			cout << setw(9) << scaleThreads[k] << setw(11) << setprecision(4) << scaleTime[k]
+			     << setw(10) << setprecision(3) << scaleTime[0] / scaleTime[k] << endl;
+	}
+
+	if(nWrong == 0)
+		cout << "Batched refinement matches sequential refinement" << endl;
+	else
+		cout << nWrong << " differences between batched and sequential refinement" << endl;
+
+	delete seq;
+	exit(nWrong > 0);
+}
@@ -0,0 +1,261 @@
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <chrono>
+#include <iostream>
+#include <set>
+#include <thread>
+#include "LRSpline/LRSplineSurface.h"
+#include "LRSpline/LRSplineVolume.h"
+#include "LRSpline/Element.h"
+
+using namespace LR;
+using namespace std;
+
+/************************************************************************************************************************//**
+ * \brief Looks up all points with the current element locator of the spline
+ * \param lr The spline
+ * \param par All parametric points, stored as [point][parametric direction]
+ * \param repeat Number of times to look up all points (for timing)
+ * \param[out] result The element containing each point
+ * \returns The average time per lookup in nanoseconds
+ ***************************************************************************************************************************/
+double lookupAll(const LRSpline *lr, const vector<double> &par, int repeat, vector<int> &result) {
+	int parDim = lr->nVariate();
+	int nPts   = par.size() / parDim;
+	result.resize(nPts);
+	clock_t start = clock();
+	for(int r=0; r<repeat; r++)
+		for(int i=0; i<nPts; i++)
+			result[i] = lr->getElementContaining(vector<double>(&par[i*parDim], &par[(i+1)*parDim]));
+	return (double) (clock()-start) / CLOCKS_PER_SEC / repeat / nPts * 1e9;
+}
+
+/************************************************************************************************************************//**
+ * \brief Looks up all points at once with getElementsContaining()
+ * \param lr The spline
+ * \param par All parametric points, stored as [point][parametric direction]
+ * \param repeat Number of times to look up all points (for timing)
+ * \param nThreads Number of threads to use
+ * \param[out] result The element containing each point
+ * \returns The average time per lookup in nanoseconds (wall time)
+ ***************************************************************************************************************************/
+double lookupBatch(const LRSpline *lr, const vector<double> &par, int repeat, int nThreads, vector<int> &result) {
+	int parDim = lr->nVariate();
+	int nPts   = par.size() / parDim;
+	vector<vector<double> > coord(parDim, vector<double>(nPts));
+	for(int i=0; i<nPts; i++)
+		for(int d=0; d<parDim; d++)
+			coord[d][i] = par[i*parDim+d];
+	result.resize(nPts);
+	const LRSplineSurface *lrs = dynamic_cast<const LRSplineSurface*>(lr);
+	const LRSplineVolume  *lrv = dynamic_cast<const LRSplineVolume*>(lr);
+	auto start = chrono::steady_clock::now();
+	for(int r=0; r<repeat; r++) {
+		if(lrv)
+			lrv->getElementsContaining(coord[0].data(), coord[1].data(), coord[2].data(), nPts, result.data(), nThreads);
+		else
+			lrs->getElementsContaining(coord[0].data(), coord[1].data(), nPts, result.data(), nThreads);
+	}
+	return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / repeat / nPts;
+}
+
+/************************************************************************************************************************//**
+ * \brief Creates a uniform spline with n basis functions of order p in all parametric directions
+ ***************************************************************************************************************************/
+LRSpline* makeSpline(bool vol, int p, int n) {
+	vector<double> knot(n+p);
+	for(int i=0; i<p+n; i++)
+		knot[i] = (i<p) ? 0 : (i>n) ? n-p+1 : i-p+1;
+	vector<double> cp((vol) ? 3*n*n*n : 2*n*n);
+	for(uint i=0; i<cp.size(); i++)
+		cp[i] = (i*839 % 853) / 853.0;
+	if(vol)
+		return new LRSplineVolume(n, n, n, p, p, p, knot.begin(), knot.begin(), knot.begin(), cp.begin(), 3);
+	return new LRSplineSurface(n, n, p, p, knot.begin(), knot.begin(), cp.begin(), 2);
+}
+
+/************************************************************************************************************************//**
+ * \brief Refines all elements inside [0,corner]^d
+ ***************************************************************************************************************************/
+void refineCorner(LRSpline *lr, double corner) {
+	vector<int> elements;
+	for(int i=0; i<lr->nElements(); i++) {
+		bool inside = true;
+		for(int d=0; d<lr->nVariate(); d++)
+			inside &= lr->getElement(i)->getParmax(d) <= corner;
+		if(inside)
+			elements.push_back(i);
+	}
+	lr->refineElement(elements);
+}
+
+int main(int argc, char **argv) {
+
+	// set default parameter values
+	int p      = 3;
+	int n      = 8;
+	int levels = 6;
+	int nPts   = 20000;
+	int repeat = 5;
+	bool vol   = false;
+	string parameters(" parameters: \n" \
+	                  "   -p      <n> polynomial ORDER (degree+1) in all parametric directions\n" \
+	                  "   -n      <n> number of basis functions in all parametric directions\n" \
+	                  "   -levels <n> number of times the lower left corner is refined\n" \
+	                  "   -pts    <n> number of random lookup points\n" \
+	                  "   -repeat <n> number of times the lookups are repeated for timing\n" \
+	                  "   -vol        test a trivariate volume instead of a surface\n" \
+	                  "   -help       display (this) help information\n");
+
+	// read input
+	for(int i=1; i<argc; i++) {
+		if(strcmp(argv[i], "-p") == 0)
+			p = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-n") == 0)
+			n = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-levels") == 0)
+			levels = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-pts") == 0)
+			nPts = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-repeat") == 0)
+			repeat = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-vol") == 0)
+			vol = true;
+		else if(strcmp(argv[i], "-help") == 0) {
+			cout << "usage: " << argv[0] << endl << parameters;
+			exit(0);
+		} else {
+			cerr << "usage: " << argv[0] << endl << parameters;
+			exit(1);
+		}
+	}
+
+	// one spline which is only looked up after all refinement is done, and one for each locator type which is looked up
+	// between every refinement (as in an adaptive loop), so that the lookup structure is maintained during refinement
+	LRSpline *lr = makeSpline(vol, p, n);
+	LRSpline *adaptive[2];
+	for(int t=0; t<2; t++) {
+		adaptive[t] = makeSpline(vol, p, n);
+		adaptive[t]->setElementLocator((t==0) ? LOCATOR_GRID : LOCATOR_TREE);
+	}
+	int parDim = lr->nVariate();
+
+	// refine towards the lower left corner, halving the refined region for every level
+	double corner = n-p+1;
+	for(int level=0; level<levels; level++) {
+		corner /= 2;
+		refineCorner(lr, corner);
+		for(int t=0; t<2; t++) {
+			adaptive[t]->getElementContaining(vector<double>(parDim, corner/2));
+			refineCorner(adaptive[t], corner);
+		}
+	}
+
+	// lookup points: all element corners and midpoints (to test the element edges), and random points with most of them in
+	// the refined corner
+	vector<double> par;
+	for(Element *el : lr->getAllElements())
+		for(int i=0; i<(1<<parDim); i++)
+			for(int d=0; d<parDim; d++)
+				par.push_back((i & (1<<d)) ? el->getParmax(d) : el->getParmin(d));
+	for(Element *el : lr->getAllElements())
+		for(int d=0; d<parDim; d++)
+			par.push_back((el->getParmin(d) + el->getParmax(d)) / 2);
+	unsigned long seed = 12345;
+	for(int i=0; i<nPts; i++) {
+		double scale = (i%2) ? corner*4 : n-p+1;
+		for(int d=0; d<parDim; d++) {
+			seed = (seed * 1103515245 + 12345) % 2147483648ul;
+			par.push_back(scale * seed / 2147483648.0);
+		}
+	}
+
+	// some points outside the domain as well
+	for(int i=0; i<parDim; i++) {
+		for(int d=0; d<parDim; d++)
+			par.push_back((d == i) ? -0.5 : 0.5);
+		for(int d=0; d<parDim; d++)
+			par.push_back((d == i) ? n-p+1.5 : 0.5);
+	}
+
+	// time both locators
+	int nThreads = max(2u, thread::hardware_concurrency());
+	vector<int> gridResult, treeResult, adaptiveResult, batchResult;
+	size_t memory[2];
+	double timeBuild[2], timeLookup[2], timeBatch[2], timeThreaded[2];
+	long nWrong = 0;
+	const char *name[] = {"grid", "tree"};
+	for(int t=0; t<2; t++) {
+		lr->setElementLocator((t==0) ? LOCATOR_GRID : LOCATOR_TREE);
+		clock_t start = clock();
+		lr->getElementContaining(vector<double>(parDim, 0.0));
+		timeBuild[t]  = (double) (clock()-start) / CLOCKS_PER_SEC;
+		memory[t]     = lr->elementLocatorMemory();
+		timeLookup[t] = lookupAll(lr, par, repeat, (t==0) ? gridResult : treeResult);
+		const vector<int> &single = (t==0) ? gridResult : treeResult;
+		timeBatch[t]    = lookupBatch(lr, par, repeat, 1, batchResult);
+		if(batchResult != single)
+			nWrong++;
+		timeThreaded[t] = lookupBatch(lr, par, repeat, nThreads, batchResult);
+		if(batchResult != single)
+			nWrong++;
+	}
+	int nInside = 0;
+	for(uint i=0; i<gridResult.size(); i++) {
+		if(gridResult[i] != treeResult[i])
+			nWrong++;
+		if(gridResult[i] >= 0)
+			nInside++;
+	}
+	if(nInside != (int) gridResult.size() - 2*parDim)
+		nWrong++;
+
+	// the locators maintained during refinement should be identical to the ones built from scratch
+	for(int t=0; t<2; t++) {
+		if(adaptive[t]->nElements() != lr->nElements())
+			nWrong++;
+		lookupAll(adaptive[t], par, 1, adaptiveResult);
+		for(uint i=0; i<gridResult.size(); i++)
+			if(gridResult[i] != adaptiveResult[i])
+				nWrong++;
+	}
+
+	// neighbours of all elements on all faces
+	int nNeighbours = 0;
+	LRSplineVolume *lrv = dynamic_cast<LRSplineVolume*>(lr);
+	if(lrv) {
+		lrv->setElementLocator(LOCATOR_GRID);
+		LRSplineVolume *grid = dynamic_cast<LRSplineVolume*>(adaptive[0]);
+		LRSplineVolume *tree = dynamic_cast<LRSplineVolume*>(adaptive[1]);
+		parameterEdge faces[] = {WEST, EAST, SOUTH, NORTH, BOTTOM, TOP};
+		for(int iEl=0; iEl<lr->nElements(); iEl++) {
+			for(parameterEdge face : faces) {
+				set<int> fromScratch = lrv->getElementNeighbours(iEl, face);
+				if(fromScratch != grid->getElementNeighbours(iEl, face) || fromScratch != tree->getElementNeighbours(iEl, face))
+					nWrong++;
+				nNeighbours += fromScratch.size();
+			}
+		}
+	}
+
+	cout << "Refined to " << lr->nElements() << " elements" << endl;
+	for(int t=0; t<2; t++)
+		cout << name[t] << " locator: " << memory[t] << " bytes, built in " << timeBuild[t] << " s, "
+		     << timeLookup[t] << " ns per lookup, " << timeBatch[t] << " ns per batched lookup ("
+		     << timeThreaded[t] << " ns with " << nThreads << " threads)" << endl;
+	if(nWrong == 0) {
+		cout << "Tree locator agrees with grid locator on " << nInside << " points";
+		if(lrv)
+			cout << " and " << nNeighbours << " neighbours";
+		cout << endl;
+		cout << "Locators updated during refinement agree with the ones built from scratch" << endl;
+		cout << "Batched lookup agrees with single lookups" << endl;
+	} else {
+		cout << "Element locator FAILED (" << nWrong << " mismatches)" << endl;
+	}
+	delete lr;
+	delete adaptive[0];
+	delete adaptive[1];
+	exit(nWrong == 0 ? 0 : 1);
+}
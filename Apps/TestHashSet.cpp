@@ -0,0 +1,182 @@
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <algorithm>
+#include "LRSpline/LRSplineSurface.h"
+#include "LRSpline/LRSplineVolume.h"
+#include "LRSpline/Element.h"
+#include "LRSpline/Basisfunction.h"
+#include "LRSpline/FlatHashSet.h"
+#include "LRSpline/MapHashSet.h"
+
+using namespace LR;
+using namespace std;
+
+/************************************************************************************************************************//**
+ * \brief Runs the container operations used during refinement on one HashSet type, and checks their results
+ * \param functions All basis functions of a refined spline
+ * \param copies Copies of the same functions (equal, but different objects)
+ * \param elements All elements of the spline, one set is created for the support of each of them
+ * \param repeat Number of times to run everything (for timing)
+ * \param[out] time The time in seconds used for one run
+ * \param[out] contents The functions in the set after erasing every other one, as seen by iterating over it
+ * \returns The number of results which are not as expected
+ ***************************************************************************************************************************/
+template<class Set>
+long exercise(const vector<Basisfunction*> &functions, const vector<Basisfunction*> &copies, const vector<Element*> &elements,
+              int repeat, double &time, vector<Basisfunction*> &contents) {
+	long nWrong = 0;
+	int  n      = functions.size();
+	clock_t start = clock();
+	for(int r=0; r<repeat; r++) {
+		// many small sets, like the element supports
+		vector<Set> support(elements.size());
+		for(uint i=0; i<elements.size(); i++)
+			for(Basisfunction *b : elements[i]->support())
+				support[i].insert(b);
+		for(uint i=0; i<elements.size(); i++)
+			if(support[i].size() != elements[i]->nBasisFunctions())
+				nWrong++;
+
+		// and one large set, like the basis
+		Set basis;
+		for(Basisfunction *b : functions)
+			basis.insert(b);
+		for(Basisfunction *b : copies)
+			basis.insert(b);
+		if(basis.size() != n)
+			nWrong++;
+		for(int i=0; i<n; i++)
+			if(basis.find(copies[i]) == basis.end() || *basis.find(copies[i]) != functions[i])
+				nWrong++;
+		for(int i=0; i<n; i+=2)
+			if(basis.erase(copies[i]) != 1 || basis.erase(functions[i]) != 0)
+				nWrong++;
+		for(int i=0; i<n; i+=2)
+			if(basis.find(functions[i]) != basis.end())
+				nWrong++;
+		contents.clear();
+		for(Basisfunction *b : basis)
+			contents.push_back(b);
+		if((int) contents.size() != n/2 || basis.size() != n/2)
+			nWrong++;
+		for(int i=0; i<n; i+=2)
+			basis.insert(functions[i]);
+		int nPopped = 0;
+		while(basis.pop() != NULL)
+			nPopped++;
+		if(nPopped != n || basis.size() != 0 || basis.begin() != basis.end())
+			nWrong++;
+	}
+	time = (double) (clock()-start) / CLOCKS_PER_SEC / repeat;
+	sort(contents.begin(), contents.end());
+	return nWrong;
+}
+
+/************************************************************************************************************************//**
+ * \brief Refines all elements inside [0,corner]^d
+ ***************************************************************************************************************************/
+void refineCorner(LRSpline *lr, double corner) {
+	vector<int> elements;
+	for(int i=0; i<lr->nElements(); i++) {
+		bool inside = true;
+		for(int d=0; d<lr->nVariate(); d++)
+			inside &= lr->getElement(i)->getParmax(d) <= corner;
+		if(inside)
+			elements.push_back(i);
+	}
+	lr->refineElement(elements);
+}
+
+int main(int argc, char **argv) {
+
+	// set default parameter values
+	int p      = 3;
+	int n      = 8;
+	int levels = 6;
+	int repeat = 5;
+	bool vol   = false;
+	string parameters(" parameters: \n" \
+	                  "   -p      <n> polynomial ORDER (degree+1) in all parametric directions\n" \
+	                  "   -n      <n> number of basis functions in all parametric directions\n" \
+	                  "   -levels <n> number of times the lower left corner is refined\n" \
+	                  "   -repeat <n> number of times the container operations are repeated for timing\n" \
+	                  "   -vol        test a trivariate volume instead of a surface\n" \
+	                  "   -help       display (this) help information\n");
+
+	// read input
+	for(int i=1; i<argc; i++) {
+		if(strcmp(argv[i], "-p") == 0)
+			p = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-n") == 0)
+			n = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-levels") == 0)
+			levels = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-repeat") == 0)
+			repeat = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-vol") == 0)
+			vol = true;
+		else if(strcmp(argv[i], "-help") == 0) {
+			cout << "usage: " << argv[0] << endl << parameters;
+			exit(0);
+		} else {
+			cerr << "usage: " << argv[0] << endl << parameters;
+			exit(1);
+		}
+	}
+
+	// make a uniform integer knot vector and some control points
+	vector<double> knot(n+p);
+	for(int i=0; i<p+n; i++)
+		knot[i] = (i<p) ? 0 : (i>n) ? n-p+1 : i-p+1;
+	vector<double> cp((vol) ? 3*n*n*n : 2*n*n);
+	for(uint i=0; i<cp.size(); i++)
+		cp[i] = (i*839 % 853) / 853.0;
+	LRSpline *lr;
+	if(vol)
+		lr = new LRSplineVolume(n, n, n, p, p, p, knot.begin(), knot.begin(), knot.begin(), cp.begin(), 3);
+	else
+		lr = new LRSplineSurface(n, n, p, p, knot.begin(), knot.begin(), cp.begin(), 2);
+
+	// refine towards the lower left corner with the HashSet the library is compiled with. Build the library with and
+	// without LRSPLINE_MAP_HASHSET to compare the two
+	clock_t start = clock();
+	double corner = n-p+1;
+	for(int level=0; level<levels; level++) {
+		corner /= 2;
+		refineCorner(lr, corner);
+	}
+	double timeRefine = (double) (clock()-start) / CLOCKS_PER_SEC;
+#ifdef LRSPLINE_MAP_HASHSET
+	const char *active = "MapHashSet";
+#else
+	const char *active = "FlatHashSet";
+#endif
+	cout << "Refined to " << lr->nElements() << " elements and " << lr->nBasisFunctions() << " basis functions" << endl;
+	cout << "Refinement time using " << active << ": " << timeRefine << " s" << endl;
+
+	// run the same container operations on both types
+	vector<Basisfunction*> functions, copies;
+	for(Basisfunction *b : lr->getAllBasisfunctions()) {
+		functions.push_back(b);
+		copies.push_back(b->copy());
+	}
+	double timeFlat, timeMap;
+	vector<Basisfunction*> contentsFlat, contentsMap;
+	long nWrong = 0;
+	nWrong += exercise<FlatHashSet<Basisfunction*> >(functions, copies, lr->getAllElements(), repeat, timeFlat, contentsFlat);
+	nWrong += exercise<MapHashSet<Basisfunction*> > (functions, copies, lr->getAllElements(), repeat, timeMap,  contentsMap);
+	if(contentsFlat != contentsMap)
+		nWrong++;
+	cout << "Container operations: FlatHashSet " << timeFlat << " s, MapHashSet " << timeMap << " s" << endl;
+
+	if(nWrong == 0)
+		cout << "FlatHashSet and MapHashSet agree on " << functions.size() << " basis functions and " << lr->nElements() << " element supports" << endl;
+	else
+		cout << "HashSet FAILED (" << nWrong << " errors)" << endl;
+	for(Basisfunction *b : copies)
+		delete b;
+	delete lr;
+	exit(nWrong == 0 ? 0 : 1);
+}
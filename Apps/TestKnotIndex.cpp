@@ -0,0 +1,189 @@
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include "LRSpline/LRSplineSurface.h"
+#include "LRSpline/LRSplineVolume.h"
+#include "LRSpline/Element.h"
+#include "LRSpline/Basisfunction.h"
+
+using namespace LR;
+using namespace std;
+
+/************************************************************************************************************************//**
+ * \brief Refines all elements inside [0,corner]^d
+ ***************************************************************************************************************************/
+void refineCorner(LRSpline *lr, double corner) {
+	vector<int> elements;
+	for(int i=0; i<lr->nElements(); i++) {
+		bool inside = true;
+		for(int d=0; d<lr->nVariate(); d++)
+			inside &= lr->getElement(i)->getParmax(d) <= corner;
+		if(inside)
+			elements.push_back(i);
+	}
+	lr->refineElement(elements);
+}
+
+/************************************************************************************************************************//**
+ * \brief Describes all functions (knots, control point and weight) and elements (bounds and number of functions) of a spline
+ *        as a sorted list of strings, which does not depend on the order the functions are stored in
+ ***************************************************************************************************************************/
+vector<string> describe(LRSpline *lr) {
+	vector<string> result;
+	for(Basisfunction *b : lr->getAllBasisfunctions()) {
+		ostringstream out;
+		out.precision(17);
+		for(int d=0; d<b->nVariate(); d++)
+			for(double t : (*b)[d])
+				out << t << " ";
+		// the control points and weights are averaged when functions coincide, which is only exact up to round-off since
+		// the order of the functions (and thus of the additions) depends on their hash codes when using MapHashSet
+		out.precision(10);
+		for(int i=0; i<b->dim(); i++)
+			out << b->cp(i) << " ";
+		out << b->w();
+		result.push_back(out.str());
+	}
+	for(Element *e : lr->getAllElements()) {
+		ostringstream out;
+		out.precision(17);
+		out << "element ";
+		for(int d=0; d<e->getDim(); d++)
+			out << e->getParmin(d) << " " << e->getParmax(d) << " ";
+		out << e->nBasisFunctions();
+		result.push_back(out.str());
+	}
+	sort(result.begin(), result.end());
+	return result;
+}
+
+/************************************************************************************************************************//**
+ * \brief Refines towards the lower left corner
+ * \returns The time in seconds
+ ***************************************************************************************************************************/
+double refine(LRSpline *lr, int levels, double corner) {
+	clock_t start = clock();
+	for(int level=0; level<levels; level++) {
+		corner /= 2;
+		refineCorner(lr, corner);
+	}
+	return (double) (clock()-start) / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char **argv) {
+
+	// set default parameter values
+	int p      = 3;
+	int n      = 8;
+	int levels = 6;
+	bool vol   = false;
+	string parameters(" parameters: \n" \
+	                  "   -p      <n> polynomial ORDER (degree+1) in all parametric directions\n" \
+	                  "   -n      <n> number of basis functions in all parametric directions\n" \
+	                  "   -levels <n> number of times the lower left corner is refined\n" \
+	                  "   -vol        test a trivariate volume instead of a surface\n" \
+	                  "   -help       display (this) help information\n");
+
+	// read input
+	for(int i=1; i<argc; i++) {
+		if(strcmp(argv[i], "-p") == 0)
+			p = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-n") == 0)
+			n = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-levels") == 0)
+			levels = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-vol") == 0)
+			vol = true;
+		else if(strcmp(argv[i], "-help") == 0) {
+			cout << "usage: " << argv[0] << endl << parameters;
+			exit(0);
+		} else {
+			cerr << "usage: " << argv[0] << endl << parameters;
+			exit(1);
+		}
+	}
+
+	// make a uniform integer knot vector and some control points
+	vector<double> knot(n+p);
+	for(int i=0; i<p+n; i++)
+		knot[i] = (i<p) ? 0 : (i>n) ? n-p+1 : i-p+1;
+	vector<double> cp((vol) ? 3*n*n*n : 2*n*n);
+	for(uint i=0; i<cp.size(); i++)
+		cp[i] = (i*839 % 853) / 853.0;
+	LRSpline *byValue, *byIndex;
+	if(vol) {
+		byValue = new LRSplineVolume(n, n, n, p, p, p, knot.begin(), knot.begin(), knot.begin(), cp.begin(), 3);
+		byIndex = new LRSplineVolume(n, n, n, p, p, p, knot.begin(), knot.begin(), knot.begin(), cp.begin(), 3);
+	} else {
+		byValue = new LRSplineSurface(n, n, p, p, knot.begin(), knot.begin(), cp.begin(), 2);
+		byIndex = new LRSplineSurface(n, n, p, p, knot.begin(), knot.begin(), cp.begin(), 2);
+	}
+
+	// refine the same way with and without knot indices
+	byIndex->setKnotIndexing(true);
+	double timeValue = refine(byValue, levels, n-p+1);
+	double timeIndex = refine(byIndex, levels, n-p+1);
+	cout << "Refined to " << byValue->nElements() << " elements and " << byValue->nBasisFunctions() << " basis functions" << endl;
+	cout << "Refinement time: knot values " << timeValue << " s, knot indices " << timeIndex << " s" << endl;
+	cout << "Unique hash codes: knot values " << byValue->getAllBasisfunctions().uniqueHashCodes()
+	     << ", knot indices " << byIndex->getAllBasisfunctions().uniqueHashCodes() << endl;
+	cout << "Knot tables:";
+	for(int d=0; d<byIndex->nVariate(); d++)
+		cout << " " << byIndex->getKnotTable(d).size();
+	cout << " unique knots" << endl;
+
+	int nWrong = 0;
+	vector<string> reference = describe(byValue);
+	if(describe(byIndex) != reference) {
+		cout << "Knot index refinement differs from knot value refinement" << endl;
+		nWrong++;
+	}
+
+	// every function should store all its knots as indices, and nothing else
+	for(Basisfunction *b : byIndex->getAllBasisfunctions()) {
+		bool allIndexed = b->hasKnotIndices();
+		for(int d=0; d<byIndex->nVariate(); d++)
+			allIndexed &= b->getknots(d).indices() != NULL && b->getknots(d).size() == p+1;
+		if(!allIndexed) {
+			cout << "Basis function " << b->getId() << " does not store knot indices" << endl;
+			nWrong++;
+			break;
+		}
+	}
+	cout << "Control point and knots per function: " << byValue->getBasisfunction(0)->dataMemory() << " bytes by value, "
+	     << byIndex->getBasisfunction(0)->dataMemory() << " bytes by index" << endl;
+
+	// copies keep the mode, and going back to knot values should not change anything
+	LRSpline *copy = (vol) ? (LRSpline*) ((LRSplineVolume*)  byIndex)->copy() :
+	                         (LRSpline*) ((LRSplineSurface*) byIndex)->copy();
+	if(!copy->getKnotIndexing() || describe(copy) != reference) {
+		cout << "Copy of knot indexed spline differs" << endl;
+		nWrong++;
+	}
+	byIndex->setKnotIndexing(false);
+	if(describe(byIndex) != reference) {
+		cout << "Turning knot indexing off changed the spline" << endl;
+		nWrong++;
+	}
+
+	// refining the copy further should still give the same result as refining by values
+	refine(byValue, 1, (n-p+1) / pow(2.0, levels));
+	refine(copy,    1, (n-p+1) / pow(2.0, levels));
+	if(describe(copy) != describe(byValue)) {
+		cout << "Refining the copy of a knot indexed spline differs" << endl;
+		nWrong++;
+	}
+
+	if(nWrong == 0)
+		cout << "Knot index mode gives identical refinement" << endl;
+	else
+		cout << "Knot index mode FAILED (" << nWrong << " errors)" << endl;
+	delete copy;
+	delete byIndex;
+	delete byValue;
+	exit(nWrong == 0 ? 0 : 1);
+}
@@ -0,0 +1,210 @@
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include "LRSpline/LRSplineSurface.h"
+#include "LRSpline/LRSplineVolume.h"
+#include "LRSpline/QuadratureCache.h"
+#include "LRSpline/Element.h"
+#include "LRSpline/Basisfunction.h"
+
+using namespace LR;
+using namespace std;
+
+/************************************************************************************************************************//**
+ * \brief Compares all cached values against computeBasis() at the same points, and fields evaluated from the cache against
+ *        pointField() and point()
+ * \returns The number of values which are not bitwise identical
+ ***************************************************************************************************************************/
+long compareCache(const LRSpline *lr, const QuadratureCache &cache, const vector<double> &points, int derivs) {
+	const LRSplineSurface *lrs = dynamic_cast<const LRSplineSurface*>(lr);
+	const LRSplineVolume  *lrv = dynamic_cast<const LRSplineVolume*>(lr);
+	int parDim = lr->nVariate();
+	int nRes   = cache.nDerivatives();
+	long nWrong = 0;
+	vector<vector<double> > result, fromPoint;
+
+	// three fields stored both ways, and the control points as a field
+	int nComp = 3;
+	int nBasis = lr->nBasisFunctions();
+	vector<double> rowMajor(nBasis*nComp), colMajor(nBasis*nComp), controlpoints;
+	for(int i=0; i<nBasis; i++) {
+		for(int j=0; j<nComp; j++)
+			rowMajor[i*nComp+j] = colMajor[j*nBasis+i] = ((i*nComp+j)*839 % 853) / 853.0 - 0.5;
+		const Basisfunction *b = lr->getBasisfunction(i);
+		controlpoints.insert(controlpoints.end(), b->cp(), b->cp()+lr->dimension());
+	}
+	vector<double> fieldRow(nRes*nComp), fieldCol(nRes*nComp), fieldCache(nRes*nComp), geometry(nRes*lr->dimension());
+
+	for(int iEl=0; iEl<lr->nElements(); iEl++) {
+		const Element *el = lr->getElement(iEl);
+		if(cache.nBasisFunctions(iEl) != el->nBasisFunctions())
+			nWrong++;
+		for(int q=0; q<cache.nQuadraturePoints(); q++) {
+			double par[3];
+			for(int d=0; d<parDim; d++)
+				par[d] = el->getParmin(d) + (points[q*parDim+d]+1)/2 * (el->getParmax(d)-el->getParmin(d));
+			if(lrv) {
+				lrv->computeBasis(par[0], par[1], par[2], result, derivs, iEl);
+				lrv->pointField(fieldRow.data(), rowMajor.data(),      nComp,            par[0], par[1], par[2], derivs, iEl);
+				lrv->pointField(fieldCol.data(), colMajor.data(),      nComp,            par[0], par[1], par[2], derivs, iEl, COLUMN_MAJOR);
+				lrv->pointField(geometry.data(), controlpoints.data(), lr->dimension(),  par[0], par[1], par[2], derivs, iEl);
+				lrv->point(fromPoint, par[0], par[1], par[2], derivs, iEl);
+			} else {
+				lrs->computeBasis(par[0], par[1], result, derivs, iEl);
+				lrs->pointField(fieldRow.data(), rowMajor.data(),      nComp,            par[0], par[1], derivs, iEl);
+				lrs->pointField(fieldCol.data(), colMajor.data(),      nComp,            par[0], par[1], derivs, iEl, COLUMN_MAJOR);
+				lrs->pointField(geometry.data(), controlpoints.data(), lr->dimension(),  par[0], par[1], derivs, iEl);
+				lrs->point(fromPoint, par[0], par[1], derivs, iEl);
+			}
+			for(uint f=0; f<result.size(); f++)
+				for(uint d=0; d<result[f].size(); d++)
+					if(cache.value(iEl, q, f, d) != result[f][d])
+						nWrong++;
+			cache.evaluateField(fieldCache.data(), iEl, q, colMajor.data(), nComp, COLUMN_MAJOR);
+			for(int i=0; i<nRes*nComp; i++)
+				if(fieldRow[i] != fieldCol[i] || fieldRow[i] != fieldCache[i])
+					nWrong++;
+			for(int i=0; i<nRes; i++)
+				for(int j=0; j<lr->dimension(); j++)
+					if(geometry[i*lr->dimension()+j] != fromPoint[i][j])
+						nWrong++;
+		}
+	}
+	return nWrong;
+}
+
+/************************************************************************************************************************//**
+ * \brief Compares the geometry evaluated from the cache against point(), before anything else has renumbered the basis
+ *        functions after refinement. The control points are laid out in the order the ids are given by generateIDs()
+ * \returns The number of values which are not bitwise identical
+ ***************************************************************************************************************************/
+long compareBeforeRenumbering(const LRSpline *lr, const QuadratureCache &cache, const vector<double> &points, int derivs) {
+	const LRSplineSurface *lrs = dynamic_cast<const LRSplineSurface*>(lr);
+	const LRSplineVolume  *lrv = dynamic_cast<const LRSplineVolume*>(lr);
+	int parDim = lr->nVariate();
+	int dim    = lr->dimension();
+	int nRes   = cache.nDerivatives();
+	vector<double> controlpoints;
+	for(Basisfunction *b : lr->getAllBasisfunctions())
+		controlpoints.insert(controlpoints.end(), b->cp(), b->cp()+dim);
+
+	vector<double> fromCache(lr->nElements()*nRes*dim);
+	for(int iEl=0; iEl<lr->nElements(); iEl++)
+		cache.evaluateField(&fromCache[iEl*nRes*dim], iEl, 0, controlpoints.data(), dim);
+
+	long nWrong = 0;
+	vector<vector<double> > fromPoint;
+	for(int iEl=0; iEl<lr->nElements(); iEl++) {
+		const Element *el = lr->getElement(iEl);
+		double par[3];
+		for(int d=0; d<parDim; d++)
+			par[d] = el->getParmin(d) + (points[d]+1)/2 * (el->getParmax(d)-el->getParmin(d));
+		if(lrv)
+			lrv->point(fromPoint, par[0], par[1], par[2], derivs, iEl);
+		else
+			lrs->point(fromPoint, par[0], par[1], derivs, iEl);
+		for(int i=0; i<nRes; i++)
+			for(int j=0; j<dim; j++)
+				if(fromCache[(iEl*nRes+i)*dim+j] != fromPoint[i][j])
+					nWrong++;
+	}
+	return nWrong;
+}
+
+int main(int argc, char **argv) {
+
+	// set default parameter values
+	int p      = 3;
+	int n      = 8;
+	int nq     = 3;
+	int derivs = 1;
+	bool vol   = false;
+	string parameters(" parameters: \n" \
+	                  "   -p      <n> polynomial ORDER (degree+1) in all parametric directions\n" \
+	                  "   -n      <n> number of basis functions in all parametric directions\n" \
+	                  "   -nq     <n> number of quadrature points per element in each parametric direction\n" \
+	                  "   -derivs <n> number of derivatives to cache\n" \
+	                  "   -vol        test a trivariate volume instead of a surface\n" \
+	                  "   -help       display (this) help information\n");
+
+	// read input
+	for(int i=1; i<argc; i++) {
+		if(strcmp(argv[i], "-p") == 0)
+			p = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-n") == 0)
+			n = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-nq") == 0)
+			nq = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-derivs") == 0)
+			derivs = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-vol") == 0)
+			vol = true;
+		else if(strcmp(argv[i], "-help") == 0) {
+			cout << "usage: " << argv[0] << endl << parameters;
+			exit(0);
+		} else {
+			cerr << "usage: " << argv[0] << endl << parameters;
+			exit(1);
+		}
+	}
+
+	// make a uniform integer knot vector and some control points
+	vector<double> knot(n+p);
+	for(int i=0; i<p+n; i++)
+		knot[i] = (i<p) ? 0 : (i>n) ? n-p+1 : i-p+1;
+	int parDim = (vol) ? 3 : 2;
+	vector<double> cp((vol) ? 3*n*n*n : 2*n*n);
+	for(uint i=0; i<cp.size(); i++)
+		cp[i] = (i*839 % 853) / 853.0;
+	LRSpline *lr;
+	if(vol)
+		lr = new LRSplineVolume(n, n, n, p, p, p, knot.begin(), knot.begin(), knot.begin(), cp.begin(), 3);
+	else
+		lr = new LRSplineSurface(n, n, p, p, knot.begin(), knot.begin(), cp.begin(), 2);
+
+	// tensor midpoint rule on the reference element, including the element corners to test evaluation on the edges
+	vector<double> points;
+	int nPts = 1;
+	for(int d=0; d<parDim; d++)
+		nPts *= nq+1;
+	for(int i=0; i<nPts; i++) {
+		for(int d=0, k=i; d<parDim; d++, k/=nq+1) {
+			int j = k % (nq+1);
+			points.push_back((j == nq) ? 1.0 : -1.0 + (2*j+1.0)/nq);
+		}
+	}
+
+	clock_t start = clock();
+	QuadratureCache cache(lr, points, derivs);
+	double timeBuild = (double) (clock()-start) / CLOCKS_PER_SEC;
+	cout << "Cached " << cache.nElements() << " elements with " << cache.nQuadraturePoints() << " points each" << endl;
+	cout << "Memory footprint: " << cache.memoryFootprint() << " bytes" << endl;
+	long nWrong = compareCache(lr, cache, points, derivs);
+
+	// refine the lower left corner, and only update what has changed
+	vector<int> elements;
+	for(int i=0; i<lr->nElements(); i++) {
+		const Element *el = lr->getElement(i);
+		if(el->getParmax(0) <= 2 && el->getParmax(1) <= 2)
+			elements.push_back(i);
+	}
+	lr->refineElement(elements);
+	start = clock();
+	int nUpdated = cache.update();
+	double timeUpdate = (double) (clock()-start) / CLOCKS_PER_SEC;
+	nWrong += compareBeforeRenumbering(lr, cache, points, derivs);
+	cout << "Refined to " << lr->nElements() << " elements, re-evaluated " << nUpdated << " of them" << endl;
+	cout << "Time building cache: " << timeBuild << " s, updating: " << timeUpdate << " s" << endl;
+	nWrong += compareCache(lr, cache, points, derivs);
+
+	// second update should not find anything to do
+	nWrong += cache.update();
+
+	if(nWrong == 0 && nUpdated < lr->nElements())
+		cout << "All cached values identical to computeBasis(), and all fields to point()" << endl;
+	else
+		cout << "Quadrature cache FAILED (" << nWrong << " errors)" << endl;
+	delete lr;
+	exit(nWrong == 0 ? 0 : 1);
+}
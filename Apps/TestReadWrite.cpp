@@ -165,14 +165,14 @@ int main(int argc, char **argv) {
 	lrfile4.open("TestReadWrite4.lr"); // this SHOULD be different from 1-3. Reg test shouldn't check against this one
 	if(vol) {
 		LRSplineVolume *copyVol = lrv->copy();
-		lrv->getBasisfunction(0)->getknots(0)[0] = -99999;
+		lrv->getBasisfunction(0)->setKnot(0, 0, -99999);
 		lrv->getElement(0)->setUmin(               -99999);
 		lrv->getMeshRectangle(0)->start_[0]      = -99999;
 		lrfile3 << *copyVol << endl;
 		lrfile4 << *lrv << endl;
 	} else {
 		LRSplineSurface *copySurf = lrs->copy();
-		lrs->getBasisfunction(0)->getknots(0)[0] = -99999;
+		lrs->getBasisfunction(0)->setKnot(0, 0, -99999);
 		lrs->getElement(0)->setUmin(               -99999);
 		(*lrs->meshlineBegin())->start_          = -99999;
 		lrfile3 << *copySurf << endl;
@@ -0,0 +1,221 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include "LRSpline/LRSplineSurface.h"
+#include "LRSpline/LRSplineVolume.h"
+#include "LRSpline/Element.h"
+#include "LRSpline/Basisfunction.h"
+
+using namespace LR;
+using namespace std;
+
+/************************************************************************************************************************//**
+ * \brief Refines all elements inside [0,corner]^d
+ ***************************************************************************************************************************/
+void refineCorner(LRSpline *lr, double corner) {
+	vector<int> elements;
+	for(int i=0; i<lr->nElements(); i++) {
+		bool inside = true;
+		for(int d=0; d<lr->nVariate(); d++)
+			inside &= lr->getElement(i)->getParmax(d) <= corner;
+		if(inside)
+			elements.push_back(i);
+	}
+	lr->refineElement(elements);
+}
+
+/************************************************************************************************************************//**
+ * \brief Describes all functions (knots) and elements (bounds) of a spline as a sorted list of strings, which does not
+ *        depend on the order they are stored in
+ ***************************************************************************************************************************/
+vector<string> describe(LRSpline *lr) {
+	vector<string> result;
+	for(Basisfunction *b : lr->getAllBasisfunctions()) {
+		ostringstream out;
+		out.precision(17);
+		for(int d=0; d<b->nVariate(); d++)
+			for(double t : (*b)[d])
+				out << t << " ";
+		result.push_back(out.str());
+	}
+	for(Element *e : lr->getAllElements()) {
+		ostringstream out;
+		out.precision(17);
+		out << "element ";
+		for(int d=0; d<e->getDim(); d++)
+			out << e->getParmin(d) << " " << e->getParmax(d) << " ";
+		result.push_back(out.str());
+	}
+	sort(result.begin(), result.end());
+	return result;
+}
+
+/************************************************************************************************************************//**
+ * \brief Returns the largest difference in id between two functions on the same element, i.e. the half bandwidth of the
+ *        mass or stiffness matrix
+ ***************************************************************************************************************************/
+int functionBandwidth(LRSpline *lr) {
+	int result = 0;
+	for(Element *e : lr->getAllElements()) {
+		int lo = lr->nBasisFunctions();
+		int hi = 0;
+		for(Basisfunction *b : e->support()) {
+			lo = min(lo, b->getId());
+			hi = max(hi, b->getId());
+		}
+		result = max(result, hi-lo);
+	}
+	return result;
+}
+
+/************************************************************************************************************************//**
+ * \brief Returns the largest difference in id between two elements in the support of the same function
+ ***************************************************************************************************************************/
+int elementBandwidth(LRSpline *lr) {
+	int result = 0;
+	for(Basisfunction *b : lr->getAllBasisfunctions()) {
+		int lo = lr->nElements();
+		int hi = 0;
+		for(Element *e : b->support()) {
+			lo = min(lo, e->getId());
+			hi = max(hi, e->getId());
+		}
+		result = max(result, hi-lo);
+	}
+	return result;
+}
+
+/************************************************************************************************************************//**
+ * \brief Checks that the ids, the iterators, getBasisfunction(), getElementContaining() and write() all agree on the order
+ * \returns The number of errors found
+ ***************************************************************************************************************************/
+int checkOrder(LRSpline *lr) {
+	int nWrong = 0;
+	// listing all functions and elements the same way as write() does
+	ostringstream functions, elements;
+	functions.precision(16);
+	elements.precision(16);
+	int i = 0;
+	for(Basisfunction *b : lr->getAllBasisfunctions()) {
+		if(b->getId() != i || lr->getBasisfunction(i) != b)
+			nWrong++;
+		functions << *b << endl;
+		i++;
+	}
+	for(i=0; i<lr->nElements(); i++) {
+		Element *e = lr->getElement(i);
+		vector<double> midpoint = e->midpoint();
+		if(e->getId() != i || lr->getElementContaining(midpoint) != i)
+			nWrong++;
+		elements << *e << endl;
+	}
+
+	ostringstream written;
+	lr->write(written);
+	if(written.str().find(functions.str()) == string::npos || written.str().find(elements.str()) == string::npos)
+		nWrong++;
+	return nWrong;
+}
+
+int main(int argc, char **argv) {
+
+	// set default parameter values
+	int p      = 3;
+	int n      = 8;
+	int levels = 5;
+	bool vol   = false;
+	string parameters(" parameters: \n" \
+	                  "   -p      <n> polynomial ORDER (degree+1) in all parametric directions\n" \
+	                  "   -n      <n> number of basis functions in all parametric directions\n" \
+	                  "   -levels <n> number of times the lower left corner is refined\n" \
+	                  "   -vol        test a trivariate volume instead of a surface\n" \
+	                  "   -help       display (this) help information\n");
+
+	// read input
+	for(int i=1; i<argc; i++) {
+		if(strcmp(argv[i], "-p") == 0)
+			p = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-n") == 0)
+			n = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-levels") == 0)
+			levels = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-vol") == 0)
+			vol = true;
+		else if(strcmp(argv[i], "-help") == 0) {
+			cout << "usage: " << argv[0] << endl << parameters;
+			exit(0);
+		} else {
+			cerr << "usage: " << argv[0] << endl << parameters;
+			exit(1);
+		}
+	}
+
+	// make a uniform integer knot vector and some control points
+	vector<double> knot(n+p);
+	for(int i=0; i<p+n; i++)
+		knot[i] = (i<p) ? 0 : (i>n) ? n-p+1 : i-p+1;
+	vector<double> cp((vol) ? 3*n*n*n : 2*n*n);
+	for(uint i=0; i<cp.size(); i++)
+		cp[i] = (i*839 % 853) / 853.0;
+
+	// refine towards the lower left corner
+	LRSpline *lr;
+	if(vol)
+		lr = new LRSplineVolume(n, n, n, p, p, p, knot.begin(), knot.begin(), knot.begin(), cp.begin(), 3);
+	else
+		lr = new LRSplineSurface(n, n, p, p, knot.begin(), knot.begin(), cp.begin(), 2);
+	double corner = n-p+1;
+	for(int level=0; level<levels; level++) {
+		corner /= 2;
+		refineCorner(lr, corner);
+	}
+	lr->generateIDs();
+	cout << "Refined to " << lr->nElements() << " elements and " << lr->nBasisFunctions() << " basis functions" << endl;
+	vector<string> reference = describe(lr);
+
+	const char *name[]       = {"creation", "greville", "morton", "hilbert", "rcm"};
+	numberingScheme scheme[] = {NUMBER_CREATION, NUMBER_GREVILLE, NUMBER_MORTON, NUMBER_HILBERT, NUMBER_RCM};
+	int nWrong = 0;
+	for(int s=0; s<5; s++) {
+		LRSpline *renumbered = (vol) ? (LRSpline*) ((LRSplineVolume*)  lr)->copy() :
+		                               (LRSpline*) ((LRSplineSurface*) lr)->copy();
+		renumbered->renumberBasisfunctions(scheme[s]);
+		renumbered->renumberElements(scheme[s]);
+		cout << "Numbering " << name[s] << ": function bandwidth " << functionBandwidth(renumbered)
+		     << ", element bandwidth " << elementBandwidth(renumbered) << endl;
+
+		int errors = checkOrder(renumbered);
+		if(describe(renumbered) != reference)
+			errors++;
+
+		// refining further after renumbering gives the same spline as refining the original
+		LRSpline *original = (vol) ? (LRSpline*) ((LRSplineVolume*)  lr)->copy() :
+		                             (LRSpline*) ((LRSplineSurface*) lr)->copy();
+		refineCorner(renumbered, corner/2);
+		refineCorner(original,   corner/2);
+		// looking up functions by id renumbers them, without building the element lookup structure
+		for(int i=0; i<renumbered->nBasisFunctions(); i++)
+			if(renumbered->getBasisfunction(i)->getId() != i)
+				errors++;
+		if(renumbered->elementLocatorMemory() != 0)
+			errors++;
+		renumbered->generateIDs();
+		if(describe(renumbered) != describe(original))
+			errors++;
+		errors += checkOrder(renumbered);
+
+		if(errors > 0)
+			cout << "Numbering " << name[s] << " FAILED (" << errors << " errors)" << endl;
+		nWrong += errors;
+		delete original;
+		delete renumbered;
+	}
+
+	if(nWrong == 0)
+		cout << "Renumbering keeps the spline intact" << endl;
+	delete lr;
+	exit(nWrong == 0 ? 0 : 1);
+}
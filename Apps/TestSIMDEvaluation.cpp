@@ -0,0 +1,116 @@
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include "LRSpline/Basisfunction.h"
+#include "LRSpline/BasisWorkspace.h"
+
+using namespace LR;
+using namespace std;
+
+/************************************************************************************************************************//**
+ * \brief Distance between two doubles counted in units in the last place (+0 and -0 are considered equal)
+ ***************************************************************************************************************************/
+int64_t ulpDistance(double a, double b) {
+	int64_t ia, ib;
+	memcpy(&ia, &a, sizeof(double));
+	memcpy(&ib, &b, sizeof(double));
+	if(ia < 0) ia = INT64_MIN - ia;
+	if(ib < 0) ib = INT64_MIN - ib;
+	return (ia > ib) ? ia - ib : ib - ia;
+}
+
+int main(int argc, char **argv) {
+
+	// set default parameter values
+	int maxOrder = 7;
+	int nPts     = 1000;
+	int nKnots   = 20;
+	int seed     = 1;
+	string parameters(" parameters: \n" \
+	                  "   -p     <n> maximum polynomial ORDER (degree+1) to test\n" \
+	                  "   -pts   <n> number of evaluation points per knot vector\n" \
+	                  "   -knots <n> number of random knot vectors per polynomial order\n" \
+	                  "   -seed  <n> seed for the random knot vectors and points\n" \
+	                  "   -help      display (this) help information\n");
+
+	// read input
+	for(int i=1; i<argc; i++) {
+		if(strcmp(argv[i], "-p") == 0)
+			maxOrder = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-pts") == 0)
+			nPts = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-knots") == 0)
+			nKnots = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-seed") == 0)
+			seed = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-help") == 0) {
+			cout << "usage: " << argv[0] << endl << parameters;
+			exit(0);
+		} else {
+			cerr << "usage: " << argv[0] << endl << parameters;
+			exit(1);
+		}
+	}
+
+	const char *isaName[] = {"scalar", "SSE2", "AVX2", "AVX-512"};
+	simdInstructionSet best = Basisfunction::supportedInstructionSet();
+	cout << "Widest supported instruction set: " << isaName[best] << endl;
+
+	BasisWorkspace workspace;
+	bool allOK = true;
+	for(int isa=SIMD_SSE2; isa<=best; isa++) {
+		mt19937 random(seed);
+		uniform_real_distribution<double> uniform(0.0, 1.0);
+		long    nValues = 0;
+		int64_t maxUlp  = 0;
+		bool    insideOK = true;
+		for(int order=1; order<=maxOrder; order++) {
+			for(int k=0; k<nKnots; k++) {
+				// random knot vector, every other one with integer (and repeated) knots
+				vector<double> knot(order+1);
+				knot[0] = (k%2) ? (double) (random()%3) : uniform(random);
+				for(int i=1; i<=order; i++)
+					knot[i] = knot[i-1] + ((k%2) ? (double) (random()%2) : uniform(random));
+				if(knot[order] == knot[0])
+					knot[order] += 1.0;
+
+				// random points slightly outside the support, and all the knots themselves
+				vector<double> t(nPts);
+				double len = knot[order]-knot[0];
+				for(int i=0; i<nPts; i++)
+					t[i] = (i <= order) ? knot[i] : knot[0] - 0.1*len + 1.2*len*uniform(random);
+				unique_ptr<bool[]> fromRight(new bool[nPts]);
+				for(int i=0; i<nPts; i++)
+					fromRight[i] = (random()%2 == 0);
+
+				for(int derivs=0; derivs<=order; derivs++) {
+					vector<double> values(nPts*(derivs+1)), reference(nPts*(derivs+1));
+					vector<char>   inside(nPts),            referenceInside(nPts);
+
+					Basisfunction::setInstructionSet(SIMD_NONE);
+					Basisfunction::evaluateUnivariate(reference.data(), referenceInside.data(), knot, t.data(), fromRight.get(), nPts, derivs, workspace);
+					Basisfunction::setInstructionSet((simdInstructionSet) isa);
+					Basisfunction::evaluateUnivariate(values.data(),    inside.data(),          knot, t.data(), fromRight.get(), nPts, derivs, workspace);
+
+					for(int i=0; i<nPts*(derivs+1); i++)
+						maxUlp = max(maxUlp, ulpDistance(values[i], reference[i]));
+					insideOK = insideOK && inside == referenceInside;
+					nValues += values.size();
+				}
+			}
+		}
+		cout << isaName[isa] << ": " << nValues << " values compared, max difference " << maxUlp << " ulp";
+		cout << ((insideOK) ? "" : ", support test FAILED") << endl;
+		allOK = allOK && insideOK && maxUlp <= 1;
+	}
+	Basisfunction::setInstructionSet(best);
+
+	if(allOK)
+		cout << "All vectorized kernels agree with the scalar evaluation within 1 ulp" << endl;
+	else
+		cout << "Vectorized evaluation FAILED" << endl;
+	exit(allOK ? 0 : 1);
+}
@@ -0,0 +1,156 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include "LRSpline/LRSplineSurface.h"
+#include "LRSpline/LRSplineVolume.h"
+#include "LRSpline/SupportGraph.h"
+#include "LRSpline/Element.h"
+#include "LRSpline/Basisfunction.h"
+
+using namespace LR;
+using namespace std;
+
+/************************************************************************************************************************//**
+ * \brief Refines all elements inside [0,corner]^d
+ ***************************************************************************************************************************/
+void refineCorner(LRSpline *lr, double corner) {
+	vector<int> elements;
+	for(int i=0; i<lr->nElements(); i++) {
+		bool inside = true;
+		for(int d=0; d<lr->nVariate(); d++)
+			inside &= lr->getElement(i)->getParmax(d) <= corner;
+		if(inside)
+			elements.push_back(i);
+	}
+	lr->refineElement(elements);
+}
+
+/************************************************************************************************************************//**
+ * \brief Returns the wall clock time in seconds since some fixed point
+ ***************************************************************************************************************************/
+double wallTime() {
+	return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/************************************************************************************************************************//**
+ * \brief Checks the support graph against the supports stored in the spline objects
+ * \returns The number of errors found
+ ***************************************************************************************************************************/
+int checkGraph(LRSpline *lr, const SupportGraph &graph) {
+	int nWrong = 0;
+	if(graph.nElements() != lr->nElements() || graph.nBasisFunctions() != lr->nBasisFunctions())
+		return 1;
+	for(int i=0; i<lr->nElements(); i++) {
+		const Element *el = lr->getElement(i);
+		vector<int> ids;
+		for(Basisfunction *b : el->support())
+			ids.push_back(b->getId());
+		sort(ids.begin(), ids.end());
+		if(!equal(ids.begin(), ids.end(), graph.elementFunctions(i)) || (int) ids.size() != graph.nElementFunctions(i))
+			nWrong++;
+	}
+	for(int i=0; i<lr->nBasisFunctions(); i++) {
+		const Basisfunction *b = lr->getBasisfunction(i);
+		vector<int> ids;
+		for(Element *el : b->support())
+			ids.push_back(el->getId());
+		sort(ids.begin(), ids.end());
+		if(!equal(ids.begin(), ids.end(), graph.basisElements(i)) || (int) ids.size() != graph.nBasisElements(i))
+			nWrong++;
+	}
+	// the two directions should be the transpose of each other
+	for(int i=0; i<graph.nElements(); i++)
+		for(int k=0; k<graph.nElementFunctions(i); k++) {
+			int j = graph.elementFunctions(i)[k];
+			if(!binary_search(graph.basisElements(j), graph.basisElements(j)+graph.nBasisElements(j), i))
+				nWrong++;
+		}
+	return nWrong;
+}
+
+int main(int argc, char **argv) {
+
+	// set default parameter values
+	int p        = 3;
+	int n        = 8;
+	int levels   = 5;
+	int nThreads = 4;
+	bool vol     = false;
+	string parameters(" parameters: \n" \
+	                  "   -p       <n> polynomial ORDER (degree+1) in all parametric directions\n" \
+	                  "   -n       <n> number of basis functions in all parametric directions\n" \
+	                  "   -levels  <n> number of times the lower left corner is refined\n" \
+	                  "   -threads <n> number of threads to build the graph with\n" \
+	                  "   -vol         test a trivariate volume instead of a surface\n" \
+	                  "   -help        display (this) help information\n");
+
+	// read input
+	for(int i=1; i<argc; i++) {
+		if(strcmp(argv[i], "-p") == 0)
+			p = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-n") == 0)
+			n = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-levels") == 0)
+			levels = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-threads") == 0)
+			nThreads = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-vol") == 0)
+			vol = true;
+		else if(strcmp(argv[i], "-help") == 0) {
+			cout << "usage: " << argv[0] << endl << parameters;
+			exit(0);
+		} else {
+			cerr << "usage: " << argv[0] << endl << parameters;
+			exit(1);
+		}
+	}
+
+	// make a uniform integer knot vector and some control points
+	vector<double> knot(n+p);
+	for(int i=0; i<p+n; i++)
+		knot[i] = (i<p) ? 0 : (i>n) ? n-p+1 : i-p+1;
+	vector<double> cp((vol) ? 3*n*n*n : 2*n*n);
+	for(size_t i=0; i<cp.size(); i++)
+		cp[i] = (i*839 % 853) / 853.0;
+
+	// refine towards the lower left corner
+	LRSpline *lr;
+	if(vol)
+		lr = new LRSplineVolume(n, n, n, p, p, p, knot.begin(), knot.begin(), knot.begin(), cp.begin(), 3);
+	else
+		lr = new LRSplineSurface(n, n, p, p, knot.begin(), knot.begin(), cp.begin(), 2);
+	double corner = n-p+1;
+	for(int level=0; level<levels; level++) {
+		corner /= 2;
+		refineCorner(lr, corner);
+	}
+	lr->generateIDs();
+	cout << "Refined to " << lr->nElements() << " elements and " << lr->nBasisFunctions() << " basis functions" << endl;
+
+	// build the graph serially and in parallel
+	double start = wallTime();
+	SupportGraph serial(lr, 1);
+	double timeSerial = wallTime() - start;
+	start = wallTime();
+	SupportGraph parallel(lr, nThreads);
+	double timeParallel = wallTime() - start;
+	cout << "Support graph: " << serial.elementIndices().size() << " element-function pairs, "
+	     << serial.memoryFootprint() / 1048576.0 << " MB" << endl;
+	cout << "Build time: 1 thread " << timeSerial << " s, " << nThreads << " threads " << timeParallel << " s" << endl;
+
+	int nWrong = checkGraph(lr, serial);
+	if(parallel.elementOffsets() != serial.elementOffsets() || parallel.elementIndices() != serial.elementIndices() ||
+	   parallel.basisOffsets()   != serial.basisOffsets()   || parallel.basisIndices()   != serial.basisIndices()) {
+		cout << "Support graph built in parallel differs" << endl;
+		nWrong++;
+	}
+
+	if(nWrong == 0)
+		cout << "Support graph matches the spline" << endl;
+	else
+		cout << "Support graph FAILED (" << nWrong << " errors)" << endl;
+	delete lr;
+	exit(nWrong == 0 ? 0 : 1);
+}
@@ -0,0 +1,171 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include "LRSpline/LRSplineSurface.h"
+#include "LRSpline/LRSplineVolume.h"
+#include "LRSpline/Element.h"
+
+using namespace LR;
+using namespace std;
+
+#ifdef __SANITIZE_THREAD__
+// stop at the first data race, so that the regression test fails
+extern "C" const char* __tsan_default_options() { return "halt_on_error=1"; }
+#endif
+
+/************************************************************************************************************************//**
+ * \brief Creates a uniform spline which is refined in the lower left corner
+ ***************************************************************************************************************************/
+LRSpline* makeSpline(bool vol, int p, int n) {
+	vector<double> knot(n+p);
+	for(int i=0; i<p+n; i++)
+		knot[i] = (i<p) ? 0 : (i>n) ? n-p+1 : i-p+1;
+	vector<double> cp((vol) ? 3*n*n*n : 3*n*n);
+	for(uint i=0; i<cp.size(); i++)
+		cp[i] = (i*839 % 853) / 853.0;
+	LRSpline *lr;
+	if(vol)
+		lr = new LRSplineVolume(n, n, n, p, p, p, knot.begin(), knot.begin(), knot.begin(), cp.begin(), 3);
+	else
+		lr = new LRSplineSurface(n, n, p, p, knot.begin(), knot.begin(), cp.begin(), 3);
+	vector<int> elements;
+	for(int i=0; i<lr->nElements(); i++)
+		if(lr->getElement(i)->getParmax(0) <= 2 && lr->getElement(i)->getParmax(1) <= 2)
+			elements.push_back(i);
+	lr->refineElement(elements);
+	return lr;
+}
+
+/************************************************************************************************************************//**
+ * \brief Evaluates everything which may lazily build caches on the spline, and appends all results to one flat list
+ * \param lr The spline
+ * \param par All parametric points, stored as [point][parametric direction]
+ * \param first Index of the first point to evaluate (the points are evaluated cyclically from there)
+ * \param derivs Number of derivatives
+ ***************************************************************************************************************************/
+vector<double> evaluateAll(const LRSpline *lr, const vector<double> &par, int first, int derivs) {
+	const LRSplineSurface *lrs = dynamic_cast<const LRSplineSurface*>(lr);
+	const LRSplineVolume  *lrv = dynamic_cast<const LRSplineVolume*>(lr);
+	int parDim = lr->nVariate();
+	int nPts   = par.size() / parDim;
+	vector<double> result(nPts);
+	vector<vector<double> > pts, bezier, basis;
+	for(int k=0; k<nPts; k++) {
+		int i = (first + k) % nPts;
+		const double *u = &par[i*parDim];
+		int iEl = lr->getElementContaining(vector<double>(u, u+parDim));
+		if(lrv) {
+			lrv->point(pts, u[0], u[1], u[2], derivs);
+			lrv->pointBezier(bezier, u[0], u[1], u[2], derivs, iEl);
+			lrv->computeBasis(u[0], u[1], u[2], basis, derivs, iEl);
+		} else {
+			lrs->point(pts, u[0], u[1], derivs);
+			lrs->pointBezier(bezier, u[0], u[1], derivs, iEl);
+			lrs->computeBasis(u[0], u[1], basis, derivs, iEl);
+		}
+		// store the results in point order, no matter which order they were evaluated in
+		double sum = iEl;
+		for(auto &v : pts)    for(double x : v) sum += x;
+		for(auto &v : bezier) for(double x : v) sum += 2*x;
+		for(auto &v : basis)  for(double x : v) sum += 3*x;
+		result[i] = sum;
+	}
+	vector<double> grid;
+	vector<double> g = {0.0, 0.3, 1.5, 2.0, 4.75};
+	if(lrv)
+		lrv->gridEvaluate(g, g, g, derivs, grid);
+	else
+		lrs->gridEvaluate(g, g, derivs, grid);
+	result.insert(result.end(), grid.begin(), grid.end());
+	return result;
+}
+
+int main(int argc, char **argv) {
+
+	// set default parameter values
+	int p        = 3;
+	int n        = 8;
+	int it       = 4;
+	int nThreads = 16;
+	bool vol     = false;
+	string parameters(" parameters: \n" \
+	                  "   -p       <n> polynomial ORDER (degree+1) in all parametric directions\n" \
+	                  "   -n       <n> number of basis functions in all parametric directions\n" \
+	                  "   -it      <n> number of evaluation points per element in each parametric direction\n" \
+	                  "   -threads <n> number of threads evaluating at the same time\n" \
+	                  "   -vol         test a trivariate volume instead of a surface\n" \
+	                  "   -help        display (this) help information\n");
+
+	// read input
+	for(int i=1; i<argc; i++) {
+		if(strcmp(argv[i], "-p") == 0)
+			p = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-n") == 0)
+			n = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-it") == 0)
+			it = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-threads") == 0)
+			nThreads = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-vol") == 0)
+			vol = true;
+		else if(strcmp(argv[i], "-help") == 0) {
+			cout << "usage: " << argv[0] << endl << parameters;
+			exit(0);
+		} else {
+			cerr << "usage: " << argv[0] << endl << parameters;
+			exit(1);
+		}
+	}
+
+	// two identical splines: one to compute the reference results, and one which all threads share. Refinement has left
+	// the element cache of the shared one out of date, and none of them have any Bezier elements cached
+	LRSpline *reference = makeSpline(vol, p, n);
+	LRSpline *shared    = makeSpline(vol, p, n);
+	int parDim = reference->nVariate();
+
+	// evaluation points on all elements, including the element corners
+	vector<double> par;
+	int nPerElement = 1;
+	for(int d=0; d<parDim; d++)
+		nPerElement *= it+1;
+	for(Element *el : reference->getAllElements()) {
+		for(int i=0; i<nPerElement; i++) {
+			for(int d=0, k=i; d<parDim; d++, k/=it+1)
+				par.push_back(el->getParmin(d) + (k%(it+1)) / (double) it * (el->getParmax(d)-el->getParmin(d)));
+		}
+	}
+	int derivs = p-1;
+	vector<double> expected = evaluateAll(reference, par, 0, derivs);
+
+	// all threads evaluate all points, each starting at a different point
+	atomic<bool> go(false);
+	vector<long> nWrong(nThreads, 0);
+	vector<thread> threads;
+	for(int t=0; t<nThreads; t++) {
+		threads.push_back(thread([&, t]() {
+			while(!go)
+				this_thread::yield();
+			vector<double> result = evaluateAll(shared, par, t * par.size()/parDim/nThreads, derivs);
+			for(uint i=0; i<result.size(); i++)
+				if(result[i] != expected[i])
+					nWrong[t]++;
+		}));
+	}
+	go = true;
+	long totalWrong = 0;
+	for(int t=0; t<nThreads; t++) {
+		threads[t].join();
+		totalWrong += nWrong[t];
+	}
+
+	cout << "Evaluated " << par.size()/parDim << " points on " << reference->nElements() << " elements from " << nThreads << " threads" << endl;
+	if(totalWrong == 0)
+		cout << "All threads agree with serial evaluation" << endl;
+	else
+		cout << "Concurrent evaluation FAILED (" << totalWrong << " wrong results)" << endl;
+	delete reference;
+	delete shared;
+	exit(totalWrong == 0 ? 0 : 1);
+}
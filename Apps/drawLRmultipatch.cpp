@@ -20,7 +20,7 @@ vector<double> bounding_box(const LRSplineSurface &surf) {
 	result[2] =  1e9;
 	result[3] = -1e9;
 	for(Basisfunction *b : surf.getAllBasisfunctions()) {
-		std::vector<double>::const_iterator cp = b->cp();
+		const double *cp = b->cp();
 		result[0] = (cp[0] < result[0]) ? cp[0] : result[0];
 		result[1] = (cp[0] > result[1]) ? cp[0] : result[1];
 		result[2] = (cp[1] < result[2]) ? cp[1] : result[2];
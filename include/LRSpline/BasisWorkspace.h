@@ -0,0 +1,128 @@
+#ifndef BASIS_WORKSPACE_H
+#define BASIS_WORKSPACE_H
+
+#include <vector>
+#include "LocalKnotVector.h"
+
+namespace LR {
+
+/************************************************************************************************************************//**
+ * \brief Scratch memory used by Basisfunction::evaluate and LRSpline::computeElementBasis
+ * \details The univariate Cox-de Boor recursion needs a small triangular table per parametric direction for the function
+ *          values and each derivative level. Keeping one BasisWorkspace alive between calls (i.e. one per assembly loop or
+ *          per thread) means that the buffers are only grown on the first evaluation, and every subsequent evaluation of
+ *          the same (or lower) order and derivative level does no heap allocations at all.
+ ***************************************************************************************************************************/
+class BasisWorkspace {
+public:
+	BasisWorkspace() : parDim_(0), derivs_(-1), width_(0) { };
+
+	/************************************************************************************************************************//**
+	 * \brief Makes sure the buffers are large enough for the requested evaluation. Only allocates when growing
+	 * \param parDim Number of parametric directions
+	 * \param derivs Number of derivatives requested
+	 * \param width Maximum number of knot intervals in any local knot vector (i.e. polynomial order)
+	 ***************************************************************************************************************************/
+	void reserve(int parDim, int derivs, int width) {
+		if(parDim <= parDim_ && derivs <= derivs_ && width <= width_)
+			return;
+		parDim_ = (parDim > parDim_) ? parDim : parDim_;
+		derivs_ = (derivs > derivs_) ? derivs : derivs_;
+		width_  = (width  > width_ ) ? width  : width_ ;
+		diff_.resize((derivs_+1) * width_);
+		values_.resize(parDim_ * (derivs_+1));
+		uniqueKnots_.resize(parDim_);
+		uniqueValues_.resize(parDim_);
+		uniqueInside_.resize(parDim_);
+	}
+
+	//! \brief table of the d'th derivative of the univariate B-splines (d=0 is the function values) used in the recursion
+	double* diff(int d)        { return &diff_[d*width_]; };
+	//! \brief all derivatives of the univariate B-spline in parametric direction dir
+	double* values(int dir)    { return &values_[dir*(derivs_+1)]; };
+
+	/************************************************************************************************************************//**
+	 * \brief Looks up a univariate B-spline which has already been evaluated (at the current parametric point)
+	 * \param dir The parametric direction
+	 * \param knot The local knot vector
+	 * \param[out] inside If the parametric point was inside the support of this univariate B-spline
+	 * \returns All derivatives of the univariate B-spline, or NULL if it has not been stored yet
+	 ***************************************************************************************************************************/
+	const double* findUnivariate(int dir, const LocalKnotVector &knot, bool &inside) const {
+		const std::vector<LocalKnotVector> &knots = uniqueKnots_[dir];
+		for(unsigned int i=0; i<knots.size(); i++) {
+			if(knots[i] == knot) {
+				inside = uniqueInside_[dir][i];
+				return &uniqueValues_[dir][i*(derivs_+1)];
+			}
+		}
+		return NULL;
+	}
+
+	/************************************************************************************************************************//**
+	 * \brief Stores a univariate B-spline evaluation for later lookup by findUnivariate()
+	 * \param dir The parametric direction
+	 * \param knot The local knot vector. Only the view is copied, so the knots must be kept alive until clearUnivariate()
+	 * \param inside If the parametric point was inside the support of this univariate B-spline
+	 * \returns Storage for all derivatives of the univariate B-spline. Is invalidated on the next call to this function
+	 ***************************************************************************************************************************/
+	double* addUnivariate(int dir, const LocalKnotVector &knot, bool inside) {
+		uniqueKnots_[dir].push_back(knot);
+		uniqueInside_[dir].push_back(inside);
+		uniqueValues_[dir].resize(uniqueKnots_[dir].size()*(derivs_+1));
+		return &uniqueValues_[dir][(uniqueKnots_[dir].size()-1)*(derivs_+1)];
+	}
+
+	//! \brief forget all stored univariate B-splines (typically done when moving to a new parametric point)
+	void clearUnivariate() {
+		for(int i=0; i<parDim_; i++) {
+			uniqueKnots_[i].clear();
+			uniqueValues_[i].clear();
+			uniqueInside_[i].clear();
+		}
+	}
+
+	//! \brief general purpose result buffer which is kept between calls
+	double* buffer(int size) {
+		if((int) buffer_.size() < size)
+			buffer_.resize(size);
+		return &buffer_[0];
+	}
+
+	//! \brief scratch memory for the vectorized univariate kernels, kept apart from buffer() which may hold results
+	double* lanes(int size) {
+		if((int) lanes_.size() < size)
+			lanes_.resize(size);
+		return &lanes_[0];
+	}
+
+	//! \brief result buffer for the point evaluation functions, kept apart from buffer() which the functions they call use
+	double* results(int size) {
+		if((int) results_.size() < size)
+			results_.resize(size);
+		return &results_[0];
+	}
+
+	//! \brief Scratch memory private to the calling thread, used by the evaluation functions not taking a workspace argument
+	static BasisWorkspace& local() {
+		static thread_local BasisWorkspace workspace;
+		return workspace;
+	}
+
+private:
+	int parDim_;
+	int derivs_;
+	int width_;
+	std::vector<double> diff_;
+	std::vector<double> values_;
+	std::vector<double> buffer_;
+	std::vector<double> lanes_;
+	std::vector<double> results_;
+	std::vector<std::vector<LocalKnotVector> >            uniqueKnots_;
+	std::vector<std::vector<double> >                     uniqueValues_;
+	std::vector<std::vector<char> >                       uniqueInside_;
+};
+
+} // end namespace LR
+
+#endif
@@ -4,39 +4,60 @@
 #ifdef HAS_GOTOOLS
 	#include <GoTools/utils/Point.h>
 #endif
+#include <array>
+#include <atomic>
 #include <vector>
 #include "HashSet.h"
+#include "SmallVector.h"
+#include "ObjectPool.h"
+#include "KnotTable.h"
+#include "LocalKnotVector.h"
 #include "Streamable.h"
 #include "LRSpline.h"
 
 namespace LR {
 
 class Element;
+class BasisWorkspace;
+
+//! \brief Support list of a Basisfunction. Room for the 16 elements of a bicubic B-spline without any heap allocation
+typedef SmallVector<Element*, 16> BasisSupport;
+
+//! \brief Instruction sets used by the vectorized evaluation of univariate B-splines, see Basisfunction::setInstructionSet()
+enum simdInstructionSet {
+	SIMD_NONE   = 0,
+	SIMD_SSE2   = 1,
+	SIMD_AVX2   = 2,
+	SIMD_AVX512 = 3
+};
 
 /************************************************************************************************************************//**
  * \brief Basisfunction class to store the individual B-splines which make up the LR B-spline space
  * \details Stores the local knot vectors corresponding in each parametric direction (two for bivariate surfaces, three for
  *          trivariate volumes) as well as the control point and scaling weight. Used for evaluation of the B-splines and
  *          all their derivatives. The class does also have pointers back to the elements which they have support on
+ *
+ *          The control point and the knots are kept together in one memory block, taken from the same ObjectPool as the
+ *          function itself (as is the support list if it does not fit inside the object). Basisfunctions must therefore
+ *          always be created by new, on the heap or in a pool, and the knots are read through the LocalKnotVector views
+ *          given by operator[] and getknots(). In knot index mode the block holds the knot indices instead of the knot
+ *          values (see indexKnots())
  ***************************************************************************************************************************/
 class Basisfunction : public Streamable {
 public:
 	Basisfunction(int dim, int order_u, int order_v);
 	/************************************************************************************************************************//**
-	 * \brief Constructor for arbitray high parametric dimension
+	 * \brief Constructor for bivariate and trivariate functions with all knots and control point values zero
 	 * \param physDim The dimension in the physical space, i.e. the number of components of the controlpoints
-	 * \param parDim The dimension in the parametric space, i.e. the number of local knot vectors
+	 * \param parDim The dimension in the parametric space, i.e. the number of local knot vectors (at most 3)
 	 * \param order List of polynomial orders (degree + 1) in each parametric direction
 	 ***************************************************************************************************************************/
 	template <typename RandomIterator>
 	Basisfunction(int physDim, int parDim, RandomIterator order) {
-		weight_       = 1;
-		id_           = -1;
-		hashCode_     = 0;
-		knots_.resize(parDim);
-		for(int i=0; i<parDim; i++)
-			knots_[i].resize(order[i]+1);
-		controlpoint_.resize(physDim);
+		int orders[3] = {0, 0, 0};
+		for(int i=0; i<parDim && i<3; i++)
+			orders[i] = order[i];
+		init(physDim, parDim, orders, 1.0);
 	}
 
 	/************************************************************************************************************************//**
@@ -53,17 +74,13 @@ public:
 	          typename RandomIterator2,
 	          typename RandomIterator3>
 	Basisfunction(RandomIterator1 knot_u, RandomIterator2 knot_v, RandomIterator3 controlpoint, int dim, int order_u, int order_v, double weight=1.0) {
-		weight_       = weight ;
-		id_           = -1;
-		hashCode_     = 0;
-		knots_.resize(2);
-		knots_[0].resize(order_u+1);
-		knots_[1].resize(order_v+1);
-		controlpoint_.resize(dim);
-
-		std::copy(knot_u,       knot_u       + order_u+1,   knots_[0].begin());
-		std::copy(knot_v,       knot_v       + order_v+1,   knots_[1].begin());
-		std::copy(controlpoint, controlpoint + dim,         controlpoint_.begin());
+		int orders[] = {order_u, order_v};
+		init(dim, 2, orders, weight);
+		support_.reserve(order_u*order_v, ObjectPool<Basisfunction>::dataPool(this));
+
+		std::copy(knot_u,       knot_u       + order_u+1,   knotData(0));
+		std::copy(knot_v,       knot_v       + order_v+1,   knotData(1));
+		std::copy(controlpoint, controlpoint + dim,         data_);
 	}
 
 	/************************************************************************************************************************//**
@@ -83,22 +100,22 @@ public:
 	          typename RandomIterator3,
 	          typename RandomIterator4>
 	Basisfunction(RandomIterator1 knot_u, RandomIterator2 knot_v, RandomIterator3 knot_w, RandomIterator4 controlpoint, int dim, int order_u, int order_v, int order_w, double weight=1.0) {
-		weight_       = weight ;
-		id_           = -1;
-		hashCode_     = 0;
-		knots_.resize(3);
-		knots_[0].resize(order_u+1);
-		knots_[1].resize(order_v+1);
-		knots_[2].resize(order_w+1);
-		controlpoint_.resize(dim);
-
-		std::copy(knot_u,       knot_u       + order_u+1,   knots_[0].begin());
-		std::copy(knot_v,       knot_v       + order_v+1,   knots_[1].begin());
-		std::copy(knot_w,       knot_w       + order_w+1,   knots_[2].begin());
-		std::copy(controlpoint, controlpoint + dim,         controlpoint_.begin());
+		int orders[] = {order_u, order_v, order_w};
+		init(dim, 3, orders, weight);
+		support_.reserve(order_u*order_v*order_w, ObjectPool<Basisfunction>::dataPool(this));
+
+		std::copy(knot_u,       knot_u       + order_u+1,   knotData(0));
+		std::copy(knot_v,       knot_v       + order_v+1,   knotData(1));
+		std::copy(knot_w,       knot_w       + order_w+1,   knotData(2));
+		std::copy(controlpoint, controlpoint + dim,         data_);
 	}
 	virtual ~Basisfunction();
 	Basisfunction* copy() const;
+	// allocation, on the heap or in an ObjectPool owned by the spline (see ObjectPool)
+	static void* operator new(size_t size)                                  { return ObjectPool<Basisfunction>::allocate(size, NULL); };
+	static void* operator new(size_t size, ObjectPool<Basisfunction> *pool) { return ObjectPool<Basisfunction>::allocate(size, pool); };
+	static void  operator delete(void *p)                                   { ObjectPool<Basisfunction>::deallocate(p); };
+	static void  operator delete(void *p, ObjectPool<Basisfunction> *)      { ObjectPool<Basisfunction>::deallocate(p); };
 
 	//evaluation functions
 	double evaluate(double u, double v, bool u_from_right=true, bool v_from_right=true) const;
@@ -106,20 +123,88 @@ public:
 	void   evaluate(std::vector<double> &results, double u, double v, int derivs, bool u_from_right=true, bool v_from_right=true) const;
 	void   evaluate(std::vector<double> &results, double u, double v, double w, int derivs, bool u_from_right=true, bool v_from_right=true, bool w_from_right=true) const;
 	void   evaluate(std::vector<double> &results, const std::vector<double> &parPt, int derivs, const std::vector<bool> &from_right) const;
+	void   evaluate(double *results, const double *parPt, int derivs, const bool *from_right, BasisWorkspace &workspace) const;
+	void   evaluate(double *results, const double * const *univariate, int derivs) const;
+	static bool evaluateUnivariate(double *values, const LocalKnotVector &knot, double t, int derivs, bool from_right, BasisWorkspace &workspace);
+	static void evaluateUnivariate(double *values, char *inside, const LocalKnotVector &knot, const double *t, const bool *from_right, int nPts, int derivs, BasisWorkspace &workspace);
+	static int  nDerivatives(int parDim, int derivs);
+
+	/************************************************************************************************************************//**
+	 * \brief evaluates a univariate B-spline and all its derivatives, specialized at compile time on order and derivatives
+	 * \tparam P Polynomial order (degree+1), i.e. the local knot vector has P+1 entries
+	 * \tparam D Number of derivatives requested
+	 * \param values [out] Array of D+1 values; the function value and all derivatives up to order D
+	 * \param knot The local knot vector of the B-spline
+	 * \param t Parametric evaluation point
+	 * \param from_right Evaluate in the limit from the right
+	 * \returns False if t is outside the support of the B-spline, in which case values is not computed
+	 * \details Does exactly the same operations as the general evaluateUnivariate(), but on fixed size storage with all loop
+	 *          bounds known at compile time so the compiler can unroll the entire recursion. The general version dispatches to
+	 *          this for orders 2-5 and up to 3 derivatives.
+	 ***************************************************************************************************************************/
+	template <int P, int D>
+	static bool evaluateUnivariate(double *values, const double *knot, double t, bool from_right) {
+		const int L = (D < P-1) ? D : P-1; // highest non-vanishing derivative
+		if(knot[0] > t || t > knot[P])
+			return false;
+		std::array<std::array<double,P>,L+1> diff; // diff[0] is the function values
+		std::array<double,P> &ans = diff[0];
+		for(int j=0; j<P; j++) {
+			if(from_right)
+				ans[j] = (knot[j] <= t && t <  knot[j+1]) ? 1 : 0;
+			else
+				ans[j] = (knot[j] <  t && t <= knot[j+1]) ? 1 : 0;
+		}
+
+		for(int n=1; n<P; n++) {
+			int diff_level = P-n;
+			if(diff_level <= D)
+				for(int j=0; j<=diff_level; j++)
+					diff[diff_level][j] = ans[j];
+			for(int d = diff_level; d <= L; d++) {
+				for(int j=0; j<P-n; j++) {
+					diff[d][j]  = (knot[ j+n ]==knot[ j ]) ? 0 : (   n   )/(knot[j+n]  -knot[ j ])*diff[d][ j ];
+					diff[d][j] -= (knot[j+n+1]==knot[j+1]) ? 0 : (   n   )/(knot[j+n+1]-knot[j+1])*diff[d][j+1];
+				}
+			}
+			for(int j=0; j<P-n; j++) {
+				ans[j]  = (knot[ j+n ]==knot[ j ]) ? 0 : (  t-knot[j]  )/(knot[j+n]  -knot[ j ])*ans[ j ];
+				ans[j] += (knot[j+n+1]==knot[j+1]) ? 0 : (knot[j+n+1]-t)/(knot[j+n+1]-knot[j+1])*ans[j+1];
+			}
+		}
+
+		for(int d=0; d<=D; d++) // derivatives higher than the degree vanish
+			values[d] = (d > L) ? 0 : diff[d][0];
+		return true;
+	}
+
+	// vectorization
+	static simdInstructionSet supportedInstructionSet();
+	static simdInstructionSet getInstructionSet();
+	static bool               setInstructionSet(simdInstructionSet isa);
 
 	// Basisfunction -> Element interatcion (support)
 	bool                            overlaps(Element *el) const ;
 	bool                            addSupport(Element *el)     ;
 	bool                            removeSupport(Element *el)  ;
-	std::vector<Element*>::iterator supportedElementBegin(){ return support_.begin(); };
-	std::vector<Element*>::iterator supportedElementEnd()  { return support_.end();   };
-	const std::vector<Element*>     support() const        { return support_;         };
+	BasisSupport::iterator          supportedElementBegin(){ return support_.begin(); };
+	BasisSupport::iterator          supportedElementEnd()  { return support_.end();   };
+	const BasisSupport&             support() const        { return support_;         };
+	//! \brief Forgets all supported elements without removing this function from them. Only for when they are deleted as well
+	void                            clearSupport()         { support_.clear();        };
 	std::vector<Element*>           getExtendedSupport()        ;
 	std::vector<Element*>           getMinimalExtendedSupport() ;
 	HashSet<Basisfunction*>         getOverlappingFunctions() const ;
 	bool                            isOverloaded()     const    ;
 	int                             getOverloadCount() const    ;
 
+	// knot index mode (see LRSpline::setKnotIndexing)
+	void indexKnots(std::vector<KnotTable> &tables);
+	void clearKnotIndices();
+	//! \brief Returns true if the knots are stored as indices, in which case equals() and hashCode() use the indices
+	bool hasKnotIndices() const                  { return indexed_; };
+	size_t dataMemory() const;
+
 	// get/set methods
 	void setId(int id)  { this->id_ = id; };
 	void setDimension(int dim)  ;
@@ -132,16 +217,17 @@ public:
 	void   getGrevilleParameter(std::vector<double> &pt) const;
 	int    getId()                           const { return id_; };
 	int    nSupportedElements()              const { return support_.size(); };
-	int    nVariate()                        const { return knots_.size(); };
-	int    dim()                             const { return controlpoint_.size(); };
-	double getParmin(int i)                  const { return knots_[i][0];     };
-	double getParmax(int i)                  const { return knots_[i].back(); };
-	int    getOrder( int i)                  const { return knots_[i].size()-1;   };
-	std::vector<double>& getknots(int i)           { return knots_[i]; };
-	const std::vector<double>& getknots(int i) const { return knots_[i]; };
-	std::vector<double>::iterator cp()             { return controlpoint_.begin(); };
-	std::vector<double>::const_iterator cp() const { return controlpoint_.begin(); };
-	double cp(int i)                         const { return controlpoint_[i]; };
+	int    nVariate()                        const { return nVariate_; };
+	int    dim()                             const { return dim_; };
+	double getParmin(int i)                  const { return getknots(i).front(); };
+	double getParmax(int i)                  const { return getknots(i).back();  };
+	int    getOrder( int i)                  const { return order_[i];   };
+	LocalKnotVector getknots(int i)          const { return indexed_ ? LocalKnotVector(indexData(i), order_[i]+1, indexTables()+i)
+	                                                         : LocalKnotVector(knotData(i),  order_[i]+1); };
+	void   setKnot(int i, int j, double knot);
+	double* cp()                                   { return data_; };
+	const double* cp()                       const { return data_; };
+	double cp(int i)                         const { return data_[i]; };
 	double w()                               const { return weight_; };
 
 	long hashCode() const ;
@@ -152,8 +238,7 @@ public:
 	bool equals(const Basisfunction &other) const ;
 	bool operator==(const Basisfunction &other) const;
 	void operator+=(const Basisfunction &other) ;
-	std::vector<double>&       operator[](int i)       { return knots_[i]; } ;
-	const std::vector<double>& operator[](int i) const { return knots_[i]; } ;
+	LocalKnotVector operator[](int i) const { return getknots(i); } ;
 
 	// IO-functions
 	virtual void read(std::istream &is);
@@ -164,13 +249,39 @@ public:
 	void normalize(int pardir, double parmin, double parmax);
 
 private:
+	void init(int dim, int parDim, const int *order, double weight);
+	int  nKnots() const;
+	static size_t dataBytes(int dim, int nKnots, bool indexed);
+	void allocateData();
+	void releaseData();
+	//! \brief The local knot vector in direction i, stored after the control point and the knots of the previous directions
+	double* knotData(int i) const {
+		double *knot = data_ + dim_;
+		for(int j=0; j<i; j++)
+			knot += order_[j]+1;
+		return knot;
+	}
+	//! \brief The knot tables of an indexed function, stored after the control point
+	const KnotTable*& indexTables() const {
+		return *((const KnotTable**) (data_ + dim_));
+	}
+	//! \brief The knot indices in direction i of an indexed function, stored after the knot tables
+	KnotIndex* indexData(int i) const {
+		KnotIndex *index = (KnotIndex*) (&indexTables() + 1);
+		for(int j=0; j<i; j++)
+			index += order_[j]+1;
+		return index;
+	}
 
 	int                               id_;
+	int                               dim_;
+	unsigned char                     nVariate_;
+	unsigned char                     order_[3];
+	bool                              indexed_;    // the knots are stored as indices into knot tables (see indexKnots())
 	double                            weight_;
-	mutable long                      hashCode_;
-	std::vector<double>               controlpoint_;
-	std::vector<std::vector<double> > knots_;
-	std::vector<Element*>             support_;
+	mutable std::atomic<long>         hashCode_;   // computed on first use, 0 if not known
+	double                           *data_;       // the control point followed by the knots (or the knot indices) of each direction
+	BasisSupport                      support_;
 
 };
 
@@ -3,18 +3,26 @@
 
 #include "Streamable.h"
 #include <vector>
-#include "HashSet.h"
+#include <atomic>
+#include "SmallVector.h"
+#include "ObjectPool.h"
 
 namespace LR {
 
 class Basisfunction;
 class Meshline;
 
+//! \brief Support list of an Element. Room for the 16 functions of a bicubic element without any heap allocation
+typedef SmallVector<Basisfunction*, 16> ElementSupport;
+
 /************************************************************************************************************************//**
  * \brief Element class to partition the parametric space into subrectangles where all Basisfunctions are infitely differentiable
  * \details Stores the parametric bounding box of an element as well as a pointer to all the Basisfunctions which are active
  *          on this element. It is noteworthy to state that all computations on the Element class take place in the parametric
  *          space rather than in the physical (geometry) space. This class is shared by both LRSplineVolume and LRSplineSurface
+ *
+ *          A support list which does not fit inside the object is kept in the ObjectPool of the element, so elements must
+ *          always be created by new (on the heap or in a pool)
  ***************************************************************************************************************************/
 class Element : public Streamable {
 
@@ -31,19 +39,25 @@ public:
 	template <typename RandomIterator1,
 	          typename RandomIterator2>
 	Element(int dim, RandomIterator1 lowerLeft, RandomIterator2 upperRight) {
-		min.resize(dim);
-		max.resize(dim);
-		std::copy(lowerLeft,  lowerLeft  + dim, min.begin());
-		std::copy(upperRight, upperRight + dim, max.begin());
+		dim_ = dim;
+		std::copy(lowerLeft,  lowerLeft  + dim, min);
+		std::copy(upperRight, upperRight + dim, max);
 		id_           = -1;
 		overloadCount = 0;
+		revision_     = newRevision();
+		bezierValid_  = false;
 	}
 	Element(std::vector<double> &lowerLeft, std::vector<double> &upperRight);
 	void removeSupportFunction(Basisfunction *f);
 	void addSupportFunction(Basisfunction *f);
-	Element *split(int splitDim, double par_value);
+	Element *split(int splitDim, double par_value, ObjectPool<Element> *pool=NULL);
 	Element* copy();
 	virtual ~Element() {}
+	// allocation, on the heap or in an ObjectPool owned by the spline (see ObjectPool)
+	static void* operator new(size_t size)                            { return ObjectPool<Element>::allocate(size, NULL); };
+	static void* operator new(size_t size, ObjectPool<Element> *pool) { return ObjectPool<Element>::allocate(size, pool); };
+	static void  operator delete(void *p)                             { ObjectPool<Element>::deallocate(p); };
+	static void  operator delete(void *p, ObjectPool<Element> *)      { ObjectPool<Element>::deallocate(p); };
 	// get/set methods
 	//! \brief Get coordinate i of the lower left corner of the element
 	double getParmin(int i) const { return min[i]; };
@@ -60,11 +74,11 @@ public:
 	double area()           const { return (max[1]-min[1])*(max[0]-min[0]);                  };
 	//! \brief Returns the parametric volume of the element
 	double volume()         const { return (max[2]-min[2])*(max[1]-min[1])*(max[0]-min[0]);  };
-	HashSet_iterator<Basisfunction*> supportBegin()                 { return support_.begin(); };
-	HashSet_iterator<Basisfunction*> supportEnd()                   { return support_.end();   };
-	HashSet_const_iterator<Basisfunction*> constSupportBegin()const { return support_.begin(); };
-	HashSet_const_iterator<Basisfunction*> constSupportEnd()  const { return support_.end();   };
-	const HashSet<Basisfunction*>& support()                  const { return support_;   };
+	ElementSupport::iterator       supportBegin()                   { return support_.begin(); };
+	ElementSupport::iterator       supportEnd()                     { return support_.end();   };
+	ElementSupport::const_iterator constSupportBegin()        const { return support_.begin(); };
+	ElementSupport::const_iterator constSupportEnd()          const { return support_.end();   };
+	const ElementSupport&          support()                  const { return support_;         };
 	//! \brief Returns the number of Basisfunctions with support on this element
 	int nBasisFunctions() const           { return support_.size(); };
 	//! \brief Sets a general purpose indexing id to this element
@@ -72,11 +86,21 @@ public:
 	//! \brief Gets the id set by the Element::setId function
 	int  getId() const                    { return id_; };
 	//! \brief Gets the dimension of the element (2 for surfaces, 3 for volumes)
-	int  getDim() const                   { return min.size(); };
-	void setUmin(double u)                { min[0] = u; };
-	void setVmin(double v)                { min[1] = v; };
-	void setUmax(double u)                { max[0] = u; };
-	void setVmax(double v)                { max[1] = v; };
+	int  getDim() const                   { return dim_; };
+	void setUmin(double u)                { min[0] = u; changed(); };
+	void setVmin(double v)                { min[1] = v; changed(); };
+	void setUmax(double u)                { max[0] = u; changed(); };
+	void setVmax(double v)                { max[1] = v; changed(); };
+	//! \brief Cached Bezier control points of this element (see LRSpline::getBezierCache). Is emptied whenever the element changes
+	const std::vector<double>& bezierCache() const { return bezier_; };
+	//! \brief Returns true if the Bezier control points are cached. Safe to call while another thread sets them
+	bool hasBezierCache() const           { return bezierValid_; };
+	//! \brief Stores the Bezier control points (by swapping with the argument) and marks them as valid
+	void setBezierCache(std::vector<double> &controlPoints) { bezier_.swap(controlPoints); bezierValid_ = true; };
+	//! \brief Throws away the cached Bezier control points
+	void clearBezierCache()               { bezierValid_ = false; bezier_.clear(); };
+	//! \brief Number which is unique to this element and its current bounds and support. Changes whenever either of them change
+	unsigned long long revision() const   { return revision_; };
 
 	bool isOverloaded() const;
 	void resetOverloadCount()    { overloadCount = 0;      }
@@ -89,15 +113,24 @@ public:
 	virtual void write(std::ostream &os) const;
 
 private:
-	std::vector<double> min;  // lower left corner in typical 2 or 3 dimensions
-	std::vector<double> max;  // upper right corner
+	double min[3]; // lower left corner in 2 or 3 dimensions (stored inline, as there are no elements of higher dimension)
+	double max[3]; // upper right corner
+	int    dim_;
 	int id_;
 
-	HashSet<Basisfunction*> support_;
+	ElementSupport   support_;
 	std::vector<int> support_ids_; // temporary storage for the read() method only
 
 	int overloadCount ;
 
+	std::vector<double> bezier_; // cached Bezier control points, only valid if bezierValid_
+	std::atomic<bool>   bezierValid_;
+	unsigned long long  revision_;
+
+	static unsigned long long newRevision();
+	//! \brief Invalidates everything cached on this element, called whenever the bounds or support changes
+	void changed() { clearBezierCache(); revision_ = newRevision(); };
+
 };
 
 } // end namespace LR
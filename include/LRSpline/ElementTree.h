@@ -0,0 +1,66 @@
+#ifndef ELEMENT_TREE_H
+#define ELEMENT_TREE_H
+
+#include <vector>
+#include <set>
+#include <cstddef>
+
+namespace LR {
+
+class Element;
+
+/************************************************************************************************************************//**
+ * \brief Bounding box tree over the elements of an LR mesh, used to locate elements by parametric coordinates
+ * \details This is the alternative to the dense tensor table used by LRSplineSurface and LRSplineVolume (see
+ *          LOCATOR_TREE). The elements are recursively split in two halves by their midpoint along the widest direction,
+ *          giving a balanced binary tree where every node stores the bounding box of its elements. The memory is
+ *          proportional to the number of elements, no matter how many unique knots the mesh has.
+ *
+ *          The tree is kept up to date during refinement by split(): an element can only be split into parts inside its
+ *          old box, so the new part is simply added to the leaf of the old one. Leaves which grow too large are
+ *          rebuilt locally, and the whole tree is rebuilt when the number of elements has doubled or when the local
+ *          rebuilds have made it too deep.
+ ***************************************************************************************************************************/
+class ElementTree {
+
+public:
+	ElementTree() : parDim_(0), nBuilt_(0) {};
+
+	void build(const std::vector<Element*> &elements, const std::vector<double> &end);
+	void split(const std::vector<Element*> &elements, int iEl, int iNew);
+	void clear();
+
+	int  getElementContaining(const double *par) const;
+	void getElementNeighbours(int iEl, int dir, bool upper, std::set<int> &result) const;
+	void getElementsOverlapping(const double *lo, const double *hi, std::vector<int> &result) const;
+
+	size_t memoryFootprint() const;
+
+private:
+	//! \brief Tree node. Internal nodes have their children in node_[left] and node_[left+1], while leaves have left = -1
+	//!        and keep a list of count elements starting at first (see next_)
+	struct Node {
+		double lo[3];
+		double hi[3];
+		int    left;
+		int    first;
+		int    count;
+		int    depth; // number of nodes above this one
+	};
+
+	void buildNode(int iNode, std::vector<int>::iterator first, std::vector<int>::iterator last, int depth);
+	void setBox(int iEl, const Element *el);
+	bool contains(int iEl, const double *par) const;
+
+	int parDim_;
+	int nBuilt_;                // number of elements at the last full build
+	double end_[3];
+	std::vector<double> box_;   // element bounding boxes stored as [element][lo/hi][parametric direction]
+	std::vector<int>    next_;  // next element in the same leaf, or -1 at the end of the list
+	std::vector<int>    leaf_;  // leaf node holding each element
+	std::vector<Node>   node_;  // tree nodes, the root is node_[0]
+};
+
+} // end namespace LR
+
+#endif
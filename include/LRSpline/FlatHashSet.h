@@ -0,0 +1,370 @@
+#ifndef FLAT_HASHSET_H
+#define FLAT_HASHSET_H
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <cstddef>
+
+/*!
+	\brief FlatHashSet iterator which allows for iteration over the FlatHashSet class
+	\details The iterator walks the dense array of elements in the order they were inserted, skipping the holes left behind by
+	         erased elements
+*/
+
+template<typename T>
+class FlatHashSet_iterator
+         :public std::iterator<std::forward_iterator_tag,     // type of iterator
+                               T,ptrdiff_t,T*,T&>             // Info about iterator
+{
+
+public:
+
+	//! \brief Default constructor
+	FlatHashSet_iterator() {
+		pos  = NULL;
+		last = NULL;
+	}
+
+	//! \brief Default constructor
+	//! \param pos  iterator position in the element array
+	//! \param last end of the element array
+	FlatHashSet_iterator(T *pos, T *last) {
+		this->pos  = pos;
+		this->last = last;
+		skipHoles();
+	}
+
+	//! \brief Dereferencing the iterator returns an object of class <T>
+	T& operator*() const {
+		return *pos;
+	}
+
+	//! \brief Dereferencing the iterator returns an object of class <T>
+	T* operator->() const {
+		return pos;
+	}
+
+	FlatHashSet_iterator& operator++() {
+		pos++;
+		skipHoles();
+		return *this;
+	}
+
+	bool equal(FlatHashSet_iterator const& rhs) const {
+		return pos == rhs.pos;
+	}
+
+private:
+	void skipHoles() {
+		while(pos != last && *pos == T())
+			pos++;
+	}
+
+	T *pos;
+	T *last;
+
+};
+
+/*!
+	\brief const version of the FlatHashSet iterator
+*/
+template<typename T>
+class FlatHashSet_const_iterator
+         :public std::iterator<std::forward_iterator_tag,     // type of iterator
+                               T,ptrdiff_t,const T*,const T&> // Info about iterator
+{
+
+public:
+
+	//! \brief Default constructor
+	FlatHashSet_const_iterator() {
+		pos  = NULL;
+		last = NULL;
+	}
+
+	//! \brief Default constructor
+	//! \param pos  iterator position in the element array
+	//! \param last end of the element array
+	FlatHashSet_const_iterator(const T *pos, const T *last) {
+		this->pos  = pos;
+		this->last = last;
+		skipHoles();
+	}
+
+	//! \brief Dereferencing the iterator returns an object of class <T>
+	const T& operator*() const {
+		return *pos;
+	}
+
+	//! \brief Dereferencing the iterator returns an object of class <T>
+	const T* operator->() const {
+		return pos;
+	}
+
+	FlatHashSet_const_iterator& operator++() {
+		pos++;
+		skipHoles();
+		return *this;
+	}
+
+	bool equal(FlatHashSet_const_iterator const& rhs) const {
+		return pos == rhs.pos;
+	}
+
+private:
+	void skipHoles() {
+		while(pos != last && *pos == T())
+			pos++;
+	}
+
+	const T *pos;
+	const T *last;
+
+};
+
+template<typename T>
+inline bool operator!=(FlatHashSet_iterator<T> const& lhs, FlatHashSet_iterator<T> const& rhs)
+{
+	return !lhs.equal(rhs);
+}
+
+template<typename T>
+inline bool operator==(FlatHashSet_iterator<T> const& lhs, FlatHashSet_iterator<T> const& rhs)
+{
+	return lhs.equal(rhs);
+}
+
+template<typename T>
+inline bool operator!=(FlatHashSet_const_iterator<T> const& lhs, FlatHashSet_const_iterator<T> const& rhs)
+{
+	return !lhs.equal(rhs);
+}
+
+template<typename T>
+inline bool operator==(FlatHashSet_const_iterator<T> const& lhs, FlatHashSet_const_iterator<T> const& rhs)
+{
+	return lhs.equal(rhs);
+}
+
+
+/*!
+	\brief HashSet container using open addressing, which only contains truly unique elements
+	\details Same interface and semantics as MapHashSet: the class T is a pointer to an object implementing hashCode() and
+	         equals(), and elements that pass the equality-test must produce the same hash code. The elements are kept in a
+	         dense array in the order they were inserted (which is also the iteration order), while a power-of-two table of
+	         indices into this array is searched by linear probing. The hash code of every element is stored next to it, so
+	         equals() is only called when the full hash codes match. Erased elements leave a hole in the array, which is
+	         compacted away once there are more holes than elements.
+
+	         Inserting or erasing elements invalidates all iterators. Null pointers can not be stored.
+*/
+
+template <class T>
+class FlatHashSet {
+
+public:
+
+	//! \brief Default constructor
+	//! \details Creates an empty container
+	FlatHashSet() {
+		numb  = 0;
+		shift = 64;
+	}
+
+	//! \brief insert an element in the container if it does not already exist
+	//! \param obj the element to insert
+	//! \details on the occasion that the element do already exist in the set, no action is taken.
+	//!          Complexity: constant on average, linear in hash collisions
+	void insert(const T &obj) {
+		long hc = obj->hashCode();
+		if(2*(numb+1) > (int) slot.size())
+			rehash(std::max<size_t>(16, 2*slot.size()));
+		size_t i = findSlot(obj, hc);
+		if(slot[i] >= 0)
+			return;
+		slot[i] = entry.size();
+		entry.push_back(obj);
+		hash.push_back(hc);
+		numb++;
+	}
+
+	//! \brief erase an element in the container if it does exist
+	//! \param obj the element to remove
+	//! \returns 0 if no elements were removed, 1 if it did exist and was successfully removed
+	//! \details Complexity: constant on average, linear in hash collisions
+	int erase(const T &obj) {
+		if(numb == 0)
+			return 0;
+		size_t i = findSlot(obj, obj->hashCode());
+		if(slot[i] < 0)
+			return 0;
+		eraseSlot(i);
+		return 1;
+	}
+
+	//! \brief Searches the container for an element and returns an iterator to it if found, otherwise it returns an iterator to end()
+	//! \param obj The element to search for
+	//! \details Complexity: constant on average, linear in hash collisions
+	FlatHashSet_iterator<T> find(const T &obj) {
+		if(numb == 0)
+			return end();
+		size_t i = findSlot(obj, obj->hashCode());
+		if(slot[i] < 0)
+			return end();
+		return FlatHashSet_iterator<T>(entry.data() + slot[i], entry.data() + entry.size());
+	}
+
+	//! \brief returns the last inserted element, and removes this from the container
+	T pop() {
+		if(numb == 0)
+			return NULL;
+
+		T ans = entry.back();
+		int k = entry.size() - 1;
+		size_t mask = slot.size() - 1;
+		size_t i = bucket(hash[k]);
+		while(slot[i] != k)
+			i = (i+1) & mask;
+		eraseSlot(i);
+		return ans;
+	}
+
+	//! \brief clears the container
+	void clear() {
+		std::vector<T>().swap(entry);
+		std::vector<long>().swap(hash);
+		std::vector<int>().swap(slot);
+		numb  = 0;
+		shift = 64;
+	}
+
+	//! \brief returns the number of unique hash codes in this container
+	//! \details this is the number of elements that produce distinct value upon calling T::hashFunction()
+	int uniqueHashCodes() const {
+		std::vector<long> codes;
+		for(size_t k=0; k<entry.size(); k++)
+			if(entry[k] != T())
+				codes.push_back(hash[k]);
+		std::sort(codes.begin(), codes.end());
+		return std::unique(codes.begin(), codes.end()) - codes.begin();
+	}
+
+	//! \brief returns the number of unique elements in the container
+	//! \details this is the number of elements that produce false upon calling T::equals()
+	int size() const {
+		return numb;
+	}
+
+	//! \brief sorts some of the elements in the container into the order they are iterated over
+	//! \param objs elements which are all in the container. Repeated elements end up next to each other
+	//! \details Complexity: n log(n) in the number of objs, independent of the size of the container
+	void sortByIterationOrder(std::vector<T> &objs) const {
+		std::vector<std::pair<int,T> > pos(objs.size());
+		for(size_t i=0; i<objs.size(); i++)
+			pos[i] = std::make_pair(slot[findSlot(objs[i], objs[i]->hashCode())], objs[i]);
+		std::sort(pos.begin(), pos.end(), [](const std::pair<int,T> &a, const std::pair<int,T> &b) { return a.first < b.first; });
+		for(size_t i=0; i<objs.size(); i++)
+			objs[i] = pos[i].second;
+	}
+
+	//! \brief iterator to the beginning of the container.
+	//! \details dereferencing the iterator returns an object of class <T>
+	FlatHashSet_const_iterator<T> begin() const {
+		return FlatHashSet_const_iterator<T>(entry.data(), entry.data() + entry.size());
+	}
+
+	//! \brief iterator to one past the last element
+	//! \details dereferencing the iterator returns an object of class <T>
+	FlatHashSet_const_iterator<T> end() const {
+		return FlatHashSet_const_iterator<T>(entry.data() + entry.size(), entry.data() + entry.size());
+	}
+
+	//! \brief iterator to the beginning of the container.
+	//! \details dereferencing the iterator returns an object of class <T>
+	FlatHashSet_iterator<T> begin() {
+		return FlatHashSet_iterator<T>(entry.data(), entry.data() + entry.size());
+	}
+
+	//! \brief iterator to one past the last element
+	//! \details dereferencing the iterator returns an object of class <T>
+	FlatHashSet_iterator<T> end() {
+		return FlatHashSet_iterator<T>(entry.data() + entry.size(), entry.data() + entry.size());
+	}
+
+private:
+	//! \brief home slot of a hash code. The hash codes are not well distributed in the lower bits, so they are mixed by
+	//!        Fibonacci hashing (multiplication by 2^64 divided by the golden ratio), keeping the upper bits
+	size_t bucket(long hc) const {
+		return (size_t) (((unsigned long long) hc * 11400714819323198485ull) >> shift);
+	}
+
+	//! \brief returns the slot holding an element equal to obj, or the empty slot where it should be put
+	size_t findSlot(const T &obj, long hc) const {
+		size_t mask = slot.size() - 1;
+		for(size_t i=bucket(hc); ; i=(i+1) & mask) {
+			int k = slot[i];
+			if(k < 0 || (hash[k] == hc && obj->equals(*entry[k])))
+				return i;
+		}
+	}
+
+	//! \brief removes the element in slot i, and moves the following elements in the same probe sequence back so that no
+	//!        tombstones are needed in the table
+	void eraseSlot(size_t i) {
+		entry[slot[i]] = T();
+		numb--;
+		size_t mask = slot.size() - 1;
+		for(size_t j=(i+1) & mask; slot[j] >= 0; j=(j+1) & mask) {
+			size_t home = bucket(hash[slot[j]]);
+			if(((j-home) & mask) >= ((j-i) & mask)) {
+				slot[i] = slot[j];
+				i = j;
+			}
+		}
+		slot[i] = -1;
+
+		while(!entry.empty() && entry.back() == T()) {
+			entry.pop_back();
+			hash.pop_back();
+		}
+		if(entry.size() > 2*(size_t)numb + 8)
+			rehash(slot.size());
+	}
+
+	//! \brief compacts the element array and rebuilds the table with nSlots slots (a power of two)
+	void rehash(size_t nSlots) {
+		size_t n = 0;
+		for(size_t k=0; k<entry.size(); k++) {
+			if(entry[k] != T()) {
+				entry[n] = entry[k];
+				hash[n]  = hash[k];
+				n++;
+			}
+		}
+		entry.resize(n);
+		hash.resize(n);
+
+		shift = 64;
+		for(size_t s=nSlots; s>1; s/=2)
+			shift--;
+		slot.assign(nSlots, -1);
+		size_t mask = nSlots - 1;
+		for(size_t k=0; k<n; k++) {
+			size_t i = bucket(hash[k]);
+			while(slot[i] >= 0)
+				i = (i+1) & mask;
+			slot[i] = k;
+		}
+	}
+
+	std::vector<T>    entry; // all elements in insertion order, with erased ones set to null
+	std::vector<long> hash;  // hash code of each element in entry
+	std::vector<int>  slot;  // open addressing table of indices into entry, -1 for empty slots
+	int  numb;
+	int  shift;              // 64 - log2(slot.size())
+
+};
+
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef KNOT_TABLE_H
+#define KNOT_TABLE_H
+
+#include <vector>
+#include <cstddef>
+
+namespace LR {
+
+//! \brief Index of a knot in a KnotTable, as stored by the basis functions in knot index mode
+typedef unsigned short KnotIndex;
+
+/************************************************************************************************************************//**
+ * \brief Table of all unique knot values in one parametric direction of a spline, used by the knot index mode
+ * \details Every knot value is given a small integer index, so that basis functions can be compared and hashed by their
+ *          knot indices instead of by the knot values themselves (see LRSpline::setKnotIndexing). Values closer than
+ *          Basisfunction::equals() tolerates (1e-10) share the same index.
+ *
+ *          The indices are handed out in the order the knots are added and never change, so that inserting new meshlines
+ *          does not invalidate the indices (and hash codes) of the existing functions. A list of the indices sorted by
+ *          knot value is kept alongside for lookup.
+ *
+ *          Indexed basis functions store only the indices, and read their knot values from the table. The indices are 16 bits,
+ *          so a table holds at most MAX_KNOTS unique knots.
+ ***************************************************************************************************************************/
+class KnotTable {
+
+public:
+	//! \brief Largest number of unique knots in one table, given by the size of KnotIndex
+	static const int MAX_KNOTS = 65536;
+
+	KnotTable() {};
+
+	KnotIndex    index(double knot);
+	int          find(double knot) const;
+	void         clear();
+
+	//! \brief Returns the knot value with the given index
+	double value(KnotIndex i)    const { return value_[i]; };
+	//! \brief Returns the number of unique knots
+	int    size()                const { return value_.size(); };
+
+	size_t memoryFootprint() const;
+
+private:
+	size_t lowerBound(double knot) const;
+
+	std::vector<double>       value_;  // all unique knots, in the order they were added
+	std::vector<KnotIndex>    sorted_; // indices into value_, sorted by knot value
+};
+
+} // end namespace LR
+
+#endif
@@ -3,7 +3,13 @@
 
 #include "HashSet.h"
 #include "Streamable.h"
+#include "ObjectPool.h"
+#include "KnotTable.h"
 #include <vector>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <functional>
 
 enum refinementStrategy {
 	LR_MINSPAN         = 0,
@@ -31,6 +37,24 @@ SOUTH_EAST = 6,    // 000110
 NORTH_WEST = 9,    // 001001
 NORTH_EAST = 10};  // 001010
 
+// memory layout of external coefficient arrays, see LRSplineSurface::pointField
+enum coefficientLayout {
+ROW_MAJOR    = 0,  // coefs[id*nComp + component], i.e. all components of one basis function are stored together
+COLUMN_MAJOR = 1}; // coefs[component*nBasisFunctions() + id], i.e. each component (field) is stored as one vector
+
+// data structure used to look up elements by parametric coordinates, see LRSpline::setElementLocator
+enum elementLocator {
+LOCATOR_GRID = 0,  // dense table over all unique knots: fastest lookup, but the memory is the product of the number of unique knots
+LOCATOR_TREE = 1}; // bounding box tree over the elements (see ElementTree): memory proportional to the number of elements
+
+// order of the basis functions and elements, see LRSpline::renumberBasisfunctions and LRSpline::renumberElements
+enum numberingScheme {
+NUMBER_CREATION = 0,  // the order they were created in by refinement (nothing is changed)
+NUMBER_GREVILLE = 1,  // lexicographic by Greville point (element midpoint), last parametric direction running slowest
+NUMBER_MORTON   = 2,  // along the Morton (Z-order) space-filling curve through the Greville points
+NUMBER_HILBERT  = 3,  // along the Hilbert space-filling curve through the Greville points
+NUMBER_RCM      = 4}; // reverse Cuthill-McKee on the overlap graph, i.e. minimizing the bandwidth of the system matrices
+
 inline parameterEdge operator|(parameterEdge a, parameterEdge b)
 {return static_cast<parameterEdge>(static_cast<int>(a) | static_cast<int>(b));}
 
@@ -38,6 +62,7 @@ typedef enum parameterEdge parameterEdge;
 
 class Element;
 class Basisfunction;
+class BasisWorkspace;
 
 class LRSpline : public Streamable {
 
@@ -46,6 +71,7 @@ public:
         virtual ~LRSpline() {}
 
 	virtual void generateIDs() const;
+	void requireBasisTable() const;
 
 	// common get methods
 
@@ -78,6 +104,34 @@ public:
 	virtual void getBezierExtraction(int iEl, std::vector<double> &extractMatrix) const = 0;
 	virtual int getElementContaining(const std::vector<double>& parvalues) const = 0;
 
+	// element lookup structure
+	//! \brief selects the data structure used by getElementContaining(), it is rebuilt on the next lookup
+	virtual void setElementLocator(elementLocator type) = 0;
+	//! \brief returns the data structure used by getElementContaining()
+	elementLocator getElementLocator() const { return locator_; };
+	//! \brief returns the number of bytes used by the current element lookup structure (zero if it is not built)
+	virtual size_t elementLocatorMemory() const = 0;
+
+	// knot index mode
+	void setKnotIndexing(bool on);
+	//! \brief returns true if the basis functions are compared and hashed by knot indices (see setKnotIndexing())
+	bool getKnotIndexing() const             { return knotIndexing_;  };
+	//! \brief returns the table of all unique knots in parametric direction i. Only available in knot index mode
+	const KnotTable& getKnotTable(int i) const { return knotTable_[i]; };
+
+	// numbering
+	void renumberBasisfunctions(numberingScheme scheme);
+	void renumberElements(numberingScheme scheme);
+
+	// Bezier evaluation
+	const std::vector<double>& getBezierCache(int iEl) const;
+	void buildBezierCache() const;
+	void clearBezierCache() const;
+
+	// evaluation functions
+	void computeElementBasis(double *results, const double *parPt, int derivs, const bool *from_right, int iEl, BasisWorkspace &workspace) const;
+	void computeElementBasis(double *results, const double *parPt, int derivs, const bool *from_right, Basisfunction * const *functions, int nFunctions, BasisWorkspace &workspace) const;
+
 	// get container iterators
 	std::vector<Element*>::iterator        elementBegin()         { return element_.begin(); };
 	std::vector<Element*>::iterator        elementEnd()           { return element_.end();   };
@@ -91,21 +145,19 @@ public:
 	// traditional get methods
 	Element* getElement(int i)                                     { return element_[i]; };
 	const Element* getElement(int i) const                         { return element_[i]; };
+	//! \brief Returns the basis function with id iBasis (see generateIDs()) in constant time, or NULL if out of range
 	Basisfunction* getBasisfunction(int iBasis) {
 		if(iBasis<0 || iBasis>=basis_.size())
 			return NULL;
-		HashSet_iterator<Basisfunction*> it=basis_.begin();
-		for(int i=0; i<iBasis; i++)
-			++it;
-		return *it;
+		requireBasisTable();
+		return basisTable_[iBasis];
 	}
+	//! \brief Returns the basis function with id iBasis (see generateIDs()) in constant time, or NULL if out of range
 	const Basisfunction* getBasisfunction(int iBasis) const {
 		if(iBasis<0 || iBasis>=basis_.size())
 			return NULL;
-		HashSet_const_iterator<Basisfunction*> it=basis_.begin();
-		for(int i=0; i<iBasis; i++)
-			++it;
-		return *it;
+		requireBasisTable();
+		return basisTable_[iBasis];
 	}
 
 	// refinement functions
@@ -124,6 +176,13 @@ public:
 	void setRefMultiplicity(int mult)               { refKnotlineMult_ = mult;     };
 	void setMaxTjoints(int n)                       { maxTjoints_      = n;        };
 	void setCloseGaps(bool doClose)                 { doCloseGaps_     = doClose;  };
+	//! \brief Lets refineElement() and refineBasisFunction() of surfaces insert all new lines in one batch. Volumes always insert
+	//!        their meshrectangles one by one, since the basis depends on the order they come in, and refuse this with a warning
+	void setBatchRefinement(bool batch);
+	//! \brief Number of threads splitting the basis functions in batch refinement of surfaces. Only the function split and
+	//!        the support update run on the threads, merging the lines into the mesh and splitting the elements does not.
+	//!        Volumes are always refined on one thread, and refuse more with a warning
+	void setRefinementThreads(int nThreads);
 	void setMaxAspectRatio(double r, bool aposterioriFix=true) {
 		maxAspectRatio_ = r;
 		doAspectRatioFix_ = aposterioriFix;
@@ -150,10 +209,28 @@ protected:
 	std::vector<double> end_   ; //! \brief parametric stop coordinate (2 components for surfaces, 3 for volumes)
 	std::vector<int>    order_ ; //! \brief polynomial order (degree + 1) in each parametric direction (2 or 3 components)
 
+	// memory for the building blocks created by this spline. Deleting them returns the memory to the pools, which are
+	// released as a whole when the spline is destroyed. The knots, control points and long support lists are pooled too
+	ObjectPool<Basisfunction> basisPool_;
+	ObjectPool<Element>       elementPool_;
+	std::deque<ObjectPool<Basisfunction> > threadPools_; // for the functions created on the other threads of batch refinement
+
 	// core storage places for the building blocks
 	std::vector<Basisfunction*> basisVector; // only used in read/write functions
 	HashSet<Basisfunction*> basis_;
 	std::vector<Element*> element_;
+	mutable std::vector<Basisfunction*> basisTable_; // all basis functions indexed by their id, built by generateIDs()
+	mutable std::atomic<bool> validBasisTable_;  // all ids and basisTable_ are up to date
+	mutable std::mutex    elementCacheLock_;     // guards renumbering the ids and building the element lookup structure
+	mutable std::mutex    bezierLock_; // guards storing new Bezier elements in getBezierCache()
+	elementLocator        locator_;    // lookup structure used by getElementContaining()
+	bool                   knotIndexing_; // functions are compared and hashed by indices into knotTable_
+	std::vector<KnotTable> knotTable_;    // all unique knots in each parametric direction, only in knot index mode
+
+	//! \brief Brings the element lookup structure, all ids and basisTable_ up to date (if they are not already)
+	virtual void requireElementCache() const = 0;
+	//! \brief Marks the element lookup structure and all ids as out of date, so they are rebuilt on the next lookup
+	virtual void invalidateElementCache() = 0;
 
 	// refinement parameters
 	enum refinementStrategy refStrat_;
@@ -161,9 +238,40 @@ protected:
 	int                     symmetry_;
 	int                     maxTjoints_;
 	bool                    doCloseGaps_;
+	bool                    batchRefinement_; // refineElement() and refineBasisFunction() insert all lines in one batch (surfaces only)
+	int                     refineThreads_;   // number of threads splitting the basis functions in batch refinement (surfaces only)
 	bool                    doAspectRatioFix_;
 	double                  maxAspectRatio_;
 
+	// tensor grid and batch evaluation
+	static void getGridCells(const std::vector<double> &grid, const std::vector<double> &globKnot, std::vector<int> &cells);
+	static void getKnotBuckets(const std::vector<double> &globKnot, std::vector<int> &bucket);
+	static void getKnotSpans(const std::vector<double> &globKnot, const std::vector<int> &bucket, const double *t, int n, int *cells);
+	static void insertKnots(std::vector<double> &knot, int order, const std::vector<double> &newKnots, std::vector<double> &alpha);
+
+	//! \brief The functions split together in batch refinement. The supports of different groups do not overlap, so that the
+	//!        groups can be split at the same time, and basis_ is only changed when all groups are done
+	struct SplitGroup {
+		std::vector<Basisfunction*> candidates;   // functions which may be split, in the order they are iterated over in basis_
+		std::vector<Basisfunction*> removed;      // candidates which were split, to be removed from basis_
+		std::vector<Basisfunction*> created;      // the new functions, in the order they are added to basis_
+		HashSet<Basisfunction*>     split;        // same as removed
+		HashSet<Basisfunction*>     done;         // same as created
+		HashSet<Basisfunction*>     newFunctions; // new functions which may be split further
+		ObjectPool<Basisfunction>  *pool;         // where the new functions are allocated, the pool of the thread splitting the group
+	};
+	static void groupBySupport(const std::vector<Basisfunction*> &functions, std::vector<SplitGroup> &groups);
+	static void runGroups(int nGroups, int nThreads, const std::function<void(int,int)> &work);
+	void requireThreadPools(int nThreads);
+	//! \brief Returns the pool for the basis functions created on thread t of runGroups(), which thread 0 shares with the rest of the spline
+	ObjectPool<Basisfunction>* threadPool(int t) { return (t == 0) ? &basisPool_ : &threadPools_[t-1]; };
+	void addSplitFunction(Basisfunction *f, SplitGroup &group);
+	void evaluateGridElement(double *out, int iEl, const std::vector<double> *grid, const int *start, const int *stop, const int *stride, int derivs) const;
+	void evaluateElementPoints(double *out, int iEl, const double * const *parPt, const int *index, int nPts, int derivs) const;
+	void evaluateBezier(double *pts, const double *parPt, int derivs, int iEl) const;
+	void evaluateField(double *out, const double *parPt, const bool *from_right, int derivs, int iEl,
+	                   const double *coefs, int nComp, coefficientLayout layout) const;
+
 	// caching stuff
 	static std::vector<double> getUniformKnotVector(int n, int p) {
 		std::vector<double> result(n+p);
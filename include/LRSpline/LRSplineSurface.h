@@ -2,6 +2,8 @@
 #define LRSPLINESURFACE_H
 
 #include <vector>
+#include <atomic>
+#include <mutex>
 #ifdef HAS_GOTOOLS
 	#include <GoTools/utils/Point.h>
 	#include <GoTools/geometry/SplineSurface.h>
@@ -16,8 +18,10 @@
 #include "LRSpline.h"
 #include "Basisfunction.h"
 #include "Meshline.h"
+#include "MeshlineIndex.h"
 #include "Element.h"
 #include "HashSet.h"
+#include "ElementTree.h"
 
 #ifdef HAS_GOTOOLS
 #ifndef GOTOOLS_HAS_BASISDERIVS_SF3
@@ -121,6 +125,12 @@ public:
 	virtual void point(std::vector<double> &pt, double u, double v, int iEl, bool u_from_right, bool v_from_right) const;
 	virtual void point(std::vector<std::vector<double> > &pts, double upar, double vpar, int derivs, int iEl=-1) const;
 	virtual void point(std::vector<std::vector<double> > &pts, double upar, double vpar, int derivs, bool u_from_right, bool v_from_right, int iEl=-1) const;
+	void points(double *pts, const double *u, const double *v, int nPts, int derivs=0, const int *iEl=NULL) const;
+	void pointBezier(std::vector<double> &pt, double u, double v, int iEl=-1) const;
+	void pointBezier(std::vector<std::vector<double> > &pts, double u, double v, int derivs, int iEl=-1) const;
+	void pointField(double *pts, const double *coefs, int nComp, double u, double v, int derivs=0, int iEl=-1, coefficientLayout layout=ROW_MAJOR) const;
+	void pointField(std::vector<std::vector<double> > &pts, const double *coefs, int nComp, double u, double v, int derivs=0, int iEl=-1, coefficientLayout layout=ROW_MAJOR) const;
+	void gridEvaluate(const std::vector<double> &us, const std::vector<double> &vs, int derivs, std::vector<double> &out) const;
 	void computeBasis (double param_u,
 	                   double param_v,
 	                   std::vector<std::vector<double> >& result,
@@ -130,6 +140,9 @@ public:
 	// TODO: get rid of the iEl argument in evaluation signatures - it's too easy to mess it up (especially with derivatives at multiple-knot boundaries).
 	//       Try and sort the Elements after all refinements and binary search for the containing point in logarithmic time
 	int getElementContaining(const std::vector<double>& parvalues) const { return this->getElementContaining(parvalues[0], parvalues[1]); };
+	void getElementsContaining(const double *u, const double *v, int n, int *out, int nThreads=1) const;
+	void setElementLocator(elementLocator type);
+	size_t elementLocatorMemory() const;
 
 	// refinement functions
 	void refineBasisFunction(int index);
@@ -163,8 +176,8 @@ public:
 
 	void updateSupport(Basisfunction *f) ;
 	void updateSupport(Basisfunction *f,
-	                   std::vector<Element*>::iterator start,
-	                   std::vector<Element*>::iterator end ) ;
+	                   Element* const *start,
+	                   Element* const *end ) ;
 
 	// common get methods
 	void getGlobalKnotVector      (std::vector<double> &knot_u, std::vector<double> &knot_v) const;
@@ -222,10 +235,18 @@ private:
 
 	// caching stuff
 	mutable std::vector<std::vector<int> > elementCache_;
+	mutable ElementTree                    elementTree_;
 	mutable std::vector<double>            glob_knot_u_;
 	mutable std::vector<double>            glob_knot_v_;
+	mutable std::atomic<bool>              builtElementCache_; // element lookup structure and all ids are up to date
+	mutable bool                           validLocator_;      // element lookup structure is up to date (ids may not be)
+	mutable bool                           validElementTree_;  // elementTree_ is up to date, also kept with LOCATOR_GRID by insert_line()
 
 	void createElementCache() const;
+	void requireElementCache() const;
+	void invalidateElementCache();
+	void requireElementTree();
+	void updateElementCache(int iEl, int iNew);
 
 	// initializeation methods (called from constructors)
 	void initMeta();
@@ -271,7 +292,7 @@ private:
 				elm_u.push_back(unique_u);
 			}
 			unique_u++;
-			meshline_.push_back(new Meshline(false, knot_u[i], knot_v[0], knot_v[n2+p2-1], mult) );
+			meshline_.push_back(new (&meshlinePool_) Meshline(false, knot_u[i], knot_v[0], knot_v[n2+p2-1], mult) );
 		}
 		for(int i=0; i<n2+p2; i++) {// const v, spanning u
 			int mult = 1;
@@ -282,7 +303,7 @@ private:
 				elm_v.push_back(unique_v);
 			}
 			unique_v++;
-			meshline_.push_back(new Meshline(true, knot_v[i], knot_u[0], knot_u[n1+p1-1], mult) );
+			meshline_.push_back(new (&meshlinePool_) Meshline(true, knot_v[i], knot_u[0], knot_u[n1+p1-1], mult) );
 		}
 		std::vector<std::vector<Element*> > elmRows(unique_v-1);
 		for(int j=0; j<unique_v-1; j++) {
@@ -291,7 +312,7 @@ private:
 				double vmin = meshline_[unique_u + j]->const_par_;
 				double umax = meshline_[i+1]->const_par_;
 				double vmax = meshline_[unique_u + j+1]->const_par_;
-				Element* elm = new Element(umin, vmin, umax, vmax);
+				Element* elm = new (&elementPool_) Element(umin, vmin, umax, vmax);
 				element_.push_back(elm);
 				elmRows[j].push_back(elm);
 			}
@@ -299,18 +320,36 @@ private:
 
 		for(int j=0; j<n2; j++)
 			for(int i=0; i<n1; i++) {
-				Basisfunction *b = new Basisfunction(knot_u+i, knot_v+j, coef+(j*n1+i)*(dim+rational), dim, order_u, order_v);
+				Basisfunction *b = new (&basisPool_) Basisfunction(knot_u+i, knot_v+j, coef+(j*n1+i)*(dim+rational), dim, order_u, order_v);
 				basis_.insert(b);
 				for(int k=elm_v[j]; k<elm_v[j+p2]; k++)
-					updateSupport(b, elmRows[k].begin() + elm_u[i], elmRows[k].begin() + elm_u[i+p1]);
+					updateSupport(b, elmRows[k].data() + elm_u[i], elmRows[k].data() + elm_u[i+p1]);
 		}
 	}
 
 	void aPosterioriFixElements();
 	void split(bool insert_in_u, Basisfunction* b, double new_knot, int multiplicity, HashSet<Basisfunction*> &newFunctions);
+	Meshline* mergeLine(bool const_u, double const_par, double start, double stop, int multiplicity, bool &exists);
 	Meshline* insert_line(bool const_u, double const_par, double start, double stop, int multiplicity);
-
+	void insert_lines(const std::vector<Meshline*> &lines, int multiplicity);
+	bool splitAll(Basisfunction *b, SplitGroup &group);
+	void splitGroup(SplitGroup &group);
+	void requireMeshlineIndex();
+	void eraseMeshline(Meshline *m);
+	void getElementsCrossing(const Meshline *line, std::vector<int> &elements) const;
+	void getSplitCandidates(const std::vector<int> &elements, std::vector<Basisfunction*> &functions) const;
+	void getTjoints(const Element *el, std::vector<double> &left, std::vector<double> &right, std::vector<double> &top, std::vector<double> &bottom);
+	bool takeFixCheck(int iEl, char fix);
+	Meshline* insertFixLine(bool const_u, double const_par, double start, double stop);
+
+	// the a posteriori fixes which still have to check each element, only used during aPosterioriFixes()
+	enum { FIX_GAPS = 1, FIX_TJOINTS = 2, FIX_ASPECT = 4, FIX_ALL = 7 };
+	std::vector<char> fixPending_;
+
+	ObjectPool<Meshline>   meshlinePool_; // memory for meshline_, declared first so that it is released after them
 	std::vector<Meshline*> meshline_;
+	MeshlineIndex          meshlineIndex_;      // lookup structure over meshline_, used by insert_line()
+	bool                   validMeshlineIndex_; // meshlineIndex_ is up to date with meshline_
 
 	// plotting parameters
 	double element_red;
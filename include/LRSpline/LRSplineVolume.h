@@ -1,6 +1,8 @@
 #ifndef LRSPLINEVOLUME_H
 #define LRSPLINEVOLUME_H
 
+#include <atomic>
+#include <mutex>
 #ifdef HAS_GOTOOLS
 	#include <GoTools/utils/Point.h>
 	#include <GoTools/trivariate/SplineVolume.h>
@@ -16,6 +18,7 @@
 #include "Basisfunction.h"
 #include "MeshRectangle.h"
 #include "Element.h"
+#include "ElementTree.h"
 #include <set>
 
 namespace Go {
@@ -63,6 +66,11 @@ public:
 	virtual void point(std::vector<double> &pt, double u, double v, double w, int iEl, bool u_from_right, bool v_from_right, bool w_from_right) const;
 	virtual void point(std::vector<std::vector<double> > &pts, double u, double v, double w, int derivs, int iEl=-1) const;
 	virtual void point(std::vector<std::vector<double> > &pts, double u, double v, double w, int derivs, bool u_from_right, bool v_from_right, bool w_from_right, int iEl=-1) const;
+	void gridEvaluate(const std::vector<double> &us, const std::vector<double> &vs, const std::vector<double> &ws, int derivs, std::vector<double> &out) const;
+	void pointBezier(std::vector<double> &pt, double u, double v, double w, int iEl=-1) const;
+	void pointBezier(std::vector<std::vector<double> > &pts, double u, double v, double w, int derivs, int iEl=-1) const;
+	void pointField(double *pts, const double *coefs, int nComp, double u, double v, double w, int derivs=0, int iEl=-1, coefficientLayout layout=ROW_MAJOR) const;
+	void pointField(std::vector<std::vector<double> > &pts, const double *coefs, int nComp, double u, double v, double w, int derivs=0, int iEl=-1, coefficientLayout layout=ROW_MAJOR) const;
 	void computeBasis (double param_u,
 	                   double param_v,
 	                   double param_w,
@@ -74,6 +82,9 @@ public:
 	// TODO: get rid of the iEl argument in evaluation signatures - it's too easy to mess it up (especially with derivatives at multiple-knot boundaries).
 	//       Try and sort the Elements after all refinements and binary search for the containing point in logarithmic time
 	int getElementContaining(const std::vector<double>& parvalues) const { return this->getElementContaining(parvalues[0], parvalues[1], parvalues[2]); };
+	void getElementsContaining(const double *u, const double *v, const double *w, int n, int *out, int nThreads=1) const;
+	void setElementLocator(elementLocator type);
+	size_t elementLocatorMemory() const;
 
 	// refinement functions
 	void refineElement(int index);
@@ -108,8 +119,8 @@ public:
 
 	void updateSupport(Basisfunction *f) ;
 	void updateSupport(Basisfunction *f,
-	                   std::vector<Element*>::iterator start,
-	                   std::vector<Element*>::iterator end ) ;
+	                   Element* const *start,
+	                   Element* const *end ) ;
 
 	// common get methods
 	void getGlobalKnotVector      (std::vector<double> &knot_u,
@@ -166,17 +177,28 @@ private:
 
 	// caching stuff
 	mutable std::vector<std::vector<std::vector<int> > > elementCache_;
+	mutable ElementTree                    elementTree_;
 	mutable std::vector<double>            glob_knot_u_;
 	mutable std::vector<double>            glob_knot_v_;
 	mutable std::vector<double>            glob_knot_w_;
-	mutable bool                           builtElementCache_;
+	mutable std::atomic<bool>              builtElementCache_; // element lookup structure and all ids are up to date
+	mutable bool                           validLocator_;      // element lookup structure is up to date (ids may not be)
+	mutable bool                           validElementTree_;  // elementTree_ is up to date, also kept with LOCATOR_GRID by insert_line()
 
 	void createElementCache() const;
+	void requireElementCache() const;
+	void invalidateElementCache();
+	void requireElementTree();
+	void updateElementCache(int iEl, int iNew);
 
+	ObjectPool<MeshRectangle>   meshrectPool_; // memory for meshrect_, declared first so that it is released after them
 	std::vector<MeshRectangle*> meshrect_;
 
 	void aPosterioriFixElements();
 	void split(int constDir, Basisfunction *b, double new_knot, int multiplicity, HashSet<Basisfunction*> &newFunctions);
+	void mergeRect(MeshRectangle *newRect, std::vector<MeshRectangle*> &newGuys);
+	void getElementsCrossing(const MeshRectangle *rect, std::vector<int> &elements) const;
+	void getSplitCandidates(const std::vector<int> &elements, std::vector<Basisfunction*> &functions) const;
 	void initMeta();
 	template <typename RandomIterator1,
 	          typename RandomIterator2,
@@ -228,7 +250,7 @@ private:
 			  elm_u.push_back(unique_u);
 			}
 			unique_u++;
-			meshrect_.push_back(new MeshRectangle(knot_u[i], knot_v[0],  knot_w[0],
+			meshrect_.push_back(new (&meshrectPool_) MeshRectangle(knot_u[i], knot_v[0],  knot_w[0],
 			                                      knot_u[i], knot_v[n2], knot_w[n3], mult));
 		}
 		for(int i=0; i<n2+order_v; i++) {// const v, spanning u,w
@@ -240,7 +262,7 @@ private:
 			  elm_v.push_back(unique_v);
 			}
 			unique_v++;
-			meshrect_.push_back(new MeshRectangle(knot_u[0],  knot_v[i], knot_w[0],
+			meshrect_.push_back(new (&meshrectPool_) MeshRectangle(knot_u[0],  knot_v[i], knot_w[0],
 			                                      knot_u[n1], knot_v[i], knot_w[n3], mult));
 		}
 		for(int i=0; i<n3+order_w; i++) {
@@ -252,7 +274,7 @@ private:
 			  elm_w.push_back(unique_w);
 			}
 			unique_w++;
-			meshrect_.push_back(new MeshRectangle(knot_u[0],  knot_v[0],  knot_w[i],
+			meshrect_.push_back(new (&meshrectPool_) MeshRectangle(knot_u[0],  knot_v[0],  knot_w[i],
 			                                      knot_u[n1], knot_v[n2], knot_w[i], mult));
 		}
 		std::vector<std::vector<std::vector<Element*> > > elmRows(unique_w-1, std::vector<std::vector<Element*> >(unique_v-1));
@@ -267,7 +289,7 @@ private:
 					double wmax = meshrect_[unique_v + unique_u + k+1]->stop_[2];
 					double min[] = {umin, vmin, wmin};
 					double max[] = {umax, vmax, wmax};
-					Element *elm = new Element(3, min, max);
+					Element *elm = new (&elementPool_) Element(3, min, max);
 					element_.push_back(elm);
 					elmRows[k][j].push_back(elm);
 				}
@@ -281,11 +303,11 @@ private:
 					RandomIterator2 kv = knot_v + j;
 					RandomIterator3 kw = knot_w + k;
 					RandomIterator4 c = coef + (k*n1*n2 + j*n1 + i)*(dim + rational);
-					Basisfunction *b = new Basisfunction(ku, kv, kw, c , dim, order_u, order_v, order_w);
+					Basisfunction *b = new (&basisPool_) Basisfunction(ku, kv, kw, c , dim, order_u, order_v, order_w);
 					basis_.insert(b);
 					for(int k1=elm_w[k]; k1<elm_w[k+p3]; k1++)
 						for(int k2=elm_v[j]; k2<elm_v[j+p2]; k2++)
-							updateSupport(b, elmRows[k1][k2].begin() + elm_u[i], elmRows[k1][k2].begin() + elm_u[i+p1]);
+							updateSupport(b, elmRows[k1][k2].data() + elm_u[i], elmRows[k1][k2].data() + elm_u[i+p1]);
 		}
 	}
 
@@ -0,0 +1,118 @@
+#ifndef LOCAL_KNOT_VECTOR_H
+#define LOCAL_KNOT_VECTOR_H
+
+#include <vector>
+#include <iterator>
+#include <cstddef>
+#include "KnotTable.h"
+
+namespace LR {
+
+/************************************************************************************************************************//**
+ * \brief Read-only view of the local knot vector of a Basisfunction in one parametric direction
+ * \details The knots of a basis function live in a memory block owned by the spline (see Basisfunction and ObjectPool), and
+ *          this is what Basisfunction::operator[] and Basisfunction::getknots() hand out instead of a reference to a
+ *          std::vector. It is cheap to copy, and valid until the function is changed or destroyed. Use
+ *          Basisfunction::setKnot() to change the knots.
+ *
+ *          In knot index mode (see LRSpline::setKnotIndexing) the function only stores the index of each knot, and the view
+ *          reads the values from the KnotTable. The knots are then not contiguous in memory, and values() copies them
+ *          into a buffer for the code which needs an array.
+ ***************************************************************************************************************************/
+class LocalKnotVector {
+
+public:
+	class const_iterator;
+
+	LocalKnotVector(const double *knot, int size) : knot_(knot), index_(NULL), table_(NULL), size_(size) { };
+	//! \brief View of knots stored as indices into a KnotTable
+	LocalKnotVector(const KnotIndex *index, int size, const KnotTable *table) : knot_(NULL), index_(index), table_(table), size_(size) { };
+	//! \brief View of a std::vector, so that any knot vector can be passed where a LocalKnotVector is expected
+	LocalKnotVector(const std::vector<double> &knot) : knot_(knot.data()), index_(NULL), table_(NULL), size_(knot.size()) { };
+
+	double operator[](int i)   const { return (index_ == NULL) ? knot_[i] : table_->value(index_[i]); };
+	int    size()              const { return size_;                             };
+	double front()             const { return (*this)[0];                        };
+	double back()              const { return (*this)[size_-1];                  };
+	const_iterator begin()     const;
+	const_iterator end()       const;
+	//! \brief The knot indices, or NULL if the knots are stored by value
+	const KnotIndex* indices() const { return index_;                            };
+	//! \brief The knot table the indices refer to, or NULL if the knots are stored by value
+	const KnotTable* table()   const { return table_;                            };
+
+	//! \brief The knots as a contiguous array, i.e. for the evaluation kernels
+	//! \param buffer Room for size() values, only written to if the knots are stored as indices
+	const double* values(double *buffer) const {
+		if(index_ == NULL)
+			return knot_;
+		for(int i=0; i<size_; i++)
+			buffer[i] = table_->value(index_[i]);
+		return buffer;
+	}
+
+	//! \brief Exact comparison of all knot values, or of the indices if both refer to the same table
+	bool operator==(const LocalKnotVector &other) const {
+		if(size_ != other.size_)
+			return false;
+		if(index_ != NULL && table_ == other.table_) {
+			for(int i=0; i<size_; i++)
+				if(index_[i] != other.index_[i])
+					return false;
+			return true;
+		}
+		for(int i=0; i<size_; i++)
+			if((*this)[i] != other[i])
+				return false;
+		return true;
+	}
+	bool operator!=(const LocalKnotVector &other) const { return !(*this == other); };
+
+private:
+	const double    *knot_;  // the knot values, if stored by value
+	const KnotIndex *index_; // the knot indices, if stored as indices
+	const KnotTable *table_;
+	int              size_;
+};
+
+//! \brief Random access iterator over the knot values. Holds a copy of the view, so it does not depend on the view it came from
+class LocalKnotVector::const_iterator {
+public:
+	typedef std::random_access_iterator_tag iterator_category;
+	typedef double                          value_type;
+	typedef std::ptrdiff_t                  difference_type;
+	typedef const double*                   pointer;
+	typedef double                          reference;
+
+	const_iterator() : knots_(NULL, 0), i_(0) { };
+	const_iterator(const LocalKnotVector &knots, int i) : knots_(knots), i_(i) { };
+
+	double          operator*()                           const { return knots_[i_];                  };
+	double          operator[](std::ptrdiff_t n)          const { return knots_[i_+n];                };
+	const_iterator& operator++()                                { i_++; return *this;                 };
+	const_iterator& operator--()                                { i_--; return *this;                 };
+	const_iterator  operator++(int)                             { return const_iterator(knots_, i_++); };
+	const_iterator  operator--(int)                             { return const_iterator(knots_, i_--); };
+	const_iterator& operator+=(std::ptrdiff_t n)                { i_ += n; return *this;              };
+	const_iterator& operator-=(std::ptrdiff_t n)                { i_ -= n; return *this;              };
+	const_iterator  operator+ (std::ptrdiff_t n)          const { return const_iterator(knots_, i_+n); };
+	const_iterator  operator- (std::ptrdiff_t n)          const { return const_iterator(knots_, i_-n); };
+	std::ptrdiff_t  operator- (const const_iterator &o)   const { return i_ - o.i_;                   };
+	bool            operator==(const const_iterator &o)   const { return i_ == o.i_;                  };
+	bool            operator!=(const const_iterator &o)   const { return i_ != o.i_;                  };
+	bool            operator< (const const_iterator &o)   const { return i_ <  o.i_;                  };
+	bool            operator> (const const_iterator &o)   const { return i_ >  o.i_;                  };
+	bool            operator<=(const const_iterator &o)   const { return i_ <= o.i_;                  };
+	bool            operator>=(const const_iterator &o)   const { return i_ >= o.i_;                  };
+
+private:
+	LocalKnotVector knots_;
+	int             i_;
+};
+
+inline LocalKnotVector::const_iterator LocalKnotVector::begin() const { return const_iterator(*this, 0);     };
+inline LocalKnotVector::const_iterator LocalKnotVector::end()   const { return const_iterator(*this, size_); };
+
+} // end namespace LR
+
+#endif
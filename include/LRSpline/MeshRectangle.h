@@ -3,6 +3,7 @@
 
 #include "Streamable.h"
 #include <vector>
+#include "ObjectPool.h"
 
 namespace LR {
 
@@ -37,6 +38,11 @@ public:
 	}
 	virtual ~MeshRectangle();
 	MeshRectangle* copy() const;
+	// allocation, on the heap or in an ObjectPool owned by the spline (see ObjectPool)
+	static void* operator new(size_t size)                                  { return ObjectPool<MeshRectangle>::allocate(size, NULL); };
+	static void* operator new(size_t size, ObjectPool<MeshRectangle> *pool) { return ObjectPool<MeshRectangle>::allocate(size, pool); };
+	static void  operator delete(void *p)                                   { ObjectPool<MeshRectangle>::deallocate(p); };
+	static void  operator delete(void *p, ObjectPool<MeshRectangle> *)      { ObjectPool<MeshRectangle>::deallocate(p); };
 
 	int nKnotsIn(Basisfunction *basis) const;
 	bool equals(const MeshRectangle *rect) const;
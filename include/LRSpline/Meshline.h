@@ -3,6 +3,7 @@
 
 #include "Streamable.h"
 #include <vector>
+#include "ObjectPool.h"
 
 namespace LR {
 
@@ -23,6 +24,11 @@ public:
 	Meshline(bool span_u_line, double const_par, double start, double stop, int multiplicity);
 	virtual ~Meshline();
 	Meshline* copy();
+	// allocation, on the heap or in an ObjectPool owned by the spline (see ObjectPool)
+	static void* operator new(size_t size)                             { return ObjectPool<Meshline>::allocate(size, NULL); };
+	static void* operator new(size_t size, ObjectPool<Meshline> *pool) { return ObjectPool<Meshline>::allocate(size, pool); };
+	static void  operator delete(void *p)                              { ObjectPool<Meshline>::deallocate(p); };
+	static void  operator delete(void *p, ObjectPool<Meshline> *)      { ObjectPool<Meshline>::deallocate(p); };
 
 	int nKnotsIn(Basisfunction *basis) const;
 	bool splits(Basisfunction *basis) const;
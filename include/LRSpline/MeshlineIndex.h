@@ -0,0 +1,79 @@
+#ifndef MESHLINE_INDEX_H
+#define MESHLINE_INDEX_H
+
+#include <vector>
+#include <map>
+#include <cstddef>
+
+namespace LR {
+
+class Meshline;
+class Basisfunction;
+
+/************************************************************************************************************************//**
+ * \brief Lookup structure for the meshlines of an LRSplineSurface, used by insert_line() to find the existing lines which
+ *        overlap a new line and the lines which split a new basis function without testing every line
+ * \details The lines are grouped by direction and then by their constant parameter in an ordered map. Within each group
+ *          the lines are sorted by start parameter, and this sorted array is read as a balanced binary tree: the middle
+ *          entry of any range is the root of the subtree of that range. Every entry keeps the largest stop of its subtree,
+ *          so that a query for an interval [a,b] skips all subtrees ending before a, and all entries starting after b. A
+ *          query costs the logarithm of the number of lines times the number of lines found, also when a few long lines
+ *          share the parameter value with many short ones. Adding or removing a line updates its group in linear time.
+ *
+ *          The queries give every line which could match, and possibly a few more, so the caller still does the exact
+ *          test. The lines are returned in the order they were added to the index, which is the order of
+ *          LRSplineSurface::getAllMeshlines(). This way refinement gives the same result as when testing all lines in turn.
+ *
+ *          The index keeps a copy of the position of each line. The start and stop of an indexed line must be changed
+ *          through setExtent(), and a line must be removed from the index before it is deleted.
+ ***************************************************************************************************************************/
+class MeshlineIndex {
+
+public:
+	MeshlineIndex();
+
+	void build(const std::vector<Meshline*> &lines);
+	void clear();
+	void insert(Meshline *line);
+	void erase(Meshline *line);
+	void setExtent(Meshline *line, double start, double stop);
+
+	void getOverlapping(bool span_u, double const_par, double start, double stop, double tol, std::vector<Meshline*> &lines) const;
+	void getSplitting(const Basisfunction *b, std::vector<Meshline*> &lines) const;
+
+	//! \brief Returns the number of lines in the index
+	int size() const { return size_; };
+
+	size_t memoryFootprint() const;
+
+private:
+	//! \brief One indexed line
+	struct Entry {
+		double    start;
+		double    stop;
+		long      order;   // position in the order the lines were added
+		Meshline *line;
+		double    maxStop; // the largest stop in the subtree of this entry (see Bucket)
+	};
+	//! \brief All lines in one direction with the same constant parameter
+	struct Bucket {
+		std::vector<Entry> entries; // sorted by start, and read as a binary tree (see updateTree())
+	};
+	typedef std::map<double, Bucket> BucketMap;
+
+	void add(Meshline *line, long order);
+	static double updateTree(std::vector<Entry> &entries, int lo, int hi);
+	static void   searchTree(const std::vector<Entry> &entries, int lo, int hi, double start, double stop,
+	                         std::vector<const Entry*> &found);
+	static void   collect(BucketMap::const_iterator first, BucketMap::const_iterator last, double start, double stop,
+	                      std::vector<const Entry*> &found);
+	static void sortByOrder(std::vector<const Entry*> &found, std::vector<Meshline*> &lines);
+
+	BucketMap bucket_[2]; // lines spanning the v-direction (constant u) in bucket_[0], and the u-direction in bucket_[1]
+	long      nextOrder_;
+	int       size_;
+};
+
+} // end namespace LR
+
+#endif
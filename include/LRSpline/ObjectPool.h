@@ -0,0 +1,236 @@
+#ifndef OBJECTPOOL_H
+#define OBJECTPOOL_H
+
+#include <vector>
+#include <new>
+#include <cstddef>
+#include <mutex>
+
+namespace LR {
+
+/*!
+	\brief Storage for the variable size members of the objects in an ObjectPool, i.e. the knots and control point of a
+	       Basisfunction and the support lists which do not fit inside the objects
+	\details Hands out blocks in multiples of 8 bytes from large slabs, with one free list for each block size, and only
+	         releases the slabs when the pool is destroyed. Blocks larger than MAX_BYTES are taken from the heap. Unlike the
+	         object slots of ObjectPool, the blocks may be taken and given back from several threads at once, since the
+	         support lists of the elements are updated in parallel by batch refinement.
+*/
+class DataPool {
+
+public:
+	//! \brief Largest block kept in the pool, larger ones are taken from the heap
+	static const size_t MAX_BYTES = 1024;
+
+	DataPool() {
+		next_ = NULL;
+		end_  = NULL;
+		std::fill(freeList_, freeList_ + MAX_BYTES/UNIT + 1, (Block*) NULL);
+	}
+
+	//! \brief Releases all slabs. All blocks of the pool must already have been given back
+	~DataPool() {
+		for(char *slab : slabs_)
+			::operator delete(slab);
+	}
+
+	//! \brief Allocates a block of the given size from a pool, or from the heap if pool is NULL
+	static void* allocate(DataPool *pool, size_t bytes) {
+		if(pool == NULL || bytes > MAX_BYTES)
+			return ::operator new(bytes);
+		return pool->take(units(bytes));
+	}
+
+	//! \brief Releases a block given by allocate() with the same pool and size
+	static void deallocate(DataPool *pool, void *p, size_t bytes) {
+		if(p == NULL)
+			return;
+		if(pool == NULL || bytes > MAX_BYTES)
+			::operator delete(p);
+		else
+			pool->give((Block*) p, units(bytes));
+	}
+
+	//! \brief Returns the number of data slabs allocated from the heap
+	int nDataSlabs() const { return slabs_.size(); };
+
+private:
+	//! \brief A free block, linked to the next free one of the same size
+	struct Block {
+		Block *nextFree;
+	};
+
+	static const size_t UNIT      = sizeof(double); // all blocks are a multiple of this
+	static const size_t SLAB_SIZE = 65536;
+
+	static size_t units(size_t bytes) {
+		return (bytes < UNIT) ? 1 : (bytes + UNIT - 1) / UNIT;
+	}
+
+	void* take(size_t n) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		if(freeList_[n] != NULL) {
+			Block *b = freeList_[n];
+			freeList_[n] = b->nextFree;
+			return b;
+		}
+		if(next_ == NULL || next_ + n*UNIT > end_) {
+			next_ = (char*) ::operator new(SLAB_SIZE);
+			end_  = next_ + SLAB_SIZE;
+			slabs_.push_back(next_);
+		}
+		void *b = next_;
+		next_ += n*UNIT;
+		return b;
+	}
+
+	void give(Block *b, size_t n) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		b->nextFree  = freeList_[n];
+		freeList_[n] = b;
+	}
+
+	// a pool owns its slabs, and can not be copied
+	DataPool(const DataPool&)            = delete;
+	DataPool& operator=(const DataPool&) = delete;
+
+	std::vector<char*> slabs_;
+	Block      *freeList_[MAX_BYTES/UNIT + 1]; // freed blocks, one list for each size
+	char       *next_;  // first unused byte in the last slab
+	char       *end_;   // end of the last slab
+	std::mutex  mutex_;
+};
+
+/*!
+	\brief Slab allocator for the Basisfunction, Element and mesh objects owned by one spline
+	\details Refinement creates and destroys a large number of small objects of the same type. Instead of going to the heap for
+	         each of them, a pool hands out fixed size slots from large slabs and keeps freed slots on a list for reuse, and
+	         the slabs themselves are only released when the pool is destroyed.
+
+	         The classes using a pool route all allocation through allocate() and deallocate() by their own operator new and
+	         operator delete. Every object is preceded by a small header recording the pool it came from (or none), so
+	         objects are created by either
+	         \code
+	             new Element(...)         // on the heap
+	             new (&pool) Element(...) // in a pool
+	         \endcode
+	         and are in both cases destroyed by a plain delete. An object must not outlive the pool it was allocated in.
+	         The object slots are not thread safe.
+
+	         The members of variable size of the objects are kept in the DataPool this derives from, see dataPool(). Together
+	         this means that destroying a spline only gives the slabs back to the heap.
+*/
+
+template <class T>
+class ObjectPool : public DataPool {
+
+public:
+	//! \brief Default constructor
+	//! \param slabSize number of objects in each slab
+	explicit ObjectPool(int slabSize=512) {
+		slabSize_ = slabSize;
+		freeList_ = NULL;
+		next_     = NULL;
+		end_      = NULL;
+		nObjects_ = 0;
+	}
+
+	//! \brief Releases all slabs. All objects in the pool must already have been destroyed
+	~ObjectPool() {
+		for(char *slab : slabs_)
+			::operator delete(slab);
+	}
+
+	//! \brief Allocates memory for an object of the given size, preceded by the header
+	//! \param size number of bytes requested (as passed to operator new)
+	//! \param pool the pool to allocate from, or NULL for the heap
+	static void* allocate(size_t size, ObjectPool<T> *pool) {
+		Header *h;
+		if(pool == NULL || size > sizeof(T)) {
+			h = (Header*) ::operator new(sizeof(Header) + size);
+			h->pool = NULL;
+		} else {
+			h = pool->take();
+			h->pool = pool;
+		}
+		return h+1;
+	}
+
+	//! \brief Releases memory given by allocate(), back to the pool it came from
+	static void deallocate(void *p) {
+		if(p == NULL)
+			return;
+		Header *h = ((Header*) p) - 1;
+		if(h->pool == NULL)
+			::operator delete(h);
+		else
+			h->pool->give(h);
+	}
+
+	/************************************************************************************************************************//**
+	 * \brief Returns the pool an object was allocated in, to allocate the members of the object from
+	 * \param owner The object, which must have been created by new (in a pool or on the heap)
+	 * \returns The pool, or NULL if the object is on the heap (see DataPool::allocate())
+	 ***************************************************************************************************************************/
+	static DataPool* dataPool(const T *owner) {
+		return (((const Header*) (const void*) owner) - 1)->pool;
+	}
+
+	//! \brief Returns the number of objects currently allocated in this pool
+	long nObjects() const { return nObjects_; };
+
+	//! \brief Returns the number of slabs allocated from the heap
+	int  nSlabs()   const { return slabs_.size(); };
+
+private:
+	//! \brief Placed in front of every object. The pool of allocated objects, and the next free slot for free ones
+	union Header {
+		ObjectPool<T>  *pool;
+		Header         *nextFree;
+		std::max_align_t align;
+	};
+
+	//! \brief Size of one slot, rounded up to keep the objects aligned
+	static size_t slotSize() {
+		return sizeof(Header) * ((sizeof(T) + 2*sizeof(Header) - 1) / sizeof(Header));
+	}
+
+	Header* take() {
+		nObjects_++;
+		if(freeList_ != NULL) {
+			Header *h = freeList_;
+			freeList_ = h->nextFree;
+			return h;
+		}
+		if(next_ == end_) {
+			next_ = (char*) ::operator new(slabSize_ * slotSize());
+			end_  = next_ + slabSize_ * slotSize();
+			slabs_.push_back(next_);
+		}
+		Header *h = (Header*) next_;
+		next_ += slotSize();
+		return h;
+	}
+
+	void give(Header *h) {
+		nObjects_--;
+		h->nextFree = freeList_;
+		freeList_   = h;
+	}
+
+	// a pool owns its slabs, and can not be copied
+	ObjectPool(const ObjectPool<T>&)              = delete;
+	ObjectPool<T>& operator=(const ObjectPool<T>&) = delete;
+
+	std::vector<char*> slabs_;
+	Header *freeList_; // freed slots, linked through their headers
+	char   *next_;     // first unused slot in the last slab
+	char   *end_;      // end of the last slab
+	int     slabSize_;
+	long    nObjects_;
+
+};
+
+} // end namespace LR
+
+#endif
@@ -19,6 +19,7 @@
 #include <iostream>
 #include <string>
 #include <map>
+#include <thread>
 #include <sys/time.h>
 
 namespace LR {
@@ -33,6 +34,10 @@ namespace LR {
 
   The profiling results are printed in a nicely formatted table when the
   profiler object goes out of scope, typically at the end of the program.
+
+  Only tasks run on the thread which created the profiler are measured. Calls
+  from all other threads are ignored, so that profiled functions may be called
+  concurrently (i.e., evaluation in a threaded assembly loop).
 */
 
 class Profiler
@@ -52,11 +57,17 @@ public:
 	void start(const std::string& funcName);
 	//! \brief Stops profiling of task \a funcName and decrements \a nRunners.
 	void stop(const std::string& funcName);
+	//! \brief Starts profiling of task \a funcName, a string literal.
+	//! \details Looks the task up by the address of the name, so that the
+	//! profiled functions do not allocate any memory after their first call.
+	void start(const char* funcName);
+	//! \brief Stops profiling of task \a funcName, a string literal.
+	void stop(const char* funcName);
 
 	//! \brief Prints a profiling report for all tasks that have been measured.
 	void report(std::ostream& os) const;
 	//! \brief Clears the profiler.
-	void clear() { myTimers.clear(); allCPU = allWall = 0.0; nRunners = 0; }
+	void clear() { myTimers.clear(); myLabels.clear(); allCPU = allWall = 0.0; nRunners = 0; }
 
 private:
 	//! \brief Stores profiling data for one computational task.
@@ -79,8 +90,18 @@ private:
 	friend std::ostream& operator<<(std::ostream& os, const Profile& p);
 
 	std::string myName; //!< Name of this profiler
+	std::thread::id myThread; //!< The thread which is being profiled
 
 	std::map<std::string,Profile> myTimers; //!< The task profiles with names
+	typedef std::map<std::string,Profile>::iterator Timer; //!< A task profile
+	std::map<const char*,Timer> myLabels; //!< The task profiles by the address of their name
+
+	//! \brief Starts the profiling of a task.
+	void start(Profile& p);
+	//! \brief Stops the profiling of a task.
+	void stop(Profile& p);
+	//! \brief Returns the profile of a task given by a string literal, or NULL.
+	Profile* find(const char* funcName, bool create);
 
 	double allCPU;  //!< Accumulated CPU time from all "main" tasks
 	double allWall; //!< Accumulated wall clock time of all "main" tasks
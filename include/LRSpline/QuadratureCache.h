@@ -0,0 +1,74 @@
+#ifndef QUADRATURE_CACHE_H
+#define QUADRATURE_CACHE_H
+
+#include <vector>
+#include <cstddef>
+#include "LRSpline.h"
+
+namespace LR {
+
+class Element;
+class Basisfunction;
+
+/************************************************************************************************************************//**
+ * \brief Precomputed basis function values and derivatives at the quadrature points of all elements
+ * \details Meant for finite element codes which assemble many times on the same mesh (Newton iterations, time stepping).
+ *          A reference quadrature rule on [-1,1]^d is mapped to every element, and all basis functions with support on the
+ *          element are evaluated at all its points once. The results are kept in one contiguous array ordered as
+ *          [element][quadrature point][local function][derivative], where the local functions are in the order of the
+ *          element support and the derivatives in the order of LRSplineSurface::computeBasis() and
+ *          LRSplineVolume::computeBasis(). The values are identical to the ones computeBasis() returns at the same points.
+ *
+ *          After the spline is refined, update() re-evaluates only the elements which have been split or have had
+ *          their support changed, and copies the rest. All pointers returned from this class are invalidated by update().
+ ***************************************************************************************************************************/
+class QuadratureCache {
+
+public:
+	QuadratureCache(const LRSpline *spline, const std::vector<double> &points, int derivs=0);
+
+	int update();
+
+	//! \brief Returns the number of quadrature points in each element
+	int nQuadraturePoints()       const { return nQP_;                               };
+	//! \brief Returns the number of values stored for each basis function (function value and all derivatives)
+	int nDerivatives()            const { return nRes_;                              };
+	//! \brief Returns the number of elements in the cache
+	int nElements()               const { return element_.size();                    };
+	//! \brief Returns the number of basis functions with support on element iEl
+	int nBasisFunctions(int iEl)  const { return offset_[iEl+1] - offset_[iEl];      };
+	//! \brief Returns the basis functions with support on element iEl, in the order they are stored in the cache
+	Basisfunction* const* functions(int iEl) const { return &functions_[offset_[iEl]]; };
+	//! \brief Returns all values on element iEl, stored as [quadrature point][local function][derivative]
+	const double* values(int iEl) const { return &values_[offset_[iEl]*nQP_*nRes_];  };
+	//! \brief Returns all values on element iEl at quadrature point qp, stored as [local function][derivative]
+	const double* values(int iEl, int qp) const {
+		return &values_[(offset_[iEl]*nQP_ + qp*nBasisFunctions(iEl))*nRes_];
+	};
+	//! \brief Returns derivative d of local function f on element iEl at quadrature point qp
+	double value(int iEl, int qp, int f, int d) const { return values(iEl, qp)[f*nRes_ + d]; };
+
+	void evaluateField(double *out, int iEl, int qp, const double *coefs, int nComp, coefficientLayout layout=ROW_MAJOR) const;
+
+	size_t memoryFootprint() const;
+
+private:
+	void evaluateElement(double *out, int iEl) const;
+
+	const LRSpline *spline_;
+	std::vector<double> points_;    // reference quadrature points stored as [nQP][parametric dimension]
+	int parDim_;
+	int nQP_;
+	int derivs_;
+	int nRes_;
+
+	std::vector<const Element*>   element_;   // element which each block was computed for
+	std::vector<unsigned long long> revision_; // and its revision at that time
+	std::vector<size_t>           offset_;    // start of each element in functions_ (and in units of nQP_*nRes_ in values_)
+	std::vector<Basisfunction*>   functions_;
+	std::vector<double>           values_;
+};
+
+} // end namespace LR
+
+#endif
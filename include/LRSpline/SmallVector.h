@@ -0,0 +1,172 @@
+#ifndef SMALLVECTOR_H
+#define SMALLVECTOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include "ObjectPool.h"
+
+namespace LR {
+
+/*!
+	\brief Contiguous array with room for N elements inside the object itself, which only allocates memory on the heap if it
+	       grows beyond this
+	\details Is used for the support lists of Element and Basisfunction, which are short (typically the number of functions or
+	         elements in a tensor product neighbourhood of the spline order), but exist for every element and every function.
+	         The set-like methods insert(), erase() and contains() do linear scans, which for these lengths is faster than any
+	         hashing or tree structure. T is meant to be a pointer, or some other type which can be copied with memcpy.
+
+	         The methods which may grow the container take an optional DataPool to take the memory from, so that the owner
+	         can keep it in the pool it was allocated in (see ObjectPool::dataPool()). The memory outside the object records
+	         the pool it came from, and is always given back there.
+*/
+
+template <typename T, int N>
+class SmallVector {
+
+public:
+	typedef T*       iterator;
+	typedef const T* const_iterator;
+
+	//! \brief Default constructor
+	//! \details Creates an empty container
+	SmallVector() {
+		data_     = inline_;
+		size_     = 0;
+		capacity_ = N;
+	}
+
+	//! \brief Copy constructor
+	SmallVector(const SmallVector<T,N> &other) {
+		data_     = inline_;
+		size_     = 0;
+		capacity_ = N;
+		*this = other;
+	}
+
+	~SmallVector() {
+		release();
+	}
+
+	SmallVector<T,N>& operator=(const SmallVector<T,N> &other) {
+		if(this == &other)
+			return *this;
+		size_ = 0;
+		reserve(other.size_);
+		std::copy(other.begin(), other.end(), data_);
+		size_ = other.size_;
+		return *this;
+	}
+
+	//! \brief Makes room for at least n elements without further allocation
+	//! \param n number of elements
+	//! \param pool where to take the memory from if it does not fit inside the object, NULL for the heap
+	void reserve(int n, DataPool *pool=NULL) {
+		if(n <= capacity_)
+			return;
+		Spill *spill = (Spill*) DataPool::allocate(pool, spillBytes(n));
+		spill->pool  = pool;
+		T *data = (T*) (spill+1);
+		std::copy(data_, data_+size_, data);
+		release();
+		data_     = data;
+		capacity_ = n;
+	}
+
+	//! \brief Appends an element at the end
+	void push_back(const T &obj, DataPool *pool=NULL) {
+		if(size_ == capacity_)
+			reserve(2*capacity_, pool);
+		data_[size_++] = obj;
+	}
+
+	//! \brief Removes the last element
+	void pop_back() {
+		size_--;
+	}
+
+	//! \brief Changes the number of elements. New elements are default constructed
+	void resize(int n, DataPool *pool=NULL) {
+		reserve(n, pool);
+		for(int i=size_; i<n; i++)
+			data_[i] = T();
+		size_ = n;
+	}
+
+	//! \brief Removes all elements (but keeps any memory allocated)
+	void clear() {
+		size_ = 0;
+	}
+
+	//! \brief Returns true if obj is among the elements
+	bool contains(const T &obj) const {
+		return std::find(begin(), end(), obj) != end();
+	}
+
+	//! \brief Appends an element if it is not already in the container
+	//! \returns true if it was added
+	bool insert(const T &obj, DataPool *pool=NULL) {
+		if(contains(obj))
+			return false;
+		push_back(obj, pool);
+		return true;
+	}
+
+	//! \brief Removes an element, keeping the order of the rest
+	//! \returns 0 if no elements were removed, 1 if it did exist and was successfully removed
+	int erase(const T &obj) {
+		T *it = std::find(begin(), end(), obj);
+		if(it == end())
+			return 0;
+		std::copy(it+1, end(), it);
+		size_--;
+		return 1;
+	}
+
+	size_t size()  const { return size_;      };
+	bool   empty() const { return size_ == 0; };
+
+	T&       operator[](int i)       { return data_[i];       };
+	const T& operator[](int i) const { return data_[i];       };
+	T&       front()                 { return data_[0];       };
+	const T& front()           const { return data_[0];       };
+	T&       back()                  { return data_[size_-1]; };
+	const T& back()            const { return data_[size_-1]; };
+
+	iterator       begin()       { return data_;       };
+	iterator       end()         { return data_+size_; };
+	const_iterator begin() const { return data_;       };
+	const_iterator end()   const { return data_+size_; };
+
+	//! \brief Returns the number of bytes used outside the object (zero as long as the elements fit inside it)
+	size_t heapMemory() const { return (data_ == inline_) ? 0 : spillBytes(capacity_); };
+
+private:
+	//! \brief Placed in front of the elements when they do not fit inside the object
+	struct Spill {
+		DataPool *pool;
+	};
+
+	static size_t spillBytes(int n) {
+		return sizeof(Spill) + n*sizeof(T);
+	}
+
+	//! \brief Gives the memory outside the object back to where it came from
+	void release() {
+		if(data_ == inline_)
+			return;
+		Spill *spill = ((Spill*) data_) - 1;
+		DataPool::deallocate(spill->pool, spill, spillBytes(capacity_));
+		data_     = inline_;
+		capacity_ = N;
+	}
+
+	T   *data_;
+	int  size_;
+	int  capacity_;
+	T    inline_[N];
+
+};
+
+} // end namespace LR
+
+#endif
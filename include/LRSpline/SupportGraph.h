@@ -0,0 +1,62 @@
+#ifndef SUPPORT_GRAPH_H
+#define SUPPORT_GRAPH_H
+
+#include <vector>
+#include <cstddef>
+
+namespace LR {
+
+class LRSpline;
+
+/************************************************************************************************************************//**
+ * \brief Snapshot of which basis functions have support on which elements, stored in compressed sparse row (CSR) format
+ * \details Meant as the base structure for assembly, graph coloring and partitioning in finite element codes. Both
+ *          directions are stored: element to basis function (the functions with support on each element) and basis function
+ *          to element (the elements in the support of each function). Everything is referred to by the ids given by
+ *          LRSpline::generateIDs(), and each row is sorted by increasing id.
+ *
+ *          The rows of element iEl are elementIndices()[elementOffsets()[iEl]] up to elementIndices()[elementOffsets()[iEl+1]],
+ *          and similarly for the basis functions. The arrays can be handed directly to solvers and graph partitioners.
+ *
+ *          The snapshot is built once by the constructor and never changes. It does not refer back to the spline, and is not
+ *          updated when the spline is refined or renumbered; build a new one instead.
+ ***************************************************************************************************************************/
+class SupportGraph {
+
+public:
+	SupportGraph(const LRSpline *spline, int nThreads=1);
+
+	//! \brief Returns the number of elements
+	int nElements()                   const { return elementOffset_.size() - 1;                        };
+	//! \brief Returns the number of basis functions
+	int nBasisFunctions()             const { return basisOffset_.size() - 1;                          };
+	//! \brief Returns the number of basis functions with support on element iEl
+	int nElementFunctions(int iEl)    const { return elementOffset_[iEl+1] - elementOffset_[iEl];       };
+	//! \brief Returns the ids of the basis functions with support on element iEl
+	const int* elementFunctions(int iEl) const { return &elementIndex_[0] + elementOffset_[iEl];         };
+	//! \brief Returns the number of elements in the support of basis function iBasis
+	int nBasisElements(int iBasis)    const { return basisOffset_[iBasis+1] - basisOffset_[iBasis];     };
+	//! \brief Returns the ids of the elements in the support of basis function iBasis
+	const int* basisElements(int iBasis) const { return &basisIndex_[0] + basisOffset_[iBasis];         };
+
+	//! \brief Returns the start of each element row in elementIndices(), with nElements()+1 entries
+	const std::vector<size_t>& elementOffsets() const { return elementOffset_; };
+	//! \brief Returns the basis function ids of all element rows, one after another
+	const std::vector<int>&    elementIndices() const { return elementIndex_;  };
+	//! \brief Returns the start of each basis function row in basisIndices(), with nBasisFunctions()+1 entries
+	const std::vector<size_t>& basisOffsets()   const { return basisOffset_;   };
+	//! \brief Returns the element ids of all basis function rows, one after another
+	const std::vector<int>&    basisIndices()   const { return basisIndex_;    };
+
+	size_t memoryFootprint() const;
+
+private:
+	std::vector<size_t> elementOffset_; // start of each element in elementIndex_
+	std::vector<int>    elementIndex_;  // basis function ids of all elements
+	std::vector<size_t> basisOffset_;   // start of each basis function in basisIndex_
+	std::vector<int>    basisIndex_;    // element ids of all basis functions
+};
+
+} // end namespace LR
+
+#endif
@@ -1,12 +1,16 @@
 #include "LRSpline/Basisfunction.h"
+#include "LRSpline/BasisWorkspace.h"
 #include "LRSpline/Element.h"
 #include "LRSpline/Profiler.h"
 #include "LRSpline/Meshline.h"
+#include "UnivariateKernel.h"
 #include <algorithm>
 #include <cfloat>
 #include <climits>
 #include <cmath>
+#include <cstring>
 #include <set>
+#include <atomic>
 
 typedef unsigned int uint;
 
@@ -19,13 +23,32 @@ namespace LR {
  * \param order_v Polynomial order (degree + 1) in second parametric direction
  ***************************************************************************************************************************/
 Basisfunction::Basisfunction(int dim, int order_u, int order_v) {
-	weight_       = 1;
+	int orders[] = {order_u, order_v};
+	init(dim, 2, orders, 1.0);
+}
+
+/************************************************************************************************************************//**
+ * \brief Common part of all constructors. Allocates the control point and knots, all set to zero
+ * \param dim The dimension in the physical space, i.e. the number of components of the controlpoints
+ * \param parDim The dimension in the parametric space (2 or 3)
+ * \param order Polynomial order (degree + 1) in each parametric direction
+ * \param weight Scaling weight for partition of unity
+ ***************************************************************************************************************************/
+void Basisfunction::init(int dim, int parDim, const int *order, double weight) {
+	if(parDim < 1 || parDim > 3) {
+		std::cerr << "Error Basisfunction: parametric dimension " << parDim << " not supported" << std::endl;
+		exit(9232);
+	}
+	weight_       = weight;
 	id_           = -1;
 	hashCode_     = 0;
-	knots_.resize(2);
-	knots_[0].resize(order_u+1);
-	knots_[1].resize(order_v+1);
-	controlpoint_.resize(dim);
+	indexed_      = false;
+	dim_          = dim;
+	nVariate_     = parDim;
+	for(int i=0; i<3; i++)
+		order_[i] = (i < parDim) ? order[i] : 0;
+	allocateData();
+	std::fill(data_, data_ + dim_ + nKnots(), 0.0);
 }
 
 /************************************************************************************************************************//**
@@ -35,6 +58,51 @@ Basisfunction::~Basisfunction() {
 	PROFILE("Function destruction");
 	for(uint i=0; i<support_.size(); i++)
 		support_[i]->removeSupportFunction( (Basisfunction*) this);
+	releaseData();
+}
+
+/************************************************************************************************************************//**
+ * \brief Number of knots in all local knot vectors together
+ ***************************************************************************************************************************/
+int Basisfunction::nKnots() const {
+	int n = 0;
+	for(int i=0; i<nVariate_; i++)
+		n += order_[i]+1;
+	return n;
+}
+
+/************************************************************************************************************************//**
+ * \brief Size of the memory block of a function
+ * \param dim Number of components of the control point
+ * \param nKnots Number of knots in all directions together
+ * \param indexed True for the block of knot index mode; the knot tables and a KnotIndex for each knot instead of the values
+ ***************************************************************************************************************************/
+size_t Basisfunction::dataBytes(int dim, int nKnots, bool indexed) {
+	if(indexed)
+		return dim*sizeof(double) + sizeof(const KnotTable*) + nKnots*sizeof(KnotIndex);
+	return (dim + nKnots)*sizeof(double);
+}
+
+/************************************************************************************************************************//**
+ * \brief Returns the number of bytes used for the control point and knots, which are kept outside the object
+ ***************************************************************************************************************************/
+size_t Basisfunction::dataMemory() const {
+	return dataBytes(dim_, nKnots(), indexed_);
+}
+
+/************************************************************************************************************************//**
+ * \brief Allocates the memory block for the control point and knots, in the pool of this function if it has one
+ ***************************************************************************************************************************/
+void Basisfunction::allocateData() {
+	data_ = (double*) DataPool::allocate(ObjectPool<Basisfunction>::dataPool(this), dataMemory());
+}
+
+/************************************************************************************************************************//**
+ * \brief Gives the memory block for the control point and knots back to where it came from
+ ***************************************************************************************************************************/
+void Basisfunction::releaseData() {
+	DataPool::deallocate(ObjectPool<Basisfunction>::dataPool(this), data_, dataMemory());
+	data_ = NULL;
 }
 
 #ifdef HAS_GOTOOLS
@@ -43,12 +111,13 @@ Basisfunction::~Basisfunction() {
  * \returns The internal knot average
  ***************************************************************************************************************************/
 Go::Point Basisfunction::getGrevilleParameter() const {
-	Go::Point ans(knots_.size());
-	for (size_t d = 0; d < knots_.size(); ++d) {
+	Go::Point ans(nVariate_);
+	for (int d = 0; d < nVariate_; ++d) {
+		LocalKnotVector knot = getknots(d);
 		ans[d] = 0.0;
-		for(uint i=1; i<knots_[d].size()-1; i++)
-			ans[d] += knots_[d][i];
-		ans[d] /= (knots_[d].size()-2);
+		for(int i=1; i<knot.size()-1; i++)
+			ans[d] += knot[i];
+		ans[d] /= (knot.size()-2);
 	}
 	return ans;
 }
@@ -58,9 +127,9 @@ Go::Point Basisfunction::getGrevilleParameter() const {
  * \param pt [out] The ascociated control point to this B-spline
  ***************************************************************************************************************************/
 void Basisfunction::getControlPoint(Go::Point &pt) const {
-	pt.resize(controlpoint_.size());
-	for(uint d=0; d<controlpoint_.size(); d++)
-		pt[d] = controlpoint_[d];
+	pt.resize(dim_);
+	for(int d=0; d<dim_; d++)
+		pt[d] = data_[d];
 }
 #endif
 
@@ -70,12 +139,13 @@ void Basisfunction::getControlPoint(Go::Point &pt) const {
  * \returns The internal knot average
  ***************************************************************************************************************************/
 void Basisfunction::getGrevilleParameter(std::vector<double> &pt) const {
-	pt.resize(knots_.size());
-	for(uint i=0; i<knots_.size(); i++) {
+	pt.resize(nVariate_);
+	for(int i=0; i<nVariate_; i++) {
+		LocalKnotVector knot = getknots(i);
 		pt[i] = 0;
-		for(uint j=1; j<knots_[i].size()-1; j++)
-			pt[i] += knots_[i][j];
-		pt[i] /= (knots_[i].size()-2);
+		for(int j=1; j<knot.size()-1; j++)
+			pt[i] += knot[j];
+		pt[i] /= (knot.size()-2);
 	}
 }
 
@@ -238,15 +308,11 @@ double Basisfunction::evaluate(double u, double v, bool u_from_right, bool v_fro
  * \return The B-spline evaluated at the chosen parametric coordinate
  ***************************************************************************************************************************/
 double Basisfunction::evaluate(double u, double v, bool u_from_right, bool v_from_right) const {
-	std::vector<double> results;
-	std::vector<double> parPt(2);
-	std::vector<bool>   fromRight(2);
-	parPt[0] = u;
-	parPt[1] = v;
-	fromRight[0] = u_from_right;
-	fromRight[1] = v_from_right;
-	evaluate(results, parPt, 0, fromRight);
-	return results[0];
+	double result;
+	double parPt[]     = {u, v};
+	bool   fromRight[] = {u_from_right, v_from_right};
+	evaluate(&result, parPt, 0, fromRight, BasisWorkspace::local());
+	return result;
 }
 
 /************************************************************************************************************************//**
@@ -260,17 +326,11 @@ double Basisfunction::evaluate(double u, double v, bool u_from_right, bool v_fro
  * \return The B-spline evaluated at the chosen parametric coordinate
  ***************************************************************************************************************************/
 double Basisfunction::evaluate(double u, double v, double w, bool u_from_right, bool v_from_right, bool w_from_right) const {
-	std::vector<double> results;
-	std::vector<double> parPt(3);
-	std::vector<bool>   fromRight(3);
-	parPt[0] = u;
-	parPt[1] = v;
-	parPt[2] = w;
-	fromRight[0] = u_from_right;
-	fromRight[1] = v_from_right;
-	fromRight[2] = w_from_right;
-	evaluate(results, parPt, 0, fromRight);
-	return results[0];
+	double result;
+	double parPt[]     = {u, v, w};
+	bool   fromRight[] = {u_from_right, v_from_right, w_from_right};
+	evaluate(&result, parPt, 0, fromRight, BasisWorkspace::local());
+	return result;
 }
 
 /************************************************************************************************************************//**
@@ -284,13 +344,10 @@ double Basisfunction::evaluate(double u, double v, double w, bool u_from_right,
  * \param v_from_right Evaluate second parametric coordinate in the limit from the right
  ***************************************************************************************************************************/
 void Basisfunction::evaluate(std::vector<double> &results, double u, double v, int derivs, bool u_from_right, bool v_from_right) const {
-	std::vector<double> parPt(2);
-	std::vector<bool>   fromRight(2);
-	parPt[0] = u;
-	parPt[1] = v;
-	fromRight[0] = u_from_right;
-	fromRight[1] = v_from_right;
-	evaluate(results, parPt, derivs, fromRight);
+	double parPt[]     = {u, v};
+	bool   fromRight[] = {u_from_right, v_from_right};
+	results.resize(nDerivatives(2, derivs));
+	evaluate(results.data(), parPt, derivs, fromRight, BasisWorkspace::local());
 }
 
 /************************************************************************************************************************//**
@@ -306,39 +363,11 @@ void Basisfunction::evaluate(std::vector<double> &results, double u, double v, i
  * \param w_from_right Evaluate third parametric coordinate in the limit from the right
  ***************************************************************************************************************************/
 void Basisfunction::evaluate(std::vector<double> &results, double u, double v, double w, int derivs, bool u_from_right, bool v_from_right, bool w_from_right) const {
-	std::vector<double> parPt(3);
-	std::vector<bool>   fromRight(3);
-	parPt[0] = u;
-	parPt[1] = v;
-	parPt[2] = w;
-	fromRight[0] = u_from_right;
-	fromRight[1] = v_from_right;
-	fromRight[2] = w_from_right;
-	evaluate(results, parPt, derivs, fromRight);
-}
-
-// funky recursive algorithm for collecting derivative results. Best illustrated by examples:
-// ordering for bivariate second derivatives:  1, dx,dy, d2x,dxdy,d2y
-// ordering for trivariate second derivatives: 1, dx,dy,dz, d2x,dxdy,dxdz,d2y,dydz,d2z
-// ordering for trivariate third derivatives:  1,
-//                                            dx,dy,dz,
-//                                            d2x,dxdy,dxdz,d2y,dydz,d2z,
-//                                            d3x,d2xdy,d2xdz,dxd2y,dxdydz,dxd2z,d3y,d2ydz,dyd2z,d3z
-void collectResults(std::vector<double>::iterator &result,
-                    double product,
-                    std::vector<std::vector<std::vector<double> > > &diff,
-                    int derivsLeft,
-                    uint dim) {
-	if(dim == diff.size()-1) {
-		*result *= product*diff.back()[derivsLeft][0];
-		result++;
-		return;
-	}
-	for(int d=derivsLeft; d>-1; d--) {
-		double ans = diff[dim][d][0];
-		collectResults(result, ans*product, diff, derivsLeft-d, dim+1);
-	}
-};
+	double parPt[]     = {u, v, w};
+	bool   fromRight[] = {u_from_right, v_from_right, w_from_right};
+	results.resize(nDerivatives(3, derivs));
+	evaluate(results.data(), parPt, derivs, fromRight, BasisWorkspace::local());
+}
 
 /************************************************************************************************************************//**
  * \brief evaluates a general B-spline (currently only bivariate and trivariate supported - small fix to extend, but not now)
@@ -355,68 +384,251 @@ void collectResults(std::vector<double>::iterator &result,
  * Trivariate splines up to third order: 1, dx,dy,dz, d2x,dxdy,dxdz,d2y,dydz,d2z, d3x,d2xdy,d2xdz,dxd2y,dxdydz,dxd2z,d3y,d2ydz,dyd2z,d3z
  ***************************************************************************************************************************/
 void Basisfunction::evaluate(std::vector<double> &results, const std::vector<double> &parPt, int derivs, const std::vector<bool> &from_right) const {
-	uint dim = knots_.size();
+	uint dim = nVariate_;
 	if(dim != parPt.size() || dim != from_right.size()) {
 		std::cerr << "Error Basisfunction::evalate(...) parametric dimension mismatch" << std::endl;
 		exit(9230);
 	}
+	if(dim != 2 && dim != 3) {
+		std::cerr << "Error Basisfunction::evalate(...) for parametric dimension other than 2 or 3" << std::endl;
+		exit(9231);
+	}
 
-	if(dim == 2) {    // bivariate splines
-		results.resize((derivs+1)*(derivs+2)/2);               // (this is the triangular numbers)
-	} else if(dim == 3) { // trivariate splines
-		results.resize((derivs+1)*(derivs+2)*(2*derivs+6)/12); // (sum of triangular numbers)
-	} else {
+	bool fromRight[3];
+	for(uint i=0; i<dim; i++)
+		fromRight[i] = from_right[i];
+	results.resize(nDerivatives(dim, derivs));
+	evaluate(results.data(), parPt.data(), derivs, fromRight, BasisWorkspace::local());
+}
+
+/************************************************************************************************************************//**
+ * \brief Number of evaluation results (function value and all cross-derivatives) for a given parametric dimension
+ * \param parDim Parametric dimension (2 or 3)
+ * \param derivs Number of derivatives requested
+ * \returns (derivs+1)*(derivs+2)/2 for bivariate and (derivs+1)*(derivs+2)*(2*derivs+6)/12 for trivariate splines
+ ***************************************************************************************************************************/
+int Basisfunction::nDerivatives(int parDim, int derivs) {
+	if(parDim == 2)
+		return (derivs+1)*(derivs+2)/2;               // (this is the triangular numbers)
+	else if(parDim == 3)
+		return (derivs+1)*(derivs+2)*(2*derivs+6)/12; // (sum of triangular numbers)
+	return 0;
+}
+
+/************************************************************************************************************************//**
+ * \brief evaluates a general B-spline without doing any heap allocations
+ * \param results [out] Array of at least nDerivatives(nVariate(), derivs) values. Same ordering as the std::vector version
+ * \param parPt Parametric evaluation point (one value for each parametric direction)
+ * \param derivs Number of derivatives requested
+ * \param from_right Array stating if any of the parametric directions should be evaluated in the limit from the right
+ * \param workspace Scratch memory. Only grows if this evaluation needs more memory than any previous call with it
+ * \details This is the actual evaluation kernel which all other evaluate() functions call. It is meant for tight loops such
+ *          as quadrature evaluation where the caller keeps the workspace alive between calls.
+ ***************************************************************************************************************************/
+void Basisfunction::evaluate(double *results, const double *parPt, int derivs, const bool *from_right, BasisWorkspace &workspace) const {
+	uint dim  = nVariate_;
+	int  nRes = nDerivatives(dim, derivs);
+	if(nRes == 0) {
 		std::cerr << "Error Basisfunction::evalate(...) for parametric dimension other than 2 or 3" << std::endl;
 		exit(9231);
 	}
-	fill(results.begin(), results.end(), 0.0);
 
-	std::vector<std::vector<double> >               ans(dim);
-	std::vector<std::vector<std::vector<double> > > diff(dim);
-	uint i = 0;
-	for(std::vector<double> knot : knots_) {
-		if(knot[0] > parPt[i] || parPt[i] > knot.back())
+	int width = 0;
+	for(uint i=0; i<dim; i++)
+		width = std::max(width, (int) order_[i]);
+	workspace.reserve(dim, derivs, width);
+
+	const double *univariate[3];
+	for(uint i=0; i<dim; i++) {
+		if(!evaluateUnivariate(workspace.values(i), getknots(i), parPt[i], derivs, from_right[i], workspace)) {
+			std::fill(results, results+nRes, 0.0);
 			return;
-		ans[i].resize(knot.size()-1);
-		for(uint j=0; j<knot.size()-1; j++) {
-			if(from_right[i])
-				ans[i][j] = (knot[j] <= parPt[i] && parPt[i] <  knot[j+1]) ? 1 : 0;
-			else
-				ans[i][j] = (knot[j] <  parPt[i] && parPt[i] <= knot[j+1]) ? 1 : 0;
 		}
+		univariate[i] = workspace.values(i);
+	}
+	evaluate(results, univariate, derivs);
+}
 
-		int p          = knot.size()-2;
-		int diff_level = p;
-		diff[i].resize(derivs+1, std::vector<double>(1, 0));
-		for(uint n=1; n<knot.size()-1; n++, diff_level--) {
-			if(diff_level <= derivs) {
-				diff[i][diff_level].resize(diff_level+1);
-				for(int j=0; j<=diff_level; j++)
-					diff[i][diff_level][j] = ans[i][j];
-			}
-			for(int d = diff_level; d <= derivs && d <= p; d++) {
-				for(uint j=0; j<knot.size()-1-n; j++) {
-					diff[i][d][j]  = (knot[ j+n ]==knot[ j ]) ? 0 : (   n   )/(knot[j+n]  -knot[ j ])*diff[i][d][ j ];
-					diff[i][d][j] -= (knot[j+n+1]==knot[j+1]) ? 0 : (   n   )/(knot[j+n+1]-knot[j+1])*diff[i][d][j+1];
-				}
-			}
-			for(uint j=0; j<knot.size()-1-n; j++) {
-				ans[i][j]  = (knot[ j+n ]==knot[ j ]) ? 0 : (  parPt[i]-knot[j]  )/(knot[j+n]  -knot[ j ])*ans[i][ j ];
-				ans[i][j] += (knot[j+n+1]==knot[j+1]) ? 0 : (knot[j+n+1]-parPt[i])/(knot[j+n+1]-knot[j+1])*ans[i][j+1];
+/************************************************************************************************************************//**
+ * \brief Forms the tensor product of univariate B-spline evaluations
+ * \param results [out] Array of nDerivatives(nVariate(), derivs) values. Same ordering as the std::vector version of evaluate()
+ * \param univariate For each parametric direction, the derivs+1 derivatives of the univariate B-spline as computed by
+ *                   evaluateUnivariate() on the local knot vector of this function
+ * \param derivs Number of derivatives requested
+ ***************************************************************************************************************************/
+void Basisfunction::evaluate(double *results, const double * const *univariate, int derivs) const {
+	// ordering for bivariate second derivatives:  1, dx,dy, d2x,dxdy,d2y
+	// ordering for trivariate second derivatives: 1, dx,dy,dz, d2x,dxdy,dxdz,d2y,dydz,d2z
+	int ip = 0;
+	if(nVariate_ == 2) {
+		for(int totDeriv=0; totDeriv<=derivs; totDeriv++)
+			for(int d0=totDeriv; d0>-1; d0--)
+				results[ip++] = weight_ * (univariate[0][d0] * univariate[1][totDeriv-d0]);
+	} else {
+		for(int totDeriv=0; totDeriv<=derivs; totDeriv++)
+			for(int d0=totDeriv; d0>-1; d0--)
+				for(int d1=totDeriv-d0; d1>-1; d1--)
+					results[ip++] = weight_ * (univariate[0][d0] * univariate[1][d1] * univariate[2][totDeriv-d0-d1]);
+	}
+}
+
+/************************************************************************************************************************//**
+ * \brief evaluates a univariate B-spline and all its derivatives
+ * \param values [out] Array of derivs+1 values; the function value and all derivatives up to order derivs
+ * \param knot The local knot vector of the B-spline
+ * \param t Parametric evaluation point
+ * \param derivs Number of derivatives requested
+ * \param from_right Evaluate in the limit from the right
+ * \param workspace Scratch memory. Must have been reserved to hold this knot vector and number of derivatives
+ * \returns False if t is outside the support of the B-spline, in which case values is not computed
+ * \details Orders 2-5 with 0 to 3 derivatives are handed over to the compile-time specialized evaluateUnivariate<P,D>()
+ ***************************************************************************************************************************/
+bool Basisfunction::evaluateUnivariate(double *values, const LocalKnotVector &knot, double t, int derivs, bool from_right, BasisWorkspace &workspace) {
+	// the common low orders are unrolled at compile time
+	typedef bool (*Specialized)(double *values, const double *knot, double t, bool from_right);
+	static const Specialized specialized[4][4] = {
+		{evaluateUnivariate<2,0>, evaluateUnivariate<2,1>, evaluateUnivariate<2,2>, evaluateUnivariate<2,3>},
+		{evaluateUnivariate<3,0>, evaluateUnivariate<3,1>, evaluateUnivariate<3,2>, evaluateUnivariate<3,3>},
+		{evaluateUnivariate<4,0>, evaluateUnivariate<4,1>, evaluateUnivariate<4,2>, evaluateUnivariate<4,3>},
+		{evaluateUnivariate<5,0>, evaluateUnivariate<5,1>, evaluateUnivariate<5,2>, evaluateUnivariate<5,3>}};
+	int order = knot.size()-1;
+	if(2 <= order && order <= 5 && 0 <= derivs && derivs <= 3) {
+		double buffer[6]; // the knot values, if they are stored as indices
+		return specialized[order-2][derivs](values, knot.values(buffer), t, from_right);
+	}
+
+	if(knot[0] > t || t > knot.back())
+		return false;
+	double *ans = workspace.diff(0);
+	for(int j=0; j<knot.size()-1; j++) {
+		if(from_right)
+			ans[j] = (knot[j] <= t && t <  knot[j+1]) ? 1 : 0;
+		else
+			ans[j] = (knot[j] <  t && t <= knot[j+1]) ? 1 : 0;
+	}
+
+	int p          = knot.size()-2;
+	int diff_level = p;
+	for(int n=1; n<knot.size()-1; n++, diff_level--) {
+		if(diff_level <= derivs) {
+			double *diff = workspace.diff(diff_level);
+			for(int j=0; j<=diff_level; j++)
+				diff[j] = ans[j];
+		}
+		for(int d = diff_level; d <= derivs && d <= p; d++) {
+			double *diff = workspace.diff(d);
+			for(int j=0; j<knot.size()-1-n; j++) {
+				diff[j]  = (knot[ j+n ]==knot[ j ]) ? 0 : (   n   )/(knot[j+n]  -knot[ j ])*diff[ j ];
+				diff[j] -= (knot[j+n+1]==knot[j+1]) ? 0 : (   n   )/(knot[j+n+1]-knot[j+1])*diff[j+1];
 			}
 		}
-
-		i++;
+		for(int j=0; j<knot.size()-1-n; j++) {
+			ans[j]  = (knot[ j+n ]==knot[ j ]) ? 0 : (  t-knot[j]  )/(knot[j+n]  -knot[ j ])*ans[ j ];
+			ans[j] += (knot[j+n+1]==knot[j+1]) ? 0 : (knot[j+n+1]-t)/(knot[j+n+1]-knot[j+1])*ans[j+1];
+		}
 	}
 
-	// collect results
-	for(i=0; i<dim; i++)
-		diff[i][0] = ans[i];
+	for(int d=0; d<=derivs; d++) // derivatives higher than the degree vanish
+		values[d] = (d > p) ? 0 : workspace.diff(d)[0];
+	return true;
+}
 
-	fill(results.begin(), results.end(), weight_);
-	std::vector<double>::iterator resIt = results.begin();
-	for(int totDeriv=0; totDeriv<=derivs; totDeriv++)
-		collectResults(resIt, 1.0, diff, totDeriv, 0);
+/************************************************************************************************************************//**
+ * \brief Finds the widest instruction set supported both by this build of the library and by the running CPU
+ ***************************************************************************************************************************/
+static simdInstructionSet detectInstructionSet() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	__builtin_cpu_init();
+#ifdef HAS_AVX512
+	if(__builtin_cpu_supports("avx512f"))
+		return SIMD_AVX512;
+#endif
+#ifdef HAS_AVX2
+	if(__builtin_cpu_supports("avx2"))
+		return SIMD_AVX2;
+#endif
+#ifdef HAS_SSE2
+	if(__builtin_cpu_supports("sse2"))
+		return SIMD_SSE2;
+#endif
+#endif
+	return SIMD_NONE;
+}
+
+static simdInstructionSet supportedISA = detectInstructionSet();
+static std::atomic<simdInstructionSet> activeISA(supportedISA);
+
+/************************************************************************************************************************//**
+ * \brief Returns the widest instruction set which can be used for vectorized evaluation on this machine
+ ***************************************************************************************************************************/
+simdInstructionSet Basisfunction::supportedInstructionSet() {
+	return supportedISA;
+}
+
+/************************************************************************************************************************//**
+ * \brief Returns the instruction set currently used for vectorized evaluation
+ ***************************************************************************************************************************/
+simdInstructionSet Basisfunction::getInstructionSet() {
+	return activeISA.load(std::memory_order_relaxed);
+}
+
+/************************************************************************************************************************//**
+ * \brief Restricts the vectorized evaluation to a given instruction set, i.e. for testing or benchmarking
+ * \param isa The instruction set to use. SIMD_NONE evaluates all points with the scalar evaluateUnivariate()
+ * \returns False (and changes nothing) if isa is wider than supportedInstructionSet()
+ * \details The widest supported instruction set is chosen by default. This is a global setting, which takes effect for the
+ *          next evaluation in all threads.
+ ***************************************************************************************************************************/
+bool Basisfunction::setInstructionSet(simdInstructionSet isa) {
+	if(isa > supportedISA)
+		return false;
+	activeISA.store(isa, std::memory_order_relaxed);
+	return true;
+}
+
+/************************************************************************************************************************//**
+ * \brief evaluates a univariate B-spline and all its derivatives at many points
+ * \param values [out] Array of nPts*(derivs+1) values stored as [nPts][derivs+1]. Points outside the support evaluate to zero
+ * \param inside [out] Array of nPts flags; if the point is inside the support of the B-spline
+ * \param knot The local knot vector of the B-spline
+ * \param t Parametric evaluation points
+ * \param from_right Evaluate each point in the limit from the right
+ * \param nPts Number of evaluation points
+ * \param derivs Number of derivatives requested
+ * \param workspace Scratch memory
+ * \details Processes several points per instruction using the vector registers given by getInstructionSet(). The results are
+ *          identical to calling the scalar evaluateUnivariate() on each point.
+ ***************************************************************************************************************************/
+void Basisfunction::evaluateUnivariate(double *values, char *inside, const LocalKnotVector &knot, const double *t, const bool *from_right, int nPts, int derivs, BasisWorkspace &workspace) {
+	int order = knot.size()-1;
+	UnivariateKernel kernel = NULL;
+	int width = 1;
+	switch(activeISA.load(std::memory_order_relaxed)) {
+#ifdef HAS_AVX512
+		case SIMD_AVX512: kernel = univariateAVX512; width = 8; break;
+#endif
+#ifdef HAS_AVX2
+		case SIMD_AVX2:   kernel = univariateAVX2;   width = 4; break;
+#endif
+#ifdef HAS_SSE2
+		case SIMD_SSE2:   kernel = univariateSSE2;   width = 2; break;
+#endif
+		default: break;
+	}
+
+	if(kernel == NULL || nPts == 1) {
+		workspace.reserve(1, derivs, order);
+		for(int i=0; i<nPts; i++) {
+			inside[i] = evaluateUnivariate(values + i*(derivs+1), knot, t[i], derivs, from_right[i], workspace);
+			if(!inside[i])
+				std::fill(values + i*(derivs+1), values + (i+1)*(derivs+1), 0.0);
+		}
+		return;
+	}
+	// the knot values are gathered behind the scratch memory if they are stored as indices
+	int     nScratch = univariateScratchSize(order, derivs, width);
+	double *scratch  = workspace.lanes(nScratch + knot.size());
+	kernel(values, inside, knot.values(scratch + nScratch), order, t, from_right, nPts, derivs, scratch);
 }
 
 /************************************************************************************************************************//**
@@ -424,9 +636,9 @@ void Basisfunction::evaluate(std::vector<double> &results, const std::vector<dou
  * \param pt [out] The ascociated control point to this B-spline
  ***************************************************************************************************************************/
 void Basisfunction::getControlPoint(std::vector<double> &pt) const {
-	pt.resize(controlpoint_.size());
-	for(uint d=0; d<controlpoint_.size(); d++)
-		pt[d] = controlpoint_[d];
+	pt.resize(dim_);
+	for(int d=0; d<dim_; d++)
+		pt[d] = data_[d];
 }
 
 /************************************************************************************************************************//**
@@ -452,7 +664,7 @@ bool Basisfunction::removeSupport(Element *el) {
  ***************************************************************************************************************************/
 bool Basisfunction::addSupport(Element *el) {
 	if(overlaps(el)) {
-		support_.push_back(el);
+		support_.push_back(el, ObjectPool<Basisfunction>::dataPool(this));
 		return true;
 	}
 	return false;
@@ -462,10 +674,10 @@ bool Basisfunction::addSupport(Element *el) {
  * \brief Returns true if this B-splines support overlaps with the elements size
  ***************************************************************************************************************************/
 bool Basisfunction::overlaps(Element *el) const {
-	for(uint i=0; i<knots_.size(); i++) {
-		if(knots_[i][0]     >= el->getParmax(i))
+	for(int i=0; i<nVariate_; i++) {
+		if(getParmin(i) >= el->getParmax(i))
 			return false;
-		if(knots_[i].back() <= el->getParmin(i))
+		if(getParmax(i) <= el->getParmin(i))
 			return false;
 	}
 	return true;
@@ -493,7 +705,7 @@ std::vector<Element*> Basisfunction::getExtendedSupport() {
  * \return A list of elements which describes the minimal extended support
  ***************************************************************************************************************************/
 std::vector<Element*> Basisfunction::getMinimalExtendedSupport() {
-	if(knots_.size() != 2) {
+	if(nVariate_ != 2) {
 		std::cerr << "Error: Basisfunction::getMinimalExtendedSupport() only for bivariate B-splines" << std::endl;
 		exit(86136);
 	}
@@ -501,10 +713,12 @@ std::vector<Element*> Basisfunction::getMinimalExtendedSupport() {
 	double min_dv = DBL_MAX;
 	Basisfunction *smallestGuy = NULL;
 
-	bool edgeUmin = (knots_[0][0] == knots_[0][knots_[0].size()-2]);
-	bool edgeUmax = (knots_[0][1] == knots_[0][knots_[0].size()-1]);
-	bool edgeVmin = (knots_[1][0] == knots_[1][knots_[1].size()-2]);
-	bool edgeVmax = (knots_[1][1] == knots_[1][knots_[1].size()-1]);
+	LocalKnotVector knot_u = getknots(0);
+	LocalKnotVector knot_v = getknots(1);
+	bool edgeUmin = (knot_u[0] == knot_u[knot_u.size()-2]);
+	bool edgeUmax = (knot_u[1] == knot_u[knot_u.size()-1]);
+	bool edgeVmin = (knot_v[0] == knot_v[knot_v.size()-2]);
+	bool edgeVmax = (knot_v[1] == knot_v[knot_v.size()-1]);
 
 	if(! (edgeUmin || edgeUmax) )
 		min_du = getParmax(0) - getParmin(0);
@@ -576,28 +790,57 @@ HashSet<Basisfunction*> Basisfunction::getOverlappingFunctions() const {
  * \param dim New control point dimension
  ***************************************************************************************************************************/
 void Basisfunction::setDimension(int dim) {
-	controlpoint_.resize(dim);
+	double *old       = data_;
+	size_t  oldBytes  = dataMemory();
+	size_t  knotBytes = dataBytes(0, nKnots(), indexed_); // the knots (or knot tables and indices) are kept as they are
+	int     oldDim    = dim_;
+	dim_ = dim;
+	allocateData();
+	memcpy(data_ + dim, old + oldDim, knotBytes);
 	for(int i=0; i<dim; i++)
-		controlpoint_[i]  = 0.0;
+		data_[i]  = 0.0;
+	DataPool::deallocate(ObjectPool<Basisfunction>::dataPool(this), old, oldBytes);
+}
+
+/************************************************************************************************************************//**
+ * \brief Changes one knot of the local knot vectors
+ * \param i The parametric direction
+ * \param j The index of the knot in the local knot vector
+ * \param knot The new knot value
+ * \details Drops the knot indices (see indexKnots()), and the knot vectors must still be non-decreasing afterwards
+ ***************************************************************************************************************************/
+void Basisfunction::setKnot(int i, int j, double knot) {
+	clearKnotIndices();
+	knotData(i)[j] = knot;
 }
 
 /************************************************************************************************************************//**
  * \brief Get the B-spline hash code for storage in the HashSet container
- * \returns some "random" long based on the local knot vector
+ * \returns some "random" long based on the local knot vector, or on the knot indices if these are set (see indexKnots())
  ***************************************************************************************************************************/
 long Basisfunction::hashCode() const {
-	if(hashCode_ != 0)
-		return hashCode_;
-
-	int nKnots = 0;
-	for(std::vector<double> knot : knots_)
-		nKnots += knot.size();
+	// concurrent callers may all compute the hash code, but they store the same value
+	long known = hashCode_.load(std::memory_order_relaxed);
+	if(known != 0)
+		return known;
+
+	if(indexed_) {
+		// exact hash of the knot indices (FNV-1a over whole indices)
+		unsigned long long hash  = 14695981039346656037ull;
+		const KnotIndex   *index = indexData(0);
+		for(int i=nKnots(); i>0; i--)
+			hash = (hash ^ *index++) * 1099511628211ull;
+		hashCode_.store((long) hash, std::memory_order_relaxed);
+		return (long) hash;
+	}
 
-	int bitsFromEach = (sizeof(long)*8) / nKnots;
-	int bitsLeft     = (sizeof(long)*8) % nKnots;
+	int bitsFromEach = (sizeof(long)*8) / nKnots();
+	int bitsLeft     = (sizeof(long)*8) % nKnots();
 	int offset       = 0;
-	for(std::vector<double> knot : knots_) {
-		for(uint i=0; i<knot.size()-1; i++) {
+	long hashCode    = 0;
+	for(int d=0; d<nVariate_; d++) {
+		LocalKnotVector knot = getknots(d);
+		for(int i=0; i<knot.size()-1; i++) {
 			long randInt = log2(fabs(knot[i]))*120000;
 			// int randInt = log2(fabs(knot[i]+1))*343;
 			// int randInt = (i%2==0) ? knot[i] : log2(fabs(knot[i]));
@@ -607,27 +850,34 @@ long Basisfunction::hashCode() const {
 			long mask    = 0;
 			for(int k=0; k<bitsFromEach + (bitsLeft>0); k++)
 				mask |= (1<<k);
-			hashCode_ |= ((long) (randInt & mask)) << offset;
+			hashCode |= ((long) (randInt & mask)) << offset;
 			offset += bitsFromEach + (bitsLeft>0);
 			bitsLeft--;
 		}
 	}
-	return hashCode_;
+	hashCode_.store(hashCode, std::memory_order_relaxed);
+	return hashCode;
 }
 
 /************************************************************************************************************************//**
  * \brief Test for B-spline equality
  * \param other The other B-spline to check against
- * \returns True if the knot vectors are identical (up to a tolerance of 1e-10)
+ * \returns True if the knot vectors are identical (up to a tolerance of 1e-10). If both functions have their knots indexed
+ *          in the same tables, only the indices are compared
  ***************************************************************************************************************************/
 bool Basisfunction::equals(const Basisfunction &other) const {
-	if(knots_.size() != other.knots_.size())
+	if(nVariate_ != other.nVariate_)
 		return false;
-	for(uint i=0; i<knots_.size(); i++) {
-		if(knots_[i].size() != other[i].size())
+	for(int i=0; i<nVariate_; i++)
+		if(order_[i] != other.order_[i])
 			return false;
-		for(uint j=0; j<knots_[i].size(); j++)
-			if(fabs(knots_[i][j] - other[i][j]) > 1e-10)
+	if(indexed_ && other.indexed_ && indexTables() == other.indexTables())
+		return std::equal(indexData(0), indexData(0) + nKnots(), other.indexData(0));
+	for(int i=0; i<nVariate_; i++) {
+		LocalKnotVector knot  = getknots(i);
+		LocalKnotVector knot2 = other.getknots(i);
+		for(int j=0; j<=order_[i]; j++)
+			if(fabs(knot[j] - knot2[j]) > 1e-10)
 				return false;
 	}
 	return true;
@@ -649,25 +899,24 @@ bool Basisfunction::operator==(const Basisfunction &other) const {
  ***************************************************************************************************************************/
 void Basisfunction::operator+=(const Basisfunction &other) {
 	double newWeight = weight_ + other.weight_;
-	for(uint i=0; i<controlpoint_.size(); i++)
-		controlpoint_[i] = (controlpoint_[i]*weight_ + other.controlpoint_[i]*other.weight_)/newWeight;
+	for(int i=0; i<dim_; i++)
+		data_[i] = (data_[i]*weight_ + other.data_[i]*other.weight_)/newWeight;
 	weight_ = newWeight;
 }
 
 /************************************************************************************************************************//**
  * \brief Returns a deep copy of the B-spline with all the same knot vectors and controlpoints. Note: Does not copy supported elements
+ * \details The copy stores the knot values, also if this function stores knot indices
  ***************************************************************************************************************************/
 Basisfunction* Basisfunction::copy() const {
 
-	std::vector<int> order;
-	for(uint i=0; i<knots_.size(); i++)
-		order.push_back(knots_[i].size()-1);
-	Basisfunction *returnValue = new Basisfunction(controlpoint_.size(), knots_.size(), order);
+	Basisfunction *returnValue = new Basisfunction(dim_, nVariate_, order_);
 
-	for(uint i=0; i<knots_.size(); i++)
-		std::copy(knots_[i].begin(), knots_[i].end(), returnValue->knots_[i].begin());
-
-	std::copy(controlpoint_.begin(), controlpoint_.end(), returnValue->controlpoint_.begin());
+	std::copy(data_, data_ + dim_, returnValue->data_);
+	for(int i=0; i<nVariate_; i++) {
+		LocalKnotVector knot = getknots(i);
+		std::copy(knot.begin(), knot.end(), returnValue->knotData(i));
+	}
 	returnValue->weight_ = weight_;
 	returnValue->id_     = id_;
 
@@ -685,6 +934,8 @@ void Basisfunction::read(std::istream &is) {
 #define ASSERT_NEXT_CHAR(c) {ws(is); nextChar = is.get(); if(nextChar!=c) { std::cerr << "Error parsing basis function\n"; exit(324); } ws(is); }
 	char nextChar;
 
+	clearKnotIndices();
+
 	// read id tag
 	is >> id_;
 	ws(is);
@@ -692,23 +943,25 @@ void Basisfunction::read(std::istream &is) {
 
 	// read knot vectors
 	bool isFirst = true;
-	for(uint i=0; i<knots_.size(); i++) {
+	for(int i=0; i<nVariate_; i++) {
 		if(!isFirst) ASSERT_NEXT_CHAR('x');
 		ASSERT_NEXT_CHAR('[');
-		for(uint j=0; j<knots_[i].size(); j++)
-			is >> knots_[i][j];
+		double *knot = knotData(i);
+		for(int j=0; j<=order_[i]; j++)
+			is >> knot[j];
 		ASSERT_NEXT_CHAR(']');
 		isFirst = false;
 	}
 
 	// read control point
-	for(uint i=0; i<controlpoint_.size(); i++)
-		is >> controlpoint_[i];
+	for(int i=0; i<dim_; i++)
+		is >> data_[i];
 
 	// read weight
 	ASSERT_NEXT_CHAR('(');
 	is >> weight_;
 	ASSERT_NEXT_CHAR(')');
+	hashCode_ = 0;
 #undef ASSERT_NEXT_CHAR
 }
 
@@ -718,17 +971,18 @@ void Basisfunction::read(std::istream &is) {
 void Basisfunction::write(std::ostream &os) const {
 	os << id_ << ": ";
 	bool isFirst = true;
-	for(std::vector<double> knot : knots_) {
+	for(int d=0; d<nVariate_; d++) {
+		LocalKnotVector knot = getknots(d);
 		if(!isFirst) os << "x ";
 		os << "[";
-		for(uint i=0; i<knot.size(); i++)
+		for(int i=0; i<knot.size(); i++)
 			os << knot[i] << " ";
 		os << "] ";
 		isFirst = false;
 	}
 
-	for(uint i=0; i<controlpoint_.size(); i++)
-		os << controlpoint_[i] << " ";
+	for(int i=0; i<dim_; i++)
+		os << data_[i] << " ";
 	os << "(" << weight_ << ")";
 }
 
@@ -756,9 +1010,9 @@ int Basisfunction::getOverloadCount() const {
  * \brief Returns true if the support of *other is completely contained in *this
  ***************************************************************************************************************************/
 bool Basisfunction::contains(const Basisfunction &other) const {
-	for(uint i=0; i<knots_.size(); i++)
-		if(other[i][0]     < (*this)[i][0] ||
-		   other[i].back() > (*this)[i].back())
+	for(int i=0; i<nVariate_; i++)
+		if(other.getParmin(i) < getParmin(i) ||
+		   other.getParmax(i) > getParmax(i))
 			return false;
 	return true;
 }
@@ -767,19 +1021,24 @@ bool Basisfunction::contains(const Basisfunction &other) const {
  * \brief flip two parametric coordinate directions
  ***************************************************************************************************************************/
 void Basisfunction::flip(int dir1, int dir2) {
-	std::vector<double> tmp = knots_[dir1];
-	knots_[dir1] = knots_[dir2];
-	knots_[dir2] = tmp;
+	clearKnotIndices();
+	std::vector<double> tmp1(knotData(dir1), knotData(dir1) + order_[dir1]+1);
+	std::vector<double> tmp2(knotData(dir2), knotData(dir2) + order_[dir2]+1);
+	std::swap(order_[dir1], order_[dir2]); // the block keeps its size, only the knots move
+	std::copy(tmp2.begin(), tmp2.end(), knotData(dir1));
+	std::copy(tmp1.begin(), tmp1.end(), knotData(dir2));
 }
 
 /************************************************************************************************************************//**
  * \brief reverse one parametric direction. Need global range (parmin, parmax) for scaling
  ***************************************************************************************************************************/
 void Basisfunction::reverse(int pardir, double parmin, double parmax) {
-	std::vector<double> tmp(knots_[pardir]);
+	clearKnotIndices();
+	double *knot = knotData(pardir);
+	std::vector<double> tmp(knot, knot + order_[pardir]+1);
 	int n = tmp.size();
 	for(int i=0; i<n; i++) {
-		knots_[pardir][n-i-1] = (parmax - tmp[i]) / (parmax-parmin) * (parmax-parmin) + parmin;
+		knot[n-i-1] = (parmax - tmp[i]) / (parmax-parmin) * (parmax-parmin) + parmin;
 	}
 }
 
@@ -787,10 +1046,62 @@ void Basisfunction::reverse(int pardir, double parmin, double parmax) {
  * \brief (used when iterating over all functions), scales knot vectors so they globally fit into range (0,1)
  ***************************************************************************************************************************/
 void Basisfunction::normalize(int pardir, double parmin, double parmax) {
-	for(int i=0; i<knots_[pardir].size(); i++) {
-		knots_[pardir][i] = (knots_[pardir][i] - parmin) / (parmax-parmin) * (parmax-parmin) + parmin;
+	clearKnotIndices();
+	double *knot = knotData(pardir);
+	for(int i=0; i<=order_[pardir]; i++) {
+		knot[i] = (knot[i] - parmin) / (parmax-parmin) * (parmax-parmin) + parmin;
 	}
 }
 
+/************************************************************************************************************************//**
+ * \brief Looks up all knots in the knot tables of the spline, and from now on stores them as indices into these
+ * \param tables The knot table of each parametric direction. Knots which are not already there are added
+ * \details The knot values are replaced by the indices, so the knots take two bytes each instead of eight, and are read back
+ *          from the tables by getknots() and operator[]. Knots within the tolerance of a table entry (see KnotTable) get
+ *          the value of that entry. Functions are only compared by their indices if they refer to the same tables, and the
+ *          tables must not be destroyed or cleared while any function refers to them (see clearKnotIndices()).
+ ***************************************************************************************************************************/
+void Basisfunction::indexKnots(std::vector<KnotTable> &tables) {
+	if(indexed_ && indexTables() == tables.data())
+		return;
+	clearKnotIndices();
+	DataPool     *pool  = ObjectPool<Basisfunction>::dataPool(this);
+	double       *old   = data_;
+	int           n     = nKnots();
+	const double *knot  = old + dim_;
+	indexed_ = true;
+	allocateData();
+	std::copy(old, old + dim_, data_);
+	indexTables() = tables.data();
+	KnotIndex *index = indexData(0);
+	for(int i=0; i<nVariate_; i++)
+		for(int j=0; j<=order_[i]; j++)
+			*index++ = tables[i].index(*knot++);
+	DataPool::deallocate(pool, old, dataBytes(dim_, n, false));
+	hashCode_ = 0;
+}
+
+/************************************************************************************************************************//**
+ * \brief Goes back to storing the knot values, and comparing and hashing this function by these
+ * \details The values are read from the knot tables, which must therefore still hold all knots of the function
+ ***************************************************************************************************************************/
+void Basisfunction::clearKnotIndices() {
+	hashCode_ = 0;
+	if(!indexed_)
+		return;
+	DataPool        *pool   = ObjectPool<Basisfunction>::dataPool(this);
+	double          *old    = data_;
+	size_t           bytes  = dataMemory();
+	const KnotTable *tables = indexTables();
+	const KnotIndex *index  = indexData(0);
+	indexed_ = false;
+	allocateData();
+	std::copy(old, old + dim_, data_);
+	double *knot = data_ + dim_;
+	for(int i=0; i<nVariate_; i++)
+		for(int j=0; j<=order_[i]; j++)
+			*knot++ = tables[i].value(*index++);
+	DataPool::deallocate(pool, old, bytes);
+}
 
 } // end namespace LR
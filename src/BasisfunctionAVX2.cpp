@@ -0,0 +1,37 @@
+#ifdef HAS_AVX2
+
+#include "UnivariateKernel.h"
+#include <immintrin.h>
+
+namespace LR {
+
+namespace {
+
+//! \brief Four double lanes in the 256 bit AVX registers
+struct AVX2 {
+	enum { width = 4 };
+	typedef __m256d reg;
+	typedef __m256d mask;
+	static reg  load(const double *p)           { return _mm256_loadu_pd(p);                 };
+	static void store(double *p, reg a)         { _mm256_storeu_pd(p, a);                    };
+	static reg  set1(double a)                  { return _mm256_set1_pd(a);                  };
+	static reg  add(reg a, reg b)               { return _mm256_add_pd(a, b);                };
+	static reg  sub(reg a, reg b)               { return _mm256_sub_pd(a, b);                };
+	static reg  mul(reg a, reg b)               { return _mm256_mul_pd(a, b);                };
+	static reg  div(reg a, reg b)               { return _mm256_div_pd(a, b);                };
+	static mask le(reg a, reg b)                { return _mm256_cmp_pd(a, b, _CMP_LE_OQ);    };
+	static mask lt(reg a, reg b)                { return _mm256_cmp_pd(a, b, _CMP_LT_OQ);    };
+	static mask eq(reg a, reg b)                { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ);    };
+	static mask both(mask a, mask b)            { return _mm256_and_pd(a, b);                };
+	static reg  select(mask m, reg a, reg b)    { return _mm256_blendv_pd(b, a, m);          };
+};
+
+} // anonymous namespace
+
+void univariateAVX2(double *values, char *inside, const double *knot, int order, const double *t, const bool *from_right, int nPts, int derivs, double *scratch) {
+	univariateSIMD<AVX2>(values, inside, knot, order, t, from_right, nPts, derivs, scratch);
+}
+
+} // end namespace LR
+
+#endif
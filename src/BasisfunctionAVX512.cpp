@@ -0,0 +1,37 @@
+#ifdef HAS_AVX512
+
+#include "UnivariateKernel.h"
+#include <immintrin.h>
+
+namespace LR {
+
+namespace {
+
+//! \brief Eight double lanes in the 512 bit AVX-512 registers, using the dedicated mask registers for comparisons
+struct AVX512 {
+	enum { width = 8 };
+	typedef __m512d reg;
+	typedef __mmask8 mask;
+	static reg  load(const double *p)           { return _mm512_loadu_pd(p);                    };
+	static void store(double *p, reg a)         { _mm512_storeu_pd(p, a);                       };
+	static reg  set1(double a)                  { return _mm512_set1_pd(a);                     };
+	static reg  add(reg a, reg b)               { return _mm512_add_pd(a, b);                   };
+	static reg  sub(reg a, reg b)               { return _mm512_sub_pd(a, b);                   };
+	static reg  mul(reg a, reg b)               { return _mm512_mul_pd(a, b);                   };
+	static reg  div(reg a, reg b)               { return _mm512_div_pd(a, b);                   };
+	static mask le(reg a, reg b)                { return _mm512_cmp_pd_mask(a, b, _CMP_LE_OQ);  };
+	static mask lt(reg a, reg b)                { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ);  };
+	static mask eq(reg a, reg b)                { return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ);  };
+	static mask both(mask a, mask b)            { return a & b;                                 };
+	static reg  select(mask m, reg a, reg b)    { return _mm512_mask_blend_pd(m, b, a);         };
+};
+
+} // anonymous namespace
+
+void univariateAVX512(double *values, char *inside, const double *knot, int order, const double *t, const bool *from_right, int nPts, int derivs, double *scratch) {
+	univariateSIMD<AVX512>(values, inside, knot, order, t, from_right, nPts, derivs, scratch);
+}
+
+} // end namespace LR
+
+#endif
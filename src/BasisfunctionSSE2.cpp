@@ -0,0 +1,37 @@
+#ifdef HAS_SSE2
+
+#include "UnivariateKernel.h"
+#include <emmintrin.h>
+
+namespace LR {
+
+namespace {
+
+//! \brief Two double lanes in the 128 bit SSE2 registers
+struct SSE2 {
+	enum { width = 2 };
+	typedef __m128d reg;
+	typedef __m128d mask;
+	static reg  load(const double *p)           { return _mm_loadu_pd(p);    };
+	static void store(double *p, reg a)         { _mm_storeu_pd(p, a);       };
+	static reg  set1(double a)                  { return _mm_set1_pd(a);     };
+	static reg  add(reg a, reg b)               { return _mm_add_pd(a, b);   };
+	static reg  sub(reg a, reg b)               { return _mm_sub_pd(a, b);   };
+	static reg  mul(reg a, reg b)               { return _mm_mul_pd(a, b);   };
+	static reg  div(reg a, reg b)               { return _mm_div_pd(a, b);   };
+	static mask le(reg a, reg b)                { return _mm_cmple_pd(a, b); };
+	static mask lt(reg a, reg b)                { return _mm_cmplt_pd(a, b); };
+	static mask eq(reg a, reg b)                { return _mm_cmpeq_pd(a, b); };
+	static mask both(mask a, mask b)            { return _mm_and_pd(a, b);   };
+	static reg  select(mask m, reg a, reg b)    { return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b)); };
+};
+
+} // anonymous namespace
+
+void univariateSSE2(double *values, char *inside, const double *knot, int order, const double *t, const bool *from_right, int nPts, int derivs, double *scratch) {
+	univariateSIMD<SSE2>(values, inside, knot, order, t, from_right, nPts, derivs, scratch);
+}
+
+} // end namespace LR
+
+#endif
@@ -3,6 +3,7 @@
 #include "LRSpline/Meshline.h"
 #include "LRSpline/Basisfunction.h"
 #include <stdlib.h>
+#include <atomic>
 
 typedef unsigned int uint;
 
@@ -12,8 +13,11 @@ namespace LR {
  * \brief Default constructor
  ***************************************************************************************************************************/
 Element::Element() {
+	dim_     = 0;
 	id_      = -1;
 	overloadCount = 0;
+	revision_     = newRevision();
+	bezierValid_  = false;
 }
 
 /************************************************************************************************************************//**
@@ -23,8 +27,11 @@ Element::Element() {
 Element::Element(int dim) {
 	id_           = -1;
 	overloadCount = 0;
-	min.resize(dim);
-	max.resize(dim);
+	revision_     = newRevision();
+	bezierValid_  = false;
+	dim_          = dim;
+	std::fill(min, min+3, 0.0);
+	std::fill(max, max+3, 0.0);
 }
 
 /************************************************************************************************************************//**
@@ -35,15 +42,25 @@ Element::Element(int dim) {
  * \param stop_v  Upper right v-coordinate
  ***************************************************************************************************************************/
 Element::Element(double start_u, double start_v, double stop_u, double stop_v) {
-	min.resize(2);
-	max.resize(2);
-
+	dim_   = 2;
 	min[0] = start_u;
 	min[1] = start_v;
 	max[0] = stop_u ;
 	max[1] = stop_v ;
 	id_    = -1;
 	overloadCount = 0;
+	revision_     = newRevision();
+	bezierValid_  = false;
+}
+
+/************************************************************************************************************************//**
+ * \brief Returns a number which has never been handed out before, used to tag each state of all elements
+ * \details This allows external caches (like QuadratureCache) to detect changes to an element by comparing revisions, even
+ *          if the element has been deleted and a new one allocated at the same address
+ ***************************************************************************************************************************/
+unsigned long long Element::newRevision() {
+	static std::atomic<unsigned long long> counter(0);
+	return ++counter;
 }
 
 /************************************************************************************************************************//**
@@ -52,6 +69,7 @@ Element::Element(double start_u, double start_v, double stop_u, double stop_v) {
  ***************************************************************************************************************************/
 void Element::removeSupportFunction(Basisfunction *f) {
 	support_.erase(f);
+	changed();
 }
 
 /************************************************************************************************************************//**
@@ -59,7 +77,8 @@ void Element::removeSupportFunction(Basisfunction *f) {
  * \param f The pointer to the Basisfunction to add
  ***************************************************************************************************************************/
 void Element::addSupportFunction(Basisfunction *f) {
-	support_.insert(f);
+	support_.insert(f, ObjectPool<Element>::dataPool(this));
+	changed();
 }
 
 /************************************************************************************************************************//**
@@ -69,8 +88,9 @@ Element* Element::copy() {
 	Element *returnvalue = new Element();
 
 	returnvalue->id_          = this->id_;
-	returnvalue->min          = this->min;    // it seems that the default vector operator= thing takes a deep copy
-	returnvalue->max          = this->max;
+	returnvalue->dim_         = this->dim_;
+	std::copy(min, min+dim_, returnvalue->min);
+	std::copy(max, max+dim_, returnvalue->max);
 
 	for(Basisfunction* b : support_)
 		returnvalue->support_ids_.push_back(b->getId());
@@ -83,37 +103,38 @@ Element* Element::copy() {
  * \brief Splits an element into two new ones by reducing the size of this element and returning a new element.
  * \param splitDim The constant parameter direction to split the element
  * \param par_value The parameter value to do the splitting
+ * \param pool Where to allocate the new element (the ObjectPool of the spline), or NULL for the heap
  * \returns The new element resulting from the splitting
  ***************************************************************************************************************************/
-Element* Element::split(int splitDim, double par_value) {
+Element* Element::split(int splitDim, double par_value, ObjectPool<Element> *pool) {
 	Element *newElement = NULL;
 	if(par_value >= max[splitDim] || par_value <= min[splitDim])
 		return NULL;
 
-	std::vector<double> newMin(min.begin(), min.end());
-	std::vector<double> newMax(max.begin(), max.end());
+	double newMin[3], newMax[3];
+	std::copy(min, min+dim_, newMin);
+	std::copy(max, max+dim_, newMax);
 
 	newMin[splitDim] = par_value; // new element should start at par_value
 	max[splitDim]    = par_value; // old element should stop  at par_value
+	changed();
 
-	newElement = new Element(min.size(), newMin.begin(), newMax.begin());
+	newElement = new (pool) Element(dim_, newMin, newMax);
+	newElement->support_.reserve(support_.size());
 
 	for(Basisfunction *b : support_)
 		if(b->addSupport(newElement)) // tests for overlapping as well
 			newElement->addSupportFunction(b);
 
-	bool someChange = true;
-	while(someChange) {
-		someChange = false;
-		for(Basisfunction *b : support_) {
-			if(!b->overlaps(this)) {
-				support_.erase(b);
-				b->removeSupport(this);
-				someChange = true;
-				break;
-			}
-		}
+	// keep only the functions which still overlap this element, in their original order
+	int nKeep = 0;
+	for(Basisfunction *b : support_) {
+		if(b->overlaps(this))
+			support_[nKeep++] = b;
+		else
+			b->removeSupport(this);
 	}
+	support_.resize(nKeep);
 	return newElement;
 }
 
@@ -122,7 +143,7 @@ Element* Element::split(int splitDim, double par_value) {
  ***************************************************************************************************************************/
 std::vector<double> Element::midpoint() const {
 	std::vector<double> result;
-	for(uint i=0; i<min.size(); i++)
+	for(int i=0; i<dim_; i++)
 		result.push_back((min[i]+max[i])/2.0);
 	return result;
 }
@@ -132,9 +153,10 @@ std::vector<double> Element::midpoint() const {
  * \param basis The flat vector list of basisfunctions
  ***************************************************************************************************************************/
 void Element::updateBasisPointers(std::vector<Basisfunction*> &basis) {
+	changed();
 	for(uint i=0; i<support_ids_.size(); i++) {
 		// add pointer from Element to Basisfunction
-		support_.insert(basis[support_ids_[i]]);
+		support_.insert(basis[support_ids_[i]], ObjectPool<Element>::dataPool(this));
 		// add pointer from Basisfunction back to Element
 		basis[support_ids_[i]]->addSupport(this);
 	}
@@ -154,8 +176,11 @@ void Element::read(std::istream &is) {
 	is >> dim;
 	ASSERT_NEXT_CHAR(']');
 	ASSERT_NEXT_CHAR(':');
-	min.resize(dim);
-	max.resize(dim);
+	if(dim < 1 || dim > 3) {
+		std::cerr << "Error parsing element: at most 3 parametric dimensions supported\n";
+		exit(326);
+	}
+	dim_ = dim;
 
 	ASSERT_NEXT_CHAR('(');
 	is >> min[0];
@@ -187,6 +212,7 @@ void Element::read(std::istream &is) {
 		nextChar = is.peek();
 	}
 	ASSERT_NEXT_CHAR('}');
+	changed();
 }
 #undef ASSERT_NEXT_CHAR
 
@@ -195,12 +221,12 @@ void Element::read(std::istream &is) {
  * \param os The output stream to write to
  ***************************************************************************************************************************/
 void Element::write(std::ostream &os) const {
-	os << id_ << " [" << min.size() << "] : ";
+	os << id_ << " [" << dim_ << "] : ";
 	os << "(" << min[0];
-	for(uint i=1; i<min.size(); i++)
+	for(int i=1; i<dim_; i++)
 		os << ", " << min[i] ;
 	os << ") x (" << max[0];
-	for(uint i=1; i<max.size(); i++)
+	for(int i=1; i<dim_; i++)
 		os << ", " << max[i] ;
 	os << ")";
 	os << "    {";
@@ -220,17 +246,17 @@ void Element::write(std::ostream &os) const {
  ***************************************************************************************************************************/
 bool Element::isOverloaded()  const {
 	int n = support_.size();
-	Basisfunction *b = *support_.begin();
 	if(n > 0) {
+		Basisfunction *b = support_.front();
 		if(b->nVariate() == 2) { // surfaces
-			int p1 = (*support_.begin())->getOrder(0);
-			int p2 = (*support_.begin())->getOrder(1);
+			int p1 = b->getOrder(0);
+			int p2 = b->getOrder(1);
 			if(n > p1*p2)
 				return true;
 		} else if(b->nVariate() == 3) { // volumes
-			int p1 = (*support_.begin())->getOrder(0);
-			int p2 = (*support_.begin())->getOrder(1);
-			int p3 = (*support_.begin())->getOrder(2);
+			int p1 = b->getOrder(0);
+			int p2 = b->getOrder(1);
+			int p3 = b->getOrder(2);
 			if(n > p1*p2*p3)
 				return true;
 		}
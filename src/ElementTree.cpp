@@ -0,0 +1,307 @@
+#include "LRSpline/ElementTree.h"
+#include "LRSpline/Element.h"
+#include <algorithm>
+
+namespace LR {
+
+// maximum number of elements stored in one leaf when it is built
+static const int LEAF_SIZE = 8;
+// number of elements a leaf may grow to by split() before it is rebuilt
+static const int MAX_LEAF_SIZE = 4*LEAF_SIZE;
+// traversal stack size. A full build gives a balanced tree covering any number of elements that fits in an int, while
+// the local rebuilds in split() add levels until the tree is rebuilt if it gets this deep
+static const int MAX_DEPTH = 64;
+
+/************************************************************************************************************************//**
+ * \brief Returns the number of levels buildNode() adds below a node holding count elements
+ ***************************************************************************************************************************/
+static int subtreeDepth(int count) {
+	int depth = 0;
+	for(; count > LEAF_SIZE; count = (count+1)/2)
+		depth++;
+	return depth;
+}
+
+/************************************************************************************************************************//**
+ * \brief Builds the tree from scratch
+ * \param elements All elements of the mesh. Element i is reported back as index i
+ * \param end The parametric end coordinate in all directions (elements touching it are closed, the rest half-open)
+ ***************************************************************************************************************************/
+void ElementTree::build(const std::vector<Element*> &elements, const std::vector<double> &end) {
+	clear();
+	if(elements.empty())
+		return;
+	parDim_ = end.size();
+	nBuilt_ = elements.size();
+	std::copy(end.begin(), end.end(), end_);
+
+	box_.resize(2*parDim_*nBuilt_);
+	next_.resize(nBuilt_);
+	leaf_.resize(nBuilt_);
+	std::vector<int> index(nBuilt_);
+	for(int i=0; i<nBuilt_; i++) {
+		setBox(i, elements[i]);
+		index[i] = i;
+	}
+	node_.reserve(2*nBuilt_/LEAF_SIZE + 1);
+	node_.resize(1);
+	buildNode(0, index.begin(), index.end(), 0);
+}
+
+/************************************************************************************************************************//**
+ * \brief Updates the tree after an element has been split in two
+ * \param elements All elements of the mesh, after the split
+ * \param iEl The element which was split (and now covers only the first part)
+ * \param iNew The new element covering the rest. Must be the last element in the list
+ ***************************************************************************************************************************/
+void ElementTree::split(const std::vector<Element*> &elements, int iEl, int iNew) {
+	// rebuild from scratch whenever the number of elements has doubled, to keep the tree balanced
+	if(iNew != (int) next_.size() || iNew >= 2*nBuilt_) {
+		build(elements, std::vector<double>(end_, end_+parDim_));
+		return;
+	}
+
+	// the new element lies inside the old box of iEl, and thus inside all nodes holding iEl
+	setBox(iEl, elements[iEl]);
+	box_.resize(box_.size() + 2*parDim_);
+	setBox(iNew, elements[iNew]);
+	int iLeaf = leaf_[iEl];
+	next_.push_back(node_[iLeaf].first);
+	leaf_.push_back(iLeaf);
+	node_[iLeaf].first = iNew;
+	node_[iLeaf].count++;
+
+	// and turn the leaf into a subtree if it has grown too large, unless this makes the tree too deep to traverse
+	if(node_[iLeaf].count > MAX_LEAF_SIZE) {
+		if(node_[iLeaf].depth + subtreeDepth(node_[iLeaf].count) >= MAX_DEPTH) {
+			build(elements, std::vector<double>(end_, end_+parDim_));
+			return;
+		}
+		std::vector<int> index;
+		for(int k=node_[iLeaf].first; k>=0; k=next_[k])
+			index.push_back(k);
+		buildNode(iLeaf, index.begin(), index.end(), node_[iLeaf].depth);
+	}
+}
+
+/************************************************************************************************************************//**
+ * \brief Creates node iNode at the given depth containing the elements in [first,last), and all nodes below it
+ ***************************************************************************************************************************/
+void ElementTree::buildNode(int iNode, std::vector<int>::iterator first, std::vector<int>::iterator last, int depth) {
+	Node node;
+	node.left  = -1;
+	node.first = -1;
+	node.count = last - first;
+	node.depth = depth;
+
+	// bounding box of the elements, and of their midpoints
+	double midLo[3], midHi[3];
+	for(int d=0; d<parDim_; d++) {
+		node.lo[d] = midLo[d] =  1e300;
+		node.hi[d] = midHi[d] = -1e300;
+	}
+	for(auto it=first; it!=last; ++it) {
+		const double *lo = &box_[2*parDim_*(*it)];
+		const double *hi = lo + parDim_;
+		for(int d=0; d<parDim_; d++) {
+			double mid = (lo[d] + hi[d]) / 2;
+			node.lo[d] = std::min(node.lo[d], lo[d]);
+			node.hi[d] = std::max(node.hi[d], hi[d]);
+			midLo[d]   = std::min(midLo[d], mid);
+			midHi[d]   = std::max(midHi[d], mid);
+		}
+	}
+
+	if(node.count <= LEAF_SIZE) {
+		// leaf: link up the list of elements
+		for(auto it=last; it!=first; ) {
+			--it;
+			next_[*it]  = node.first;
+			leaf_[*it]  = iNode;
+			node.first  = *it;
+		}
+		node_[iNode] = node;
+		return;
+	}
+
+	// split the elements in two halves by their midpoints along the widest direction
+	int dir = 0;
+	for(int d=1; d<parDim_; d++)
+		if(midHi[d]-midLo[d] > midHi[dir]-midLo[dir])
+			dir = d;
+	auto half = first + node.count/2;
+	const std::vector<double> &box = box_;
+	int parDim = parDim_;
+	std::nth_element(first, half, last, [&box, parDim, dir](int a, int b) {
+		double midA = box[2*parDim*a + dir] + box[2*parDim*a + parDim+dir];
+		double midB = box[2*parDim*b + dir] + box[2*parDim*b + parDim+dir];
+		return midA < midB || (midA == midB && a < b);
+	});
+	node.left = node_.size();
+	node_[iNode] = node;
+	node_.resize(node_.size() + 2);
+	buildNode(node.left,   first, half, depth+1);
+	buildNode(node.left+1, half,  last, depth+1);
+}
+
+/************************************************************************************************************************//**
+ * \brief Stores the parametric box of an element
+ ***************************************************************************************************************************/
+void ElementTree::setBox(int iEl, const Element *el) {
+	for(int d=0; d<parDim_; d++) {
+		box_[2*parDim_*iEl +         d] = el->getParmin(d);
+		box_[2*parDim_*iEl + parDim_+d] = el->getParmax(d);
+	}
+}
+
+/************************************************************************************************************************//**
+ * \brief Releases all memory held by the tree
+ ***************************************************************************************************************************/
+void ElementTree::clear() {
+	std::vector<double>().swap(box_);
+	std::vector<int>().swap(next_);
+	std::vector<int>().swap(leaf_);
+	std::vector<Node>().swap(node_);
+	parDim_ = 0;
+	nBuilt_ = 0;
+}
+
+/************************************************************************************************************************//**
+ * \brief Checks if an element contains a parametric point, using the same convention as the evaluation: elements are
+ *        defined as [umin,umax) for all except the last element: [umin,umax]
+ ***************************************************************************************************************************/
+bool ElementTree::contains(int iEl, const double *par) const {
+	const double *lo = &box_[2*parDim_*iEl];
+	const double *hi = lo + parDim_;
+	for(int d=0; d<parDim_; d++)
+		if(par[d] < lo[d] || par[d] > hi[d] || (par[d] == hi[d] && hi[d] != end_[d]))
+			return false;
+	return true;
+}
+
+/************************************************************************************************************************//**
+ * \brief Get the element index of the element containing a parametric point
+ * \param par The parametric point (2 components for surfaces, 3 for volumes)
+ * \return The index of the element which contains par, or -1 if it is outside the mesh
+ ***************************************************************************************************************************/
+int ElementTree::getElementContaining(const double *par) const {
+	if(node_.empty())
+		return -1;
+	int stack[MAX_DEPTH];
+	int top = 0;
+	stack[top++] = 0;
+	while(top > 0) {
+		const Node &node = node_[stack[--top]];
+		bool inside = true;
+		for(int d=0; d<parDim_; d++)
+			if(par[d] < node.lo[d] || par[d] > node.hi[d])
+				inside = false;
+		if(!inside)
+			continue;
+		if(node.left < 0) {
+			for(int k=node.first; k>=0; k=next_[k])
+				if(contains(k, par))
+					return k;
+		} else {
+			stack[top++] = node.left+1;
+			stack[top++] = node.left;
+		}
+	}
+	return -1;
+}
+
+/************************************************************************************************************************//**
+ * \brief Get all elements sharing (part of) one face with a given element
+ * \param iEl The element index
+ * \param dir The parametric direction normal to the face
+ * \param upper True for the face at the maximum parameter value in direction dir, false for the minimum one
+ * \param[out] result The indices of all neighbouring elements are added to this set
+ ***************************************************************************************************************************/
+void ElementTree::getElementNeighbours(int iEl, int dir, bool upper, std::set<int> &result) const {
+	if(node_.empty())
+		return;
+	const double *elLo = &box_[2*parDim_*iEl];
+	const double *elHi = elLo + parDim_;
+	double x = (upper) ? elHi[dir] : elLo[dir];
+
+	int stack[MAX_DEPTH];
+	int top = 0;
+	stack[top++] = 0;
+	while(top > 0) {
+		const Node &node = node_[stack[--top]];
+		bool overlap = node.lo[dir] <= x && x <= node.hi[dir];
+		for(int d=0; d<parDim_; d++)
+			if(d != dir && (node.lo[d] >= elHi[d] || node.hi[d] <= elLo[d]))
+				overlap = false;
+		if(!overlap)
+			continue;
+		if(node.left >= 0) {
+			stack[top++] = node.left+1;
+			stack[top++] = node.left;
+			continue;
+		}
+		for(int k=node.first; k>=0; k=next_[k]) {
+			const double *lo = &box_[2*parDim_*k];
+			const double *hi = lo + parDim_;
+			// the neighbour has to start (or stop) at the face, and the faces need a common area
+			bool neighbour = (upper) ? (lo[dir] <= x && x < hi[dir]) : (lo[dir] < x && x <= hi[dir]);
+			for(int d=0; d<parDim_; d++)
+				if(d != dir && (lo[d] >= elHi[d] || hi[d] <= elLo[d]))
+					neighbour = false;
+			if(neighbour)
+				result.insert(k);
+		}
+	}
+}
+
+/************************************************************************************************************************//**
+ * \brief Get all elements overlapping a box, i.e. where the interiors of the element and the box intersect
+ * \param lo The lower corner of the box
+ * \param hi The upper corner of the box
+ * \param[out] result The indices of all overlapping elements, in no particular order
+ ***************************************************************************************************************************/
+void ElementTree::getElementsOverlapping(const double *lo, const double *hi, std::vector<int> &result) const {
+	result.clear();
+	if(node_.empty())
+		return;
+	int stack[MAX_DEPTH];
+	int top = 0;
+	stack[top++] = 0;
+	while(top > 0) {
+		const Node &node = node_[stack[--top]];
+		bool overlap = true;
+		for(int d=0; d<parDim_; d++)
+			if(node.lo[d] >= hi[d] || node.hi[d] <= lo[d])
+				overlap = false;
+		if(!overlap)
+			continue;
+		if(node.left >= 0) {
+			stack[top++] = node.left+1;
+			stack[top++] = node.left;
+			continue;
+		}
+		for(int k=node.first; k>=0; k=next_[k]) {
+			const double *elLo = &box_[2*parDim_*k];
+			const double *elHi = elLo + parDim_;
+			bool inside = true;
+			for(int d=0; d<parDim_; d++)
+				if(elLo[d] >= hi[d] || elHi[d] <= lo[d])
+					inside = false;
+			if(inside)
+				result.push_back(k);
+		}
+	}
+}
+
+/************************************************************************************************************************//**
+ * \brief Returns the number of bytes of memory used by the tree
+ ***************************************************************************************************************************/
+size_t ElementTree::memoryFootprint() const {
+	return sizeof(ElementTree)                 +
+	       box_.capacity()  * sizeof(double) +
+	       next_.capacity() * sizeof(int)    +
+	       leaf_.capacity() * sizeof(int)    +
+	       node_.capacity() * sizeof(Node);
+}
+
+} // end namespace LR
@@ -0,0 +1,74 @@
+#include "LRSpline/KnotTable.h"
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+namespace LR {
+
+// knots closer than this are considered equal, same as Basisfunction::equals()
+static const double KNOT_TOL = 1e-10;
+
+/************************************************************************************************************************//**
+ * \brief Returns the position in the sorted list of the first knot which is not below knot (up to the tolerance)
+ ***************************************************************************************************************************/
+size_t KnotTable::lowerBound(double knot) const {
+	size_t lo = 0;
+	size_t hi = sorted_.size();
+	while(lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if(value_[sorted_[mid]] < knot - KNOT_TOL)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/************************************************************************************************************************//**
+ * \brief Searches for a knot value
+ * \param knot The knot value to search for
+ * \returns The index of the knot, or -1 if it is not in the table
+ ***************************************************************************************************************************/
+int KnotTable::find(double knot) const {
+	size_t i = lowerBound(knot);
+	if(i < sorted_.size() && fabs(value_[sorted_[i]] - knot) <= KNOT_TOL)
+		return sorted_[i];
+	return -1;
+}
+
+/************************************************************************************************************************//**
+ * \brief Returns the index of a knot value, adding it to the table if it is not there already
+ * \param knot The knot value
+ * \details Complexity: logarithmic if the knot exists, linear in the number of knots if it is added. Exits if the table
+ *          would grow beyond MAX_KNOTS
+ ***************************************************************************************************************************/
+KnotIndex KnotTable::index(double knot) {
+	size_t i = lowerBound(knot);
+	if(i < sorted_.size() && fabs(value_[sorted_[i]] - knot) <= KNOT_TOL)
+		return sorted_[i];
+	if((int) value_.size() == MAX_KNOTS) {
+		std::cerr << "Error KnotTable: more than " << MAX_KNOTS << " unique knots in one direction, turn knot indexing off" << std::endl;
+		exit(9240);
+	}
+	KnotIndex newIndex = value_.size();
+	value_.push_back(knot);
+	sorted_.insert(sorted_.begin() + i, newIndex);
+	return newIndex;
+}
+
+/************************************************************************************************************************//**
+ * \brief Removes all knots
+ ***************************************************************************************************************************/
+void KnotTable::clear() {
+	value_.clear();
+	sorted_.clear();
+}
+
+/************************************************************************************************************************//**
+ * \brief Returns the number of bytes used by the table
+ ***************************************************************************************************************************/
+size_t KnotTable::memoryFootprint() const {
+	return sizeof(KnotTable) + value_.capacity()*sizeof(double) + sorted_.capacity()*sizeof(KnotIndex);
+}
+
+} // end namespace LR
@@ -1,6 +1,15 @@
 #include "LRSpline/LRSpline.h"
 #include "LRSpline/Basisfunction.h"
 #include "LRSpline/Element.h"
+#include "LRSpline/BasisWorkspace.h"
+#include "LRSpline/Profiler.h"
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
 
 typedef unsigned int uint;
 
@@ -8,15 +17,36 @@ namespace LR {
 
 LRSpline::LRSpline() {
 	dim_      = 0;
+	locator_  = LOCATOR_GRID;
+	knotIndexing_ = false;
+	validBasisTable_ = false;
 	element_.resize(0);
 }
 
 void LRSpline::generateIDs() const {
 	uint i=0;
-	for(Basisfunction *b : basis_)
+	basisTable_.resize(basis_.size());
+	for(Basisfunction *b : basis_) {
+		basisTable_[i] = b;
 		b->setId(i++);
+	}
 	for(i=0; i<element_.size(); i++)
 		element_[i]->setId(i);
+	validBasisTable_ = true;
+}
+
+/************************************************************************************************************************//**
+ * \brief Renumbers all basis functions and elements, and builds the table used by getBasisfunction(), unless they are
+ *        already up to date
+ * \details Unlike generateIDs() this does not build the element lookup structure, so it is cheap to call before indexing
+ *          functions by their id after refinement. Is safe to call from several threads at once.
+ ***************************************************************************************************************************/
+void LRSpline::requireBasisTable() const {
+	if(validBasisTable_)
+		return;
+	std::lock_guard<std::mutex> lock(elementCacheLock_);
+	if(!validBasisTable_)
+		LRSpline::generateIDs();
 }
 
 void LRSpline::getEdgeFunctions(std::vector<Basisfunction*> &edgeFunctions, parameterEdge edge, int depth) const {
@@ -80,12 +110,12 @@ void LRSpline::getEdgeElements( std::vector<Element*> &edgeElements, parameterEd
 bool LRSpline::setControlPoints(const std::vector<double>& controlpoints) {
 	if((int) controlpoints.size() != dim_*basis_.size())
 		return false;
+	clearBezierCache();
 
 	std::vector<double>::const_iterator newCP = controlpoints.begin();
 
-	HashSet_iterator<Basisfunction*> bit;
-	for(bit=basis_.begin(); bit!=basis_.end(); ++bit) {
-		std::vector<double>::iterator cp = (**bit).cp();
+	for(int j=0; j<basis_.size(); j++) {
+		double *cp = getBasisfunction(j)->cp();
 		for(int i=0; i<dim_; i++, cp++, newCP++)
 			*cp = *newCP;
 	}
@@ -93,10 +123,958 @@ bool LRSpline::setControlPoints(const std::vector<double>& controlpoints) {
 }
 
 void LRSpline::rebuildDimension(int dimvalue) {
+	clearBezierCache();
 	for(Basisfunction *b : basis_)
 		b->setDimension(dimvalue);
 	dim_ = dimvalue;
 }
 
+/************************************************************************************************************************//**
+ * \brief Turns the knot index mode on or off
+ * \param on True to compare and hash the basis functions by knot indices, false to go back to comparing knot values
+ * \details In knot index mode the spline keeps a table of all unique knots in each parametric direction (see KnotTable),
+ *          and every basis function stores the index of each of its knots in these tables. Basis functions are then
+ *          compared by integer comparison and hashed exactly from the indices, instead of by knot values with a tolerance.
+ *          New knots are added to the tables as refinement creates functions which use them. The refinement results are
+ *          the same in both modes.
+ *
+ *          Turning the mode on or off indexes (or unindexes) all existing functions and rebuilds the basis function set.
+ *          Since the hash codes differ between the modes, a function from outside the spline (like a Basisfunction::copy)
+ *          can not be looked up in getAllBasisfunctions() while knot indexing is on.
+ *
+ *          The indexed functions store a 16 bit index instead of each knot value, and read the values back from the tables
+ *          (see Basisfunction::indexKnots()), so a bicubic function keeps 20 bytes of knots instead of 80. Knot values
+ *          within the tolerance of 1e-10 are snapped to the same table value. A table holds at most KnotTable::MAX_KNOTS
+ *          unique knots, and refinement beyond this exits with an error.
+ ***************************************************************************************************************************/
+void LRSpline::setKnotIndexing(bool on) {
+	std::vector<Basisfunction*> functions(basis_.begin(), basis_.end());
+	basis_.clear();
+	// the functions read their knots from the tables until they are unindexed
+	for(Basisfunction *b : functions)
+		b->clearKnotIndices();
+
+	knotIndexing_ = on;
+	knotTable_.clear();
+	if(on)
+		knotTable_.resize(nVariate());
+
+	for(Basisfunction *b : functions) {
+		if(on)
+			b->indexKnots(knotTable_);
+		basis_.insert(b);
+	}
+	// the order of the functions is kept by FlatHashSet, but not by MapHashSet which iterates by hash code
+	generateIDs();
+}
+
+/************************************************************************************************************************//**
+ * \brief Computes the position of a point along a space-filling curve through [start,end]^dim
+ * \param x The point, with dim components
+ * \param dim The number of components (at most 3)
+ * \param hilbert Use the Hilbert curve if true, and the Morton (Z-order) curve if false
+ * \details The point is quantized to an integer grid of 2^bits cells in each direction, and the bits of the coordinates are
+ *          interleaved with the most significant ones first. For the Hilbert curve the coordinates are first transformed as
+ *          described by J. Skilling, "Programming the Hilbert curve", AIP Conference Proceedings 707 (2004).
+ ***************************************************************************************************************************/
+static unsigned long long curveKey(const double *x, int dim, const double *start, const double *end, bool hilbert) {
+	const int bits = 63 / dim;
+	const unsigned long long cells = (1ULL << bits) - 1;
+	unsigned long long X[3];
+	for(int i=0; i<dim; i++) {
+		double t = (end[i] > start[i]) ? (x[i]-start[i]) / (end[i]-start[i]) : 0.0;
+		t = std::min(std::max(t, 0.0), 1.0);
+		X[i] = (unsigned long long) (t * cells + 0.5);
+	}
+	if(hilbert) {
+		// inverse undo excess work
+		for(unsigned long long Q = 1ULL << (bits-1); Q > 1; Q >>= 1) {
+			unsigned long long P = Q - 1;
+			for(int i=0; i<dim; i++) {
+				if(X[i] & Q) {
+					X[0] ^= P;
+				} else {
+					unsigned long long t = (X[0] ^ X[i]) & P;
+					X[0] ^= t;
+					X[i] ^= t;
+				}
+			}
+		}
+		// Gray encode
+		for(int i=1; i<dim; i++)
+			X[i] ^= X[i-1];
+		unsigned long long t = 0;
+		for(unsigned long long Q = 1ULL << (bits-1); Q > 1; Q >>= 1)
+			if(X[dim-1] & Q)
+				t ^= Q - 1;
+		for(int i=0; i<dim; i++)
+			X[i] ^= t;
+	}
+	unsigned long long key = 0;
+	for(int j=bits-1; j>=0; j--)
+		for(int i=0; i<dim; i++)
+			key = (key << 1) | ((X[i] >> j) & 1);
+	return key;
+}
+
+/************************************************************************************************************************//**
+ * \brief Orders a set of points lexicographically or along a space-filling curve
+ * \param pts All points, dim components each
+ * \param dim Number of components of each point
+ * \param scheme NUMBER_GREVILLE, NUMBER_MORTON or NUMBER_HILBERT
+ * \param[out] order The indices of the points in their new order. Ties keep their original order
+ ***************************************************************************************************************************/
+static void orderPoints(const std::vector<double> &pts, int dim, numberingScheme scheme, const double *start, const double *end,
+                        std::vector<int> &order) {
+	int n = pts.size() / dim;
+	order.resize(n);
+	for(int i=0; i<n; i++)
+		order[i] = i;
+	if(scheme == NUMBER_GREVILLE) {
+		std::stable_sort(order.begin(), order.end(), [&pts,dim](int a, int b) {
+			for(int d=dim-1; d>=0; d--)
+				if(pts[a*dim+d] != pts[b*dim+d])
+					return pts[a*dim+d] < pts[b*dim+d];
+			return false;
+		});
+		return;
+	}
+	std::vector<unsigned long long> key(n);
+	for(int i=0; i<n; i++)
+		key[i] = curveKey(&pts[i*dim], dim, start, end, scheme == NUMBER_HILBERT);
+	std::stable_sort(order.begin(), order.end(), [&key](int a, int b) { return key[a] < key[b]; });
+}
+
+/************************************************************************************************************************//**
+ * \brief Breadth first search from one node, visiting the neighbours of each node by increasing degree
+ * \param graph Sorted adjacency lists
+ * \param root The start node
+ * \param visited Nodes not to be searched. The ones found by this search are marked
+ * \param[out] order The nodes found, appended in the order they are visited
+ * \param[out] lastLevel The position in order of the first node in the last level
+ * \returns The number of levels
+ ***************************************************************************************************************************/
+static int levelSearch(const std::vector<std::vector<int> > &graph, int root, std::vector<bool> &visited, std::vector<int> &order,
+                       size_t &lastLevel) {
+	lastLevel = order.size();
+	order.push_back(root);
+	visited[root] = true;
+	int    levels   = 1;
+	size_t levelEnd = order.size();
+	for(size_t i=lastLevel; i<order.size(); i++) {
+		if(i == levelEnd) {
+			lastLevel = i;
+			levelEnd  = order.size();
+			levels++;
+		}
+		size_t firstChild = order.size();
+		for(int j : graph[order[i]]) {
+			if(!visited[j]) {
+				visited[j] = true;
+				order.push_back(j);
+			}
+		}
+		std::stable_sort(order.begin()+firstChild, order.end(), [&graph](int a, int b) {
+			return graph[a].size() < graph[b].size();
+		});
+	}
+	return levels;
+}
+
+/************************************************************************************************************************//**
+ * \brief Computes the reverse Cuthill-McKee ordering of a graph
+ * \param graph Sorted adjacency lists
+ * \param[out] order The nodes in their new order
+ * \details Each connected component is started from a pseudo-peripheral node, found by the heuristic of George and Liu:
+ *          starting from a node of minimum degree, move to a node of minimum degree in the last level of the breadth first
+ *          search for as long as this increases the number of levels.
+ ***************************************************************************************************************************/
+static void reverseCuthillMcKee(const std::vector<std::vector<int> > &graph, std::vector<int> &order) {
+	int n = graph.size();
+	order.clear();
+	order.reserve(n);
+	std::vector<bool> visited(n, false);
+	std::vector<bool> searched;
+	std::vector<int>  component;
+	size_t lastLevel;
+	int next = 0; // all nodes before this are numbered
+	while((int) order.size() < n) {
+		int root = -1;
+		for(int i=next; i<n; i++)
+			if(!visited[i] && (root < 0 || graph[i].size() < graph[root].size()))
+				root = i;
+
+		int levels = 0;
+		while(true) {
+			searched = visited;
+			component.clear();
+			int newLevels = levelSearch(graph, root, searched, component, lastLevel);
+			if(newLevels <= levels)
+				break;
+			levels = newLevels;
+			int candidate = component[lastLevel];
+			for(size_t i=lastLevel; i<component.size(); i++)
+				if(graph[component[i]].size() < graph[candidate].size())
+					candidate = component[i];
+			if(candidate == root)
+				break;
+			root = candidate;
+		}
+		levelSearch(graph, root, visited, order, lastLevel);
+		while(next < n && visited[next])
+			next++;
+	}
+	std::reverse(order.begin(), order.end());
+}
+
+/************************************************************************************************************************//**
+ * \brief Changes the order of the basis functions, and with it their ids
+ * \param scheme How to order the functions, see numberingScheme
+ * \details The new order is used by generateIDs(), the basis function iterators, getAllBasisfunctions() and write(). For the
+ *          space-filling curves and the lexicographic order the functions are placed by their Greville points, while
+ *          NUMBER_RCM works on the graph connecting all functions which overlap on at least one element.
+ *
+ *          This is a one-time reordering. Functions created by later refinement are placed last, so the spline has to be
+ *          renumbered again after refining. The order of the functions is kept by FlatHashSet (the default), but not by
+ *          MapHashSet which always iterates by hash code.
+ ***************************************************************************************************************************/
+void LRSpline::renumberBasisfunctions(numberingScheme scheme) {
+	if(scheme == NUMBER_CREATION || basis_.size() == 0)
+		return;
+	this->LRSpline::generateIDs();
+	int n      = basis_.size();
+	int parDim = nVariate();
+
+	std::vector<int> order;
+	if(scheme == NUMBER_RCM) {
+		std::vector<std::vector<int> > graph(n);
+		for(int i=0; i<n; i++) {
+			for(Element *el : basisTable_[i]->support())
+				for(Basisfunction *b : el->support())
+					if(b->getId() != i)
+						graph[i].push_back(b->getId());
+			std::sort(graph[i].begin(), graph[i].end());
+			graph[i].erase(std::unique(graph[i].begin(), graph[i].end()), graph[i].end());
+		}
+		reverseCuthillMcKee(graph, order);
+	} else {
+		std::vector<double> pts(n*parDim);
+		std::vector<double> greville;
+		for(int i=0; i<n; i++) {
+			basisTable_[i]->getGrevilleParameter(greville);
+			std::copy(greville.begin(), greville.end(), pts.begin() + i*parDim);
+		}
+		orderPoints(pts, parDim, scheme, &start_[0], &end_[0], order);
+	}
+
+	std::vector<Basisfunction*> functions(basisTable_);
+	basis_.clear();
+	for(int i : order)
+		basis_.insert(functions[i]);
+	this->LRSpline::generateIDs();
+}
+
+/************************************************************************************************************************//**
+ * \brief Changes the order of the elements, and with it their ids
+ * \param scheme How to order the elements, see numberingScheme
+ * \details The new order is used by generateIDs(), the element iterators, getAllElements() and write(). For the
+ *          space-filling curves and the lexicographic order the elements are placed by their midpoints, while NUMBER_RCM
+ *          works on the graph connecting all elements which share at least one basis function. The element lookup
+ *          structure is rebuilt on the next call to getElementContaining().
+ *
+ *          This is a one-time reordering. Elements created by later refinement are placed last, so the spline has to be
+ *          renumbered again after refining.
+ ***************************************************************************************************************************/
+void LRSpline::renumberElements(numberingScheme scheme) {
+	if(scheme == NUMBER_CREATION || element_.size() == 0)
+		return;
+	this->LRSpline::generateIDs();
+	int n      = element_.size();
+	int parDim = nVariate();
+
+	std::vector<int> order;
+	if(scheme == NUMBER_RCM) {
+		std::vector<std::vector<int> > graph(n);
+		for(int i=0; i<n; i++) {
+			for(Basisfunction *b : element_[i]->support())
+				for(Element *el : b->support())
+					if(el->getId() != i)
+						graph[i].push_back(el->getId());
+			std::sort(graph[i].begin(), graph[i].end());
+			graph[i].erase(std::unique(graph[i].begin(), graph[i].end()), graph[i].end());
+		}
+		reverseCuthillMcKee(graph, order);
+	} else {
+		std::vector<double> pts(n*parDim);
+		for(int i=0; i<n; i++)
+			for(int d=0; d<parDim; d++)
+				pts[i*parDim+d] = (element_[i]->getParmin(d) + element_[i]->getParmax(d)) / 2;
+		orderPoints(pts, parDim, scheme, &start_[0], &end_[0], order);
+	}
+
+	std::vector<Element*> elements(element_);
+	for(int i=0; i<n; i++)
+		element_[i] = elements[order[i]];
+	invalidateElementCache();
+	this->LRSpline::generateIDs();
+}
+
+/************************************************************************************************************************//**
+ * \brief Evaluates a range of basis functions at a parametric point, evaluating each distinct univariate B-spline only once
+ * \details Is the common implementation of both LRSpline::computeElementBasis functions
+ ***************************************************************************************************************************/
+template <typename Iterator>
+static void computeBasisRange(double *results, const double *parPt, int derivs, const bool *from_right, Iterator begin, Iterator end, int parDim, int width, BasisWorkspace &workspace) {
+	int nRes = Basisfunction::nDerivatives(parDim, derivs);
+	workspace.reserve(parDim, derivs, width);
+	workspace.clearUnivariate();
+	const double *univariate[3];
+	for(Iterator it=begin; it!=end; ++it) {
+		const Basisfunction *b = *it;
+		bool inside = true;
+		for(int i=0; i<parDim && inside; i++) {
+			univariate[i] = workspace.findUnivariate(i, (*b)[i], inside);
+			if(univariate[i] == NULL) {
+				double *values = workspace.values(i);
+				inside = Basisfunction::evaluateUnivariate(values, (*b)[i], parPt[i], derivs, from_right[i], workspace);
+				double *stored = workspace.addUnivariate(i, (*b)[i], inside);
+				std::copy(values, values+derivs+1, stored);
+				univariate[i] = stored;
+			}
+		}
+		if(inside)
+			b->evaluate(results, univariate, derivs);
+		else
+			std::fill(results, results+nRes, 0.0);
+		results += nRes;
+	}
+}
+
+/************************************************************************************************************************//**
+ * \brief Evaluates all basis functions with support on one element at a parametric point
+ * \param results [out] Array of nBasisFunctions()*Basisfunction::nDerivatives(nVariate(),derivs) values if iEl<0, and
+ *                      getElement(iEl)->nBasisFunctions()*Basisfunction::nDerivatives(nVariate(),derivs) otherwise. The
+ *                      functions are stored one after another in the order of the element support (or of all basis
+ *                      functions if iEl<0), and the derivatives of each function as given by Basisfunction::evaluate
+ * \param parPt Parametric evaluation point (one value for each parametric direction)
+ * \param derivs Number of derivatives requested
+ * \param from_right Array stating if any of the parametric directions should be evaluated in the limit from the right
+ * \param iEl The element containing parPt, or -1 to evaluate all basis functions
+ * \param workspace Scratch memory kept by the caller between calls
+ * \details The functions on one element share a lot of their local knot vectors in each parametric direction. Each distinct
+ *          univariate B-spline is evaluated only once, and the tensor products are formed afterwards. The results are
+ *          identical to calling Basisfunction::evaluate on each function in turn.
+ ***************************************************************************************************************************/
+void LRSpline::computeElementBasis(double *results, const double *parPt, int derivs, const bool *from_right, int iEl, BasisWorkspace &workspace) const {
+	int parDim = nVariate();
+	int nRes   = Basisfunction::nDerivatives(parDim, derivs);
+
+	if(iEl < 0) {
+		for(Basisfunction *b : basis_) {
+			b->evaluate(results, parPt, derivs, from_right, workspace);
+			results += nRes;
+		}
+		return;
+	}
+
+	const ElementSupport &support = element_[iEl]->support();
+	int width = *std::max_element(order_.begin(), order_.end());
+	computeBasisRange(results, parPt, derivs, from_right, support.begin(), support.end(), parDim, width, workspace);
+}
+
+/************************************************************************************************************************//**
+ * \brief Evaluates a list of basis functions at a parametric point
+ * \param results [out] Array of nFunctions*Basisfunction::nDerivatives(nVariate(),derivs) values
+ * \param parPt Parametric evaluation point (one value for each parametric direction)
+ * \param derivs Number of derivatives requested
+ * \param from_right Array stating if any of the parametric directions should be evaluated in the limit from the right
+ * \param functions The basis functions to evaluate, typically the support of one element gathered up front
+ * \param nFunctions Number of basis functions
+ * \param workspace Scratch memory kept by the caller between calls
+ * \details Same as the element version, but avoids walking the element support when many points are evaluated on the same
+ *          element
+ ***************************************************************************************************************************/
+void LRSpline::computeElementBasis(double *results, const double *parPt, int derivs, const bool *from_right, Basisfunction * const *functions, int nFunctions, BasisWorkspace &workspace) const {
+	int width = *std::max_element(order_.begin(), order_.end());
+	computeBasisRange(results, parPt, derivs, from_right, functions, functions+nFunctions, nVariate(), width, workspace);
+}
+
+/************************************************************************************************************************//**
+ * \brief Finds the cell in the global tensor mesh for each of a sorted list of parameter values
+ * \param grid Sorted parameter values
+ * \param globKnot Sorted unique global knot vector
+ * \param[out] cells The cell index i of each parameter value, following the same rule as getElementContaining(), i.e.
+ *                   globKnot[i] <= t < globKnot[i+1] except for the last cell which is closed. Values before the domain are
+ *                   given index -1 and values after the domain index globKnot.size()-1, so that cells is also sorted
+ ***************************************************************************************************************************/
+void LRSpline::getGridCells(const std::vector<double> &grid, const std::vector<double> &globKnot, std::vector<int> &cells) {
+	int nCells = globKnot.size()-1;
+	cells.resize(grid.size());
+	for(uint i=0; i<grid.size(); i++) {
+		if(grid[i] < globKnot.front())
+			cells[i] = -1;
+		else if(grid[i] > globKnot.back())
+			cells[i] = nCells;
+		else
+			cells[i] = std::min((int) (std::upper_bound(globKnot.begin(), globKnot.end(), grid[i]) - globKnot.begin()) - 1, nCells-1);
+	}
+}
+
+/************************************************************************************************************************//**
+ * \brief Builds the lookup table used by getKnotSpans()
+ * \param globKnot Sorted unique global knot vector
+ * \param[out] bucket The domain is divided into twice as many uniform buckets as there are cells, and bucket[b] is the cell
+ *                    containing the start of bucket b
+ ***************************************************************************************************************************/
+void LRSpline::getKnotBuckets(const std::vector<double> &globKnot, std::vector<int> &bucket) {
+	int    nCells   = globKnot.size()-1;
+	int    nBuckets = 2*nCells;
+	double start    = globKnot.front();
+	double scale    = nBuckets / (globKnot.back() - start);
+
+	bucket.resize(nBuckets);
+	for(int b=0, i=0; b<nBuckets; b++) {
+		double x = start + b / scale;
+		while(i < nCells-1 && globKnot[i+1] <= x)
+			i++;
+		bucket[b] = i;
+	}
+}
+
+/************************************************************************************************************************//**
+ * \brief Finds the cell in the global tensor mesh for each of an unsorted list of parameter values
+ * \param globKnot Sorted unique global knot vector
+ * \param bucket The lookup table of globKnot, see getKnotBuckets()
+ * \param t Parameter values
+ * \param n Number of parameter values
+ * \param[out] cells The cell index i of each parameter value, following the same rule as getElementContaining(), i.e.
+ *                   globKnot[i] <= t < globKnot[i+1] except for the last cell which is closed. Values outside the domain
+ *                   are given index -1
+ * \details A parameter value is found by one multiplication giving its bucket, followed by a binary search among the cells
+ *          overlapping this bucket. This is usually just one or two cells, and never more than a search of all knots, no
+ *          matter how the knots are clustered.
+ ***************************************************************************************************************************/
+void LRSpline::getKnotSpans(const std::vector<double> &globKnot, const std::vector<int> &bucket, const double *t, int n, int *cells) {
+	int    nCells   = globKnot.size()-1;
+	int    nBuckets = bucket.size();
+	double start    = globKnot.front();
+	double stop     = globKnot.back();
+	double scale    = nBuckets / (stop - start);
+
+	for(int k=0; k<n; k++) {
+		double x = t[k];
+		if(!(x >= start && x <= stop)) {
+			cells[k] = -1;
+			continue;
+		}
+		int b     = std::min((int) ((x-start) * scale), nBuckets-1);
+		int first = bucket[b];
+		int last  = (b+1 < nBuckets) ? bucket[b+1] : nCells-1;
+		int i     = std::upper_bound(globKnot.begin()+first+1, globKnot.begin()+last+1, x) - globKnot.begin() - 1;
+		// the bucket index may be off by rounding, in which case all knots are searched
+		if(globKnot[i] > x || (i < nCells-1 && globKnot[i+1] <= x))
+			i = std::min((int) (std::upper_bound(globKnot.begin(), globKnot.end(), x) - globKnot.begin()) - 1, nCells-1);
+		cells[k] = i;
+	}
+}
+
+/************************************************************************************************************************//**
+ * \brief Inserts several knots into the local knot vector of a univariate B-spline
+ * \param[in,out] knot The order+1 knots of the B-spline, which on return holds these and the new knots, sorted
+ * \param order The polynomial order (degree+1)
+ * \param newKnots The knots to insert. These need not be sorted, but must all be strictly inside the original support
+ * \param[out] alpha The B-spline is the sum of alpha[i] times the B-spline on knot[i], ..., knot[i+order]
+ * \details This is Boehm's algorithm, applied to the coefficients of the B-spline itself in the refined space. Inserting k
+ *          knots this way gives the same result as k calls to LRSplineSurface::split() (up to roundoff), without creating
+ *          the functions in between.
+ ***************************************************************************************************************************/
+void LRSpline::insertKnots(std::vector<double> &knot, int order, const std::vector<double> &newKnots, std::vector<double> &alpha) {
+	alpha.assign(1, 1.0);
+	for(double t : newKnots) {
+		// the new knot goes after all equal ones, so knot[l] <= t < knot[l+1]
+		int l = std::upper_bound(knot.begin(), knot.end(), t) - knot.begin() - 1;
+		alpha.push_back(0.0);
+		for(int j=alpha.size()-1; j>=0; j--) {
+			if(j >= l+1) {
+				alpha[j] = alpha[j-1];
+			} else if(j >= l-order+2) {
+				double a  = (t - knot[j]) / (knot[j+order-1] - knot[j]);
+				alpha[j]  = a*alpha[j] + ((j>0) ? (1-a)*alpha[j-1] : 0.0);
+			}
+		}
+		knot.insert(knot.begin()+l+1, t);
+	}
+}
+
+/************************************************************************************************************************//**
+ * \brief Divides functions into groups with no overlapping supports between the groups
+ * \param functions The functions, typically the ones to be split in batch refinement
+ * \param[out] groups The groups, holding all functions as candidates. The functions keep their order within each group, and the
+ *                    groups are ordered by their first function
+ * \details Two functions overlap exactly when they share a support element, so the groups are the connected components of
+ *          functions joined by common elements. The new functions from splitting one group lie inside the supports of the
+ *          group, and can thus never be equal to any function of another group.
+ ***************************************************************************************************************************/
+void LRSpline::groupBySupport(const std::vector<Basisfunction*> &functions, std::vector<SplitGroup> &groups) {
+	// union-find, always keeping the lowest index as the root
+	std::vector<int> root(functions.size());
+	auto find = [&root](int i) {
+		while(root[i] != i)
+			i = root[i] = root[root[i]];
+		return i;
+	};
+	std::unordered_map<const Element*, int> owner;
+	for(uint i=0; i<functions.size(); i++) {
+		root[i] = i;
+		for(Element *el : functions[i]->support()) {
+			std::pair<std::unordered_map<const Element*, int>::iterator, bool> res = owner.insert(std::make_pair(el, i));
+			if(res.second)
+				continue;
+			int a = find(i);
+			int b = find(res.first->second);
+			root[std::max(a,b)] = std::min(a,b);
+		}
+	}
+
+	groups.clear();
+	std::vector<int> groupOf(functions.size());
+	for(uint i=0; i<functions.size(); i++) {
+		int r = find(i);
+		if(r == (int) i) {
+			groupOf[i] = groups.size();
+			groups.push_back(SplitGroup());
+		}
+		groups[groupOf[r]].candidates.push_back(functions[i]);
+	}
+}
+
+/************************************************************************************************************************//**
+ * \brief Turns batch refinement on or off
+ * \param batch True to let refineElement() and refineBasisFunction() insert all new lines at once (see
+ *              LRSplineSurface::insert_lines()), false to insert them one by one with insert_line()
+ * \details The batch gives the same mesh as inserting the lines one by one on surfaces only. In a volume the basis reached
+ *          by splitting the functions depends on the order of the meshrectangles, so volumes always insert them one by one,
+ *          and turning batch refinement on for a volume is ignored with a warning
+ ***************************************************************************************************************************/
+void LRSpline::setBatchRefinement(bool batch) {
+	if(nVariate() == 3 && batch) {
+		std::cerr << "Warning: LRSplineVolume inserts its meshrectangles one by one, ignoring setBatchRefinement(true)" << std::endl;
+		batch = false;
+	}
+	batchRefinement_ = batch;
+}
+
+/************************************************************************************************************************//**
+ * \brief Sets the number of threads splitting the basis functions in batch refinement (see setBatchRefinement())
+ * \param nThreads The number of threads, 1 to refine on the calling thread only
+ * \details On surfaces the new lines are first merged into the mesh and the elements split on the calling thread, before
+ *          the functions are split and given their support in groups on nThreads threads (see insert_lines()). Volumes
+ *          insert their meshrectangles one by one, so for these nThreads is ignored with a warning
+ ***************************************************************************************************************************/
+void LRSpline::setRefinementThreads(int nThreads) {
+	if(nVariate() == 3 && nThreads > 1) {
+		std::cerr << "Warning: LRSplineVolume is refined on one thread, ignoring setRefinementThreads(" << nThreads << ")" << std::endl;
+		nThreads = 1;
+	}
+	refineThreads_ = (nThreads < 1) ? 1 : nThreads;
+}
+
+/************************************************************************************************************************//**
+ * \brief Calls work(g,t) for every group g in [0,nGroups), on up to nThreads threads at once
+ * \details The groups are handed out one at a time, so that a few large groups do not hold up the rest. The index t in
+ *          [0,nThreads) of the thread running a group is passed along, so that each thread may use its own pool
+ *          (see threadPool())
+ ***************************************************************************************************************************/
+void LRSpline::runGroups(int nGroups, int nThreads, const std::function<void(int,int)> &work) {
+	if(nThreads <= 1 || nGroups <= 1) {
+		for(int g=0; g<nGroups; g++)
+			work(g, 0);
+		return;
+	}
+	std::atomic<int> next(0);
+	std::vector<std::thread> threads;
+	for(int t=0; t<std::min(nThreads, nGroups); t++)
+		threads.push_back(std::thread([&next, nGroups, &work, t]() {
+			for(int g=next++; g<nGroups; g=next++)
+				work(g, t);
+		}));
+	for(std::thread &t : threads)
+		t.join();
+}
+
+/************************************************************************************************************************//**
+ * \brief Makes sure there is a basis function pool for each of nThreads threads in runGroups() (see threadPool())
+ * \details The pools are kept for the lifetime of the spline, since the functions created in them are. Must be called before
+ *          the threads are started
+ ***************************************************************************************************************************/
+void LRSpline::requireThreadPools(int nThreads) {
+	while((int) threadPools_.size() < nThreads-1)
+		threadPools_.emplace_back();
+}
+
+/************************************************************************************************************************//**
+ * \brief Adds a new function from splitting a function of a group
+ * \param f The new function, which is deleted if it already exists
+ * \param group The group
+ * \details If f is in basis_ (and not split away) or among the new functions of the group, it is added to the existing one,
+ *          otherwise it is stored among the new functions of the group. Only reads basis_, so several groups may do this at
+ *          the same time. In knot index mode, all knots of f must already be in the knot tables.
+ ***************************************************************************************************************************/
+void LRSpline::addSplitFunction(Basisfunction *f, SplitGroup &group) {
+	if(knotIndexing_)
+		f->indexKnots(knotTable_);
+	HashSet_iterator<Basisfunction*> it = basis_.find(f);
+	if(it != basis_.end() && group.split.find(f) == group.split.end()) {
+		**it += *f;
+		delete f;
+		return;
+	}
+	it = group.done.find(f);
+	if(it != group.done.end()) {
+		**it += *f;
+		delete f;
+		return;
+	}
+	it = group.newFunctions.find(f);
+	if(it != group.newFunctions.end()) {
+		**it += *f;
+		delete f;
+		return;
+	}
+	group.newFunctions.insert(f);
+}
+
+/************************************************************************************************************************//**
+ * \brief Evaluates each distinct univariate B-spline in one parametric direction of a set of basis functions, at many points
+ * \param functions The basis functions
+ * \param dir The parametric direction
+ * \param t The parametric evaluation points
+ * \param nPts The number of evaluation points
+ * \param derivs Number of derivatives requested
+ * \param end The end of the parametric domain in this direction. All other points are evaluated from the right
+ * \param[out] knotIndex For each basis function, the index of its univariate B-spline
+ * \param[out] values All univariate B-splines evaluated at all points stored as [nUnivariate][nPts][derivs+1]
+ * \param[out] inside If the points are inside the support of each univariate B-spline, stored as [nUnivariate][nPts]
+ * \param workspace Scratch memory
+ * \details Is the common part of LRSpline::evaluateGridElement() and LRSpline::evaluateElementPoints()
+ ***************************************************************************************************************************/
+static void evaluateDistinctUnivariate(const std::vector<Basisfunction*> &functions, int dir, const double *t, int nPts, int derivs, double end,
+                                       std::vector<int> &knotIndex, std::vector<double> &values, std::vector<char> &inside, BasisWorkspace &workspace) {
+	std::vector<LocalKnotVector> knots;
+	std::unique_ptr<bool[]> fromRight(new bool[nPts]);
+	for(int n=0; n<nPts; n++)
+		fromRight[n] = t[n] != end;
+	knotIndex.resize(functions.size());
+	for(uint f=0; f<functions.size(); f++) {
+		LocalKnotVector knot = (*functions[f])[dir];
+		uint k = 0;
+		while(k<knots.size() && knots[k] != knot)
+			k++;
+		if(k == knots.size()) {
+			knots.push_back(knot);
+			values.resize(knots.size()*nPts*(derivs+1));
+			inside.resize(knots.size()*nPts);
+			Basisfunction::evaluateUnivariate(&values[k*nPts*(derivs+1)], &inside[k*nPts], knot, t, fromRight.get(), nPts, derivs, workspace);
+		}
+		knotIndex[f] = k;
+	}
+}
+
+/************************************************************************************************************************//**
+ * \brief Evaluates the spline on all nodes of a tensor grid that are contained in one element, and adds it to the results
+ * \param out [out] The results stored contiguously as [node][nDerivs][dimension()]
+ * \param iEl The element to evaluate
+ * \param grid The grid parameter values in each parametric direction
+ * \param start Index of the first grid value in each direction that falls inside this element
+ * \param stop Index one past the last grid value in each direction that falls inside this element
+ * \param stride The node index in out is the sum of stride[i] times the grid index in direction i
+ * \param derivs Number of derivatives requested
+ * \details All univariate B-splines are evaluated once per grid line through the element (all lines in one vectorized
+ *          call), and reused for all grid nodes on that line. The results are identical to calling point() on each grid node.
+ ***************************************************************************************************************************/
+void LRSpline::evaluateGridElement(double *out, int iEl, const std::vector<double> *grid, const int *start, const int *stop, const int *stride, int derivs) const {
+	int parDim = nVariate();
+	int nRes   = Basisfunction::nDerivatives(parDim, derivs);
+	BasisWorkspace &workspace = BasisWorkspace::local();
+	workspace.reserve(parDim, derivs, *std::max_element(order_.begin(), order_.end()));
+
+	std::vector<Basisfunction*> functions(element_[iEl]->constSupportBegin(), element_[iEl]->constSupportEnd());
+	int nFun = functions.size();
+
+	// evaluate each distinct univariate B-spline on all grid lines through this element
+	int nNodes[] = {1, 1, 1};
+	std::vector<int>    knotIndex[3];
+	std::vector<double> values[3];
+	std::vector<char>   inside[3];
+	for(int dir=0; dir<parDim; dir++) {
+		nNodes[dir] = stop[dir]-start[dir];
+		evaluateDistinctUnivariate(functions, dir, &grid[dir][start[dir]], nNodes[dir], derivs, end_[dir], knotIndex[dir], values[dir], inside[dir], workspace);
+	}
+
+	// form the tensor products at each grid node and sum up with the control points
+	std::vector<double> basis_ev(nRes);
+	const double *univariate[3];
+	for(int k=0; k<nNodes[2]; k++) {
+		for(int j=0; j<nNodes[1]; j++) {
+			for(int i=0; i<nNodes[0]; i++) {
+				int node[] = {i, j, k};
+				int index  = 0;
+				for(int dir=0; dir<parDim; dir++)
+					index += (start[dir]+node[dir])*stride[dir];
+				double *pt = out + index*nRes*dim_;
+				for(int f=0; f<nFun; f++) {
+					bool isInside = true;
+					for(int dir=0; dir<parDim; dir++) {
+						int row = knotIndex[dir][f]*nNodes[dir] + node[dir];
+						isInside      = isInside && inside[dir][row];
+						univariate[dir] = &values[dir][row*(derivs+1)];
+					}
+					if(isInside)
+						functions[f]->evaluate(basis_ev.data(), univariate, derivs);
+					else
+						std::fill(basis_ev.begin(), basis_ev.end(), 0.0);
+					for(int d=0; d<nRes; d++)
+						for(int c=0; c<dim_; c++)
+							pt[d*dim_+c] += basis_ev[d]*functions[f]->cp(c);
+				}
+			}
+		}
+	}
+}
+
+/************************************************************************************************************************//**
+ * \brief Evaluates the spline on a set of scattered points that are all contained in one element, and adds it to the results
+ * \param out [out] The results stored contiguously as [point][nDerivs][dimension()]
+ * \param iEl The element to evaluate
+ * \param parPt The parametric coordinates of all points, one array per parametric direction
+ * \param index The indices of the points (into parPt and out) which are to be evaluated on this element
+ * \param nPts The number of indices
+ * \param derivs Number of derivatives requested
+ * \details All univariate B-splines are evaluated for all points in one vectorized call. The results are identical to calling
+ *          point() on each point.
+ ***************************************************************************************************************************/
+void LRSpline::evaluateElementPoints(double *out, int iEl, const double * const *parPt, const int *index, int nPts, int derivs) const {
+	int parDim = nVariate();
+	int nRes   = Basisfunction::nDerivatives(parDim, derivs);
+	BasisWorkspace &workspace = BasisWorkspace::local();
+	workspace.reserve(parDim, derivs, *std::max_element(order_.begin(), order_.end()));
+
+	std::vector<Basisfunction*> functions(element_[iEl]->constSupportBegin(), element_[iEl]->constSupportEnd());
+	int nFun = functions.size();
+
+	// evaluate each distinct univariate B-spline on all points
+	std::vector<double> t(nPts);
+	std::vector<int>    knotIndex[3];
+	std::vector<double> values[3];
+	std::vector<char>   inside[3];
+	for(int dir=0; dir<parDim; dir++) {
+		for(int n=0; n<nPts; n++)
+			t[n] = parPt[dir][index[n]];
+		evaluateDistinctUnivariate(functions, dir, t.data(), nPts, derivs, end_[dir], knotIndex[dir], values[dir], inside[dir], workspace);
+	}
+
+	// form the tensor products at each point and sum up with the control points
+	std::vector<double> basis_ev(nRes);
+	const double *univariate[3];
+	for(int n=0; n<nPts; n++) {
+		double *pt = out + index[n]*nRes*dim_;
+		for(int f=0; f<nFun; f++) {
+			bool isInside = true;
+			for(int dir=0; dir<parDim; dir++) {
+				int row = knotIndex[dir][f]*nPts + n;
+				isInside      = isInside && inside[dir][row];
+				univariate[dir] = &values[dir][row*(derivs+1)];
+			}
+			if(isInside)
+				functions[f]->evaluate(basis_ev.data(), univariate, derivs);
+			else
+				std::fill(basis_ev.begin(), basis_ev.end(), 0.0);
+			for(int d=0; d<nRes; d++)
+				for(int c=0; c<dim_; c++)
+					pt[d*dim_+c] += basis_ev[d]*functions[f]->cp(c);
+		}
+	}
+}
+
+/************************************************************************************************************************//**
+ * \brief Evaluates a spline given by an external coefficient array, on the basis of this spline
+ * \param out [out] The result stored as [nDerivs][nComp]
+ * \param parPt Parametric evaluation point (one value for each parametric direction)
+ * \param from_right Array stating if any of the parametric directions should be evaluated in the limit from the right
+ * \param derivs Number of derivatives requested
+ * \param iEl The element containing parPt
+ * \param coefs Coefficients of all basis functions, indexed by basis function id (see generateIDs())
+ * \param nComp Number of components (fields) for each basis function
+ * \param layout How coefs is stored in memory
+ * \details The basis functions on the element are evaluated once, and contracted with the nComp coefficients of each of them.
+ *          With the control points as coefficients, the results are identical to point().
+ ***************************************************************************************************************************/
+void LRSpline::evaluateField(double *out, const double *parPt, const bool *from_right, int derivs, int iEl,
+                             const double *coefs, int nComp, coefficientLayout layout) const {
+	int nRes = Basisfunction::nDerivatives(nVariate(), derivs);
+	std::fill(out, out + nRes*nComp, 0.0);
+
+	const Element *el = element_[iEl];
+	BasisWorkspace &workspace = BasisWorkspace::local();
+	double *basis_ev = workspace.buffer(el->nBasisFunctions() * nRes);
+	computeElementBasis(basis_ev, parPt, derivs, from_right, iEl, workspace);
+
+	size_t nBasis = basis_.size();
+	for(Basisfunction *b : el->support()) {
+		size_t id = b->getId();
+		const double *c = (layout == ROW_MAJOR) ? coefs + id*nComp : coefs + id;
+		size_t stride   = (layout == ROW_MAJOR) ? 1                : nBasis;
+		for(int i=0; i<nRes; i++)
+			for(int j=0; j<nComp; j++)
+				out[i*nComp+j] += basis_ev[i]*c[j*stride];
+		basis_ev += nRes;
+	}
+}
+
+/************************************************************************************************************************//**
+ * \brief Returns the Bezier control points of one element, computing them with getBezierElement() on first use
+ * \param iEl The element index
+ * \details The coefficients are cached on the element and thrown away automatically whenever refinement changes the element
+ *          or its supported functions, and by setControlPoints() and rebuildDimension(). If the control points are modified
+ *          directly through Basisfunction::cp(), clearBezierCache() must be called. May be called from several threads at
+ *          once; if two threads compute the same element, the first one to finish is stored.
+ ***************************************************************************************************************************/
+const std::vector<double>& LRSpline::getBezierCache(int iEl) const {
+	Element *el = element_[iEl];
+	if(!el->hasBezierCache()) {
+		std::vector<double> controlPoints;
+		getBezierElement(iEl, controlPoints);
+		std::lock_guard<std::mutex> lock(bezierLock_);
+		if(!el->hasBezierCache())
+			el->setBezierCache(controlPoints);
+	}
+	return el->bezierCache();
+}
+
+/************************************************************************************************************************//**
+ * \brief Computes the Bezier control points of all elements which are not already cached
+ ***************************************************************************************************************************/
+void LRSpline::buildBezierCache() const {
+#ifdef TIME_LRSPLINE
+	PROFILE("buildBezierCache()");
+#endif
+	for(uint iEl=0; iEl<element_.size(); iEl++)
+		getBezierCache(iEl);
+}
+
+/************************************************************************************************************************//**
+ * \brief Throws away the cached Bezier control points of all elements
+ ***************************************************************************************************************************/
+void LRSpline::clearBezierCache() const {
+	for(Element *el : element_)
+		el->clearBezierCache();
+}
+
+/************************************************************************************************************************//**
+ * \brief Evaluates all Bernstein polynomials of one order and their derivatives
+ * \param B [out] Array of (derivs+1)*order values stored as [derivs+1][order]
+ * \param order Polynomial order (degree+1)
+ * \param s Evaluation point in [0,1]
+ * \param derivs Number of derivatives requested
+ * \param h Length of the element, derivatives are scaled by 1/h to give the derivatives on the element
+ * \param scratch Memory for 2*order values
+ ***************************************************************************************************************************/
+static void bernsteinBasis(double *B, int order, double s, int derivs, double h, double *scratch) {
+	int p = order-1;
+	std::fill(B, B+(derivs+1)*order, 0.0);
+	// build all degrees up to p, keeping each one which some derivative is computed from
+	double *row = scratch;
+	row[0] = 1;
+	for(int k=0; k<=p; k++) {
+		if(k>0) {
+			for(int i=k; i>=0; i--)
+				row[i] = ((i<k) ? (1-s)*row[i] : 0.0) + ((i>0) ? s*row[i-1] : 0.0);
+		}
+		int r = p-k; // derivative of degree-p polynomials computed from the degree-k ones
+		if(r > derivs)
+			continue;
+		// differentiate r times: d/ds B_i^m = m*(B_{i-1}^{m-1} - B_i^{m-1})
+		double *d = scratch + order;
+		std::copy(row, row+k+1, d);
+		for(int m=k+1; m<=p; m++)
+			for(int i=m; i>=0; i--)
+				d[i] = m*( ((i>0) ? d[i-1] : 0.0) - ((i<m) ? d[i] : 0.0) ) / h;
+		std::copy(d, d+order, B + r*order);
+	}
+}
+
+/************************************************************************************************************************//**
+ * \brief Evaluates the spline and its derivatives from the cached Bezier representation of one element
+ * \param pts [out] Array of Basisfunction::nDerivatives(nVariate(), derivs)*dimension() values, ordered as point()
+ * \param parPt The parametric evaluation point
+ * \param derivs Number of derivatives requested
+ * \param iEl The element containing parPt
+ * \details Contracts the tensor of Bezier control points with the univariate Bernstein polynomials one direction at a time,
+ *          i.e. without looking at the basis functions of the element at all
+ ***************************************************************************************************************************/
+void LRSpline::evaluateBezier(double *pts, const double *parPt, int derivs, int iEl) const {
+	int parDim = nVariate();
+	const std::vector<double> &C = getBezierCache(iEl);
+	const Element *el = element_[iEl];
+	int p[] = {1, 1, 1};
+	for(int dir=0; dir<parDim; dir++)
+		p[dir] = order_[dir];
+
+	// univariate Bernstein polynomials, followed by room for the partial contractions
+	int nB    = (derivs+1)*(p[0]+p[1]+p[2]);
+	int nTmp1 = (derivs+1)*p[1]*p[2]*dim_;
+	int nTmp2 = (derivs+1)*(derivs+1)*p[2]*dim_;
+	int maxP  = *std::max_element(p, p+3);
+	double *mem  = BasisWorkspace::local().buffer(nB + nTmp1 + nTmp2 + 2*maxP);
+	double *B[3] = {mem, mem + (derivs+1)*p[0], mem + (derivs+1)*(p[0]+p[1])};
+	double *tmp1 = mem + nB;
+	double *tmp2 = tmp1 + nTmp1;
+	double *scratch = tmp2 + nTmp2;
+	for(int dir=0; dir<parDim; dir++) {
+		double h = el->getParmax(dir) - el->getParmin(dir);
+		bernsteinBasis(B[dir], p[dir], (parPt[dir]-el->getParmin(dir))/h, derivs, h, scratch);
+	}
+	if(parDim == 2)
+		B[2][0] = 1; // dummy constant third direction
+
+	// contract u:  tmp1[du][w][v][c] = sum_u B0[du][u] C[w][v][u][c]
+	for(int du=0; du<=derivs; du++) {
+		for(int wv=0; wv<p[1]*p[2]; wv++) {
+			double *t = tmp1 + (du*p[1]*p[2] + wv)*dim_;
+			std::fill(t, t+dim_, 0.0);
+			for(int u=0; u<p[0]; u++)
+				for(int c=0; c<dim_; c++)
+					t[c] += B[0][du*p[0]+u] * C[(wv*p[0]+u)*dim_+c];
+		}
+	}
+	// contract v:  tmp2[du][dv][w][c] = sum_v B1[dv][v] tmp1[du][w][v][c]
+	for(int du=0; du<=derivs; du++) {
+		for(int dv=0; du+dv<=derivs; dv++) {
+			for(int w=0; w<p[2]; w++) {
+				double *t = tmp2 + ((du*(derivs+1) + dv)*p[2] + w)*dim_;
+				std::fill(t, t+dim_, 0.0);
+				for(int v=0; v<p[1]; v++)
+					for(int c=0; c<dim_; c++)
+						t[c] += B[1][dv*p[1]+v] * tmp1[((du*p[2] + w)*p[1] + v)*dim_+c];
+			}
+		}
+	}
+	// contract w and write out in the same derivative ordering as Basisfunction::evaluate
+	int ip = 0;
+	for(int totDeriv=0; totDeriv<=derivs; totDeriv++) {
+		for(int du=totDeriv; du>-1; du--) {
+			for(int dv=totDeriv-du; dv>-1; dv--) {
+				int dw = totDeriv-du-dv;
+				if(parDim == 2 && dw > 0) // bivariate: only dv=totDeriv-du
+					continue;
+				double *pt = pts + (ip++)*dim_;
+				std::fill(pt, pt+dim_, 0.0);
+				for(int w=0; w<p[2]; w++)
+					for(int c=0; c<dim_; c++)
+						pt[c] += B[2][dw*p[2]+w] * tmp2[((du*(derivs+1) + dv)*p[2] + w)*dim_+c];
+			}
+		}
+	}
+}
 
 } // end namespace LR
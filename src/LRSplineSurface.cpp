@@ -1,10 +1,12 @@
 #include "LRSpline/LRSplineSurface.h"
 #include "LRSpline/Basisfunction.h"
+#include "LRSpline/BasisWorkspace.h"
 #include "LRSpline/Meshline.h"
 #include "LRSpline/Element.h"
 #include "LRSpline/Profiler.h"
 
 #include <set>
+#include <thread>
 #include <algorithm>
 #include <functional>
 #include <cstdio>
@@ -167,11 +169,18 @@ LRSplineSurface::LRSplineSurface(int n1, int n2, int order_u, int order_v) {
 void LRSplineSurface::initMeta() {
 	maxTjoints_           = -1;
 	doCloseGaps_          = true;
+	batchRefinement_      = false;
+	refineThreads_        = 1;
 	maxAspectRatio_       = 2.0;
 	doAspectRatioFix_     = false;
 	refStrat_             = LR_FULLSPAN;
 	refKnotlineMult_      = 1;
 	symmetry_             = 1;
+	builtElementCache_    = false;
+	validBasisTable_      = false;
+	validLocator_         = false;
+	validElementTree_     = false;
+	validMeshlineIndex_   = false;
 	element_red           = 0.5;
 	element_green         = 0.5;
 	element_blue          = 0.5;
@@ -186,11 +195,14 @@ void LRSplineSurface::initMeta() {
 /************************************************************************************************************************//**
  * \brief Destructor. Frees up all memory consumed by this LRSplineSurface
  * \details This deletes all Basisfunction, Element and Meshline used by this class. All pointers to these objects are
- *          rendered invalid
+ *          rendered invalid. Objects created by this spline live in its pools, so this only returns a few slabs to the heap
  ***************************************************************************************************************************/
 LRSplineSurface::~LRSplineSurface() {
-	for(Basisfunction* b : basis_)
+	// the elements are deleted as well, so there is no need for the functions to remove themselves from their support lists
+	for(Basisfunction* b : basis_) {
+		b->clearSupport();
 		delete b;
+	}
 	for(uint i=0; i<meshline_.size(); i++)
 		delete meshline_[i];
 	for(uint i=0; i<element_.size(); i++)
@@ -226,6 +238,7 @@ LRSplineSurface* LRSplineSurface::copy() const {
 		returnvalue -> meshline_.push_back(m->copy());
 
 	returnvalue->rational_         = this->rational_;
+	returnvalue->locator_          = this->locator_;
 	returnvalue->dim_              = this->dim_;
 	returnvalue->order_[0]          = this->order_[0];
 	returnvalue->order_[1]          = this->order_[1];
@@ -235,8 +248,12 @@ LRSplineSurface* LRSplineSurface::copy() const {
 	returnvalue->end_[1]            = this->end_[1];
 	returnvalue->maxTjoints_       = this->maxTjoints_;
 	returnvalue->doCloseGaps_      = this->doCloseGaps_;
+	returnvalue->batchRefinement_  = this->batchRefinement_;
+	returnvalue->refineThreads_    = this->refineThreads_;
 	returnvalue->doAspectRatioFix_ = this->doAspectRatioFix_;
 	returnvalue->maxAspectRatio_   = this->maxAspectRatio_;
+	if(knotIndexing_)
+		returnvalue->setKnotIndexing(true);
 
 	return returnvalue;
 }
@@ -396,8 +413,6 @@ void LRSplineSurface::point(std::vector<std::vector<double> > &pts, double u, do
 #ifdef TIME_LRSPLINE
 	PROFILE("Point()");
 #endif
-	std::vector<double> basis_ev;
-
 	// clear and resize output array (optimization may consider this an outside task)
 	pts.clear();
 	pts.resize((derivs+1)*(derivs+2)/2);
@@ -411,11 +426,218 @@ void LRSplineSurface::point(std::vector<std::vector<double> > &pts, double u, do
 		iEl = getElementContaining(u,v);
 	if(iEl == -1)
 		return;
+
+	BasisWorkspace &workspace = BasisWorkspace::local();
+	double  parPt[]     = {u, v};
+	bool    fromRight[] = {u_from_right, v_from_right};
+	double *basis_ev    = workspace.buffer(element_[iEl]->nBasisFunctions() * pts.size());
+	computeElementBasis(basis_ev, parPt, derivs, fromRight, iEl, workspace);
 	for(Basisfunction* b : element_[iEl]->support() ) {
-		b->evaluate(basis_ev, u,v, derivs, u_from_right, v_from_right);
 		for(uint i=0; i<pts.size(); i++)
 			for(int j=0; j<dim_; j++)
 				pts[i][j] += basis_ev[i]*b->cp(j);
+		basis_ev += pts.size();
+	}
+}
+
+/************************************************************************************************************************//**
+ * \brief Evaluate the surface at a point (u,v) from the Bezier representation of the element
+ * \param[out] pt The result, i.e. the parametric surface mapped to physical space
+ * \param u The u-coordinate on which to evaluate the surface
+ * \param v The v-coordinate on which to evaluate the surface
+ * \param iEl The element index which this point is contained in. If used will speed up computational efficiency
+ * \details Gives the same result as point() up to round-off. See getBezierCache() for details on the cached coefficients
+ ***************************************************************************************************************************/
+void LRSplineSurface::pointBezier(std::vector<double> &pt, double u, double v, int iEl) const {
+	pt.assign(dim_, 0.0);
+	if(u < start_[0] || end_[0] < u ||
+	   v < start_[1] || end_[1] < v)
+		return;
+	if(iEl == -1)
+		iEl = getElementContaining(u,v);
+	if(iEl == -1)
+		return;
+	double parPt[] = {u, v};
+	evaluateBezier(pt.data(), parPt, 0, iEl);
+}
+
+/************************************************************************************************************************//**
+ * \brief Evaluate the surface and its derivatives at a point (u,v) from the Bezier representation of the element
+ * \param[out] pts The result, i.e. the parametric surface as well as all parametric derivatives, ordered as in point()
+ * \param u The u-coordinate on which to evaluate the surface
+ * \param v The v-coordinate on which to evaluate the surface
+ * \param derivs The number of derivatives requested
+ * \param iEl The element index which this point is contained in. If used it will speed up computational efficiency
+ * \details Instead of evaluating every basis function on the element, this contracts the order_[0] x order_[1] Bezier control
+ *          points of the element with the Bernstein polynomials. The Bezier control points are computed on first use and
+ *          cached on the element (see getBezierCache()), so repeated evaluation on a fixed mesh is several times faster
+ *          than point(). The results are the same up to round-off.
+ ***************************************************************************************************************************/
+void LRSplineSurface::pointBezier(std::vector<std::vector<double> > &pts, double u, double v, int derivs, int iEl) const {
+#ifdef TIME_LRSPLINE
+	PROFILE("pointBezier()");
+#endif
+	pts.resize((derivs+1)*(derivs+2)/2);
+	for(uint i=0; i<pts.size(); i++)
+		pts[i].assign(dim_, 0.0);
+	if(u < start_[0] || end_[0] < u ||
+	   v < start_[1] || end_[1] < v)
+		return;
+	if(iEl == -1)
+		iEl = getElementContaining(u,v);
+	if(iEl == -1)
+		return;
+
+	double parPt[] = {u, v};
+	double *res = BasisWorkspace::local().results(pts.size()*dim_);
+	evaluateBezier(res, parPt, derivs, iEl);
+	for(uint i=0; i<pts.size(); i++)
+		std::copy(res + i*dim_, res + (i+1)*dim_, pts[i].begin());
+}
+
+/************************************************************************************************************************//**
+ * \brief Evaluate a (multi-component) field defined on the basis of this surface, and its derivatives, at a point (u,v)
+ * \param[out] pts The result stored as [nDerivs][nComp], with the derivatives ordered as in point()
+ * \param coefs The coefficients of all basis functions, indexed by the basis function id (see generateIDs())
+ * \param nComp The number of components (fields) for each basis function
+ * \param u The u-coordinate on which to evaluate the field
+ * \param v The v-coordinate on which to evaluate the field
+ * \param derivs The number of derivatives requested
+ * \param iEl The element index which this point is contained in. If used it will speed up computational efficiency
+ * \param layout If coefs is stored as [nBasisFunctions()][nComp] (ROW_MAJOR) or [nComp][nBasisFunctions()] (COLUMN_MAJOR)
+ * \details Evaluates a solution using the same basis as the geometry, without copying the coefficients into the control
+ *          points. The cost is one evaluation of the basis functions on the element plus a product with the nComp
+ *          coefficients of each function, so evaluating all fields of a multi-field solution at once is much cheaper than
+ *          evaluating each field separately. The basis function ids are renumbered on first use after refinement.
+ ***************************************************************************************************************************/
+void LRSplineSurface::pointField(double *pts, const double *coefs, int nComp, double u, double v, int derivs, int iEl, coefficientLayout layout) const {
+#ifdef TIME_LRSPLINE
+	PROFILE("pointField()");
+#endif
+	std::fill(pts, pts + (derivs+1)*(derivs+2)/2*nComp, 0.0);
+	if(u < start_[0] || end_[0] < u ||
+	   v < start_[1] || end_[1] < v)
+		return;
+	requireElementCache(); // makes sure the basis function ids are up to date
+	if(iEl == -1)
+		iEl = getElementContaining(u,v);
+	if(iEl == -1)
+		return;
+
+	double parPt[]     = {u, v};
+	bool   fromRight[] = {u!=end_[0], v!=end_[1]};
+	evaluateField(pts, parPt, fromRight, derivs, iEl, coefs, nComp, layout);
+}
+
+/************************************************************************************************************************//**
+ * \brief Evaluate a (multi-component) field defined on the basis of this surface, and its derivatives, at a point (u,v)
+ * \param[out] pts The result, pts[i][j] is derivative i (ordered as in point()) of component j
+ * \param coefs The coefficients of all basis functions, indexed by the basis function id (see generateIDs())
+ * \param nComp The number of components (fields) for each basis function
+ * \param u The u-coordinate on which to evaluate the field
+ * \param v The v-coordinate on which to evaluate the field
+ * \param derivs The number of derivatives requested
+ * \param iEl The element index which this point is contained in. If used it will speed up computational efficiency
+ * \param layout If coefs is stored as [nBasisFunctions()][nComp] (ROW_MAJOR) or [nComp][nBasisFunctions()] (COLUMN_MAJOR)
+ ***************************************************************************************************************************/
+void LRSplineSurface::pointField(std::vector<std::vector<double> > &pts, const double *coefs, int nComp, double u, double v, int derivs, int iEl, coefficientLayout layout) const {
+	int nRes = (derivs+1)*(derivs+2)/2;
+	std::vector<double> res(nRes*nComp);
+	pointField(res.data(), coefs, nComp, u, v, derivs, iEl, layout);
+	pts.resize(nRes);
+	for(int i=0; i<nRes; i++)
+		pts[i].assign(res.begin() + i*nComp, res.begin() + (i+1)*nComp);
+}
+
+/************************************************************************************************************************//**
+ * \brief Evaluate the surface and its derivatives at many points at once
+ * \param[out] pts The results stored contiguously as [nPts][nDerivs][dimension()] with nDerivs=(derivs+1)*(derivs+2)/2. The
+ *                 derivatives are ordered as in point(). Points outside the parametric domain are set to zero
+ * \param u Array of the u-coordinates of all points
+ * \param v Array of the v-coordinates of all points
+ * \param nPts The number of points
+ * \param derivs The number of derivatives requested
+ * \param iEl Optional array of element indices containing each point (-1 entries are looked up)
+ * \details The points are grouped by element, so the support of each element is gathered only once for all the points
+ *          that it contains, and each univariate B-spline is evaluated on all these points in one vectorized call. The results
+ *          are identical to calling point() on each point in turn.
+ ***************************************************************************************************************************/
+void LRSplineSurface::points(double *pts, const double *u, const double *v, int nPts, int derivs, const int *iEl) const {
+#ifdef TIME_LRSPLINE
+	PROFILE("points()");
+#endif
+	int nRes = (derivs+1)*(derivs+2)/2;
+	std::fill(pts, pts + nPts*nRes*dim_, 0.0);
+
+	// locate all points, and sort them by element
+	std::vector<std::pair<int,int> > elementPoints;
+	elementPoints.reserve(nPts);
+	for(int i=0; i<nPts; i++) {
+		if(u[i] < start_[0] || end_[0] < u[i] ||
+		   v[i] < start_[1] || end_[1] < v[i])
+			continue;
+		int el = (iEl != NULL && iEl[i] != -1) ? iEl[i] : getElementContaining(u[i], v[i]);
+		if(el != -1)
+			elementPoints.push_back(std::make_pair(el, i));
+	}
+	std::sort(elementPoints.begin(), elementPoints.end());
+
+	// evaluate all points on each element together
+	const double *parPt[] = {u, v};
+	std::vector<int> index;
+	uint k = 0;
+	while(k < elementPoints.size()) {
+		int el = elementPoints[k].first;
+		index.clear();
+		for(; k<elementPoints.size() && elementPoints[k].first == el; k++)
+			index.push_back(elementPoints[k].second);
+		evaluateElementPoints(pts, el, parPt, index.data(), index.size(), derivs);
+	}
+}
+
+/************************************************************************************************************************//**
+ * \brief Evaluate the surface and its derivatives on all nodes of a tensor grid
+ * \param us Sorted u-coordinates of the grid
+ * \param vs Sorted v-coordinates of the grid
+ * \param derivs The number of derivatives requested
+ * \param[out] out The results stored contiguously as [vs.size()][us.size()][nDerivs][dimension()] with
+ *                 nDerivs=(derivs+1)*(derivs+2)/2. The derivatives are ordered as in point(). Nodes outside the parametric
+ *                 domain are set to zero
+ * \details Each element is visited once, evaluating only the grid nodes inside it. The univariate B-splines are evaluated once
+ *          per grid line through the element and reused along that line. The results are identical to calling point() on
+ *          each grid node.
+ ***************************************************************************************************************************/
+void LRSplineSurface::gridEvaluate(const std::vector<double> &us, const std::vector<double> &vs, int derivs, std::vector<double> &out) const {
+#ifdef TIME_LRSPLINE
+	PROFILE("gridEvaluate()");
+#endif
+	int nRes = (derivs+1)*(derivs+2)/2;
+	out.assign(us.size()*vs.size()*nRes*dim_, 0.0);
+	if(!std::is_sorted(us.begin(), us.end()) || !std::is_sorted(vs.begin(), vs.end())) {
+		std::cerr << "Error: LRSplineSurface::gridEvaluate() requires sorted grid parameters" << std::endl;
+		exit(9301);
+	}
+	requireElementCache();
+
+	// locate all grid lines in the global tensor mesh
+	std::vector<int> cell_u, cell_v;
+	getGridCells(us, glob_knot_u_, cell_u);
+	getGridCells(vs, glob_knot_v_, cell_v);
+
+	const std::vector<double> grid[] = {us, vs};
+	int stride[] = {1, (int) us.size()};
+	for(uint iEl=0; iEl<element_.size(); iEl++) {
+		Element *e = element_[iEl];
+		int i0 = std::lower_bound(glob_knot_u_.begin(), glob_knot_u_.end(), e->umin()) - glob_knot_u_.begin();
+		int i1 = std::lower_bound(glob_knot_u_.begin(), glob_knot_u_.end(), e->umax()) - glob_knot_u_.begin();
+		int j0 = std::lower_bound(glob_knot_v_.begin(), glob_knot_v_.end(), e->vmin()) - glob_knot_v_.begin();
+		int j1 = std::lower_bound(glob_knot_v_.begin(), glob_knot_v_.end(), e->vmax()) - glob_knot_v_.begin();
+		int start[] = {(int) (std::lower_bound(cell_u.begin(), cell_u.end(), i0) - cell_u.begin()),
+		               (int) (std::lower_bound(cell_v.begin(), cell_v.end(), j0) - cell_v.begin())};
+		int stop[]  = {(int) (std::lower_bound(cell_u.begin(), cell_u.end(), i1) - cell_u.begin()),
+		               (int) (std::lower_bound(cell_v.begin(), cell_v.end(), j1) - cell_v.begin())};
+		if(start[0] < stop[0] && start[1] < stop[1])
+			evaluateGridElement(out.data(), iEl, grid, start, stop, stride, derivs);
 	}
 }
 
@@ -434,19 +656,16 @@ void LRSplineSurface::computeBasis (double param_u, double param_v, Go::BasisDer
 #ifdef TIME_LRSPLINE
 	PROFILE("computeBasis()");
 #endif
-	std::vector<double> values;
-	HashSet_const_iterator<Basisfunction*> it, itStop, itStart;
-	itStart = (iEl<0) ? basis_.begin() : element_[iEl]->constSupportBegin();
-	itStop  = (iEl<0) ? basis_.end()   : element_[iEl]->constSupportEnd();
 	int nPts= (iEl<0) ? basis_.size()  : element_[iEl]->nBasisFunctions();
 	result.prepareDerivs(param_u, param_v, 0, -1, nPts);
 
-	int i=0;
-	//element_[i]->write(std::cout);
-
-	for(it=itStart; it!=itStop; ++it, ++i) {
-		(*it)->evaluate(values, param_u, param_v, 2, param_u!=end_[0], param_v!=end_[1]);
+	BasisWorkspace &workspace = BasisWorkspace::local();
+	double  parPt[]     = {param_u, param_v};
+	bool    fromRight[] = {param_u!=end_[0], param_v!=end_[1]};
+	double *values      = workspace.buffer(nPts * 6);
+	computeElementBasis(values, parPt, 2, fromRight, iEl, workspace);
 
+	for(int i=0; i<nPts; i++, values+=6) {
 		result.basisValues[i]    = values[0];
 		result.basisDerivs_u[i]  = values[1];
 		result.basisDerivs_v[i]  = values[2];
@@ -461,19 +680,16 @@ void LRSplineSurface::computeBasis (double param_u, double param_v, Go::BasisDer
 #ifdef TIME_LRSPLINE
 	PROFILE("computeBasis()");
 #endif
-	std::vector<double> values;
-	HashSet_const_iterator<Basisfunction*> it, itStop, itStart;
-	itStart = (iEl<0) ? basis_.begin() : element_[iEl]->constSupportBegin();
-	itStop  = (iEl<0) ? basis_.end()   : element_[iEl]->constSupportEnd();
 	int nPts= (iEl<0) ? basis_.size()  : element_[iEl]->nBasisFunctions();
 	result.prepareDerivs(param_u, param_v, 0, -1, nPts);
 
-	int i=0;
-	//element_[i]->write(std::cout);
-
-	for(it=itStart; it!=itStop; ++it, ++i) {
-		(*it)->evaluate(values, param_u, param_v, 3, param_u!=end_[0], param_v!=end_[1]);
+	BasisWorkspace &workspace = BasisWorkspace::local();
+	double  parPt[]     = {param_u, param_v};
+	bool    fromRight[] = {param_u!=end_[0], param_v!=end_[1]};
+	double *values      = workspace.buffer(nPts * 10);
+	computeElementBasis(values, parPt, 3, fromRight, iEl, workspace);
 
+	for(int i=0; i<nPts; i++, values+=10) {
 		result.basisValues[i]    = values[0];
 		result.basisDerivs_u[i]  = values[1];
 		result.basisDerivs_v[i]  = values[2];
@@ -501,17 +717,16 @@ void LRSplineSurface::computeBasis (double param_u, double param_v, Go::BasisDer
 #ifdef TIME_LRSPLINE
 	PROFILE("computeBasis()");
 #endif
-	std::vector<double> values;
-	HashSet_const_iterator<Basisfunction*> it, itStop, itStart;
-	itStart = (iEl<0) ? basis_.begin() : element_[iEl]->constSupportBegin();
-	itStop  = (iEl<0) ? basis_.end()   : element_[iEl]->constSupportEnd();
 	int nPts= (iEl<0) ? basis_.size()  : element_[iEl]->nBasisFunctions();
 	result.prepareDerivs(param_u, param_v, 0, -1, nPts);
 
-	int i=0;
-	for(it=itStart; it!=itStop; ++it, ++i) {
-		(*it)->evaluate(values, param_u, param_v, 1, param_u!=end_[0], param_v!=end_[1]);
+	BasisWorkspace &workspace = BasisWorkspace::local();
+	double  parPt[]     = {param_u, param_v};
+	bool    fromRight[] = {param_u!=end_[0], param_v!=end_[1]};
+	double *values      = workspace.buffer(nPts * 3);
+	computeElementBasis(values, parPt, 1, fromRight, iEl, workspace);
 
+	for(int i=0; i<nPts; i++, values+=3) {
 		result.basisValues[i]   = values[0];
 		result.basisDerivs_u[i] = values[1];
 		result.basisDerivs_v[i] = values[2];
@@ -532,15 +747,16 @@ void LRSplineSurface::computeBasis(double param_u, double param_v, Go::BasisPtsS
 #ifdef TIME_LRSPLINE
 	PROFILE("computeBasis()");
 #endif
-	HashSet_const_iterator<Basisfunction*> it, itStop, itStart;
-	itStart = (iEl<0) ? basis_.begin() : element_[iEl]->constSupportBegin();
-	itStop  = (iEl<0) ? basis_.end()   : element_[iEl]->constSupportEnd();
 	int nPts= (iEl<0) ? basis_.size()  : element_[iEl]->nBasisFunctions();
-
 	result.preparePts(param_u, param_v, 0, -1, nPts);
-	int i=0;
-	for(it=itStart; it!=itStop; ++it, ++i)
-		result.basisValues[i] = (*it)->evaluate(param_u, param_v, param_u!=end_[0], param_v!=end_[1]);
+
+	BasisWorkspace &workspace = BasisWorkspace::local();
+	double  parPt[]     = {param_u, param_v};
+	bool    fromRight[] = {param_u!=end_[0], param_v!=end_[1]};
+	double *values      = workspace.buffer(nPts);
+	computeElementBasis(values, parPt, 0, fromRight, iEl, workspace);
+	for(int i=0; i<nPts; i++)
+		result.basisValues[i] = values[i];
 }
 #endif
 
@@ -565,30 +781,35 @@ void LRSplineSurface::computeBasis (double param_u,
 #ifdef TIME_LRSPLINE
 	PROFILE("computeBasis()");
 #endif
-	result.clear();
-	HashSet_const_iterator<Basisfunction*> it, itStop, itStart;
-	itStart = (iEl<0) ? basis_.begin() : element_[iEl]->constSupportBegin();
-	itStop  = (iEl<0) ? basis_.end()   : element_[iEl]->constSupportEnd();
 	int nPts= (iEl<0) ? basis_.size()  : element_[iEl]->nBasisFunctions();
+	int nRes= Basisfunction::nDerivatives(2, derivs);
 
-	result.resize(nPts);
-	int i=0;
-	for(it=itStart; it!=itStop; ++it, ++i)
-	    (*it)->evaluate(result[i], param_u, param_v, derivs, param_u!=end_[0], param_v!=end_[1]);
+	BasisWorkspace &workspace = BasisWorkspace::local();
+	double  parPt[]     = {param_u, param_v};
+	bool    fromRight[] = {param_u!=end_[0], param_v!=end_[1]};
+	double *values      = workspace.buffer(nPts * nRes);
+	computeElementBasis(values, parPt, derivs, fromRight, iEl, workspace);
 
+	// reuse the memory of result (if any) instead of clearing it
+	result.resize(nPts);
+	for(int i=0; i<nPts; i++)
+		result[i].assign(values + i*nRes, values + (i+1)*nRes);
 }
 
 void LRSplineSurface::generateIDs() const
 {
   this->LRSpline::generateIDs();
-  createElementCache();
+  // the lookup structure is kept up to date during refinement, and only has to be built when it has been invalidated
+  if(!validLocator_)
+    createElementCache();
+  builtElementCache_ = true;
 }
 
 /************************************************************************************************************************//**
  * \brief Computes a cached lookup table for quick determination of element distribution. Allows getElementContaining()
  *        to be ran in O(log(n)) time.
- * \details This is done by creating a full tensor mesh (of elements) and storing the LR-elements from which each
- *          sub-element came from.
+ * \details For LOCATOR_GRID this is done by creating a full tensor mesh (of elements) and storing the LR-elements from
+ *          which each sub-element came from. For LOCATOR_TREE an ElementTree is built over the element boxes instead.
  ***************************************************************************************************************************/
 void LRSplineSurface::createElementCache() const {
 	// find the set of all unique knots in each direction (this is our global mesh)
@@ -596,6 +817,14 @@ void LRSplineSurface::createElementCache() const {
 	glob_knot_v_.clear();
 	this->getGlobalUniqueKnotVector(glob_knot_u_, glob_knot_v_);
 
+	if(locator_ == LOCATOR_TREE) {
+		std::vector<std::vector<int> >().swap(elementCache_);
+		elementTree_.build(element_, end_);
+		validLocator_     = true;
+		validElementTree_ = true;
+		return;
+	}
+
 	// create a tensor-mesh of elements given by an nxm matrix
 	elementCache_ = std::vector<std::vector<int> >(glob_knot_u_.size(), std::vector<int>(glob_knot_v_.size(), -1));
 
@@ -610,6 +839,63 @@ void LRSplineSurface::createElementCache() const {
 			for(int j=j0; j<j1; j++)
 				elementCache_[i][j] = e->getId();
 	}
+	validLocator_ = true;
+}
+
+/************************************************************************************************************************//**
+ * \brief Keeps the element lookup structure up to date when refinement splits an element in two
+ * \param iEl The element which was split
+ * \param iNew The index of the new element, i.e. the part which was cut off iEl
+ * \details Only the cells covered by the new element are touched. For LOCATOR_GRID the table gets one more row or column
+ *          if the split introduces a new unique knot, which is copied from the cell it splits. If the lookup structure
+ *          was not up to date to begin with, nothing is done and it is rebuilt on the next lookup. The element tree used by
+ *          insert_line() is updated as well, also with LOCATOR_GRID.
+ ***************************************************************************************************************************/
+void LRSplineSurface::updateElementCache(int iEl, int iNew) {
+	if(validElementTree_)
+		elementTree_.split(element_, iEl, iNew);
+	if(!validLocator_)
+		return;
+	Element *e = element_[iNew];
+	e->setId(iNew);
+	if(locator_ == LOCATOR_TREE)
+		return;
+
+	// insert the new knot (if any) into the global mesh, splitting the cells it cuts through
+	int i0 = std::lower_bound(glob_knot_u_.begin(), glob_knot_u_.end(), e->umin()) - glob_knot_u_.begin();
+	if(glob_knot_u_[i0] != e->umin()) {
+		glob_knot_u_.insert(glob_knot_u_.begin()+i0, e->umin());
+		std::vector<int> column = elementCache_[i0-1];
+		elementCache_.insert(elementCache_.begin()+i0, column);
+	}
+	int j0 = std::lower_bound(glob_knot_v_.begin(), glob_knot_v_.end(), e->vmin()) - glob_knot_v_.begin();
+	if(glob_knot_v_[j0] != e->vmin()) {
+		glob_knot_v_.insert(glob_knot_v_.begin()+j0, e->vmin());
+		for(std::vector<int> &column : elementCache_) {
+			int id = column[j0-1];
+			column.insert(column.begin()+j0, id);
+		}
+	}
+
+	// and hand the cells of the new element over to it
+	int i1 = std::lower_bound(glob_knot_u_.begin(), glob_knot_u_.end(), e->umax()) - glob_knot_u_.begin();
+	int j1 = std::lower_bound(glob_knot_v_.begin(), glob_knot_v_.end(), e->vmax()) - glob_knot_v_.begin();
+	for(int i=i0; i<i1; i++)
+		for(int j=j0; j<j1; j++)
+			elementCache_[i][j] = iNew;
+}
+
+/************************************************************************************************************************//**
+ * \brief Builds the element cache unless it is already up to date
+ * \details Is safe to call from several threads at once. The cache is built by the first thread getting here, while the
+ *          others wait for it to finish. Once built, this is a single atomic read.
+ ***************************************************************************************************************************/
+void LRSplineSurface::requireElementCache() const {
+	if(builtElementCache_)
+		return;
+	std::lock_guard<std::mutex> lock(elementCacheLock_);
+	if(!builtElementCache_)
+		generateIDs();
 }
 
 /************************************************************************************************************************//**
@@ -622,6 +908,13 @@ int LRSplineSurface::getElementContaining(double u, double v) const {
 	// sanity check input
 	if(u < startparam(0) || u > endparam(0) || v < startparam(1) || v > endparam(1))
 		return -1;
+	// build cache if not already present (element ids are renumbered along with it)
+	requireElementCache();
+
+	if(locator_ == LOCATOR_TREE) {
+		double par[] = {u, v};
+		return elementTree_.getElementContaining(par);
+	}
 
 	// binary search for the right element
 	size_t i = std::upper_bound(glob_knot_u_.begin(), glob_knot_u_.end(), u) - glob_knot_u_.begin() - 1;
@@ -633,6 +926,113 @@ int LRSplineSurface::getElementContaining(double u, double v) const {
 	return elementCache_[i][j];
 }
 
+/************************************************************************************************************************//**
+ * \brief Get the element index of the elements containing many parametric points at once
+ * \param u The u-coordinates
+ * \param v The v-coordinates
+ * \param n The number of points
+ * \param[out] out The index of the element containing each point (u[i],v[i]), or -1 if it is outside the domain
+ * \param nThreads The number of threads to split the points between
+ * \details Gives the same results as calling getElementContaining() for each point, but with LOCATOR_GRID the knot spans are
+ *          found by bucketing instead of binary search (see LRSpline::getKnotSpans()), in blocks small enough to stay in
+ *          cache. The points need not be sorted.
+ ***************************************************************************************************************************/
+void LRSplineSurface::getElementsContaining(const double *u, const double *v, int n, int *out, int nThreads) const {
+	// build cache if not already present, before any threads are started
+	requireElementCache();
+
+	if(nThreads > 1 && n > nThreads) {
+		std::vector<std::thread> threads;
+		int chunk = (n + nThreads - 1) / nThreads;
+		for(int first=0; first<n; first+=chunk)
+			threads.push_back(std::thread(&LRSplineSurface::getElementsContaining, this, u+first, v+first,
+			                              std::min(chunk, n-first), out+first, 1));
+		for(std::thread &t : threads)
+			t.join();
+		return;
+	}
+
+	if(locator_ == LOCATOR_TREE) {
+		for(int k=0; k<n; k++)
+			out[k] = getElementContaining(u[k], v[k]);
+		return;
+	}
+
+	// the bucket tables are built once, and used for all blocks of points
+	std::vector<int> bucket_u, bucket_v;
+	getKnotBuckets(glob_knot_u_, bucket_u);
+	getKnotBuckets(glob_knot_v_, bucket_v);
+	const int blockSize = 4096;
+	int i[blockSize], j[blockSize];
+	for(int first=0; first<n; first+=blockSize) {
+		int count = std::min(blockSize, n-first);
+		getKnotSpans(glob_knot_u_, bucket_u, u+first, count, i);
+		getKnotSpans(glob_knot_v_, bucket_v, v+first, count, j);
+		for(int k=0; k<count; k++)
+			out[first+k] = (i[k] < 0 || j[k] < 0) ? -1 : elementCache_[i[k]][j[k]];
+	}
+}
+
+/************************************************************************************************************************//**
+ * \brief Selects the data structure used by getElementContaining()
+ * \param type LOCATOR_GRID for a dense table over all unique knots, or LOCATOR_TREE for a tree over the elements
+ * \details The dense table has the fastest lookup, but its memory grows as the product of the number of unique knots in
+ *          each direction, which is wasteful for strongly local refinement. The tree uses memory proportional to the
+ *          number of elements. Both give identical results.
+ ***************************************************************************************************************************/
+void LRSplineSurface::setElementLocator(elementLocator type) {
+	if(type == locator_)
+		return;
+	locator_ = type;
+	invalidateElementCache();
+}
+
+/************************************************************************************************************************//**
+ * \brief Throws away the element lookup structure and the ids, which are rebuilt on the next lookup
+ ***************************************************************************************************************************/
+void LRSplineSurface::invalidateElementCache() {
+	elementTree_.clear();
+	validLocator_      = false;
+	validElementTree_  = false;
+	builtElementCache_ = false;
+	validBasisTable_   = false;
+}
+
+/************************************************************************************************************************//**
+ * \brief Builds the element tree searched by insert_line() unless it is already up to date
+ * \details With LOCATOR_TREE this is the element lookup structure itself. With LOCATOR_GRID the tree is kept next to the
+ *          table during refinement, since an element split only changes the tree locally, while a new knot changes the
+ *          size of the whole table. The table is then only updated if it has been built already.
+ ***************************************************************************************************************************/
+void LRSplineSurface::requireElementTree() {
+	if(validElementTree_)
+		return;
+	if(locator_ == LOCATOR_TREE) {
+		createElementCache();
+	} else {
+		elementTree_.build(element_, end_);
+		validElementTree_ = true;
+	}
+}
+
+/************************************************************************************************************************//**
+ * \brief Returns the number of bytes used by the element lookup structure, including the global knot vectors and the
+ *        element tree kept up to date for refinement (see requireElementTree())
+ ***************************************************************************************************************************/
+size_t LRSplineSurface::elementLocatorMemory() const {
+	if(!builtElementCache_)
+		return 0;
+	size_t bytes = (glob_knot_u_.capacity() + glob_knot_v_.capacity()) * sizeof(double);
+	if(locator_ == LOCATOR_TREE || validElementTree_)
+		bytes += elementTree_.memoryFootprint();
+	if(locator_ == LOCATOR_TREE)
+		return bytes;
+	bytes += elementCache_.capacity() * sizeof(std::vector<int>);
+	for(const std::vector<int> &column : elementCache_)
+		bytes += column.capacity() * sizeof(int);
+	return bytes;
+}
+
 /************************************************************************************************************************//**
  * \brief Used in refinement, get the minimum span meshlines that will split at least one Basisfunction on this element
  * \param iEl The element to refine
@@ -810,20 +1210,17 @@ void LRSplineSurface::refineBasisFunction(const std::vector<int> &indices) {
 	std::vector<Meshline*> newLines;
 
 	/* first retrieve all meshlines needed */
-	int ib = 0;
-	HashSet_iterator<Basisfunction*> it = basis_.begin();
-	for(uint i=0; i<sortedInd.size(); i++) {
-		while(ib < sortedInd[i]) {
-			++ib;
-			++it;
-		}
-		getStructMeshLines(*it,newLines);
-	}
+	for(uint i=0; i<sortedInd.size(); i++)
+		getStructMeshLines(getBasisfunction(sortedInd[i]),newLines);
 
 	/* Do the actual refinement */
-	for(uint i=0; i<newLines.size(); i++) {
-		Meshline *m = newLines[i];
-		insert_line(!m->is_spanning_u(), m->const_par_, m->start_, m->stop_, refKnotlineMult_);
+	if(batchRefinement_) {
+		insert_lines(newLines, refKnotlineMult_);
+	} else {
+		for(uint i=0; i<newLines.size(); i++) {
+			Meshline *m = newLines[i];
+			insert_line(!m->is_spanning_u(), m->const_par_, m->start_, m->stop_, refKnotlineMult_);
+		}
 	}
 
 	/* do a posteriori fixes to ensure a proper mesh */
@@ -863,9 +1260,13 @@ void LRSplineSurface::refineElement(const std::vector<int> &indices) {
 	}
 
 	/* Do the actual refinement */
-	for(uint i=0; i<newLines.size(); i++) {
-		Meshline *m = newLines[i];
-		insert_line(!m->is_spanning_u(), m->const_par_, m->start_, m->stop_, refKnotlineMult_);
+	if(batchRefinement_) {
+		insert_lines(newLines, refKnotlineMult_);
+	} else {
+		for(uint i=0; i<newLines.size(); i++) {
+			Meshline *m = newLines[i];
+			insert_line(!m->is_spanning_u(), m->const_par_, m->start_, m->stop_, refKnotlineMult_);
+		}
 	}
 
 	/* do a posteriori fixes to ensure a proper mesh */
@@ -881,6 +1282,7 @@ void LRSplineSurface::refineByDimensionIncrease(const std::vector<double> &errPe
 	/* accumulate the error & index - vector */
 	std::vector<IndexDouble> errors;
 	if(refStrat_ == LR_STRUCTURED_MESH) { // error per-function
+		requireBasisTable(); // all ids up to date, so that i is the id of b and getBasisfunction(i) is constant time
 		int i=0;
 		for(Basisfunction *b : basis_) {
 			errors.push_back(IndexDouble(0.0, i));
@@ -1120,9 +1522,17 @@ bool LRSplineSurface::matchParametricEdge(parameterEdge edge, std::vector<double
 }
 
 
+/************************************************************************************************************************//**
+ * \brief Applies the a posteriori fixes which are turned on (see setCloseGaps(), setMaxTjoints() and setMaxAspectRatio()),
+ *        until they no longer change the spline
+ * \details The first time, each fix checks all elements. After that, only the elements which a line inserted by one of the
+ *          fixes splits or ends at are checked again (see insertFixLine()), since nothing else changes the outcome of the
+ *          checks. The fixes are thus made in the same order as when checking all elements every time.
+ ***************************************************************************************************************************/
 void LRSplineSurface::aPosterioriFixes()  {
 	std::vector<Meshline*> *newLines = NULL;
 	int nFunc;
+	fixPending_.assign(element_.size(), FIX_ALL);
 	do {
 		nFunc = basis_.size();
 		if(doCloseGaps_)
@@ -1132,8 +1542,90 @@ void LRSplineSurface::aPosterioriFixes()  {
 		if(doAspectRatioFix_)
 			this->enforceMaxAspectRatio(newLines);
 	} while(nFunc != basis_.size());
+	fixPending_.clear();
 }
 
+/************************************************************************************************************************//**
+ * \brief Returns true if an a posteriori fix has to check an element, and marks it as checked
+ * \param iEl The element index
+ * \param fix The fix (FIX_GAPS, FIX_TJOINTS or FIX_ASPECT)
+ * \details Outside aPosterioriFixes() all elements are checked
+ ***************************************************************************************************************************/
+bool LRSplineSurface::takeFixCheck(int iEl, char fix) {
+	if(fixPending_.empty())
+		return true;
+	bool pending = (fixPending_[iEl] & fix) != 0;
+	fixPending_[iEl] &= ~fix;
+	return pending;
+}
+
+/************************************************************************************************************************//**
+ * \brief Inserts a meshline for one of the a posteriori fixes, see insert_line()
+ * \details During aPosterioriFixes(), all elements which the line may have changed are marked for all fixes to check
+ *          again. These are the elements split by the line, and the ones where it (or a line it was merged with) now ends,
+ *          which are all touching the line.
+ ***************************************************************************************************************************/
+Meshline* LRSplineSurface::insertFixLine(bool const_u, double const_par, double start, double stop) {
+	Meshline *m = insert_line(const_u, const_par, start, stop, refKnotlineMult_);
+	if(fixPending_.empty())
+		return m;
+
+	fixPending_.resize(element_.size(), FIX_ALL);
+	// widen the line slightly, so that the elements touching it are overlapping it
+	int    d = (const_u) ? 0 : 1; // constant direction
+	double lo[2], hi[2];
+	lo[d]   = m->const_par_ - 1e-10*(end_[d]-start_[d]);
+	hi[d]   = m->const_par_ + 1e-10*(end_[d]-start_[d]);
+	lo[1-d] = m->start_     - 1e-10*(end_[1-d]-start_[1-d]);
+	hi[1-d] = m->stop_      + 1e-10*(end_[1-d]-start_[1-d]);
+	std::vector<int> touched;
+	requireElementTree();
+	elementTree_.getElementsOverlapping(lo, hi, touched);
+	for(int i : touched)
+		fixPending_[i] = FIX_ALL;
+	return m;
+}
+
+/************************************************************************************************************************//**
+ * \brief Finds the T-joints on the edges of an element, i.e. the meshlines ending at its edges from the outside
+ * \param el The element
+ * \param[out] left The constant parameter of the lines in the u-direction stopping at the left edge
+ * \param[out] right The constant parameter of the lines in the u-direction starting at the right edge
+ * \param[out] top The constant parameter of the lines in the v-direction starting at the top edge
+ * \param[out] bottom The constant parameter of the lines in the v-direction stopping at the bottom edge
+ * \details Only lines ending strictly inside an edge are included, in the order they are stored in the spline
+ ***************************************************************************************************************************/
+void LRSplineSurface::getTjoints(const Element *el, std::vector<double> &left, std::vector<double> &right, std::vector<double> &top, std::vector<double> &bottom) {
+	double umin = el->umin();
+	double umax = el->umax();
+	double vmin = el->vmin();
+	double vmax = el->vmax();
+	left.clear();
+	right.clear();
+	top.clear();
+	bottom.clear();
+	// the index gives all lines touching the element, and possibly a few more which the tests below sort out
+	requireMeshlineIndex();
+	std::vector<Meshline*> lines;
+	meshlineIndex_.getOverlapping(true, (vmin+vmax)/2, umin, umax, vmax-vmin, lines);
+	for(Meshline *m : lines) {
+		if(m->const_par_ > vmin && m->const_par_ < vmax) {
+			if(m->start_ == umax)
+				right.push_back(m->const_par_);
+			else if(m->stop_ == umin)
+				left.push_back(m->const_par_);
+		}
+	}
+	meshlineIndex_.getOverlapping(false, (umin+umax)/2, vmin, vmax, umax-umin, lines);
+	for(Meshline *m : lines) {
+		if(m->const_par_ > umin && m->const_par_ < umax) {
+			if(m->start_ == vmax)
+				top.push_back(m->const_par_);
+			else if(m->stop_ == vmin)
+				bottom.push_back(m->const_par_);
+		}
+	}
+}
 
 void LRSplineSurface::closeGaps(std::vector<Meshline*>* newLines) {
 	std::vector<double>  start_v;
@@ -1143,30 +1635,15 @@ void LRSplineSurface::closeGaps(std::vector<Meshline*>* newLines) {
 	std::vector<double>  start_u;
 	std::vector<double>  stop_u ;
 	std::vector<double>  const_v  ;
+	std::vector<double> left, right, top, bottom;
 	for(uint i=0; i<element_.size(); i++) {
+		if(!takeFixCheck(i, FIX_GAPS))
+			continue;
 		double umin = element_[i]->umin();
 		double umax = element_[i]->umax();
 		double vmin = element_[i]->vmin();
 		double vmax = element_[i]->vmax();
-		std::vector<double> left, right, top, bottom;
-		for(uint j=0; j<meshline_.size(); j++) {
-			Meshline *m = meshline_[j];
-			if(      m->span_u_line_ &&
-			         m->const_par_ > vmin &&
-			         m->const_par_ < vmax) {
-				if(m->start_ == umax)
-					right.push_back(m->const_par_);
-				else if(m->stop_ == umin)
-					left.push_back(m->const_par_);
-			} else if(!m->span_u_line_ &&
-			          m->const_par_ > umin &&
-			          m->const_par_ < umax) {
-				if(m->start_ == vmax)
-					top.push_back(m->const_par_);
-				else if(m->stop_ == vmin)
-					bottom.push_back(m->const_par_);
-			}
-		}
+		getTjoints(element_[i], left, right, top, bottom);
 		for(uint j=0; j<left.size(); j++)
 			for(uint k=0; k<right.size(); k++)
 				if(left[j] == right[k]) {
@@ -1184,12 +1661,12 @@ void LRSplineSurface::closeGaps(std::vector<Meshline*>* newLines) {
 	}
 	Meshline* m;
 	for(uint i=0; i<const_u.size(); i++) {
-		m = insert_const_u_edge(const_u[i], start_v[i], stop_v[i], refKnotlineMult_);
+		m = insertFixLine(true, const_u[i], start_v[i], stop_v[i]);
 		if(newLines != NULL)
 			newLines->push_back(m->copy());
 	}
 	for(uint i=0; i<const_v.size(); i++) {
-		m = insert_const_v_edge(const_v[i], start_u[i], stop_u[i], refKnotlineMult_);
+		m = insertFixLine(false, const_v[i], start_u[i], stop_u[i]);
 		if(newLines != NULL)
 			newLines->push_back(m->copy());
 	}
@@ -1197,32 +1674,17 @@ void LRSplineSurface::closeGaps(std::vector<Meshline*>* newLines) {
 
 void LRSplineSurface::enforceMaxTjoints(std::vector<Meshline*> *newLines) {
 	bool someFix = true;
+	std::vector<double> left, right, top, bottom;
 	while(someFix) {
 		someFix = false;
 		for(uint i=0; i<element_.size(); i++) {
+			if(!takeFixCheck(i, FIX_TJOINTS))
+				continue;
 			double umin = element_[i]->umin();
 			double umax = element_[i]->umax();
 			double vmin = element_[i]->vmin();
 			double vmax = element_[i]->vmax();
-			std::vector<double> left, right, top, bottom;
-			for(uint j=0; j<meshline_.size(); j++) {
-				Meshline *m = meshline_[j];
-				if(      m->span_u_line_ &&
-						 m->const_par_ > vmin &&
-						 m->const_par_ < vmax) {
-					if(m->start_ == umax)
-						right.push_back(m->const_par_);
-					else if(m->stop_ == umin)
-						left.push_back(m->const_par_);
-				} else if(!m->span_u_line_ &&
-						  m->const_par_ > umin &&
-						  m->const_par_ < umax) {
-					if(m->start_ == vmax)
-						top.push_back(m->const_par_);
-					else if(m->stop_ == vmin)
-						bottom.push_back(m->const_par_);
-				}
-			}
+			getTjoints(element_[i], left, right, top, bottom);
 			Meshline *m;
 			double best = DBL_MAX;
 			int bi      = -1;
@@ -1233,11 +1695,11 @@ void LRSplineSurface::enforceMaxTjoints(std::vector<Meshline*> *newLines) {
 						bi = j;
 					}
 				}
-				m = insert_const_v_edge(left[bi], umin, umax, refKnotlineMult_);
+				m = insertFixLine(false, left[bi], umin, umax);
 				if(newLines != NULL)
 					newLines->push_back(m->copy());
 				if(refStrat_ == LR_STRUCTURED_MESH) {
-					m = insert_const_u_edge((umin+umax)/2, vmin, vmax, refKnotlineMult_);
+					m = insertFixLine(true, (umin+umax)/2, vmin, vmax);
 					if(newLines != NULL)
 						newLines->push_back(m->copy());
 				}
@@ -1251,11 +1713,11 @@ void LRSplineSurface::enforceMaxTjoints(std::vector<Meshline*> *newLines) {
 						bi = j;
 					}
 				}
-				m = insert_const_v_edge(right[bi], umin, umax, refKnotlineMult_);
+				m = insertFixLine(false, right[bi], umin, umax);
 				if(newLines != NULL)
 					newLines->push_back(m->copy());
 				if(refStrat_ == LR_STRUCTURED_MESH) {
-					m = insert_const_u_edge((umin+umax)/2, vmin, vmax, refKnotlineMult_);
+					m = insertFixLine(true, (umin+umax)/2, vmin, vmax);
 					if(newLines != NULL)
 						newLines->push_back(m->copy());
 				}
@@ -1269,11 +1731,11 @@ void LRSplineSurface::enforceMaxTjoints(std::vector<Meshline*> *newLines) {
 						bi = j;
 					}
 				}
-				m = insert_const_u_edge(top[bi], vmin, vmax, refKnotlineMult_);
+				m = insertFixLine(true, top[bi], vmin, vmax);
 				if(newLines != NULL)
 					newLines->push_back(m->copy());
 				if(refStrat_ == LR_STRUCTURED_MESH) {
-					m = insert_const_v_edge((vmin+vmax)/2, umin, umax, refKnotlineMult_);
+					m = insertFixLine(false, (vmin+vmax)/2, umin, umax);
 					if(newLines != NULL)
 						newLines->push_back(m->copy());
 				}
@@ -1287,11 +1749,11 @@ void LRSplineSurface::enforceMaxTjoints(std::vector<Meshline*> *newLines) {
 						bi = j;
 					}
 				}
-				m = insert_const_u_edge(bottom[bi], vmin, vmax, refKnotlineMult_);
+				m = insertFixLine(true, bottom[bi], vmin, vmax);
 				if(newLines != NULL)
 					newLines->push_back(m->copy());
 				if(refStrat_ == LR_STRUCTURED_MESH) {
-					m = insert_const_v_edge((vmin+vmax)/2, umin, umax, refKnotlineMult_);
+					m = insertFixLine(false, (vmin+vmax)/2, umin, umax);
 					if(newLines != NULL)
 						newLines->push_back(m->copy());
 				}
@@ -1307,6 +1769,8 @@ void LRSplineSurface::enforceMaxAspectRatio(std::vector<Meshline*>* newLines) {
 	while(somethingFixed) {
 		somethingFixed = false;
 		for(uint i=0; i<element_.size(); i++) {
+			if(!takeFixCheck(i, FIX_ASPECT))
+				continue;
 			double umin = element_[i]->umin();
 			double umax = element_[i]->umax();
 			double vmin = element_[i]->vmin();
@@ -1324,7 +1788,7 @@ void LRSplineSurface::enforceMaxAspectRatio(std::vector<Meshline*>* newLines) {
 				Meshline *m, *msplit;
 				msplit = splitLines.front();
 
-				m = insert_line(!msplit->is_spanning_u(), msplit->const_par_, msplit->start_, msplit->stop_, refKnotlineMult_);
+				m = insertFixLine(!msplit->is_spanning_u(), msplit->const_par_, msplit->start_, msplit->stop_);
 				if(newLines != NULL)
 					newLines->push_back(m->copy());
 
@@ -1390,51 +1854,61 @@ Meshline* LRSplineSurface::insert_const_u_edge(double u, double start_v, double
 	return insert_line(true, u, start_v, stop_v, multiplicity);
 }
 
-Meshline* LRSplineSurface::insert_line(bool const_u, double const_par, double start, double stop, int multiplicity) {
+/************************************************************************************************************************//**
+ * \brief Merges a new line with the existing meshlines it overlaps. This is the first part of insert_line()
+ * \param const_u True for lines of constant u-value
+ * \param const_par The constant parameter value of the line
+ * \param start The start of the line
+ * \param stop The end of the line
+ * \param multiplicity The multiplicity of the line
+ * \param[out] exists Set to true if the line is already part of the mesh. Nothing is changed then, and the existing line
+ *                    is returned
+ * \returns The new line, covering all lines of the same multiplicity which it was merged with. These are removed from the
+ *          mesh, while the new line is not yet added to it
+ ***************************************************************************************************************************/
+Meshline* LRSplineSurface::mergeLine(bool const_u, double const_par, double start, double stop, int multiplicity, bool &exists) {
 	// error test input
 	if(multiplicity < 1) {
 		std::cerr << "LRSplineSurface::insert_line() requested line with multiplicity " << multiplicity << ". Needs non-negative values\n";
 		exit(99822173);
 	}
-	Meshline *newline;
-#ifdef TIME_LRSPLINE
-	PROFILE("insert_line()");
-#endif
-	{ // check if the line is an extension or a merging of existing lines
 #ifdef TIME_LRSPLINE
 	PROFILE("line verification");
 #endif
-	newline = new Meshline(!const_u, const_par, start, stop, multiplicity);
+	exists = false;
+	Meshline *newline = new (&meshlinePool_) Meshline(!const_u, const_par, start, stop, multiplicity);
 	newline->type_ = NEWLINE;
-	for(uint i=0; i<meshline_.size(); i++) {
+	requireMeshlineIndex();
+	std::vector<Meshline*> overlapping;
+	meshlineIndex_.getOverlapping(!const_u, const_par, start, stop, DOUBLE_TOL, overlapping);
+	for(Meshline *m : overlapping) {
 		// if newline overlaps any existing ones (may be multiple existing ones)
 		// let newline be the entire length of all merged and delete the unused ones
 
-		if(meshline_[i]->is_spanning_u() != const_u && fabs(meshline_[i]->const_par_-const_par)<DOUBLE_TOL &&
-		   meshline_[i]->start_ <= stop && meshline_[i]->stop_ >= start)  { // meshline_[i] overlaps with newline
+		if(m->is_spanning_u() != const_u && fabs(m->const_par_-const_par)<DOUBLE_TOL &&
+		   m->start_ <= stop && m->stop_ >= start)  { // m overlaps with newline
 
-			if(meshline_[i]->start_ <= start &&
-			   meshline_[i]->stop_  >= stop ) { // newline completely contained in meshline_[i]
+			if(m->start_ <= start &&
+			   m->stop_  >= stop ) { // newline completely contained in m
 
-				if(meshline_[i]->multiplicity_ < newline->multiplicity_) { // increasing multiplicity
-					if(meshline_[i]->start_ == start &&
-					   meshline_[i]->stop_  == stop ) { // increasing the mult of the entire line
+				if(m->multiplicity_ < newline->multiplicity_) { // increasing multiplicity
+					if(m->start_ == start &&
+					   m->stop_  == stop ) { // increasing the mult of the entire line
 
 						// keeping newline, getting rid of the old line
-						delete meshline_[i];
-						meshline_.erase(meshline_.begin() + i);
-						i--;
+						eraseMeshline(m);
 
 					} else { // increasing multiplicity of partial line
-						// do nothing. Keep the entire length meshline_[i], and add newline
+						// do nothing. Keep the entire length m, and add newline
 
 					}
 
 				} else { // line exist already, do nothing
 					delete newline;
-					return meshline_[i];
+					exists = true;
+					return m;
 				}
-			} else { // newline overlaps meshline_[i]. Keep (and update) newline, delete meshline_[i]
+			} else { // newline overlaps m. Keep (and update) newline, delete m
 
 				// update refinement type (for later analysis of linear independence)
 				if(newline->type_ == ELONGATION)   // overlaps two existing lines => MERGING
@@ -1443,41 +1917,56 @@ Meshline* LRSplineSurface::insert_line(bool const_u, double const_par, double st
 					newline->type_ = ELONGATION;
 
 				// update the length of the line with the lowest multiplicity
-				if(meshline_[i]->multiplicity_ < newline->multiplicity_) {
-					if(meshline_[i]->start_ > start) meshline_[i]->start_ = newline->start_;
-					if(meshline_[i]->stop_  < stop ) meshline_[i]->stop_  = newline->stop_;
+				if(m->multiplicity_ < newline->multiplicity_) {
+					meshlineIndex_.setExtent(m, (m->start_ > start) ? newline->start_ : m->start_,
+					                            (m->stop_  < stop ) ? newline->stop_  : m->stop_);
 
-				} else if(meshline_[i]->multiplicity_ > newline->multiplicity_) {
-					if(meshline_[i]->start_ < start) newline->start_ = meshline_[i]->start_;
-					if(meshline_[i]->stop_  > stop ) newline->stop_  = meshline_[i]->stop_;
+				} else if(m->multiplicity_ > newline->multiplicity_) {
+					if(m->start_ < start) newline->start_ = m->start_;
+					if(m->stop_  > stop ) newline->stop_  = m->stop_;
 
 				} else { // for equal mult, we only keep newline and remove the previous line
-					if(meshline_[i]->start_ < start) newline->start_ = meshline_[i]->start_;
-					if(meshline_[i]->stop_  > stop ) newline->stop_  = meshline_[i]->stop_;
+					if(m->start_ < start) newline->start_ = m->start_;
+					if(m->stop_  > stop ) newline->stop_  = m->stop_;
 
 					// keeping newline, getting rid of the old line
-					delete meshline_[i];
-					meshline_.erase(meshline_.begin() + i);
-					i--;
+					eraseMeshline(m);
 				}
 
 			}
 		}
 	}
-	}
+	return newline;
+}
+
+Meshline* LRSplineSurface::insert_line(bool const_u, double const_par, double start, double stop, int multiplicity) {
+#ifdef TIME_LRSPLINE
+	PROFILE("insert_line()");
+#endif
+	// check if the line is an extension or a merging of existing lines
+	bool exists;
+	Meshline *newline = mergeLine(const_u, const_par, start, stop, multiplicity, exists);
+	if(exists)
+		return newline;
 
 	HashSet<Basisfunction*> newFuncStp1, newFuncStp2;
 	HashSet<Basisfunction*> removeFunc;
 
-	{ // STEP 1: test EVERY function against the NEW meshline
+	{ // STEP 1: test the functions on the elements crossed by the NEW meshline
 #ifdef TIME_LRSPLINE
 	PROFILE("STEP 1");
 #endif
+	// the element tree is updated by every element split, so it only has to be built once after being invalidated
+	requireElementTree();
+	std::vector<int>            crossed;
+	std::vector<Basisfunction*> candidates;
+	getElementsCrossing(newline, crossed);
+	getSplitCandidates(crossed, candidates);
 	{
 #ifdef TIME_LRSPLINE
 	PROFILE("S1-basissplit");
 #endif
-	for(Basisfunction* b : basis_) {
+	for(Basisfunction* b : candidates) {
 		if(newline->splits(b)) {
 			int nKnots = newline->nKnotsIn(b);
 			if( nKnots < newline->multiplicity_ ) {
@@ -1495,9 +1984,11 @@ Meshline* LRSplineSurface::insert_line(bool const_u, double const_par, double st
 #ifdef TIME_LRSPLINE
 	PROFILE("S1-elementsplit");
 #endif
-	for(uint i=0; i<element_.size(); i++) {
-		if(newline->splits(element_[i]))
-			element_.push_back(element_[i]->split(newline->is_spanning_u(), newline->const_par_));
+	for(int i : crossed) {
+		if(newline->splits(element_[i])) {
+			element_.push_back(element_[i]->split(newline->is_spanning_u(), newline->const_par_, &elementPool_));
+			updateElementCache(i, element_.size()-1);
+		}
 	}
 	} // end profiler (elementsplit)
 	} // end profiler (step 1)
@@ -1507,10 +1998,13 @@ Meshline* LRSplineSurface::insert_line(bool const_u, double const_par, double st
 	PROFILE("STEP 2");
 #endif
 	meshline_.push_back(newline);
+	meshlineIndex_.insert(newline);
+	std::vector<Meshline*> splitting;
 	while(newFuncStp1.size() > 0) {
 		Basisfunction *b = newFuncStp1.pop();
 		bool splitMore = false;
-		for(Meshline *m : meshline_) {
+		meshlineIndex_.getSplitting(b, splitting);
+		for(Meshline *m : splitting) {
 			if(m->splits(b)) {
 				int nKnots = m->nKnotsIn(b);
 				if( nKnots < m->multiplicity_ ) {
@@ -1526,13 +2020,183 @@ Meshline* LRSplineSurface::insert_line(bool const_u, double const_par, double st
 	}
 	} // end profiler (step 2)
 
+	// the basis function ids are out of date, while the element lookup is kept up to date by updateElementCache()
+	builtElementCache_ = false;
+	validBasisTable_   = false;
+
 	return newline;
 }
 
+/************************************************************************************************************************//**
+ * \brief Inserts several lines at once, giving the same mesh as calling insert_line() for each of them in turn
+ * \param lines The lines to insert, in order. These are only read, and remain owned by the caller
+ * \param multiplicity The multiplicity of all new lines
+ * \details This is used by refineElement() and refineBasisFunction() when setBatchRefinement() is on. All lines are first
+ *          merged into the mesh and all elements split, exactly as insert_line() would. Then every function with support on
+ *          an element crossed by a new line is split once by all lines crossing it (see splitAll()), and the new functions
+ *          get their support elements in one pass at the end. Functions which receive several new knots are thus not split
+ *          into intermediate functions which are thrown away by the next line.
+ *
+ *          The functions are split in groups with separate supports (see groupBySupport()), which are run on
+ *          setRefinementThreads() threads. Lines refining well separated regions thus make many small groups. Merging the
+ *          lines and splitting the elements is done on the calling thread.
+ *
+ *          The meshlines and elements (also their order) are the same as with insert_line(), while the basis functions are
+ *          the same up to their order and roundoff in the control points.
+ ***************************************************************************************************************************/
+void LRSplineSurface::insert_lines(const std::vector<Meshline*> &lines, int multiplicity) {
+#ifdef TIME_LRSPLINE
+	PROFILE("insert_lines()");
+#endif
+	std::vector<Basisfunction*> candidates;
+	{ // merge the lines into the mesh and split the elements they cross, collecting the functions on these
+#ifdef TIME_LRSPLINE
+	PROFILE("line insertion");
+#endif
+	requireElementTree();
+	std::vector<int> crossed;
+	for(Meshline *m : lines) {
+		bool exists;
+		Meshline *newline = mergeLine(!m->is_spanning_u(), m->const_par_, m->start_, m->stop_, multiplicity, exists);
+		if(exists)
+			continue;
+		getElementsCrossing(newline, crossed);
+		for(int i : crossed) {
+			for(Basisfunction *b : element_[i]->support())
+				candidates.push_back(b);
+			if(newline->splits(element_[i])) {
+				element_.push_back(element_[i]->split(newline->is_spanning_u(), newline->const_par_, &elementPool_));
+				updateElementCache(i, element_.size()-1);
+			}
+		}
+		meshline_.push_back(newline);
+		meshlineIndex_.insert(newline);
+		// the knot tables may not be changed while the functions are split (see addSplitFunction())
+		if(knotIndexing_)
+			knotTable_[newline->is_spanning_u()].index(newline->const_par_);
+	}
+	// each function is found on many elements, so the duplicates are removed before the (slower) sort by iteration order
+	std::sort(candidates.begin(), candidates.end());
+	candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+	basis_.sortByIterationOrder(candidates);
+	} // end profiler
+
+	std::vector<SplitGroup> groups;
+	{ // split every function which is not refined enough for the final mesh
+#ifdef TIME_LRSPLINE
+	PROFILE("function split");
+#endif
+	// the groups only read the mesh and basis_, and are merged into basis_ in a fixed order, so that the result does not
+	// depend on the number of threads. A pool can only be used by one thread at a time, so every thread has its own
+	groupBySupport(candidates, groups);
+	int nThreads = std::min<int>(refineThreads_, groups.size());
+	requireThreadPools(nThreads);
+	runGroups(groups.size(), nThreads, [this, &groups](int g, int t) {
+		groups[g].pool = threadPool(t);
+		splitGroup(groups[g]);
+	});
+	for(SplitGroup &group : groups) {
+		for(Basisfunction *b : group.removed) {
+			basis_.erase(b);
+			delete b;
+		}
+	}
+	for(SplitGroup &group : groups)
+		for(Basisfunction *b : group.created)
+			basis_.insert(b);
+	} // end profiler
+
+	{ // find the support of the new functions
+#ifdef TIME_LRSPLINE
+	PROFILE("support update");
+#endif
+	// the new functions of a group only overlap the elements inside the group, so these are not shared between threads
+	runGroups(groups.size(), refineThreads_, [this, &groups](int g, int) {
+		std::vector<int> overlapping;
+		for(Basisfunction *b : groups[g].created) {
+			double lo[2], hi[2];
+			for(int d=0; d<2; d++) {
+				lo[d] = (*b)[d][0];
+				hi[d] = (*b)[d][order_[d]];
+			}
+			elementTree_.getElementsOverlapping(lo, hi, overlapping);
+			std::sort(overlapping.begin(), overlapping.end());
+			for(int i : overlapping)
+				if(b->addSupport(element_[i]))
+					element_[i]->addSupportFunction(b);
+		}
+	});
+	} // end profiler
+
+	builtElementCache_ = false;
+	validBasisTable_   = false;
+}
+
+/************************************************************************************************************************//**
+ * \brief Builds the meshline index unless it is already up to date
+ * \details The index is kept up to date by insert_line(), and is only built from scratch after the meshlines have been
+ *          changed some other way (construction, read(), makeIntegerKnots()).
+ ***************************************************************************************************************************/
+void LRSplineSurface::requireMeshlineIndex() {
+	if(validMeshlineIndex_ && meshlineIndex_.size() == (int) meshline_.size())
+		return;
+	meshlineIndex_.build(meshline_);
+	validMeshlineIndex_ = true;
+}
+
+/************************************************************************************************************************//**
+ * \brief Removes a meshline from the spline and the meshline index, and deletes it
+ ***************************************************************************************************************************/
+void LRSplineSurface::eraseMeshline(Meshline *m) {
+	meshlineIndex_.erase(m);
+	meshline_.erase(std::find(meshline_.begin(), meshline_.end(), m));
+	delete m;
+}
+
 Meshline* LRSplineSurface::insert_const_v_edge(double v, double start_u, double stop_u, int multiplicity) {
 	return insert_line(false, v, start_u, stop_u, multiplicity);
 }
 
+/************************************************************************************************************************//**
+ * \brief Finds the elements which a meshline passes through, by walking along it in the element tree
+ * \param line The meshline
+ * \param[out] elements The index of every element containing a point of the line, sorted by increasing index. This
+ *                      includes all elements the line splits
+ * \details The element tree must be up to date (see requireElementTree()). Each step costs one lookup in the tree, so
+ *          the cost is proportional to the number of elements found
+ ***************************************************************************************************************************/
+void LRSplineSurface::getElementsCrossing(const Meshline *line, std::vector<int> &elements) const {
+	elements.clear();
+	int    d = (line->is_spanning_u()) ? 0 : 1; // direction along the line
+	double par[2];
+	par[1-d] = line->const_par_;
+	double t = line->start_;
+	while(t < line->stop_) {
+		par[d]  = t;
+		int iEl = elementTree_.getElementContaining(par);
+		if(iEl < 0 || element_[iEl]->getParmax(d) <= t)
+			break;
+		elements.push_back(iEl);
+		t = element_[iEl]->getParmax(d);
+	}
+	std::sort(elements.begin(), elements.end());
+}
+
+/************************************************************************************************************************//**
+ * \brief Collects the basis functions with support on some elements
+ * \param elements The element indices, typically from getElementsCrossing()
+ * \param[out] functions Every function supported on any of the elements once, in the order they are iterated over in
+ *                       basis_. Refinement then splits them in the same order as when looping over all functions
+ ***************************************************************************************************************************/
+void LRSplineSurface::getSplitCandidates(const std::vector<int> &elements, std::vector<Basisfunction*> &functions) const {
+	functions.clear();
+	for(int i : elements)
+		for(Basisfunction *b : element_[i]->support())
+			functions.push_back(b);
+	basis_.sortByIterationOrder(functions);
+	functions.erase(std::unique(functions.begin(), functions.end()), functions.end());
+}
+
 void LRSplineSurface::split(bool insert_in_u, Basisfunction* b, double new_knot, int multiplicity, HashSet<Basisfunction*> &newFunctions) {
 #ifdef TIME_LRSPLINE
 	PROFILE("split()");
@@ -1540,7 +2204,7 @@ void LRSplineSurface::split(bool insert_in_u, Basisfunction* b, double new_knot,
 
 	// create the new functions b1 and b2
 	Basisfunction *b1, *b2;
-	std::vector<double> knot = (insert_in_u) ? (*b)[0]  : (*b)[1];
+	LocalKnotVector knot = (insert_in_u) ? (*b)[0]  : (*b)[1];
 	int     p                = (insert_in_u) ? order_[0] : order_[1];
 	int     insert_index = 0;
 	if(new_knot < knot[0] || knot[p] < new_knot)
@@ -1554,11 +2218,15 @@ void LRSplineSurface::split(bool insert_in_u, Basisfunction* b, double new_knot,
 	newKnot[0] = new_knot;
 	std::sort(newKnot.begin(), newKnot.begin() + p + 2);
 	if(insert_in_u) {
-		b1 = new Basisfunction(newKnot.begin()  , (*b)[1].begin(), b->cp(), b->dim(), order_[0], order_[1], b->w()*alpha1);
-		b2 = new Basisfunction(newKnot.begin()+1, (*b)[1].begin(), b->cp(), b->dim(), order_[0], order_[1], b->w()*alpha2);
+		b1 = new (&basisPool_) Basisfunction(newKnot.begin()  , (*b)[1].begin(), b->cp(), b->dim(), order_[0], order_[1], b->w()*alpha1);
+		b2 = new (&basisPool_) Basisfunction(newKnot.begin()+1, (*b)[1].begin(), b->cp(), b->dim(), order_[0], order_[1], b->w()*alpha2);
 	} else { // insert in v
-		b1 = new Basisfunction((*b)[0].begin(), newKnot.begin(),     b->cp(), b->dim(), order_[0], order_[1], b->w()*alpha1);
-		b2 = new Basisfunction((*b)[0].begin(), newKnot.begin() + 1, b->cp(), b->dim(), order_[0], order_[1], b->w()*alpha2);
+		b1 = new (&basisPool_) Basisfunction((*b)[0].begin(), newKnot.begin(),     b->cp(), b->dim(), order_[0], order_[1], b->w()*alpha1);
+		b2 = new (&basisPool_) Basisfunction((*b)[0].begin(), newKnot.begin() + 1, b->cp(), b->dim(), order_[0], order_[1], b->w()*alpha2);
+	}
+	if(knotIndexing_) {
+		b1->indexKnots(knotTable_);
+		b2->indexKnots(knotTable_);
 	}
 
 	// add any brand new functions and detect their support elements
@@ -1607,6 +2275,73 @@ void LRSplineSurface::split(bool insert_in_u, Basisfunction* b, double new_knot,
 
 }
 
+/************************************************************************************************************************//**
+ * \brief Splits a basis function by all meshlines crossing its support, inserting all new knots at once
+ * \param b The function to split. This is not deleted or removed from any container
+ * \param group The group of b, which the new functions are added to (see addSplitFunction()). Their support is not set
+ * \returns False if no line splits b, so that it is a function of the current mesh
+ * \details Used by insert_lines(). The lines crossing the entire support of b also cross all of the new functions, so
+ *          these are the tensor product of the functions from inserting the new knots in each direction (see insertKnots())
+ ***************************************************************************************************************************/
+bool LRSplineSurface::splitAll(Basisfunction *b, SplitGroup &group) {
+	std::vector<Meshline*> splitting;
+	std::vector<std::pair<double,int> > knots[2]; // the parameter of each crossing line, and the number of knots it adds
+	meshlineIndex_.getSplitting(b, splitting);
+	for(Meshline *m : splitting) {
+		if(m->splits(b)) {
+			int nKnots = m->nKnotsIn(b);
+			if( nKnots < m->multiplicity_ )
+				knots[m->is_spanning_u()].push_back(std::make_pair(m->const_par_, m->multiplicity_-nKnots));
+		}
+	}
+	if(knots[0].empty() && knots[1].empty())
+		return false;
+
+	std::vector<double> knot[2], alpha[2], newKnots;
+	for(int d=0; d<2; d++) {
+		// overlapping lines of different multiplicity may cross at the same parameter, where the last one adds the most
+		std::sort(knots[d].begin(), knots[d].end());
+		newKnots.clear();
+		for(uint i=0; i<knots[d].size(); i++)
+			if(i+1 == knots[d].size() || knots[d][i+1].first != knots[d][i].first)
+				newKnots.insert(newKnots.end(), knots[d][i].second, knots[d][i].first);
+		knot[d].assign((*b)[d].begin(), (*b)[d].end());
+		insertKnots(knot[d], order_[d], newKnots, alpha[d]);
+	}
+
+	for(uint j=0; j<alpha[1].size(); j++) {
+		for(uint i=0; i<alpha[0].size(); i++) {
+			addSplitFunction(new (group.pool) Basisfunction(knot[0].begin()+i, knot[1].begin()+j, b->cp(), b->dim(), order_[0], order_[1], b->w()*alpha[0][i]*alpha[1][j]), group);
+		}
+	}
+	return true;
+}
+
+/************************************************************************************************************************//**
+ * \brief Splits the candidates of a group, and then the new functions, until all functions of the group fit the mesh
+ * \param group The group (see groupBySupport()). On return, this holds the functions to remove from and add to basis_
+ * \details Only changes the functions of the group, so that several groups may be split at the same time. The candidates are
+ *          split in order, and the new functions in the order they are popped from the group
+ ***************************************************************************************************************************/
+void LRSplineSurface::splitGroup(SplitGroup &group) {
+	for(Basisfunction *b : group.candidates) {
+		if(splitAll(b, group)) {
+			group.removed.push_back(b);
+			group.split.insert(b);
+		}
+	}
+	// the new functions may be crossed by lines which did not cross all of the function they came from
+	while(group.newFunctions.size() > 0) {
+		Basisfunction *b = group.newFunctions.pop();
+		if(splitAll(b, group)) {
+			delete b;
+		} else {
+			group.done.insert(b);
+			group.created.push_back(b);
+		}
+	}
+}
+
 void LRSplineSurface::getGlobalKnotVector(std::vector<double> &knot_u, std::vector<double> &knot_v) const {
 	getGlobalUniqueKnotVector(knot_u, knot_v);
 
@@ -1657,19 +2392,18 @@ void LRSplineSurface::getGlobalUniqueKnotVector(std::vector<double> &knot_u, std
 }
 
 void LRSplineSurface::updateSupport(Basisfunction *f,
-	                                std::vector<Element*>::iterator start,
-	                                std::vector<Element*>::iterator end ) {
+	                                Element* const *start,
+	                                Element* const *end ) {
 #ifdef TIME_LRSPLINE
 	PROFILE("update support");
 #endif
-	std::vector<Element*>::iterator it;
-	for(it=start; it!=end; it++)
+	for(Element* const *it=start; it!=end; it++)
 		if(f->addSupport(*it)) // this tests for overlapping as well as updating
 			(*it)->addSupportFunction(f);
 }
 
 void LRSplineSurface::updateSupport(Basisfunction *f) {
-	updateSupport(f, element_.begin(), element_.end());
+	updateSupport(f, element_.data(), element_.data() + element_.size());
 }
 
 bool LRSplineSurface::isLinearIndepByOverloading(bool verbose) {
@@ -2311,6 +3045,7 @@ double LRSplineSurface::makeIntegerKnots() {
 		m->start_     = floor(m->start_    /scale + 0.5);
 		m->stop_      = floor(m->stop_     /scale + 0.5);
 	}
+	validMeshlineIndex_ = false;
 
 	// scale all element values
 	Element *e;
@@ -2325,9 +3060,9 @@ double LRSplineSurface::makeIntegerKnots() {
 	// scale all basis functions values
 	for(Basisfunction *b : basis_) {
 		for(int j=0; j<order_[0]+1; j++)
-			(*b)[0][j] = floor((*b)[0][j]/scale + 0.5);
+			b->setKnot(0, j, floor((*b)[0][j]/scale + 0.5));
 		for(int j=0; j<order_[1]+1; j++)
-			(*b)[1][j] = floor((*b)[1][j]/scale + 0.5);
+			b->setKnot(1, j, floor((*b)[1][j]/scale + 0.5));
 	}
 
 	// scale all LRSplineSurface values
@@ -2336,6 +3071,11 @@ double LRSplineSurface::makeIntegerKnots() {
 	end_[0]   = floor(end_[0]  /scale + 0.5);
 	end_[1]   = floor(end_[1]  /scale + 0.5);
 
+	// all knots have changed
+	if(knotIndexing_)
+		setKnotIndexing(true);
+	invalidateElementCache();
+
 	return scale;
 }
 
@@ -2584,7 +3324,7 @@ bool LRSplineSurface::setControlPointsVDSA(const LRSplineSurface* lr) {
 	std::vector<double> u(2), newCP(2);
 	for(auto bit : this->getAllBasisfunctions()) {
 		bit->getGrevilleParameter(u);
-		std::vector<double>::iterator cp = (*bit).cp();
+		double *cp = (*bit).cp();
 		lr->point(newCP, u[0], u[1]);
 		for(int i=0; i<dim_; i++)
 			cp[i] = newCP[i];
@@ -2595,7 +3335,7 @@ bool LRSplineSurface::setControlPointsVDSA(const LRSplineSurface* lr) {
 void LRSplineSurface::getSupportElements(std::vector<int> &result, const std::vector<int> &basisfunctions) const  {
 	result.clear();
 	std::set<int> tmp;
-	std::vector<Element*>::iterator it;
+	BasisSupport::iterator it;
 	for(Basisfunction *b : basis_) {
 		for(it=b->supportedElementBegin(); it != b->supportedElementEnd(); it++)
 			tmp.insert((**it).getId());
@@ -2633,12 +3373,15 @@ void LRSplineSurface::aPosterioriFixElements() {
 	for(uint i=0; i<element_.size(); i++) {
 		for(uint j=0; j<meshline_.size(); j++) {
 			if(meshline_[j]->splits(element_[i])) {
-				element_.push_back(element_[i]->split(meshline_[j]->is_spanning_u(), meshline_[j]->const_par_));
+				element_.push_back(element_[i]->split(meshline_[j]->is_spanning_u(), meshline_[j]->const_par_, &elementPool_));
+				updateElementCache(i, element_.size()-1);
 				i=-1;
 				break;
 			}
 		}
 	}
+	builtElementCache_ = false;
+	validBasisTable_   = false;
 }
 
 void LRSplineSurface::getBezierElement(int iEl, std::vector<double> &controlPoints) const {
@@ -2841,7 +3584,9 @@ void LRSplineSurface::read(std::istream &is) {
 	is >> rational_;   ws(is);
 
 	meshline_.resize(nMeshlines);
+	validMeshlineIndex_ = false;
 	element_.resize(nElements);
+	invalidateElementCache();
 	std::vector<Basisfunction*> basisVector(nBasis);
 
 	// get rid of more comments and spaces
@@ -2854,7 +3599,7 @@ void LRSplineSurface::read(std::istream &is) {
 
 	// read all basisfunctions
 	for(int i=0; i<nBasis; i++) {
-		Basisfunction *b = new Basisfunction(dim_, order_[0], order_[1]);
+		Basisfunction *b = new (&basisPool_) Basisfunction(dim_, order_[0], order_[1]);
 		b->read(is);
 		basis_.insert(b);
 		basisVector[i] = b;
@@ -2869,7 +3614,7 @@ void LRSplineSurface::read(std::istream &is) {
 	}
 
 	for(int i=0; i<nMeshlines; i++) {
-		meshline_[i] = new Meshline();
+		meshline_[i] = new (&meshlinePool_) Meshline();
 		meshline_[i]->read(is);
 	}
 
@@ -2883,7 +3628,7 @@ void LRSplineSurface::read(std::istream &is) {
 
 	// read elements and calculate patch boundaries
 	for(int i=0; i<nElements; i++) {
-		element_[i] = new Element();
+		element_[i] = new (&elementPool_) Element();
 		element_[i]->read(is);
 		element_[i]->updateBasisPointers(basisVector);
 		start_[0] = (element_[i]->umin() < start_[0]) ? element_[i]->umin() : start_[0];
@@ -2891,6 +3636,8 @@ void LRSplineSurface::read(std::istream &is) {
 		start_[1] = (element_[i]->vmin() < start_[1]) ? element_[i]->vmin() : start_[1];
 		end_[1]   = (element_[i]->vmax() > end_[1]  ) ? element_[i]->vmax() : end_[1]  ;
 	}
+	if(knotIndexing_)
+		setKnotIndexing(true);
 }
 
 void LRSplineSurface::write(std::ostream &os) const {
@@ -3019,7 +3766,7 @@ void LRSplineSurface::writePostscriptElements(std::ostream &out, int nu, int nv,
 	y[0] = 1e7;
 	y[1] = -1e7;
 	for(Basisfunction *b : basis_) {
-		std::vector<double>::const_iterator cp = b->cp();
+		const double *cp = b->cp();
 		x[0] = (cp[0] < x[0]) ? cp[0] : x[0];
 		x[1] = (cp[0] > x[1]) ? cp[0] : x[1];
 		y[0] = (cp[1] < y[0]) ? cp[1] : y[0];
@@ -3151,7 +3898,7 @@ void LRSplineSurface::writePostscriptMeshWithControlPoints(std::ostream &out, in
 	y[0] = 1e7;
 	y[1] = -1e7;
 	for(Basisfunction *b : basis_) {
-		std::vector<double>::const_iterator cp = b->cp();
+		const double *cp = b->cp();
 		x[0] = (cp[0] < x[0]) ? cp[0] : x[0];
 		x[1] = (cp[0] > x[1]) ? cp[0] : x[1];
 		y[0] = (cp[1] < y[0]) ? cp[1] : y[0];
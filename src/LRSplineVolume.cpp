@@ -1,11 +1,13 @@
 #include "LRSpline/LRSplineVolume.h"
 #include "LRSpline/Basisfunction.h"
+#include "LRSpline/BasisWorkspace.h"
 #include "LRSpline/MeshRectangle.h"
 #include "LRSpline/Meshline.h"
 #include "LRSpline/Element.h"
 #include "LRSpline/Profiler.h"
 
 #include <algorithm>
+#include <thread>
 #include <functional>
 #include <cstdio>
 #include <cstdlib>
@@ -158,8 +160,11 @@ LRSplineVolume::LRSplineVolume(int n1, int n2, int n3, int order_u, int order_v,
 }
 
 LRSplineVolume::~LRSplineVolume() {
-	for(Basisfunction* b : basis_)
+	// the elements are deleted as well, so there is no need for the functions to remove themselves from their support lists
+	for(Basisfunction* b : basis_) {
+		b->clearSupport();
 		delete b;
+	}
 	for(uint i=0; i<meshrect_.size(); i++)
 		delete meshrect_[i];
 	for(uint i=0; i<element_.size(); i++)
@@ -169,12 +174,17 @@ LRSplineVolume::~LRSplineVolume() {
 void LRSplineVolume::initMeta() {
 	maxTjoints_           = -1;
 	doCloseGaps_          = true;
+	batchRefinement_      = false;
+	refineThreads_        = 1;
 	maxAspectRatio_       = 2.0;
 	doAspectRatioFix_     = false;
 	refStrat_             = LR_FULLSPAN;
 	refKnotlineMult_      = 1;
 	symmetry_             = 1;
 	builtElementCache_    = false;
+	validBasisTable_      = false;
+	validLocator_         = false;
+	validElementTree_     = false;
 }
 
 
@@ -202,6 +212,7 @@ LRSplineVolume* LRSplineVolume::copy() const {
 		returnvalue -> meshrect_.push_back(m->copy());
 
 	returnvalue->rational_         = this->rational_;
+	returnvalue->locator_          = this->locator_;
 	returnvalue->dim_              = this->dim_;
 	returnvalue->order_[0]          = this->order_[0];
 	returnvalue->order_[1]          = this->order_[1];
@@ -214,8 +225,12 @@ LRSplineVolume* LRSplineVolume::copy() const {
 	returnvalue->end_[2]            = this->end_[2];
 	returnvalue->maxTjoints_       = this->maxTjoints_;
 	returnvalue->doCloseGaps_      = this->doCloseGaps_;
+	returnvalue->batchRefinement_  = this->batchRefinement_;
+	returnvalue->refineThreads_    = this->refineThreads_;
 	returnvalue->doAspectRatioFix_ = this->doAspectRatioFix_;
 	returnvalue->maxAspectRatio_   = this->maxAspectRatio_;
+	if(knotIndexing_)
+		returnvalue->setKnotIndexing(true);
 
 	return returnvalue;
 }
@@ -262,7 +277,6 @@ void LRSplineVolume::point(std::vector<Go::Point> &pts, double u, double v, doub
 	PROFILE("Point()");
 #endif
 	Go::Point cp;
-	std::vector<double> basis_ev;
 
 	// clear and resize output array (optimization may consider this an outside task)
 	pts.resize((derivs+1)*(derivs+2)*(2*derivs+6)/12);
@@ -276,11 +290,16 @@ void LRSplineVolume::point(std::vector<Go::Point> &pts, double u, double v, doub
 	if(iEl == -1)
 		return;
 
+	BasisWorkspace &workspace = BasisWorkspace::local();
+	double  parPt[]     = {u, v, w};
+	bool    fromRight[] = {u!=end_[0], v!=end_[1], w!=end_[2]};
+	double *basis_ev    = workspace.buffer(element_[iEl]->nBasisFunctions() * pts.size());
+	computeElementBasis(basis_ev, parPt, derivs, fromRight, iEl, workspace);
 	for(Basisfunction* b : element_[iEl]->support() ) {
 		b->getControlPoint(cp);
-		b->evaluate(basis_ev, u,v,w, derivs, u!=end_[0], v!=end_[1], w!=end_[2]);
 		for(uint j=0; j<pts.size(); j++)
 			pts[j] += basis_ev[j]*cp;
+		basis_ev += pts.size();
 	}
 }
 #endif
@@ -349,8 +368,6 @@ void LRSplineVolume::point(std::vector<std::vector<double> > &pts, double u, dou
 #ifdef TIME_LRSPLINE
 	PROFILE("Point()");
 #endif
-	std::vector<double> basis_ev;
-
 	// clear and resize output array (optimization may consider this an outside task)
 	pts.clear();
 	pts.resize((derivs+1)*(derivs+2)*(derivs+3)/6);
@@ -361,11 +378,175 @@ void LRSplineVolume::point(std::vector<std::vector<double> > &pts, double u, dou
 		iEl = getElementContaining(u,v,w);
 	if(iEl == -1)
 		return;
+
+	BasisWorkspace &workspace = BasisWorkspace::local();
+	double  parPt[]     = {u, v, w};
+	bool    fromRight[] = {u_from_right, v_from_right, w_from_right};
+	double *basis_ev    = workspace.buffer(element_[iEl]->nBasisFunctions() * pts.size());
+	computeElementBasis(basis_ev, parPt, derivs, fromRight, iEl, workspace);
 	for(Basisfunction* b : element_[iEl]->support() ) {
-		b->evaluate(basis_ev, u,v,w, derivs, u_from_right, v_from_right, w_from_right);
 		for(uint i=0; i<pts.size(); i++)
 			for(int j=0; j<dim_; j++)
 				pts[i][j] += basis_ev[i]*b->cp(j);
+		basis_ev += pts.size();
+	}
+}
+
+/************************************************************************************************************************//**
+ * \brief Evaluate the volume at a point (u,v,w) from the Bezier representation of the element
+ * \param[out] pt The result, i.e. the parametric volume mapped to physical space
+ * \param u The u-coordinate on which to evaluate the volume
+ * \param v The v-coordinate on which to evaluate the volume
+ * \param w The w-coordinate on which to evaluate the volume
+ * \param iEl The element index which this point is contained in. If used will speed up computational efficiency
+ * \details Gives the same result as point() up to round-off. See getBezierCache() for details on the cached coefficients
+ ***************************************************************************************************************************/
+void LRSplineVolume::pointBezier(std::vector<double> &pt, double u, double v, double w, int iEl) const {
+	pt.assign(dim_, 0.0);
+	if(iEl == -1)
+		iEl = getElementContaining(u,v,w);
+	if(iEl == -1)
+		return;
+	double parPt[] = {u, v, w};
+	evaluateBezier(pt.data(), parPt, 0, iEl);
+}
+
+/************************************************************************************************************************//**
+ * \brief Evaluate the volume and its derivatives at a point (u,v,w) from the Bezier representation of the element
+ * \param[out] pts The result, i.e. the parametric volume as well as all parametric derivatives, ordered as in point()
+ * \param u The u-coordinate on which to evaluate the volume
+ * \param v The v-coordinate on which to evaluate the volume
+ * \param w The w-coordinate on which to evaluate the volume
+ * \param derivs The number of derivatives requested
+ * \param iEl The element index which this point is contained in. If used it will speed up computational efficiency
+ * \details Instead of evaluating every basis function on the element, this contracts the order_[0] x order_[1] x order_[2]
+ *          Bezier control points of the element with the Bernstein polynomials, one direction at a time. The Bezier control
+ *          points are computed on first use and cached on the element (see getBezierCache()). The results are the same as
+ *          point() up to round-off.
+ ***************************************************************************************************************************/
+void LRSplineVolume::pointBezier(std::vector<std::vector<double> > &pts, double u, double v, double w, int derivs, int iEl) const {
+#ifdef TIME_LRSPLINE
+	PROFILE("pointBezier()");
+#endif
+	pts.resize((derivs+1)*(derivs+2)*(derivs+3)/6);
+	for(uint i=0; i<pts.size(); i++)
+		pts[i].assign(dim_, 0.0);
+	if(iEl == -1)
+		iEl = getElementContaining(u,v,w);
+	if(iEl == -1)
+		return;
+
+	double parPt[] = {u, v, w};
+	double *res = BasisWorkspace::local().results(pts.size()*dim_);
+	evaluateBezier(res, parPt, derivs, iEl);
+	for(uint i=0; i<pts.size(); i++)
+		std::copy(res + i*dim_, res + (i+1)*dim_, pts[i].begin());
+}
+
+/************************************************************************************************************************//**
+ * \brief Evaluate a (multi-component) field defined on the basis of this volume, and its derivatives, at a point (u,v,w)
+ * \param[out] pts The result stored as [nDerivs][nComp], with the derivatives ordered as in point()
+ * \param coefs The coefficients of all basis functions, indexed by the basis function id (see generateIDs())
+ * \param nComp The number of components (fields) for each basis function
+ * \param u The u-coordinate on which to evaluate the field
+ * \param v The v-coordinate on which to evaluate the field
+ * \param w The w-coordinate on which to evaluate the field
+ * \param derivs The number of derivatives requested
+ * \param iEl The element index which this point is contained in. If used it will speed up computational efficiency
+ * \param layout If coefs is stored as [nBasisFunctions()][nComp] (ROW_MAJOR) or [nComp][nBasisFunctions()] (COLUMN_MAJOR)
+ * \details Evaluates a solution using the same basis as the geometry, without copying the coefficients into the control
+ *          points. The cost is one evaluation of the basis functions on the element plus a product with the nComp
+ *          coefficients of each function, so evaluating all fields of a multi-field solution at once is much cheaper than
+ *          evaluating each field separately. The basis function ids are renumbered on first use after refinement.
+ ***************************************************************************************************************************/
+void LRSplineVolume::pointField(double *pts, const double *coefs, int nComp, double u, double v, double w, int derivs, int iEl, coefficientLayout layout) const {
+#ifdef TIME_LRSPLINE
+	PROFILE("pointField()");
+#endif
+	std::fill(pts, pts + (derivs+1)*(derivs+2)*(derivs+3)/6*nComp, 0.0);
+	if(u < start_[0] || end_[0] < u ||
+	   v < start_[1] || end_[1] < v ||
+	   w < start_[2] || end_[2] < w)
+		return;
+	requireElementCache(); // makes sure the basis function ids are up to date
+	if(iEl == -1)
+		iEl = getElementContaining(u,v,w);
+	if(iEl == -1)
+		return;
+
+	double parPt[]     = {u, v, w};
+	bool   fromRight[] = {u!=end_[0], v!=end_[1], w!=end_[2]};
+	evaluateField(pts, parPt, fromRight, derivs, iEl, coefs, nComp, layout);
+}
+
+/************************************************************************************************************************//**
+ * \brief Evaluate a (multi-component) field defined on the basis of this volume, and its derivatives, at a point (u,v,w)
+ * \param[out] pts The result, pts[i][j] is derivative i (ordered as in point()) of component j
+ * \param coefs The coefficients of all basis functions, indexed by the basis function id (see generateIDs())
+ * \param nComp The number of components (fields) for each basis function
+ * \param u The u-coordinate on which to evaluate the field
+ * \param v The v-coordinate on which to evaluate the field
+ * \param w The w-coordinate on which to evaluate the field
+ * \param derivs The number of derivatives requested
+ * \param iEl The element index which this point is contained in. If used it will speed up computational efficiency
+ * \param layout If coefs is stored as [nBasisFunctions()][nComp] (ROW_MAJOR) or [nComp][nBasisFunctions()] (COLUMN_MAJOR)
+ ***************************************************************************************************************************/
+void LRSplineVolume::pointField(std::vector<std::vector<double> > &pts, const double *coefs, int nComp, double u, double v, double w, int derivs, int iEl, coefficientLayout layout) const {
+	int nRes = (derivs+1)*(derivs+2)*(derivs+3)/6;
+	std::vector<double> res(nRes*nComp);
+	pointField(res.data(), coefs, nComp, u, v, w, derivs, iEl, layout);
+	pts.resize(nRes);
+	for(int i=0; i<nRes; i++)
+		pts[i].assign(res.begin() + i*nComp, res.begin() + (i+1)*nComp);
+}
+
+/************************************************************************************************************************//**
+ * \brief Evaluate the volume and its derivatives on all nodes of a tensor grid
+ * \param us Sorted u-coordinates of the grid
+ * \param vs Sorted v-coordinates of the grid
+ * \param ws Sorted w-coordinates of the grid
+ * \param derivs The number of derivatives requested
+ * \param[out] out The results stored contiguously as [ws.size()][vs.size()][us.size()][nDerivs][dimension()] with
+ *                 nDerivs=(derivs+1)*(derivs+2)*(derivs+3)/6. The derivatives are ordered as in point(). Nodes outside the
+ *                 parametric domain are set to zero
+ * \details Each element is visited once, evaluating only the grid nodes inside it. The univariate B-splines are evaluated once
+ *          per grid line through the element and reused along that line. The results are identical to calling point() on
+ *          each grid node.
+ ***************************************************************************************************************************/
+void LRSplineVolume::gridEvaluate(const std::vector<double> &us, const std::vector<double> &vs, const std::vector<double> &ws, int derivs, std::vector<double> &out) const {
+#ifdef TIME_LRSPLINE
+	PROFILE("gridEvaluate()");
+#endif
+	int nRes = (derivs+1)*(derivs+2)*(derivs+3)/6;
+	out.assign(us.size()*vs.size()*ws.size()*nRes*dim_, 0.0);
+	if(!std::is_sorted(us.begin(), us.end()) || !std::is_sorted(vs.begin(), vs.end()) || !std::is_sorted(ws.begin(), ws.end())) {
+		std::cerr << "Error: LRSplineVolume::gridEvaluate() requires sorted grid parameters" << std::endl;
+		exit(9301);
+	}
+	requireElementCache();
+
+	// locate all grid lines in the global tensor mesh
+	std::vector<int> cell[3];
+	getGridCells(us, glob_knot_u_, cell[0]);
+	getGridCells(vs, glob_knot_v_, cell[1]);
+	getGridCells(ws, glob_knot_w_, cell[2]);
+
+	const std::vector<double> *globKnot[] = {&glob_knot_u_, &glob_knot_v_, &glob_knot_w_};
+	const std::vector<double>  grid[]     = {us, vs, ws};
+	int stride[] = {1, (int) us.size(), (int) (us.size()*vs.size())};
+	for(uint iEl=0; iEl<element_.size(); iEl++) {
+		Element *e = element_[iEl];
+		int  start[3], stop[3];
+		bool empty = false;
+		for(int d=0; d<3; d++) {
+			int i0   = std::lower_bound(globKnot[d]->begin(), globKnot[d]->end(), e->getParmin(d)) - globKnot[d]->begin();
+			int i1   = std::lower_bound(globKnot[d]->begin(), globKnot[d]->end(), e->getParmax(d)) - globKnot[d]->begin();
+			start[d] = std::lower_bound(cell[d].begin(), cell[d].end(), i0) - cell[d].begin();
+			stop[d]  = std::lower_bound(cell[d].begin(), cell[d].end(), i1) - cell[d].begin();
+			empty    = empty || start[d] >= stop[d];
+		}
+		if(!empty)
+			evaluateGridElement(out.data(), iEl, grid, start, stop, stride, derivs);
 	}
 }
 
@@ -374,18 +555,16 @@ void LRSplineVolume::computeBasis (double param_u, double param_v, double param_
 #ifdef TIME_LRSPLINE
 	PROFILE("computeBasis()");
 #endif
-	std::vector<double> values;
-	HashSet_const_iterator<Basisfunction*> it, itStop, itStart;
-	itStart = (iEl<0) ? basis_.begin() : element_[iEl]->constSupportBegin();
-	itStop  = (iEl<0) ? basis_.end()   : element_[iEl]->constSupportEnd();
 	int nPts= (iEl<0) ? basis_.size()  : element_[iEl]->nBasisFunctions();
 	result.prepareDerivs(param_u, param_v, param_w, 0, 0, 0, nPts);
 
-	int i=0;
-
-	for(it=itStart; it!=itStop; ++it, ++i) {
-		(*it)->evaluate(values, param_u, param_v, param_w, 2, param_u!=end_[0], param_v!=end_[1], param_w!=end_[2]);
+	BasisWorkspace &workspace = BasisWorkspace::local();
+	double  parPt[]     = {param_u, param_v, param_w};
+	bool    fromRight[] = {param_u!=end_[0], param_v!=end_[1], param_w!=end_[2]};
+	double *values      = workspace.buffer(nPts * 10);
+	computeElementBasis(values, parPt, 2, fromRight, iEl, workspace);
 
+	for(int i=0; i<nPts; i++, values+=10) {
 		result.basisValues[i]    = values[0];
 		result.basisDerivs_u[i]  = values[1];
 		result.basisDerivs_v[i]  = values[2];
@@ -403,17 +582,16 @@ void LRSplineVolume::computeBasis (double param_u, double param_v, double param_
 #ifdef TIME_LRSPLINE
 	PROFILE("computeBasis()");
 #endif
-	std::vector<double> values;
-	HashSet_const_iterator<Basisfunction*> it, itStop, itStart;
-	itStart = (iEl<0) ? basis_.begin() : element_[iEl]->constSupportBegin();
-	itStop  = (iEl<0) ? basis_.end()   : element_[iEl]->constSupportEnd();
 	int nPts= (iEl<0) ? basis_.size()  : element_[iEl]->nBasisFunctions();
 	result.prepareDerivs(param_u, param_v, param_w, 0, 0, 0, nPts);
 
-	int i=0;
-	for(it=itStart; it!=itStop; ++it, ++i) {
-		(*it)->evaluate(values, param_u, param_v, param_w, 1, param_u!=end_[0], param_v!=end_[1], param_w!=end_[2]);
+	BasisWorkspace &workspace = BasisWorkspace::local();
+	double  parPt[]     = {param_u, param_v, param_w};
+	bool    fromRight[] = {param_u!=end_[0], param_v!=end_[1], param_w!=end_[2]};
+	double *values      = workspace.buffer(nPts * 4);
+	computeElementBasis(values, parPt, 1, fromRight, iEl, workspace);
 
+	for(int i=0; i<nPts; i++, values+=4) {
 		result.basisValues[i]   = values[0];
 		result.basisDerivs_u[i] = values[1];
 		result.basisDerivs_v[i] = values[2];
@@ -426,14 +604,16 @@ void LRSplineVolume::computeBasis(double param_u, double param_v, double param_w
 #ifdef TIME_LRSPLINE
 	PROFILE("computeBasis()");
 #endif
-	HashSet_const_iterator<Basisfunction*> it, itStop, itStart;
-	itStart = (iEl<0) ? basis_.begin() : element_[iEl]->constSupportBegin();
-	itStop  = (iEl<0) ? basis_.end()   : element_[iEl]->constSupportEnd();
 	int nPts= (iEl<0) ? basis_.size()  : element_[iEl]->nBasisFunctions();
 	result.preparePts(param_u, param_v, param_w, 0, 0, 0, nPts);
-	int i=0;
-	for(it=itStart; it!=itStop; ++it, ++i)
-		result.basisValues[i] = (*it)->evaluate(param_u, param_v, param_w, param_u!=end_[0], param_v!=end_[1], param_w!=end_[2]);
+
+	BasisWorkspace &workspace = BasisWorkspace::local();
+	double  parPt[]     = {param_u, param_v, param_w};
+	bool    fromRight[] = {param_u!=end_[0], param_v!=end_[1], param_w!=end_[2]};
+	double *values      = workspace.buffer(nPts);
+	computeElementBasis(values, parPt, 0, fromRight, iEl, workspace);
+	for(int i=0; i<nPts; i++)
+		result.basisValues[i] = values[i];
 }
 #endif
 
@@ -447,23 +627,26 @@ void LRSplineVolume::computeBasis (double param_u,
 #ifdef TIME_LRSPLINE
 	PROFILE("computeBasis()");
 #endif
-	result.clear();
-	HashSet_const_iterator<Basisfunction*> it, itStop, itStart;
-	itStart = (iEl<0) ? basis_.begin() : element_[iEl]->constSupportBegin();
-	itStop  = (iEl<0) ? basis_.end()   : element_[iEl]->constSupportEnd();
 	int nPts= (iEl<0) ? basis_.size()  : element_[iEl]->nBasisFunctions();
-	result.resize(nPts);
+	int nRes= Basisfunction::nDerivatives(3, derivs);
 
-	int i=0;
-	for(it=itStart; it!=itStop; ++it, ++i)
-	    (*it)->evaluate(result[i], param_u, param_v, param_w, derivs, param_u!=end_[0], param_v!=end_[1], param_w!=end_[2]);
+	BasisWorkspace &workspace = BasisWorkspace::local();
+	double  parPt[]     = {param_u, param_v, param_w};
+	bool    fromRight[] = {param_u!=end_[0], param_v!=end_[1], param_w!=end_[2]};
+	double *values      = workspace.buffer(nPts * nRes);
+	computeElementBasis(values, parPt, derivs, fromRight, iEl, workspace);
+
+	// reuse the memory of result (if any) instead of clearing it
+	result.resize(nPts);
+	for(int i=0; i<nPts; i++)
+		result[i].assign(values + i*nRes, values + (i+1)*nRes);
 }
 
 /************************************************************************************************************************//**
  * \brief Computes a cached lookup table for quick determination of element distribution. Allows getElementContaining()
  *        to be ran in O(log(n)) time.
- * \details This is done by creating a full tensor mesh (of elements) and storing the LR-elements from which each
- *          sub-element came from.
+ * \details For LOCATOR_GRID this is done by creating a full tensor mesh (of elements) and storing the LR-elements from
+ *          which each sub-element came from. For LOCATOR_TREE an ElementTree is built over the element boxes instead.
  ***************************************************************************************************************************/
 void LRSplineVolume::createElementCache() const {
 	generateIDs();
@@ -473,6 +656,15 @@ void LRSplineVolume::createElementCache() const {
 	glob_knot_w_.clear();
 	this->getGlobalUniqueKnotVector(glob_knot_u_, glob_knot_v_, glob_knot_w_);
 
+	if(locator_ == LOCATOR_TREE) {
+		std::vector<std::vector<std::vector<int> > >().swap(elementCache_);
+		elementTree_.build(element_, end_);
+		validLocator_      = true;
+		validElementTree_  = true;
+		builtElementCache_ = true;
+		return;
+	}
+
 	// create a tensor-mesh of elements given by an nxm matrix
 	elementCache_ = std::vector<std::vector<std::vector<int> > >(glob_knot_u_.size(),
                               std::vector<std::vector<int> >(  glob_knot_v_.size(),
@@ -492,9 +684,85 @@ void LRSplineVolume::createElementCache() const {
 			  for(int k=k0; k<k1; k++)
 				  elementCache_[i][j][k] = e->getId();
 	}
+	validLocator_      = true;
 	builtElementCache_ = true;
 }
 
+/************************************************************************************************************************//**
+ * \brief Keeps the element lookup structure up to date when refinement splits an element in two
+ * \param iEl The element which was split
+ * \param iNew The index of the new element, i.e. the part which was cut off iEl
+ * \details Only the cells covered by the new element are touched. For LOCATOR_GRID the table gets one more layer of cells
+ *          if the split introduces a new unique knot, which is copied from the layer it splits. If the lookup structure
+ *          was not up to date to begin with, nothing is done and it is rebuilt on the next lookup. The element tree used by
+ *          insert_line() is updated as well, also with LOCATOR_GRID.
+ ***************************************************************************************************************************/
+void LRSplineVolume::updateElementCache(int iEl, int iNew) {
+	if(validElementTree_)
+		elementTree_.split(element_, iEl, iNew);
+	if(!validLocator_)
+		return;
+	Element *e = element_[iNew];
+	e->setId(iNew);
+	if(locator_ == LOCATOR_TREE)
+		return;
+
+	// insert the new knot (if any) into the global mesh, splitting the cells it cuts through
+	int i0 = std::lower_bound(glob_knot_u_.begin(), glob_knot_u_.end(), e->umin()) - glob_knot_u_.begin();
+	if(glob_knot_u_[i0] != e->umin()) {
+		glob_knot_u_.insert(glob_knot_u_.begin()+i0, e->umin());
+		std::vector<std::vector<int> > plane = elementCache_[i0-1];
+		elementCache_.insert(elementCache_.begin()+i0, plane);
+	}
+	int j0 = std::lower_bound(glob_knot_v_.begin(), glob_knot_v_.end(), e->vmin()) - glob_knot_v_.begin();
+	if(glob_knot_v_[j0] != e->vmin()) {
+		glob_knot_v_.insert(glob_knot_v_.begin()+j0, e->vmin());
+		for(std::vector<std::vector<int> > &plane : elementCache_) {
+			std::vector<int> column = plane[j0-1];
+			plane.insert(plane.begin()+j0, column);
+		}
+	}
+	int k0 = std::lower_bound(glob_knot_w_.begin(), glob_knot_w_.end(), e->wmin()) - glob_knot_w_.begin();
+	if(glob_knot_w_[k0] != e->wmin()) {
+		glob_knot_w_.insert(glob_knot_w_.begin()+k0, e->wmin());
+		for(std::vector<std::vector<int> > &plane : elementCache_) {
+			for(std::vector<int> &column : plane) {
+				int id = column[k0-1];
+				column.insert(column.begin()+k0, id);
+			}
+		}
+	}
+
+	// and hand the cells of the new element over to it
+	int i1 = std::lower_bound(glob_knot_u_.begin(), glob_knot_u_.end(), e->umax()) - glob_knot_u_.begin();
+	int j1 = std::lower_bound(glob_knot_v_.begin(), glob_knot_v_.end(), e->vmax()) - glob_knot_v_.begin();
+	int k1 = std::lower_bound(glob_knot_w_.begin(), glob_knot_w_.end(), e->wmax()) - glob_knot_w_.begin();
+	for(int i=i0; i<i1; i++)
+		for(int j=j0; j<j1; j++)
+			for(int k=k0; k<k1; k++)
+				elementCache_[i][j][k] = iNew;
+}
+
+/************************************************************************************************************************//**
+ * \brief Builds the element cache unless it is already up to date
+ * \details Is safe to call from several threads at once. The cache is built by the first thread getting here, while the
+ *          others wait for it to finish. Once built, this is a single atomic read.
+ ***************************************************************************************************************************/
+void LRSplineVolume::requireElementCache() const {
+	if(builtElementCache_)
+		return;
+	std::lock_guard<std::mutex> lock(elementCacheLock_);
+	if(builtElementCache_)
+		return;
+	// the lookup structure is kept up to date during refinement, and only has to be built when it has been invalidated
+	if(validLocator_) {
+		generateIDs();
+		builtElementCache_ = true;
+	} else {
+		createElementCache();
+	}
+}
+
 /************************************************************************************************************************//**
  * \brief Get the element index of the element containing the parametric point (u,v,w)
  * \param u The u-coordinate
@@ -507,8 +775,12 @@ int LRSplineVolume::getElementContaining(double u, double v, double w) const {
 	if(u < startparam(0) || u > endparam(0) || v < startparam(1) || v > endparam(1) || w < startparam(2) || w > endparam(2))
 		return -1;
 	// build cache if not already present
-	if(builtElementCache_ == false)
-		createElementCache();
+	requireElementCache();
+
+	if(locator_ == LOCATOR_TREE) {
+		double par[] = {u, v, w};
+		return elementTree_.getElementContaining(par);
+	}
 
 	// binary search for the right element
 	size_t i = std::upper_bound(glob_knot_u_.begin(), glob_knot_u_.end(), u) - glob_knot_u_.begin() - 1;
@@ -522,6 +794,119 @@ int LRSplineVolume::getElementContaining(double u, double v, double w) const {
 	return elementCache_[i][j][k];
 }
 
+/************************************************************************************************************************//**
+ * \brief Get the element index of the elements containing many parametric points at once
+ * \param u The u-coordinates
+ * \param v The v-coordinates
+ * \param w The w-coordinates
+ * \param n The number of points
+ * \param[out] out The index of the element containing each point (u[i],v[i],w[i]), or -1 if it is outside the domain
+ * \param nThreads The number of threads to split the points between
+ * \details Gives the same results as calling getElementContaining() for each point, but with LOCATOR_GRID the knot spans are
+ *          found by bucketing instead of binary search (see LRSpline::getKnotSpans()), in blocks small enough to stay in
+ *          cache. The points need not be sorted.
+ ***************************************************************************************************************************/
+void LRSplineVolume::getElementsContaining(const double *u, const double *v, const double *w, int n, int *out, int nThreads) const {
+	// build cache if not already present, before any threads are started
+	requireElementCache();
+
+	if(nThreads > 1 && n > nThreads) {
+		std::vector<std::thread> threads;
+		int chunk = (n + nThreads - 1) / nThreads;
+		for(int first=0; first<n; first+=chunk)
+			threads.push_back(std::thread(&LRSplineVolume::getElementsContaining, this, u+first, v+first, w+first,
+			                              std::min(chunk, n-first), out+first, 1));
+		for(std::thread &t : threads)
+			t.join();
+		return;
+	}
+
+	if(locator_ == LOCATOR_TREE) {
+		for(int k=0; k<n; k++)
+			out[k] = getElementContaining(u[k], v[k], w[k]);
+		return;
+	}
+
+	// the bucket tables are built once, and used for all blocks of points
+	std::vector<int> bucket_u, bucket_v, bucket_w;
+	getKnotBuckets(glob_knot_u_, bucket_u);
+	getKnotBuckets(glob_knot_v_, bucket_v);
+	getKnotBuckets(glob_knot_w_, bucket_w);
+	const int blockSize = 4096;
+	int i[blockSize], j[blockSize], l[blockSize];
+	for(int first=0; first<n; first+=blockSize) {
+		int count = std::min(blockSize, n-first);
+		getKnotSpans(glob_knot_u_, bucket_u, u+first, count, i);
+		getKnotSpans(glob_knot_v_, bucket_v, v+first, count, j);
+		getKnotSpans(glob_knot_w_, bucket_w, w+first, count, l);
+		for(int k=0; k<count; k++)
+			out[first+k] = (i[k] < 0 || j[k] < 0 || l[k] < 0) ? -1 : elementCache_[i[k]][j[k]][l[k]];
+	}
+}
+
+/************************************************************************************************************************//**
+ * \brief Selects the data structure used by getElementContaining() and getElementNeighbours()
+ * \param type LOCATOR_GRID for a dense table over all unique knots, or LOCATOR_TREE for a tree over the elements
+ * \details The dense table has the fastest lookup, but its memory grows as the product of the number of unique knots in
+ *          each direction, which quickly dominates for strongly local refinement in 3D. The tree uses memory
+ *          proportional to the number of elements. Both give identical results.
+ ***************************************************************************************************************************/
+void LRSplineVolume::setElementLocator(elementLocator type) {
+	if(type == locator_)
+		return;
+	locator_ = type;
+	invalidateElementCache();
+}
+
+/************************************************************************************************************************//**
+ * \brief Throws away the element lookup structure and the ids, which are rebuilt on the next lookup
+ ***************************************************************************************************************************/
+void LRSplineVolume::invalidateElementCache() {
+	elementTree_.clear();
+	validLocator_      = false;
+	validElementTree_  = false;
+	builtElementCache_ = false;
+	validBasisTable_   = false;
+}
+
+/************************************************************************************************************************//**
+ * \brief Builds the element tree searched by insert_line() unless it is already up to date
+ * \details With LOCATOR_TREE this is the element lookup structure itself. With LOCATOR_GRID the tree is kept next to the
+ *          table during refinement, since an element split only changes the tree locally, while a new knot changes the
+ *          size of the whole table. The table is then only updated if it has been built already.
+ ***************************************************************************************************************************/
+void LRSplineVolume::requireElementTree() {
+	if(validElementTree_)
+		return;
+	if(locator_ == LOCATOR_TREE) {
+		createElementCache();
+	} else {
+		elementTree_.build(element_, end_);
+		validElementTree_ = true;
+	}
+}
+
+/************************************************************************************************************************//**
+ * \brief Returns the number of bytes used by the element lookup structure, including the global knot vectors and the
+ *        element tree kept up to date for refinement (see requireElementTree())
+ ***************************************************************************************************************************/
+size_t LRSplineVolume::elementLocatorMemory() const {
+	if(!builtElementCache_)
+		return 0;
+	size_t bytes = (glob_knot_u_.capacity() + glob_knot_v_.capacity() + glob_knot_w_.capacity()) * sizeof(double);
+	if(locator_ == LOCATOR_TREE || validElementTree_)
+		bytes += elementTree_.memoryFootprint();
+	if(locator_ == LOCATOR_TREE)
+		return bytes;
+	bytes += elementCache_.capacity() * sizeof(std::vector<std::vector<int> >);
+	for(const std::vector<std::vector<int> > &plane : elementCache_) {
+		bytes += plane.capacity() * sizeof(std::vector<int>);
+		for(const std::vector<int> &column : plane)
+			bytes += column.capacity() * sizeof(int);
+	}
+	return bytes;
+}
+
 /************************************************************************************************************************//**
  * \brief Get the all neighbours for a given Element
  * \param iEl  The element index
@@ -530,8 +915,18 @@ int LRSplineVolume::getElementContaining(double u, double v, double w) const {
  ***************************************************************************************************************************/
 std::set<int> LRSplineVolume::getElementNeighbours(int iEl, parameterEdge edge) const {
 	// build cache if not already present
-	if(builtElementCache_ == false)
-		createElementCache();
+	requireElementCache();
+
+	std::set<int> result;
+	if(locator_ == LOCATOR_TREE) {
+		if (edge & (TOP|BOTTOM))
+			elementTree_.getElementNeighbours(iEl, 2, edge == TOP,   result);
+		else if (edge & (NORTH|SOUTH))
+			elementTree_.getElementNeighbours(iEl, 1, edge == NORTH, result);
+		else if (edge & (WEST|EAST))
+			elementTree_.getElementNeighbours(iEl, 0, edge == EAST,  result);
+		return result;
+	}
 
 	Element *e = element_[iEl];
 	int i0 = std::lower_bound(glob_knot_u_.begin(), glob_knot_u_.end(), e->umin()) - glob_knot_u_.begin();
@@ -540,7 +935,6 @@ std::set<int> LRSplineVolume::getElementNeighbours(int iEl, parameterEdge edge)
 	int j1 = std::lower_bound(glob_knot_v_.begin(), glob_knot_v_.end(), e->vmax()) - glob_knot_v_.begin();
 	int k0 = std::lower_bound(glob_knot_w_.begin(), glob_knot_w_.end(), e->wmin()) - glob_knot_w_.begin();
 	int k1 = std::lower_bound(glob_knot_w_.begin(), glob_knot_w_.end(), e->wmax()) - glob_knot_w_.begin();
-	std::set<int> result;
 	if (edge & (TOP|BOTTOM)) {
 		size_t k = (edge == TOP) ? k1:k0-1;
 		if (k >= 0 && k < glob_knot_w_.size()-1)
@@ -776,15 +1170,8 @@ void LRSplineVolume::refineBasisFunction(const std::vector<int> &indices) {
 	std::vector<MeshRectangle*> newRects;
 
 	/* first retrieve all meshrects needed */
-	int ib = 0;
-	HashSet_iterator<Basisfunction*> it = basis_.begin();
-	for(uint i=0; i<sortedInd.size(); i++) {
-		while(ib < sortedInd[i]) {
-			++ib;
-			++it;
-		}
-		getStructMeshRects(*it,newRects);
-	}
+	for(uint i=0; i<sortedInd.size(); i++)
+		getStructMeshRects(getBasisfunction(sortedInd[i]),newRects);
 
 	/* Do the actual refinement */
 	for(MeshRectangle *m : newRects)
@@ -826,6 +1213,7 @@ void LRSplineVolume::refineByDimensionIncrease(const std::vector<double> &errPer
 	/* accumulate the error & index - vector */
 	std::vector<IndexDouble> errors;
 	if(refStrat_ == LR_STRUCTURED_MESH) { // error per-function
+		requireBasisTable(); // all ids up to date, so that i is the id of b and getBasisfunction(i) is constant time
 		int i=0;
 		for(Basisfunction *b : basis_) {
 			errors.push_back(IndexDouble(0.0, i));
@@ -1158,17 +1546,17 @@ bool LRSplineVolume::enforceIsotropic() {
 			double h  = std::min(std::min(du,dv),dw);
 			MeshRectangle *m;
 			if(du - h > DOUBLE_TOL) {
-				m = new MeshRectangle(umin+du/2, vmin, wmin, umin+du/2, vmax, wmax, refKnotlineMult_);
+				m = new (&meshrectPool_) MeshRectangle(umin+du/2, vmin, wmin, umin+du/2, vmax, wmax, refKnotlineMult_);
 				insert_line(m);
 				somethingFixed = true;
 			}
 			if(dv - h > DOUBLE_TOL) {
-				m = new MeshRectangle(umin, vmin+dv/2, wmin, umax, vmin+dv/2, wmax, refKnotlineMult_);
+				m = new (&meshrectPool_) MeshRectangle(umin, vmin+dv/2, wmin, umax, vmin+dv/2, wmax, refKnotlineMult_);
 				insert_line(m);
 				somethingFixed = true;
 			}
 			if(dw - h > DOUBLE_TOL) {
-				m = new MeshRectangle(umin, vmin, wmin+dw/2, umax, vmax, wmin+dw/2, refKnotlineMult_);
+				m = new (&meshrectPool_) MeshRectangle(umin, vmin, wmin+dw/2, umax, vmax, wmin+dw/2, refKnotlineMult_);
 				insert_line(m);
 				somethingFixed = true;
 			}
@@ -1181,7 +1569,12 @@ bool LRSplineVolume::enforceIsotropic() {
 	return result;
 }
 
-MeshRectangle* LRSplineVolume::insert_line(MeshRectangle *newRect) {
+/************************************************************************************************************************//**
+ * \brief Merges a new meshrectangle with the existing ones it overlaps. This is the first part of insert_line()
+ * \param newRect The new meshrectangle, which is owned by the spline from now on
+ * \param[out] newGuys The rectangles to add to the mesh. These have been removed from meshrect_, and are not yet added back
+ ***************************************************************************************************************************/
+void LRSplineVolume::mergeRect(MeshRectangle *newRect, std::vector<MeshRectangle*> &newGuys) {
 	if(newRect->start_[0] < start_[0] ||
 	   newRect->start_[1] < start_[1] ||
 	   newRect->start_[2] < start_[2] ||
@@ -1198,7 +1591,7 @@ MeshRectangle* LRSplineVolume::insert_line(MeshRectangle *newRect) {
 		exit(5312174);
 	}
 
-	std::vector<MeshRectangle*> newGuys;
+	newGuys.clear();
 	newGuys.push_back(newRect);
 
 	{ // check if the line is an extension or a merging of existing lines
@@ -1267,15 +1660,31 @@ MeshRectangle* LRSplineVolume::insert_line(MeshRectangle *newRect) {
 		}
 	}
 	} // end meshrectangle verification timer
+}
+
+MeshRectangle* LRSplineVolume::insert_line(MeshRectangle *newRect) {
+	std::vector<MeshRectangle*> newGuys;
+	mergeRect(newRect, newGuys);
 
 	HashSet<Basisfunction*> newFuncStp1, newFuncStp2;
 	HashSet<Basisfunction*> removeFunc;
 
-	{ // STEP 1: test EVERY function against the NEW meshrect
+	{ // STEP 1: test the functions on the elements crossed by the NEW meshrects
 #ifdef TIME_LRSPLINE
 	PROFILE("STEP 1");
 #endif
-	for(Basisfunction* b : basis_) {
+	// the element tree is updated by every element split, so it only has to be built once after being invalidated
+	requireElementTree();
+	std::vector<int>            crossed, crossedRect;
+	std::vector<Basisfunction*> candidates;
+	for(MeshRectangle *m : newGuys) {
+		getElementsCrossing(m, crossedRect);
+		crossed.insert(crossed.end(), crossedRect.begin(), crossedRect.end());
+	}
+	std::sort(crossed.begin(), crossed.end());
+	crossed.erase(std::unique(crossed.begin(), crossed.end()), crossed.end());
+	getSplitCandidates(crossed, candidates);
+	for(Basisfunction* b : candidates) {
 		for(MeshRectangle *m : newGuys) {
 			if(m->splits(b)) {
 				int nKnots = m->nKnotsIn(b);
@@ -1291,10 +1700,15 @@ MeshRectangle* LRSplineVolume::insert_line(MeshRectangle *newRect) {
 		basis_.erase(b);
 		delete b;
 	}
-	for(uint i=0; i<element_.size(); i++) {
+	// the new elements are appended to the list as well, in case another of the rectangles splits them again
+	for(uint k=0; k<crossed.size(); k++) {
+		int i = crossed[k];
 		for(MeshRectangle *m : newGuys) {
-			if(m->splits(element_[i]))
-				element_.push_back(element_[i]->split(m->constDirection(), m->constParameter()) );
+			if(m->splits(element_[i])) {
+				element_.push_back(element_[i]->split(m->constDirection(), m->constParameter(), &elementPool_) );
+				updateElementCache(i, element_.size()-1);
+				crossed.push_back(element_.size()-1);
+			}
 		}
 	}
 	} // end step 1 timer
@@ -1324,12 +1738,66 @@ MeshRectangle* LRSplineVolume::insert_line(MeshRectangle *newRect) {
 	}
 	} // end step 2 timer
 
-	// clear cache since mesh is now changed
+	// the basis function ids are out of date, while the element lookup is kept up to date by updateElementCache()
 	builtElementCache_ = false;
+	validBasisTable_   = false;
 
 	return NULL;
 }
 
+/************************************************************************************************************************//**
+ * \brief Finds the elements which a meshrectangle passes through, by sweeping over it in the element tree
+ * \param rect The meshrectangle
+ * \param[out] elements The index of every element containing a point of the rectangle, sorted by increasing index. This
+ *                      includes all elements the rectangle splits
+ * \details The element tree must be up to date (see requireElementTree()). The rectangle is swept in rows: each row is
+ *          walked from element to element in the first direction, and the next row starts where the lowest of these
+ *          elements ends in the second direction
+ ***************************************************************************************************************************/
+void LRSplineVolume::getElementsCrossing(const MeshRectangle *rect, std::vector<int> &elements) const {
+	elements.clear();
+	int c  = rect->constDirection(); // constant index
+	int v1 = (c+1)%3;                // first variable index
+	int v2 = (c+2)%3;                // second variable index
+	double par[3];
+	par[c] = rect->constParameter();
+	double t = rect->start_[v2];
+	while(t < rect->stop_[v2]) {
+		double nextT = rect->stop_[v2];
+		double s     = rect->start_[v1];
+		par[v2] = t;
+		while(s < rect->stop_[v1]) {
+			par[v1] = s;
+			int iEl = elementTree_.getElementContaining(par);
+			if(iEl < 0 || element_[iEl]->getParmax(v1) <= s)
+				break;
+			elements.push_back(iEl);
+			nextT = std::min(nextT, element_[iEl]->getParmax(v2));
+			s     = element_[iEl]->getParmax(v1);
+		}
+		if(nextT <= t)
+			break;
+		t = nextT;
+	}
+	std::sort(elements.begin(), elements.end());
+	elements.erase(std::unique(elements.begin(), elements.end()), elements.end());
+}
+
+/************************************************************************************************************************//**
+ * \brief Collects the basis functions with support on some elements
+ * \param elements The element indices, typically from getElementsCrossing()
+ * \param[out] functions Every function supported on any of the elements once, in the order they are iterated over in
+ *                       basis_. Refinement then splits them in the same order as when looping over all functions
+ ***************************************************************************************************************************/
+void LRSplineVolume::getSplitCandidates(const std::vector<int> &elements, std::vector<Basisfunction*> &functions) const {
+	functions.clear();
+	for(int i : elements)
+		for(Basisfunction *b : element_[i]->support())
+			functions.push_back(b);
+	basis_.sortByIterationOrder(functions);
+	functions.erase(std::unique(functions.begin(), functions.end()), functions.end());
+}
+
 void LRSplineVolume::split(int constDir, Basisfunction *b, double new_knot, int multiplicity, HashSet<Basisfunction*> &newFunctions) {
 #ifdef TIME_LRSPLINE
 	PROFILE("split()");
@@ -1337,7 +1805,7 @@ void LRSplineVolume::split(int constDir, Basisfunction *b, double new_knot, int
 
 	// create the new functions b1 and b2
 	Basisfunction *b1, *b2;
-	std::vector<double> knot = b->getknots(constDir);
+	LocalKnotVector knot = b->getknots(constDir);
 	int     p                = b->getOrder(constDir);
 	int     insert_index     = 0;
 	if(new_knot < knot[0] || knot[p] < new_knot)
@@ -1351,14 +1819,18 @@ void LRSplineVolume::split(int constDir, Basisfunction *b, double new_knot, int
 	newKnot[0] = new_knot;
 	std::sort(newKnot.begin(), newKnot.begin() + p+2);
 	if(constDir == 0) {
-		b1 = new Basisfunction(newKnot.begin()  ,  (*b)[1].begin(),  (*b)[2].begin(), b->cp(), b->dim(), order_[0], order_[1], order_[2], b->w()*alpha1);
-		b2 = new Basisfunction(newKnot.begin()+1,  (*b)[1].begin(),  (*b)[2].begin(), b->cp(), b->dim(), order_[0], order_[1], order_[2], b->w()*alpha2);
+		b1 = new (&basisPool_) Basisfunction(newKnot.begin()  ,  (*b)[1].begin(),  (*b)[2].begin(), b->cp(), b->dim(), order_[0], order_[1], order_[2], b->w()*alpha1);
+		b2 = new (&basisPool_) Basisfunction(newKnot.begin()+1,  (*b)[1].begin(),  (*b)[2].begin(), b->cp(), b->dim(), order_[0], order_[1], order_[2], b->w()*alpha2);
 	} else if(constDir == 1) {
-		b1 = new Basisfunction((*b)[0].begin(), newKnot.begin()   ,  (*b)[2].begin(), b->cp(), b->dim(), order_[0], order_[1], order_[2], b->w()*alpha1);
-		b2 = new Basisfunction((*b)[0].begin(), newKnot.begin()+1 ,  (*b)[2].begin(), b->cp(), b->dim(), order_[0], order_[1], order_[2], b->w()*alpha2);
+		b1 = new (&basisPool_) Basisfunction((*b)[0].begin(), newKnot.begin()   ,  (*b)[2].begin(), b->cp(), b->dim(), order_[0], order_[1], order_[2], b->w()*alpha1);
+		b2 = new (&basisPool_) Basisfunction((*b)[0].begin(), newKnot.begin()+1 ,  (*b)[2].begin(), b->cp(), b->dim(), order_[0], order_[1], order_[2], b->w()*alpha2);
 	} else { // insert in w
-		b1 = new Basisfunction((*b)[0].begin(), (*b)[1].begin(),  newKnot.begin()   , b->cp(), b->dim(), order_[0], order_[1], order_[2], b->w()*alpha1);
-		b2 = new Basisfunction((*b)[0].begin(), (*b)[1].begin(),  newKnot.begin()+1 , b->cp(), b->dim(), order_[0], order_[1], order_[2], b->w()*alpha2);
+		b1 = new (&basisPool_) Basisfunction((*b)[0].begin(), (*b)[1].begin(),  newKnot.begin()   , b->cp(), b->dim(), order_[0], order_[1], order_[2], b->w()*alpha1);
+		b2 = new (&basisPool_) Basisfunction((*b)[0].begin(), (*b)[1].begin(),  newKnot.begin()+1 , b->cp(), b->dim(), order_[0], order_[1], order_[2], b->w()*alpha2);
+	}
+	if(knotIndexing_) {
+		b1->indexKnots(knotTable_);
+		b2->indexKnots(knotTable_);
 	}
 
 	// add any brand new functions and detect their support elements
@@ -1472,24 +1944,23 @@ void LRSplineVolume::getGlobalUniqueKnotVector(std::vector<double> &knot_u, std:
 }
 
 void LRSplineVolume::updateSupport(Basisfunction *f,
-                                   std::vector<Element*>::iterator start,
-                                   std::vector<Element*>::iterator end ) {
+                                   Element* const *start,
+                                   Element* const *end ) {
 #ifdef TIME_LRSPLINE
 	PROFILE("update support");
 #endif
-	std::vector<Element*>::iterator it;
-	for(it=start; it!=end; it++)
+	for(Element* const *it=start; it!=end; it++)
 		if(f->addSupport(*it)) // this tests for overlapping as well as updating
 			(*it)->addSupportFunction(f);
 }
 
 void LRSplineVolume::updateSupport(Basisfunction *f) {
-	updateSupport(f, element_.begin(), element_.end());
+	updateSupport(f, element_.data(), element_.data() + element_.size());
 }
 
 bool LRSplineVolume::isLinearIndepByOverloading(bool verbose) {
 	std::vector<Basisfunction*>           overloaded;
-	std::vector<Element*>::iterator       eit;
+	BasisSupport::iterator                eit;
 	std::vector<int>                      singleElms;
 	std::vector<int>                      multipleElms;
 	std::vector<int>                      singleBasis;
@@ -2045,7 +2516,7 @@ bool LRSplineVolume::setControlPointsVDSA(const LRSplineVolume* lr) {
 	std::vector<double> u(3), newCP(3);
 	for(auto bit : this->getAllBasisfunctions()) {
 		bit->getGrevilleParameter(u);
-		std::vector<double>::iterator cp = (*bit).cp();
+		double *cp = (*bit).cp();
 		lr->point(newCP, u[0], u[1], u[2]);
 		for(int i=0; i<dim_; i++)
 			cp[i] = newCP[i];
@@ -2062,12 +2533,15 @@ void LRSplineVolume::aPosterioriFixElements() {
 		for(uint j=0; j<meshrect_.size(); j++) {
 			MeshRectangle *m = meshrect_[j];
 			if(m->splits(element_[i])) {
-				element_.push_back(element_[i]->split(m->constDirection(), m->constParameter()) );
+				element_.push_back(element_[i]->split(m->constDirection(), m->constParameter(), &elementPool_) );
+				updateElementCache(i, element_.size()-1);
 				i=-1;
 				break;
 			}
 		}
 	}
+	builtElementCache_ = false;
+	validBasisTable_   = false;
 }
 
 
@@ -2104,6 +2578,7 @@ void LRSplineVolume::read(std::istream &is) {
 
 	meshrect_.resize(nMeshRectangles);
 	element_.resize(nElements);
+	invalidateElementCache();
 	basisVector.resize(nBasis);
 	int allOrder[] = {order_[0], order_[1], order_[2]};
 
@@ -2117,7 +2592,7 @@ void LRSplineVolume::read(std::istream &is) {
 
 	// read all basisfunctions
 	for(int i=0; i<nBasis; i++) {
-		Basisfunction *b = new Basisfunction(dim_, 3, allOrder);
+		Basisfunction *b = new (&basisPool_) Basisfunction(dim_, 3, allOrder);
 		b->read(is);
 		basis_.insert(b);
 		basisVector[i] = b;
@@ -2132,7 +2607,7 @@ void LRSplineVolume::read(std::istream &is) {
 	}
 
 	for(int i=0; i<nMeshRectangles; i++) {
-		meshrect_[i] = new MeshRectangle();
+		meshrect_[i] = new (&meshrectPool_) MeshRectangle();
 		meshrect_[i]->read(is);
 	}
 
@@ -2146,7 +2621,7 @@ void LRSplineVolume::read(std::istream &is) {
 
 	// read elements and calculate patch boundaries
 	for(int i=0; i<nElements; i++) {
-		element_[i] = new Element();
+		element_[i] = new (&elementPool_) Element();
 		element_[i]->read(is);
 		element_[i]->updateBasisPointers(basisVector);
 		start_[0] = (element_[i]->getParmin(0) < start_[0]) ? element_[i]->getParmin(0) : start_[0];
@@ -2156,6 +2631,8 @@ void LRSplineVolume::read(std::istream &is) {
 		start_[2] = (element_[i]->getParmin(2) < start_[2]) ? element_[i]->getParmin(2) : start_[2];
 		end_[2]   = (element_[i]->getParmax(2) > end_[2]  ) ? element_[i]->getParmax(2) : end_[2]  ;
 	}
+	if(knotIndexing_)
+		setKnotIndexing(true);
 }
 
 void LRSplineVolume::write(std::ostream &os) const {
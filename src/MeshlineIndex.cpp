@@ -0,0 +1,214 @@
+#include "LRSpline/MeshlineIndex.h"
+#include "LRSpline/Meshline.h"
+#include "LRSpline/Basisfunction.h"
+#include <algorithm>
+#include <cfloat>
+
+namespace LR {
+
+// slack on the line extents in the queries. Is larger than the tolerances of Meshline::splits() and
+// LRSplineSurface::insert_line(), so that no line which the exact tests accept is left out
+static const double EXTENT_SLACK = 1e-12;
+
+MeshlineIndex::MeshlineIndex() {
+	nextOrder_ = 0;
+	size_      = 0;
+}
+
+/************************************************************************************************************************//**
+ * \brief Throws away the current content and indexes all lines, in the order they are given
+ ***************************************************************************************************************************/
+void MeshlineIndex::build(const std::vector<Meshline*> &lines) {
+	clear();
+	for(Meshline *m : lines) {
+		Entry entry = {m->start_, m->stop_, nextOrder_++, m, m->stop_};
+		bucket_[m->is_spanning_u()][m->const_par_].entries.push_back(entry);
+	}
+	// sort and set up the trees once per bucket, instead of once per line. Lines with the same start stay in the order
+	// they are given, as with insert()
+	for(int dir=0; dir<2; dir++) {
+		for(BucketMap::iterator it=bucket_[dir].begin(); it!=bucket_[dir].end(); ++it) {
+			std::vector<Entry> &entries = it->second.entries;
+			std::stable_sort(entries.begin(), entries.end(),
+				[](const Entry &a, const Entry &b) { return a.start < b.start; });
+			updateTree(entries, 0, entries.size());
+		}
+	}
+	size_ = lines.size();
+}
+
+/************************************************************************************************************************//**
+ * \brief Removes all lines from the index
+ ***************************************************************************************************************************/
+void MeshlineIndex::clear() {
+	bucket_[0].clear();
+	bucket_[1].clear();
+	nextOrder_ = 0;
+	size_      = 0;
+}
+
+/************************************************************************************************************************//**
+ * \brief Adds a line to the index, placing it after all lines already there
+ ***************************************************************************************************************************/
+void MeshlineIndex::insert(Meshline *line) {
+	add(line, nextOrder_++);
+}
+
+void MeshlineIndex::add(Meshline *line, long order) {
+	Bucket &bucket = bucket_[line->is_spanning_u()][line->const_par_];
+	Entry   entry  = {line->start_, line->stop_, order, line, line->stop_};
+	std::vector<Entry>::iterator pos = std::upper_bound(bucket.entries.begin(), bucket.entries.end(), entry,
+		[](const Entry &a, const Entry &b) { return a.start < b.start; });
+	bucket.entries.insert(pos, entry);
+	updateTree(bucket.entries, 0, bucket.entries.size());
+	size_++;
+}
+
+/************************************************************************************************************************//**
+ * \brief Removes a line from the index. Does nothing if the line is not there
+ ***************************************************************************************************************************/
+void MeshlineIndex::erase(Meshline *line) {
+	BucketMap::iterator it = bucket_[line->is_spanning_u()].find(line->const_par_);
+	if(it == bucket_[line->is_spanning_u()].end())
+		return;
+	std::vector<Entry> &entries = it->second.entries;
+	for(std::vector<Entry>::iterator e = entries.begin(); e != entries.end(); ++e) {
+		if(e->line == line) {
+			entries.erase(e);
+			size_--;
+			break;
+		}
+	}
+	if(entries.empty())
+		bucket_[line->is_spanning_u()].erase(it);
+	else
+		updateTree(entries, 0, entries.size());
+}
+
+/************************************************************************************************************************//**
+ * \brief Changes the start and stop parameter of an indexed line, keeping its place in the order of the lines
+ ***************************************************************************************************************************/
+void MeshlineIndex::setExtent(Meshline *line, double start, double stop) {
+	long order = nextOrder_;
+	BucketMap::iterator it = bucket_[line->is_spanning_u()].find(line->const_par_);
+	if(it != bucket_[line->is_spanning_u()].end())
+		for(const Entry &e : it->second.entries)
+			if(e.line == line)
+				order = e.order;
+	erase(line);
+	line->start_ = start;
+	line->stop_  = stop;
+	add(line, order);
+	if(order == nextOrder_)
+		nextOrder_++;
+}
+
+/************************************************************************************************************************//**
+ * \brief Recomputes the largest stop of every subtree of the entries [lo,hi)
+ * \details The entry in the middle of [lo,hi) is the root, and [lo,mid) and [mid+1,hi) are its subtrees
+ * \returns The largest stop of all entries in [lo,hi)
+ ***************************************************************************************************************************/
+double MeshlineIndex::updateTree(std::vector<Entry> &entries, int lo, int hi) {
+	if(lo >= hi)
+		return -DBL_MAX;
+	int mid = (lo + hi) / 2;
+	double left  = updateTree(entries, lo, mid);
+	double right = updateTree(entries, mid+1, hi);
+	entries[mid].maxStop = std::max(entries[mid].stop, std::max(left, right));
+	return entries[mid].maxStop;
+}
+
+/************************************************************************************************************************//**
+ * \brief Finds all entries in the subtree [lo,hi) which overlap [start,stop], i.e. starting before stop and ending after
+ *        start (see updateTree())
+ ***************************************************************************************************************************/
+void MeshlineIndex::searchTree(const std::vector<Entry> &entries, int lo, int hi, double start, double stop,
+                               std::vector<const Entry*> &found) {
+	while(lo < hi) {
+		int mid = (lo + hi) / 2;
+		if(entries[mid].maxStop < start - EXTENT_SLACK) // no line in this subtree reaches start
+			return;
+		searchTree(entries, lo, mid, start, stop, found);
+		if(entries[mid].start > stop + EXTENT_SLACK)    // neither this line nor the ones after it start before stop
+			return;
+		if(entries[mid].stop >= start - EXTENT_SLACK)
+			found.push_back(&entries[mid]);
+		lo = mid+1;
+	}
+}
+
+/************************************************************************************************************************//**
+ * \brief Finds all lines in the buckets [first,last) which overlap [start,stop], i.e. starting before stop and ending
+ *        after start
+ ***************************************************************************************************************************/
+void MeshlineIndex::collect(BucketMap::const_iterator first, BucketMap::const_iterator last, double start, double stop,
+                            std::vector<const Entry*> &found) {
+	for(BucketMap::const_iterator it=first; it!=last; ++it)
+		searchTree(it->second.entries, 0, it->second.entries.size(), start, stop, found);
+}
+
+/************************************************************************************************************************//**
+ * \brief Gives the lines found, in the order they were added to the index
+ ***************************************************************************************************************************/
+void MeshlineIndex::sortByOrder(std::vector<const Entry*> &found, std::vector<Meshline*> &lines) {
+	std::sort(found.begin(), found.end(), [](const Entry *a, const Entry *b) { return a->order < b->order; });
+	lines.clear();
+	for(const Entry *e : found)
+		lines.push_back(e->line);
+}
+
+/************************************************************************************************************************//**
+ * \brief Finds the lines which may overlap a given line
+ * \param span_u The direction of the line (see Meshline::is_spanning_u())
+ * \param const_par The constant parameter value of the line
+ * \param start The start of the line
+ * \param stop The end of the line
+ * \param tol The lines with constant parameter value within this distance of const_par are included
+ * \param[out] lines All lines in the same direction, with a constant parameter within tol, which overlap [start,stop]. May
+ *                   contain lines just outside this, but never leaves out any
+ ***************************************************************************************************************************/
+void MeshlineIndex::getOverlapping(bool span_u, double const_par, double start, double stop, double tol, std::vector<Meshline*> &lines) const {
+	static thread_local std::vector<const Entry*> found;
+	found.clear();
+	const BucketMap &buckets = bucket_[span_u];
+	collect(buckets.lower_bound(const_par-tol), buckets.upper_bound(const_par+tol), start, stop, found);
+	sortByOrder(found, lines);
+}
+
+/************************************************************************************************************************//**
+ * \brief Finds the lines which may split a basis function
+ * \param b The basis function
+ * \param[out] lines All lines with a constant parameter strictly inside the support of b, which may cover all of the support
+ *                   in the other direction. Meshline::splits() gives the exact answer
+ ***************************************************************************************************************************/
+void MeshlineIndex::getSplitting(const Basisfunction *b, std::vector<Meshline*> &lines) const {
+	static thread_local std::vector<const Entry*> found;
+	found.clear();
+	for(int span_u=0; span_u<2; span_u++) {
+		// lines spanning u have a constant v-value inside the v-support of b, and must cover all of its u-support. Asking for
+		// the lines overlapping the support reversed gives the ones starting before it starts and stopping after it stops
+		int    d      = span_u;
+		double parMin = (*b)[d][0];
+		double parMax = (*b)[d][b->getOrder(d)];
+		double start  = (*b)[1-d][b->getOrder(1-d)];
+		double stop   = (*b)[1-d][0];
+		const BucketMap &buckets = bucket_[span_u];
+		collect(buckets.upper_bound(parMin), buckets.lower_bound(parMax), start, stop, found);
+	}
+	sortByOrder(found, lines);
+}
+
+/************************************************************************************************************************//**
+ * \brief Returns the number of bytes used by the index
+ ***************************************************************************************************************************/
+size_t MeshlineIndex::memoryFootprint() const {
+	size_t bytes = sizeof(MeshlineIndex);
+	for(int d=0; d<2; d++) {
+		for(const BucketMap::value_type &bucket : bucket_[d])
+			// an estimate of the memory used by each map node
+			bytes += sizeof(BucketMap::value_type) + 4*sizeof(void*) + bucket.second.entries.capacity() * sizeof(Entry);
+	}
+	return bytes;
+}
+
+} // end namespace LR
@@ -20,7 +20,7 @@ namespace LR {
 Profiler* utl::profiler = 0;
 
 
-Profiler::Profiler (const std::string& name) : myName(name), nRunners(0)
+Profiler::Profiler (const std::string& name) : myName(name), myThread(std::this_thread::get_id()), nRunners(0)
 {
 	this->start("Total");
 
@@ -51,7 +51,22 @@ static double WallTime ()
 
 void Profiler::start (const std::string& funcName)
 {
-	Profile& p = myTimers[funcName];
+	if (std::this_thread::get_id() != myThread) return;
+
+	this->start(myTimers[funcName]);
+}
+
+
+void Profiler::start (const char* funcName)
+{
+	if (std::this_thread::get_id() != myThread) return;
+
+	this->start(*this->find(funcName,true));
+}
+
+
+void Profiler::start (Profile& p)
+{
 	if (p.running) return;
 
 	p.running = true;
@@ -64,16 +79,36 @@ void Profiler::start (const std::string& funcName)
 
 void Profiler::stop (const std::string& funcName)
 {
-	clock_t stopCPU = clock();
-	double stopWall = WallTime();
+	if (std::this_thread::get_id() != myThread) return;
 
 	std::map<std::string,Profile>::iterator it = myTimers.find(funcName);
 	if (it == myTimers.end())
 		std::cerr <<" *** No matching timer for "<< funcName << std::endl;
-	else if (it->second.running)
+	else
+		this->stop(it->second);
+}
+
+
+void Profiler::stop (const char* funcName)
+{
+	if (std::this_thread::get_id() != myThread) return;
+
+	Profile* p = this->find(funcName,false);
+	if (!p)
+		std::cerr <<" *** No matching timer for "<< funcName << std::endl;
+	else
+		this->stop(*p);
+}
+
+
+void Profiler::stop (Profile& p)
+{
+	clock_t stopCPU = clock();
+	double stopWall = WallTime();
+
+	if (p.running)
 	{
 		// Accumulate consumed CPU and wall time by this task
-		Profile& p = it->second;
 		double deltaCPU  = double(stopCPU - p.startCPU)/double(CLOCKS_PER_SEC);
 		double deltaWall = stopWall - p.startWall;
 		p.running = false;
@@ -89,6 +124,25 @@ void Profiler::stop (const std::string& funcName)
 }
 
 
+Profiler::Profile* Profiler::find (const char* funcName, bool create)
+{
+	// the name is usually a literal, but may be a buffer which is reused
+	// for other names, so the cached task is only used if the name matches
+	std::map<const char*,Timer>::iterator it = myLabels.find(funcName);
+	if (it != myLabels.end() && it->second->first.compare(funcName) == 0)
+		return &it->second->second;
+
+	Timer t = myTimers.find(funcName);
+	if (t == myTimers.end())
+	{
+		if (!create) return NULL;
+		t = myTimers.insert(std::make_pair(std::string(funcName),Profile())).first;
+	}
+	myLabels[funcName] = t;
+	return &t->second;
+}
+
+
 static bool use_ms = false; //!< Print mean times in microseconds?
 
 
@@ -0,0 +1,153 @@
+#include "LRSpline/QuadratureCache.h"
+#include "LRSpline/LRSpline.h"
+#include "LRSpline/Basisfunction.h"
+#include "LRSpline/Element.h"
+#include "LRSpline/BasisWorkspace.h"
+#include "LRSpline/Profiler.h"
+#include <algorithm>
+#include <iostream>
+#include <stdlib.h>
+
+typedef unsigned int uint;
+
+namespace LR {
+
+/************************************************************************************************************************//**
+ * \brief Constructor. Evaluates all basis functions at all quadrature points of all elements
+ * \param spline The spline to evaluate. Must be kept alive for as long as the cache is used
+ * \param points The reference quadrature points on [-1,1]^d stored as [point][parametric direction], i.e. (xi_0,eta_0,
+ *               xi_1,eta_1,...) for surfaces. The same rule is used on every element
+ * \param derivs Number of derivatives to store
+ ***************************************************************************************************************************/
+QuadratureCache::QuadratureCache(const LRSpline *spline, const std::vector<double> &points, int derivs) {
+	spline_  = spline;
+	points_  = points;
+	parDim_  = spline->nVariate();
+	derivs_  = derivs;
+	nRes_    = Basisfunction::nDerivatives(parDim_, derivs);
+	if(points.size() % parDim_ != 0) {
+		std::cerr << "QuadratureCache: number of reference coordinates (" << points.size() << ") is not a multiple of the parametric dimension\n";
+		exit(9401);
+	}
+	nQP_     = points.size() / parDim_;
+	offset_.resize(1, 0);
+	update();
+}
+
+/************************************************************************************************************************//**
+ * \brief Brings the cache up to date with the current state of the spline, typically called after refinement
+ * \returns The number of elements which had to be evaluated
+ * \details Elements are recognized by their revision (see Element::revision()), so only new elements and elements which
+ *          have been split or had functions added or removed are evaluated. The values of all other elements are copied
+ *          into the new arena as they are. Changes to the control points do not affect the cache.
+ ***************************************************************************************************************************/
+int QuadratureCache::update() {
+#ifdef TIME_LRSPLINE
+	PROFILE("QuadratureCache::update()");
+#endif
+	const std::vector<Element*> &elements = spline_->getAllElements();
+	int nEl = elements.size();
+
+	// lay out the new arena
+	std::vector<size_t> offset(nEl+1);
+	std::vector<char>   valid(nEl);
+	offset[0] = 0;
+	for(int i=0; i<nEl; i++) {
+		valid[i]    = i < (int) element_.size() && element_[i] == elements[i] && revision_[i] == elements[i]->revision();
+		offset[i+1] = offset[i] + elements[i]->nBasisFunctions();
+	}
+	std::vector<Basisfunction*> functions(offset[nEl]);
+	std::vector<double>         values(offset[nEl]*nQP_*nRes_);
+
+	// move over everything unchanged
+	size_t block = nQP_*nRes_;
+	for(int i=0; i<nEl; i++) {
+		if(!valid[i])
+			continue;
+		std::copy(functions_.begin() + offset_[i],       functions_.begin() + offset_[i+1],       functions.begin() + offset[i]);
+		std::copy(values_.begin()    + offset_[i]*block, values_.begin()    + offset_[i+1]*block, values.begin()    + offset[i]*block);
+	}
+
+	element_.resize(nEl);
+	revision_.resize(nEl);
+	offset_.swap(offset);
+	functions_.swap(functions);
+	values_.swap(values);
+
+	// and evaluate the rest
+	int nEvaluated = 0;
+	for(int i=0; i<nEl; i++) {
+		if(valid[i])
+			continue;
+		element_[i]  = elements[i];
+		revision_[i] = elements[i]->revision();
+		std::copy(elements[i]->constSupportBegin(), elements[i]->constSupportEnd(), functions_.begin() + offset_[i]);
+		evaluateElement(&values_[offset_[i]*block], i);
+		nEvaluated++;
+	}
+	return nEvaluated;
+}
+
+/************************************************************************************************************************//**
+ * \brief Evaluates all functions on one element at all quadrature points
+ * \param out [out] Storage for the element, as [quadrature point][local function][derivative]
+ * \param iEl The element index
+ ***************************************************************************************************************************/
+void QuadratureCache::evaluateElement(double *out, int iEl) const {
+	BasisWorkspace &workspace = BasisWorkspace::local();
+	const Element *el = element_[iEl];
+	int nFun = nBasisFunctions(iEl);
+	double parPt[3];
+	bool   fromRight[3];
+	for(int q=0; q<nQP_; q++) {
+		for(int d=0; d<parDim_; d++) {
+			double xi    = points_[q*parDim_ + d];
+			parPt[d]     = el->getParmin(d) + (xi+1)/2 * (el->getParmax(d)-el->getParmin(d));
+			fromRight[d] = parPt[d] != spline_->endparam(d);
+		}
+		spline_->computeElementBasis(out + q*nFun*nRes_, parPt, derivs_, fromRight, functions(iEl), nFun, workspace);
+	}
+}
+
+/************************************************************************************************************************//**
+ * \brief Evaluates a (multi-component) field from the cached basis values at one quadrature point
+ * \param out [out] The result stored as [nDerivatives()][nComp]
+ * \param iEl The element index
+ * \param qp The quadrature point on the element
+ * \param coefs The coefficients of all basis functions, indexed by the basis function id (see LRSpline::generateIDs())
+ * \param nComp The number of components (fields) for each basis function
+ * \param layout If coefs is stored as [nBasisFunctions()][nComp] (ROW_MAJOR) or [nComp][nBasisFunctions()] (COLUMN_MAJOR)
+ * \details The result is identical to LRSplineSurface::pointField() and LRSplineVolume::pointField() at the same point. The
+ *          basis function ids are renumbered on first use after refinement
+ ***************************************************************************************************************************/
+void QuadratureCache::evaluateField(double *out, int iEl, int qp, const double *coefs, int nComp, coefficientLayout layout) const {
+	std::fill(out, out + nRes_*nComp, 0.0);
+	spline_->requireBasisTable(); // makes sure the basis function ids are up to date
+	const double        *basis_ev = values(iEl, qp);
+	Basisfunction* const *fun     = functions(iEl);
+	size_t nBasis = spline_->nBasisFunctions();
+	for(int f=0; f<nBasisFunctions(iEl); f++) {
+		size_t id = fun[f]->getId();
+		const double *c = (layout == ROW_MAJOR) ? coefs + id*nComp : coefs + id;
+		size_t stride   = (layout == ROW_MAJOR) ? 1                : nBasis;
+		for(int i=0; i<nRes_; i++)
+			for(int j=0; j<nComp; j++)
+				out[i*nComp+j] += basis_ev[i]*c[j*stride];
+		basis_ev += nRes_;
+	}
+}
+
+/************************************************************************************************************************//**
+ * \brief Returns the number of bytes of heap memory allocated by the cache (including its bookkeeping)
+ ***************************************************************************************************************************/
+size_t QuadratureCache::memoryFootprint() const {
+	return sizeof(QuadratureCache)                                 +
+	       points_.capacity()    * sizeof(double)                  +
+	       element_.capacity()   * sizeof(const Element*)          +
+	       revision_.capacity()  * sizeof(unsigned long long)      +
+	       offset_.capacity()    * sizeof(size_t)                  +
+	       functions_.capacity() * sizeof(Basisfunction*)          +
+	       values_.capacity()    * sizeof(double);
+}
+
+} // end namespace LR
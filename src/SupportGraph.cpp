@@ -0,0 +1,101 @@
+#include "LRSpline/SupportGraph.h"
+#include "LRSpline/LRSpline.h"
+#include "LRSpline/Basisfunction.h"
+#include "LRSpline/Element.h"
+#include "LRSpline/Profiler.h"
+#include <algorithm>
+#include <thread>
+
+namespace LR {
+
+/************************************************************************************************************************//**
+ * \brief Calls work(first, last) on consecutive ranges covering [0,n), on up to nThreads threads at once
+ ***************************************************************************************************************************/
+template <typename Work>
+static void parallelRanges(int n, int nThreads, Work work) {
+	if(nThreads <= 1 || n <= nThreads) {
+		work(0, n);
+		return;
+	}
+	std::vector<std::thread> threads;
+	int chunk = (n + nThreads - 1) / nThreads;
+	for(int first=0; first<n; first+=chunk)
+		threads.push_back(std::thread(work, first, std::min(first+chunk, n)));
+	for(std::thread &t : threads)
+		t.join();
+}
+
+/************************************************************************************************************************//**
+ * \brief Builds the offsets of a CSR structure from the number of entries in each row
+ * \param[in,out] offset The length of row i in offset[i+1] on input, and the start of row i in offset[i] on output
+ ***************************************************************************************************************************/
+static void prefixSum(std::vector<size_t> &offset) {
+	offset[0] = 0;
+	for(size_t i=1; i<offset.size(); i++)
+		offset[i] += offset[i-1];
+}
+
+/************************************************************************************************************************//**
+ * \brief Constructor. Builds both directions of the support graph of the spline in its current state
+ * \param spline The spline. Is not referred to after construction
+ * \param nThreads The number of threads to build with
+ * \details Calls LRSpline::generateIDs(), so the spline must not be used by other threads during construction. Each
+ *          direction is built in two passes over the spline objects, first counting the row lengths and then filling in the
+ *          rows, where both passes are split between the threads.
+ ***************************************************************************************************************************/
+SupportGraph::SupportGraph(const LRSpline *spline, int nThreads) {
+#ifdef TIME_LRSPLINE
+	PROFILE("SupportGraph()");
+#endif
+	spline->generateIDs();
+	const std::vector<Element*> &elements = spline->getAllElements();
+	int nEl    = elements.size();
+	int nBasis = spline->nBasisFunctions();
+	std::vector<const Basisfunction*> functions(nBasis);
+	for(int i=0; i<nBasis; i++)
+		functions[i] = spline->getBasisfunction(i);
+
+	elementOffset_.resize(nEl+1);
+	basisOffset_.resize(nBasis+1);
+	parallelRanges(nEl, nThreads, [&](int first, int last) {
+		for(int i=first; i<last; i++)
+			elementOffset_[i+1] = elements[i]->nBasisFunctions();
+	});
+	parallelRanges(nBasis, nThreads, [&](int first, int last) {
+		for(int i=first; i<last; i++)
+			basisOffset_[i+1] = functions[i]->nSupportedElements();
+	});
+	prefixSum(elementOffset_);
+	prefixSum(basisOffset_);
+
+	elementIndex_.resize(elementOffset_[nEl]);
+	basisIndex_.resize(basisOffset_[nBasis]);
+	parallelRanges(nEl, nThreads, [&](int first, int last) {
+		for(int i=first; i<last; i++) {
+			int *row = &elementIndex_[0] + elementOffset_[i];
+			int  k   = 0;
+			for(const Basisfunction *b : elements[i]->support())
+				row[k++] = b->getId();
+			std::sort(row, row+k);
+		}
+	});
+	parallelRanges(nBasis, nThreads, [&](int first, int last) {
+		for(int i=first; i<last; i++) {
+			int *row = &basisIndex_[0] + basisOffset_[i];
+			int  k   = 0;
+			for(const Element *el : functions[i]->support())
+				row[k++] = el->getId();
+			std::sort(row, row+k);
+		}
+	});
+}
+
+/************************************************************************************************************************//**
+ * \brief Returns the number of bytes used by the snapshot
+ ***************************************************************************************************************************/
+size_t SupportGraph::memoryFootprint() const {
+	return sizeof(SupportGraph) + (elementOffset_.capacity() + basisOffset_.capacity()) * sizeof(size_t)
+	                            + (elementIndex_.capacity()  + basisIndex_.capacity())  * sizeof(int);
+}
+
+} // end namespace LR
@@ -0,0 +1,117 @@
+#ifndef UNIVARIATE_KERNEL_H
+#define UNIVARIATE_KERNEL_H
+
+/************************************************************************************************************************//**
+ * \file UnivariateKernel.h
+ * \brief Vectorized Cox-de Boor recursion, private to the library
+ * \details The kernel is written once as a template over a small register abstraction V, and instantiated in one
+ *          translation unit per instruction set (BasisfunctionSSE2.cpp, BasisfunctionAVX2.cpp, BasisfunctionAVX512.cpp), each
+ *          compiled with its own target flags. Basisfunction::evaluateUnivariate() picks the widest one supported by the
+ *          running CPU. Only raw pointers pass through this interface, so that no inline library code is instantiated with
+ *          instructions the CPU may not have.
+ *
+ *          A register abstraction V provides
+ *            - V::width, the number of double lanes
+ *            - V::reg and V::mask, the register and comparison mask types
+ *            - load, store, set1, add, sub, mul, div
+ *            - le, lt, eq (comparisons returning V::mask), both (logical and of two masks) and select(mask, a, b)
+ ***************************************************************************************************************************/
+
+namespace LR {
+
+typedef void (*UnivariateKernel)(double *values, char *inside, const double *knot, int order, const double *t,
+                                 const bool *from_right, int nPts, int derivs, double *scratch);
+
+void univariateSSE2  (double *values, char *inside, const double *knot, int order, const double *t, const bool *from_right, int nPts, int derivs, double *scratch);
+void univariateAVX2  (double *values, char *inside, const double *knot, int order, const double *t, const bool *from_right, int nPts, int derivs, double *scratch);
+void univariateAVX512(double *values, char *inside, const double *knot, int order, const double *t, const bool *from_right, int nPts, int derivs, double *scratch);
+
+/************************************************************************************************************************//**
+ * \brief Number of doubles of scratch memory needed by univariateSIMD
+ ***************************************************************************************************************************/
+inline int univariateScratchSize(int order, int derivs, int width) {
+	int levels = (derivs < order-1) ? derivs+1 : order;
+	return levels*order*width;
+}
+
+/************************************************************************************************************************//**
+ * \brief Evaluates one univariate B-spline and its derivatives at many points, V::width points at a time
+ * \param values [out] Array of nPts*(derivs+1) values stored as [nPts][derivs+1]
+ * \param inside [out] Array of nPts flags; if the point is inside the support of the B-spline
+ * \param knot The local knot vector, of length order+1
+ * \param order Polynomial order (degree+1)
+ * \param t The parametric evaluation points
+ * \param from_right Evaluate each point in the limit from the right
+ * \param nPts The number of evaluation points
+ * \param derivs Number of derivatives requested
+ * \param scratch Memory of at least univariateScratchSize(order, derivs, V::width) doubles
+ * \details Performs exactly the same floating point operations, in the same order, as the scalar version
+ *          Basisfunction::evaluateUnivariate(). All branching on the knot values is done once for all lanes, and only the
+ *          initial indicator function depends on the point itself. Points outside the support evaluate to zero.
+ ***************************************************************************************************************************/
+template <class V>
+inline void univariateSIMD(double *values, char *inside, const double *knot, int order, const double *t,
+                           const bool *from_right, int nPts, int derivs, double *scratch) {
+	typedef typename V::reg  reg;
+	typedef typename V::mask mask;
+	const int W = V::width;
+	int p = order-1;
+
+	// diff level 0 is the function values themselves (same aliasing as in the scalar version)
+	double *ans = scratch;
+	double tLane[W];
+	double rightLane[W];
+
+	for(int i0=0; i0<nPts; i0+=W) {
+		int n0 = (nPts-i0 < W) ? nPts-i0 : W;
+		for(int l=0; l<W; l++) { // pad the last chunk with a harmless point
+			tLane[l]     = (l<n0) ? t[i0+l] : knot[0];
+			rightLane[l] = (l<n0 && !from_right[i0+l]) ? 0.0 : 1.0;
+		}
+		reg  tt    = V::load(tLane);
+		mask right = V::eq(V::load(rightLane), V::set1(1.0));
+		reg  one   = V::set1(1.0);
+		reg  zero  = V::set1(0.0);
+
+		for(int j=0; j<order; j++) {
+			reg  k0 = V::set1(knot[j]);
+			reg  k1 = V::set1(knot[j+1]);
+			reg  fromRight = V::select(V::both(V::le(k0, tt), V::lt(tt, k1)), one, zero);
+			reg  fromLeft  = V::select(V::both(V::lt(k0, tt), V::le(tt, k1)), one, zero);
+			V::store(ans + j*W, V::select(right, fromRight, fromLeft));
+		}
+
+		int diff_level = p;
+		for(int n=1; n<order; n++, diff_level--) {
+			if(diff_level <= derivs) {
+				double *diff = scratch + diff_level*order*W;
+				for(int j=0; j<=diff_level; j++)
+					V::store(diff + j*W, V::load(ans + j*W));
+			}
+			for(int d = diff_level; d <= derivs && d <= p; d++) {
+				double *diff = scratch + d*order*W;
+				for(int j=0; j<order-n; j++) {
+					reg a = (knot[ j+n ]==knot[ j ]) ? zero : V::mul(V::set1(n/(knot[j+n]  -knot[ j ])), V::load(diff +  j   *W));
+					reg b = (knot[j+n+1]==knot[j+1]) ? zero : V::mul(V::set1(n/(knot[j+n+1]-knot[j+1])), V::load(diff + (j+1)*W));
+					V::store(diff + j*W, V::sub(a, b));
+				}
+			}
+			for(int j=0; j<order-n; j++) {
+				reg a = (knot[ j+n ]==knot[ j ]) ? zero : V::mul(V::div(V::sub(tt, V::set1(knot[j])),     V::set1(knot[j+n]  -knot[ j ])), V::load(ans +  j   *W));
+				reg b = (knot[j+n+1]==knot[j+1]) ? zero : V::mul(V::div(V::sub(V::set1(knot[j+n+1]), tt), V::set1(knot[j+n+1]-knot[j+1])), V::load(ans + (j+1)*W));
+				V::store(ans + j*W, V::add(a, b));
+			}
+		}
+
+		for(int l=0; l<n0; l++) {
+			double *val = values + (i0+l)*(derivs+1);
+			for(int d=0; d<=derivs; d++) // derivatives higher than the degree vanish
+				val[d] = (d > p) ? 0 : scratch[d*order*W + l];
+			inside[i0+l] = !(knot[0] > tLane[l] || tLane[l] > knot[order]);
+		}
+	}
+}
+
+} // end namespace LR
+
+#endif